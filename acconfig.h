@@ -7,3 +7,18 @@
 #undef OS
 #undef USE_MD5
 #undef DEF_SERVICE
+#undef USE_HELP
+#undef USE_EZIP
+#undef USE_PGPOW
+#undef USE_JUSTL
+#undef USE_DHS
+#undef USE_DYNDNS
+#undef USE_ODS
+#undef USE_TZO
+#undef USE_GNUDIP
+#undef USE_EASYDNS
+#undef USE_EASYDNS_PARTNER
+#undef USE_DYNS
+#undef USE_HN
+#undef USE_ZONEEDIT
+#undef USE_HEIPV6TB
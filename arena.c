@@ -0,0 +1,298 @@
+/* ============================================================================
+ * Copyright (C) 2001 Angus Mackay. All rights reserved; 
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2, or (at your option)
+ * any later version.
+ *
+ * THIS SOFTWARE IS PROVIDED ``AS IS'' AND ANY EXPRESSED OR IMPLIED WARRANTIES,
+ * INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND
+ * FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE
+ * AUTHOR BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY,
+ * OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ * ============================================================================
+ */
+
+/*
+ * arena.c
+ *
+ * an arena is a list of blocks, the newest first, and memory is cut off
+ * the front of the newest block until it runs out.  a request bigger than
+ * the block size gets a block to itself.
+ *
+ * resetting an arena that had to grow past one block frees the lot and
+ * keeps a single block as big as the most that was ever in use, so an
+ * arena that is reset after every update settles after the first one and
+ * never calls malloc() again.
+ *
+ */
+
+#ifdef HAVE_CONFIG_H
+#  include <config.h>
+#endif
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <arena.h>
+
+union arena_align
+{
+  long l;
+  double d;
+  void *p;
+};
+
+#define ALIGN sizeof(union arena_align)
+#define ROUND(n) (((n) + ALIGN - 1) & ~(ALIGN - 1))
+
+struct arena_block
+{
+  struct arena_block *next;
+  size_t size;
+  size_t used;
+};
+
+#define BLOCK_HEADER ROUND(sizeof(struct arena_block))
+#define BLOCK_DATA(b) ((char *)(b) + BLOCK_HEADER)
+
+static unsigned long heap_bytes = 0;
+static unsigned long heap_blocks = 0;
+static unsigned long heap_mallocs = 0;
+
+// the library's own switch, it doesn't see the program's options
+static int debug = 0;
+
+#ifdef DEBUG
+#define dprintf(x) if( debug ) \
+{ \
+  fprintf(stderr, "%s,%d: ", __FILE__, __LINE__); \
+    fprintf x; \
+}
+#else
+#  define dprintf(x)
+#endif
+
+// arenas of sessions on different threads share the totals
+#ifdef __GNUC__
+#  define COUNT(var, n) __sync_fetch_and_add(&(var), (n))
+#else
+#  define COUNT(var, n) ((var) += (n))
+#endif
+
+static struct arena_block *new_block(struct arena *a, size_t size)
+{
+  struct arena_block *b;
+
+  if((b=malloc(BLOCK_HEADER + size)) == NULL)
+  {
+    return(NULL);
+  }
+  b->next = NULL;
+  b->size = size;
+  b->used = 0;
+
+  a->nblocks++;
+  a->size += size;
+  COUNT(heap_bytes, size);
+  COUNT(heap_blocks, 1);
+  COUNT(heap_mallocs, 1);
+
+  return(b);
+}
+
+static void free_blocks(struct arena *a)
+{
+  struct arena_block *b;
+
+  while((b=a->blocks) != NULL)
+  {
+    a->blocks = b->next;
+    COUNT(heap_bytes, -b->size);
+    COUNT(heap_blocks, -1);
+    free(b);
+  }
+  a->nblocks = 0;
+  a->size = 0;
+}
+
+/*
+ * arena_alloc
+ *
+ * returns n bytes, suitably aligned for anything, or NULL if malloc()
+ * fails.
+ */
+void *arena_alloc(struct arena *a, size_t n)
+{
+  struct arena_block *b;
+  void *p;
+
+  n = ROUND(n ? n : 1);
+  b = a->blocks;
+  if(b == NULL || b->size - b->used < n)
+  {
+    if(n > a->block_size)
+    {
+      // a block of its own, behind the current one so that keeps filling
+      if((b=new_block(a, n)) == NULL)
+      {
+        return(NULL);
+      }
+      if(a->blocks)
+      {
+        b->next = a->blocks->next;
+        a->blocks->next = b;
+      }
+      else
+      {
+        a->blocks = b;
+      }
+    }
+    else
+    {
+      if((b=new_block(a, a->block_size)) == NULL)
+      {
+        return(NULL);
+      }
+      b->next = a->blocks;
+      a->blocks = b;
+    }
+  }
+
+  p = BLOCK_DATA(b) + b->used;
+  b->used += n;
+  a->used += n;
+  if(a->used > a->peak) { a->peak = a->used; }
+  a->allocs++;
+
+  return(p);
+}
+
+char *arena_strdup(struct arena *a, const char *s)
+{
+  size_t n = strlen(s) + 1;
+  char *p;
+
+  if((p=arena_alloc(a, n)) != NULL)
+  {
+    memcpy(p, s, n);
+  }
+  return(p);
+}
+
+/*
+ * arena_realloc
+ *
+ * p must be NULL or have come from arena_realloc() or arena_string() on
+ * the same arena.  these keep their capacity just in front of them, so p
+ * comes straight back if it already holds n bytes, otherwise the contents
+ * are copied to new space and the old space is simply abandoned.
+ */
+void *arena_realloc(struct arena *a, void *p, size_t n)
+{
+  size_t *cap;
+  size_t old = 0;
+  char *q;
+
+  if(p != NULL)
+  {
+    old = *(size_t *)((char *)p - ALIGN);
+    if(old >= n)
+    {
+      return(p);
+    }
+  }
+
+  if((cap=arena_alloc(a, ALIGN + n)) == NULL)
+  {
+    return(NULL);
+  }
+  *cap = ROUND(n ? n : 1);
+  q = (char *)cap + ALIGN;
+  if(p != NULL)
+  {
+    memcpy(q, p, old);
+  }
+
+  return(q);
+}
+
+/*
+ * arena_string
+ *
+ * set *var to a copy of s, in the storage *var already has if it is big
+ * enough.  a NULL s makes *var NULL.
+ */
+char *arena_string(struct arena *a, char **var, const char *s)
+{
+  size_t n;
+  char *p;
+
+  if(s == NULL)
+  {
+    return(*var = NULL);
+  }
+
+  n = strlen(s) + 1;
+  if((p=arena_realloc(a, *var, n)) == NULL)
+  {
+    return(NULL);
+  }
+  memmove(p, s, n);
+
+  return(*var = p);
+}
+
+void arena_reset(struct arena *a)
+{
+  size_t peak;
+
+  a->resets++;
+  a->used = 0;
+
+  if(a->nblocks > 1)
+  {
+    peak = ROUND(a->peak);
+    dprintf((stderr, "arena: %lu blocks, folding into one of %lu bytes\n",
+          a->nblocks, (unsigned long)peak));
+    free_blocks(a);
+    a->blocks = new_block(a, peak > a->block_size ? peak : a->block_size);
+  }
+  else if(a->blocks)
+  {
+    a->blocks->used = 0;
+  }
+}
+
+void arena_free(struct arena *a)
+{
+  free_blocks(a);
+  a->used = 0;
+}
+
+void arena_set_debug(int on)
+{
+  debug = on;
+}
+
+unsigned long arena_heap_bytes(void)
+{
+  return(heap_bytes);
+}
+
+unsigned long arena_heap_blocks(void)
+{
+  return(heap_blocks);
+}
+
+unsigned long arena_heap_mallocs(void)
+{
+  return(heap_mallocs);
+}
@@ -0,0 +1,76 @@
+/* ============================================================================
+ * Copyright (C) 2001 Angus Mackay. All rights reserved; 
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2, or (at your option)
+ * any later version.
+ *
+ * THIS SOFTWARE IS PROVIDED ``AS IS'' AND ANY EXPRESSED OR IMPLIED WARRANTIES,
+ * INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND
+ * FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE
+ * AUTHOR BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY,
+ * OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ * ============================================================================
+ */
+
+
+/*
+ * arena.h
+ *
+ * bump allocation for strings and buffers that all die together.
+ *
+ * an arena hands out memory from large blocks and only gives it back when
+ * the whole arena is reset or freed.  each update session keeps one arena
+ * for the length of an update and resets it afterwards, and the daemon
+ * keeps one for configuration strings that lives as long as the process.
+ *
+ * strings that get replaced over and over (the configuration values, the
+ * current address) are set with arena_string(), which reuses the old
+ * storage whenever the new value fits so that re-reading the config file
+ * or a changing address does not make the arena grow.
+ *
+ */
+
+#ifndef _ARENA_H
+#define _ARENA_H
+
+#include <stddef.h>
+
+struct arena_block;
+
+struct arena
+{
+  struct arena_block *blocks;
+  size_t block_size;
+
+  // counters
+  unsigned long nblocks;
+  unsigned long size;
+  unsigned long used;
+  unsigned long peak;
+  unsigned long allocs;
+  unsigned long resets;
+};
+
+#define ARENA_INIT(block_size) { NULL, (block_size), 0, 0, 0, 0, 0, 0 }
+
+extern void *arena_alloc(struct arena *a, size_t n);
+extern char *arena_strdup(struct arena *a, const char *s);
+extern void *arena_realloc(struct arena *a, void *p, size_t n);
+extern char *arena_string(struct arena *a, char **var, const char *s);
+extern void arena_reset(struct arena *a);
+extern void arena_free(struct arena *a);
+extern void arena_set_debug(int on);
+
+// totals over every arena in the process
+extern unsigned long arena_heap_bytes(void);
+extern unsigned long arena_heap_blocks(void);
+extern unsigned long arena_heap_mallocs(void);
+
+#endif
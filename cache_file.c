@@ -22,6 +22,10 @@
 /*
  * cache_file.c
  *
+ * the cache is "<date>,<address>" on the first line.  a second line,
+ * "spread=<seconds>", keeps the job's place in the refresh spread window
+ * across restarts, older versions just don't read it.
+ *
  */
 
 
@@ -41,13 +45,12 @@
 #endif
 
 #include <cache_file.h>
+#include <probes.h>
 
 #if HAVE_STRERROR
-extern int errno;
 #  define error_string strerror(errno)
 #elif HAVE_SYS_ERRLIST
 extern const char *const sys_errlist[];
-extern int errno;
 #  define error_string (sys_errlist[errno])
 #else
 #  define error_string "error message not found"
@@ -63,11 +66,9 @@ extern int errno;
 #  define dprintf(x)
 #endif
 #if HAVE_STRERROR
-extern int errno;
 #  define error_string strerror(errno)
 #elif HAVE_SYS_ERRLIST
 extern const char *const sys_errlist[];
-extern int errno;
 #  define error_string (sys_errlist[errno])
 #else
 #  define error_string "error message not found"
@@ -77,7 +78,7 @@ extern int errno;
 
 extern int options;
 
-int read_cache_file(char *file, time_t *date, char **ipaddr)
+int read_cache_file(char *file, time_t *date, char **ipaddr, int *spread)
 {
   FILE *fp = NULL;
   char buf[BUFSIZ+1];
@@ -94,6 +95,7 @@ int read_cache_file(char *file, time_t *date, char **ipaddr)
   // indicate failure
   *date = 0;
   *ipaddr = NULL;
+  *spread = -1;
 
 #if HAVE_STAT
   if(stat(file, &st) != 0)
@@ -136,6 +138,12 @@ int read_cache_file(char *file, time_t *date, char **ipaddr)
 
     *date = strtoul(datestr, NULL, 10);
     *ipaddr = strdup(ipstr);
+
+    if(fgets(buf, BUFSIZ, fp) != NULL &&
+        sscanf(buf, "spread=%d", spread) != 1)
+    {
+      *spread = -1;
+    }
   }
   else
   {
@@ -153,7 +161,7 @@ ERR:
   return(-1);
 }
 
-int write_cache_file(char *file, time_t date, char *ipaddr)
+int write_cache_file(char *file, time_t date, char *ipaddr, int spread)
 {
   FILE *fp = NULL;
 
@@ -163,6 +171,11 @@ int write_cache_file(char *file, time_t date, char *ipaddr)
   }
 
   fprintf(fp, "%ld,%s\n", date, ipaddr);
+  if(spread >= 0)
+  {
+    fprintf(fp, "spread=%d\n", spread);
+  }
+  PROBE3(cache__write, file, ipaddr, date);
 
   fclose(fp);
 
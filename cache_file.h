@@ -31,7 +31,9 @@
 #  include <sys/time.h>
 #endif
 
-extern int read_cache_file(char *file, time_t *date, char **ipaddr);
-extern int write_cache_file(char *file, time_t date, char *ipaddr);
+extern int read_cache_file(char *file, time_t *date, char **ipaddr,
+    int *spread);
+extern int write_cache_file(char *file, time_t date, char *ipaddr,
+    int spread);
 
 #endif
@@ -0,0 +1,249 @@
+/* ============================================================================
+ * Copyright (C) 2001 Angus Mackay. All rights reserved; 
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2, or (at your option)
+ * any later version.
+ *
+ * THIS SOFTWARE IS PROVIDED ``AS IS'' AND ANY EXPRESSED OR IMPLIED WARRANTIES,
+ * INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND
+ * FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE
+ * AUTHOR BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY,
+ * OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ * ============================================================================
+ */
+
+/*
+ * change.c
+ *
+ * what matters about an address change is how long it takes to be visible
+ * in DNS, not just how long the HTTP request took.  each change gets an id
+ * when it is first seen, which it keeps while it settles and through the
+ * retries until the provider acknowledges it.  after that, if watching is
+ * on, the host's nameservers are polled (backing off from
+ * CHANGE_POLL_FIRST to CHANGE_POLL_MAX seconds) until the new record is
+ * there or the time given to change_watch() is up.  the polls run from
+ * the event loop, the daemon doesn't stop for their answers.
+ *
+ * both stages go into the per provider histograms in metrics.c and every
+ * step is logged with the id, so one change can be followed through the
+ * log.
+ *
+ */
+
+#ifdef HAVE_CONFIG_H
+#  include <config.h>
+#endif
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#if HAVE_SYS_TYPES_H
+#  include <sys/types.h>
+#endif
+#include <sys/time.h>
+#include <time.h>
+
+#include <dprintf.h>
+#include <event.h>
+#include <logger.h>
+#include <dnscheck.h>
+#include <metrics.h>
+#include <change.h>
+
+struct change
+{
+  char id[32];
+  char address[128];
+  struct timeval detected;
+  struct timeval acked;
+  // for the DNS polls after the acknowledgement
+  char service[32];
+  char host[256];
+  char v4[32];
+  char v6[64];
+  int interval;
+};
+
+static int watch_time = 0;
+static void (*recorded)(void) = NULL;
+static unsigned int seq = 0;
+// the change not yet acknowledged and the one waiting to show up in DNS
+static struct change pending;
+static struct change unseen;
+
+/*
+ * change_watch
+ *
+ * poll DNS for up to seconds after each acknowledged change, 0 to not
+ */
+void change_watch(int seconds)
+{
+  watch_time = seconds > 0 ? seconds : 0;
+}
+
+/*
+ * change_on_record
+ *
+ * have cb called when a change that was being watched for in DNS has
+ * been timed or given up on, to write out the metrics
+ */
+void change_on_record(void (*cb)(void))
+{
+  recorded = cb;
+}
+
+/*
+ * change_detected
+ *
+ * the address is now address (text from addresses_text()), returns the id
+ * of the change, which is the pending one's if it was to the same address
+ */
+char *change_detected(char *address)
+{
+  if(*pending.id != '\0' && strcmp(pending.address, address) == 0)
+  {
+    return(pending.id);
+  }
+  if(*pending.id != '\0')
+  {
+    logger_kv(LOG_INFO, "change", "change", pending.id, "result",
+        "superseded", NULL);
+  }
+
+  memset(&pending, 0, sizeof(pending));
+  gettimeofday(&pending.detected, NULL);
+  snprintf(pending.id, sizeof(pending.id), "%lx-%u",
+      (unsigned long)pending.detected.tv_sec, ++seq);
+  snprintf(pending.address, sizeof(pending.address), "%s", address);
+  logger_kv(LOG_INFO, "change", "change", pending.id, "address", address,
+      "result", "detected", NULL);
+
+  return(pending.id);
+}
+
+/* the id of the pending change, "" if there isn't one */
+char *change_id(void)
+{
+  return(pending.id);
+}
+
+/*
+ * change_dropped
+ *
+ * the pending change won't be sent, the address went back or DNS had it
+ * already
+ */
+void change_dropped(char *why)
+{
+  if(*pending.id != '\0')
+  {
+    logger_kv(LOG_INFO, "change", "change", pending.id, "result", why, NULL);
+  }
+  memset(&pending, 0, sizeof(pending));
+}
+
+static void poll_dns(void *arg);
+
+/* the watched change isn't coming, or can't be looked for any more */
+static void give_up(void)
+{
+  metrics_unseen(unseen.service);
+  logger_kv(LOG_NOTICE, "change", "change", unseen.id, "result", "unseen",
+      NULL);
+  memset(&unseen, 0, sizeof(unseen));
+  if(recorded) { recorded(); }
+}
+
+/* what the look in DNS that poll_dns() started found */
+static void polled(int res, void *arg)
+{
+  struct timeval now;
+  char secs[32];
+
+  gettimeofday(&now, NULL);
+  if(res == 1)
+  {
+    metrics_change(unseen.service, METRICS_ACK_VISIBLE, &unseen.acked, &now);
+    snprintf(secs, sizeof(secs), "%ld", (long)(now.tv_sec - unseen.acked.tv_sec));
+    logger_kv(LOG_INFO, "change", "change", unseen.id, "result", "visible",
+        "seconds", secs, NULL);
+    memset(&unseen, 0, sizeof(unseen));
+    if(recorded) { recorded(); }
+    return;
+  }
+  if(now.tv_sec - unseen.acked.tv_sec + unseen.interval > watch_time ||
+      event_timer(unseen.interval * 1000, poll_dns, NULL) != 0)
+  {
+    give_up();
+    return;
+  }
+
+  dprintf((stderr, "change %s not in DNS yet, looking again in %d seconds\n",
+        unseen.id, unseen.interval));
+  unseen.interval *= 2;
+  if(unseen.interval > CHANGE_POLL_MAX)
+  {
+    unseen.interval = CHANGE_POLL_MAX;
+  }
+}
+
+/* look in DNS without waiting for the answers, polled() gets them */
+static void poll_dns(void *arg)
+{
+  if(dnscheck_start(unseen.host, unseen.v4, unseen.v6, polled, NULL) != 0)
+  {
+    polled(-1, NULL);
+  }
+}
+
+/*
+ * change_acked
+ *
+ * the provider took the pending change, time it and start watching DNS
+ * for it
+ */
+void change_acked(char *service, char *host, char *v4, char *v6)
+{
+  if(*pending.id == '\0')
+  {
+    return;
+  }
+  gettimeofday(&pending.acked, NULL);
+  metrics_change(service, METRICS_DETECT_ACK, &pending.detected,
+      &pending.acked);
+  logger_kv(LOG_INFO, "change", "change", pending.id, "result", "acked", NULL);
+
+  if(watch_time > 0 && host != NULL && v4 != NULL)
+  {
+    // a newer change replaces one still on its way
+    if(*unseen.id != '\0')
+    {
+      event_timer_del(poll_dns, NULL);
+      dnscheck_cancel();
+      logger_kv(LOG_INFO, "change", "change", unseen.id, "result",
+          "superseded", NULL);
+    }
+    unseen = pending;
+    snprintf(unseen.service, sizeof(unseen.service), "%s", service);
+    snprintf(unseen.host, sizeof(unseen.host), "%s", host);
+    snprintf(unseen.v4, sizeof(unseen.v4), "%s", v4);
+    snprintf(unseen.v6, sizeof(unseen.v6), "%s", v6 ? v6 : "");
+    unseen.interval = CHANGE_POLL_FIRST;
+    if(event_timer(CHANGE_POLL_FIRST * 1000, poll_dns, NULL) != 0)
+    {
+      give_up();
+    }
+    else
+    {
+      unseen.interval *= 2;
+    }
+  }
+  memset(&pending, 0, sizeof(pending));
+}
@@ -0,0 +1,44 @@
+/* ============================================================================
+ * Copyright (C) 2001 Angus Mackay. All rights reserved; 
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2, or (at your option)
+ * any later version.
+ *
+ * THIS SOFTWARE IS PROVIDED ``AS IS'' AND ANY EXPRESSED OR IMPLIED WARRANTIES,
+ * INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND
+ * FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE
+ * AUTHOR BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY,
+ * OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ * ============================================================================
+ */
+
+/*
+ * change.h
+ *
+ * following an address change from detection to public DNS
+ *
+ */
+
+#ifndef _CHANGE_H
+#define _CHANGE_H
+
+// seconds before the first look in DNS after an acknowledgement
+#define CHANGE_POLL_FIRST 5
+// the most seconds between looks
+#define CHANGE_POLL_MAX 300
+
+extern void change_watch(int seconds);
+extern void change_on_record(void (*cb)(void));
+extern char *change_detected(char *address);
+extern char *change_id(void);
+extern void change_dropped(char *why);
+extern void change_acked(char *service, char *host, char *v4, char *v6);
+
+#endif
@@ -34,15 +34,16 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#if HAVE_ERRNO_H
+#  include <errno.h>
+#endif
 
 #include <conf_file.h>
 
 #if HAVE_STRERROR
-extern int errno;
 #  define error_string strerror(errno)
 #elif HAVE_SYS_ERRLIST
 extern const char *const sys_errlist[];
-extern int errno;
 #  define error_string (sys_errlist[errno])
 #else
 #  define error_string "error message not found"
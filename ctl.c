@@ -0,0 +1,492 @@
+/* ============================================================================
+ * Copyright (C) 2001 Angus Mackay. All rights reserved; 
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2, or (at your option)
+ * any later version.
+ *
+ * THIS SOFTWARE IS PROVIDED ``AS IS'' AND ANY EXPRESSED OR IMPLIED WARRANTIES,
+ * INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND
+ * FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE
+ * AUTHOR BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY,
+ * OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ * ============================================================================
+ */
+
+/*
+ * ctl.c
+ *
+ * the daemon listens on a unix domain socket for one line commands and
+ * answers each with zero or more lines of output followed by "ok" or
+ * "error: <reason>". clients are served from the event loop and may send
+ * as many commands as they like before closing.
+ *
+ *   status [<glob>]           one line of key=value pairs per job
+ *   update <glob>             update the jobs now, even if nothing changed
+ *   pause <glob>              stop updating the jobs (update still works)
+ *   resume <glob>             undo pause
+ *   set <option> <value>      change period, resolv-period, max-interval or
+ *                             timeout on the fly
+ *   help
+ *
+ * jobs are matched against their host name with fnmatch(3).
+ *
+ */
+
+#ifdef HAVE_CONFIG_H
+#  include <config.h>
+#endif
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <fnmatch.h>
+#if HAVE_STDARG_H
+#  include <stdarg.h>
+#endif
+#if HAVE_SYS_TYPES_H
+#  include <sys/types.h>
+#endif
+#if HAVE_SYS_STAT_H
+#  include <sys/stat.h>
+#endif
+#include <sys/socket.h>
+#include <sys/un.h>
+
+#include <error.h>
+#include <dprintf.h>
+#include <event.h>
+#include <ctl.h>
+
+#define CTL_MAX_CLIENTS 4
+#define CTL_LINE_LEN 512
+
+struct ctl_client
+{
+  int fd;
+  int len;
+  char buf[CTL_LINE_LEN];
+};
+
+static int listen_fd = -1;
+static char *sock_path = NULL;
+static struct ctl_job *ctl_jobs = NULL;
+static int ctl_njobs = 0;
+static ctl_setter ctl_set = NULL;
+static struct ctl_client clients[CTL_MAX_CLIENTS];
+// a reply didn't fit in the client's socket buffer
+static int stalled = 0;
+
+/*
+ * client sockets are non-blocking, a client that doesn't read its
+ * answers is dropped after the command rather than waited for
+ */
+static void reply(int fd, char *fmt, ...)
+{
+  char buf[CTL_LINE_LEN];
+  va_list args;
+  int len;
+
+  va_start(args, fmt);
+  len = vsnprintf(buf, sizeof(buf), fmt, args);
+  va_end(args);
+  if(len >= sizeof(buf)) { len = sizeof(buf)-1; }
+
+  if(send(fd, buf, len, 0) != len)
+  {
+    stalled = 1;
+  }
+}
+
+/* apply fn to every job matching glob, returns how many matched */
+static int for_jobs(char *glob, void (*fn)(int fd, struct ctl_job *job), int fd)
+{
+  int n = 0;
+  int i;
+
+  for(i=0; i<ctl_njobs; i++)
+  {
+    if(fnmatch(glob, ctl_jobs[i].name, 0) == 0)
+    {
+      fn(fd, &ctl_jobs[i]);
+      n++;
+    }
+  }
+
+  return(n);
+}
+
+static void job_status(int fd, struct ctl_job *job)
+{
+  reply(fd, "job=%s address=%s address6=%s last_update=%ld next_due=%ld "
+      "failures=%d paused=%d\n", job->name,
+      *job->address ? job->address : "-", *job->address6 ? job->address6 : "-",
+      (long)job->last_update, (long)job->next_due, job->failures, job->paused);
+}
+
+static void job_update(int fd, struct ctl_job *job)
+{
+  job->force = 1;
+}
+
+static void job_pause(int fd, struct ctl_job *job)
+{
+  job->paused = 1;
+}
+
+static void job_resume(int fd, struct ctl_job *job)
+{
+  job->paused = 0;
+}
+
+static void do_command(int fd, char *line)
+{
+  char *argv[4];
+  int argc = 0;
+  char *p;
+
+  for(p=strtok(line, " \t\r\n"); p != NULL && argc < 4; p=strtok(NULL, " \t\r\n"))
+  {
+    argv[argc++] = p;
+  }
+  if(argc == 0)
+  {
+    return;
+  }
+  dprintf((stderr, "ctl command: %s\n", argv[0]));
+
+  if(strcmp(argv[0], "status") == 0 && argc <= 2)
+  {
+    for_jobs(argc == 2 ? argv[1] : "*", job_status, fd);
+    reply(fd, "ok\n");
+  }
+  else if(strcmp(argv[0], "update") == 0 && argc == 2)
+  {
+    if(for_jobs(argv[1], job_update, fd) == 0)
+    {
+      reply(fd, "error: no job matches %s\n", argv[1]);
+      return;
+    }
+    event_break();
+    reply(fd, "ok\n");
+  }
+  else if((strcmp(argv[0], "pause") == 0 || strcmp(argv[0], "resume") == 0) && argc == 2)
+  {
+    if(for_jobs(argv[1], *argv[0] == 'p' ? job_pause : job_resume, fd) == 0)
+    {
+      reply(fd, "error: no job matches %s\n", argv[1]);
+      return;
+    }
+    reply(fd, "ok\n");
+  }
+  else if(strcmp(argv[0], "set") == 0 && argc == 3)
+  {
+    if(ctl_set == NULL || ctl_set(argv[1], argv[2]) != 0)
+    {
+      reply(fd, "error: can't set %s to %s\n", argv[1], argv[2]);
+      return;
+    }
+    // so the new value takes effect now rather than after the next sleep
+    event_break();
+    reply(fd, "ok\n");
+  }
+  else if(strcmp(argv[0], "help") == 0)
+  {
+    reply(fd, "status [<glob>]\nupdate <glob>\npause <glob>\nresume <glob>\n"
+        "set <period|resolv-period|max-interval|timeout> <value>\nok\n");
+  }
+  else
+  {
+    reply(fd, "error: unknown command, try help\n");
+  }
+}
+
+static void client_read(int fd, void *arg)
+{
+  struct ctl_client *c = arg;
+  char *nl;
+  int n;
+
+  n = recv(fd, c->buf + c->len, sizeof(c->buf) - 1 - c->len, 0);
+  if(n == -1 && (errno == EAGAIN || errno == EINTR))
+  {
+    return;
+  }
+  if(n <= 0)
+  {
+    event_del(fd);
+    close(fd);
+    c->fd = -1;
+    return;
+  }
+  c->len += n;
+  c->buf[c->len] = '\0';
+
+  stalled = 0;
+  while(!stalled && (nl=strchr(c->buf, '\n')) != NULL)
+  {
+    *nl++ = '\0';
+    do_command(fd, c->buf);
+    c->len -= nl - c->buf;
+    memmove(c->buf, nl, c->len + 1);
+  }
+
+  if(stalled)
+  {
+    dprintf((stderr, "ctl client isn't reading, dropped\n"));
+    event_del(fd);
+    close(fd);
+    c->fd = -1;
+  }
+  else if(c->len == sizeof(c->buf) - 1)
+  {
+    reply(fd, "error: line too long\n");
+    event_del(fd);
+    close(fd);
+    c->fd = -1;
+  }
+}
+
+static void client_accept(int fd, void *arg)
+{
+  int client;
+  int i;
+
+  if((client=accept(fd, NULL, NULL)) == -1)
+  {
+    dprintf((stderr, "accept: %s\n", error_string));
+    return;
+  }
+
+  fcntl(client, F_SETFL, fcntl(client, F_GETFL) | O_NONBLOCK);
+  fcntl(client, F_SETFD, FD_CLOEXEC);
+
+  for(i=0; i<CTL_MAX_CLIENTS && clients[i].fd != -1; i++);
+  if(i == CTL_MAX_CLIENTS || event_add(client, client_read, &clients[i]) != 0)
+  {
+    reply(client, "error: too many clients\n");
+    close(client);
+    return;
+  }
+
+  clients[i].fd = client;
+  clients[i].len = 0;
+}
+
+/*
+ * ctl_listen
+ *
+ * start accepting commands on the unix socket path. the socket is only
+ * accessible by our own user.
+ */
+int ctl_listen(char *path, struct ctl_job *jobs, int njobs, ctl_setter set)
+{
+  struct sockaddr_un addr;
+  mode_t old_mask;
+
+  if(strlen(path) >= sizeof(addr.sun_path))
+  {
+    return(-1);
+  }
+  if((listen_fd=socket(AF_UNIX, SOCK_STREAM, 0)) == -1)
+  {
+    return(-1);
+  }
+
+  memset(&addr, 0, sizeof(addr));
+  addr.sun_family = AF_UNIX;
+  strcpy(addr.sun_path, path);
+  unlink(path);
+
+  old_mask = umask(077);
+  if(bind(listen_fd, (struct sockaddr *)&addr, sizeof(addr)) != 0)
+  {
+    umask(old_mask);
+    close(listen_fd);
+    listen_fd = -1;
+    return(-1);
+  }
+  umask(old_mask);
+
+  if(listen(listen_fd, CTL_MAX_CLIENTS) != 0)
+  {
+    close(listen_fd);
+    unlink(path);
+    listen_fd = -1;
+    return(-1);
+  }
+
+  if(ctl_adopt(listen_fd, path, jobs, njobs, set) != 0)
+  {
+    close(listen_fd);
+    unlink(path);
+    listen_fd = -1;
+    return(-1);
+  }
+
+  return(0);
+}
+
+/*
+ * ctl_adopt
+ *
+ * like ctl_listen() but with a socket that is already listening on path,
+ * one handed over by ctl_detach() say
+ */
+int ctl_adopt(int fd, char *path, struct ctl_job *jobs, int njobs,
+    ctl_setter set)
+{
+  int i;
+
+  if(event_add(fd, client_accept, NULL) != 0)
+  {
+    return(-1);
+  }
+  // hooks and the like have no business with it
+  fcntl(fd, F_SETFD, FD_CLOEXEC);
+  listen_fd = fd;
+
+  for(i=0; i<CTL_MAX_CLIENTS; i++)
+  {
+    clients[i].fd = -1;
+  }
+  sock_path = strdup(path);
+  ctl_jobs = jobs;
+  ctl_njobs = njobs;
+  ctl_set = set;
+
+  return(0);
+}
+
+static void drop_clients(void)
+{
+  int i;
+
+  for(i=0; i<CTL_MAX_CLIENTS; i++)
+  {
+    if(clients[i].fd != -1)
+    {
+      event_del(clients[i].fd);
+      close(clients[i].fd);
+      clients[i].fd = -1;
+    }
+  }
+}
+
+/*
+ * ctl_detach
+ *
+ * stop serving commands but leave the socket listening, its descriptor is
+ * returned (or -1 if there isn't one) for ctl_adopt() to pick up
+ */
+int ctl_detach(void)
+{
+  int fd = listen_fd;
+
+  if(listen_fd == -1)
+  {
+    return(-1);
+  }
+  drop_clients();
+  event_del(listen_fd);
+  listen_fd = -1;
+  free(sock_path);
+  sock_path = NULL;
+
+  return(fd);
+}
+
+void ctl_close(void)
+{
+  if(listen_fd == -1)
+  {
+    return;
+  }
+
+  drop_clients();
+  event_del(listen_fd);
+  close(listen_fd);
+  listen_fd = -1;
+  unlink(sock_path);
+  free(sock_path);
+  sock_path = NULL;
+}
+
+/*
+ * ctl_client
+ *
+ * send the command made of argv to the daemon listening on path and copy
+ * its answer to stdout. returns 0 if the daemon said "ok".
+ */
+int ctl_client(char *path, int argc, char **argv)
+{
+  struct sockaddr_un addr;
+  char buf[CTL_LINE_LEN];
+  char last[CTL_LINE_LEN];
+  FILE *fp;
+  int fd;
+  int i;
+
+  if(argc < 1)
+  {
+    fprintf(stderr, "no command given, try help\n");
+    return(1);
+  }
+  if(strlen(path) >= sizeof(addr.sun_path))
+  {
+    fprintf(stderr, "socket path too long: %s\n", path);
+    return(1);
+  }
+
+  memset(&addr, 0, sizeof(addr));
+  addr.sun_family = AF_UNIX;
+  strcpy(addr.sun_path, path);
+
+  if((fd=socket(AF_UNIX, SOCK_STREAM, 0)) == -1 ||
+      connect(fd, (struct sockaddr *)&addr, sizeof(addr)) != 0)
+  {
+    fprintf(stderr, "unable to connect to %s: %s\n", path, error_string);
+    if(fd != -1) { close(fd); }
+    return(1);
+  }
+
+  *buf = '\0';
+  for(i=0; i<argc; i++)
+  {
+    if(strlen(buf) + strlen(argv[i]) + 2 >= sizeof(buf))
+    {
+      fprintf(stderr, "command too long\n");
+      close(fd);
+      return(1);
+    }
+    if(i > 0) { strcat(buf, " "); }
+    strcat(buf, argv[i]);
+  }
+  strcat(buf, "\n");
+  send(fd, buf, strlen(buf), 0);
+  shutdown(fd, SHUT_WR);
+
+  if((fp=fdopen(fd, "r")) == NULL)
+  {
+    close(fd);
+    return(1);
+  }
+  *last = '\0';
+  while(fgets(buf, sizeof(buf), fp) != NULL)
+  {
+    fputs(buf, stdout);
+    strcpy(last, buf);
+  }
+  fclose(fp);
+
+  return(strcmp(last, "ok\n") == 0 ? 0 : 1);
+}
+
@@ -0,0 +1,66 @@
+/* ============================================================================
+ * Copyright (C) 2001 Angus Mackay. All rights reserved; 
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2, or (at your option)
+ * any later version.
+ *
+ * THIS SOFTWARE IS PROVIDED ``AS IS'' AND ANY EXPRESSED OR IMPLIED WARRANTIES,
+ * INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND
+ * FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE
+ * AUTHOR BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY,
+ * OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ * ============================================================================
+ */
+
+/*
+ * ctl.h
+ *
+ * unix domain control socket
+ *
+ */
+
+#ifndef _CTL_H
+#define _CTL_H
+
+#if HAVE_SYS_TIME_H
+#  include <sys/time.h>
+#endif
+#include <time.h>
+#include <netinet/in.h>
+
+#define DEFAULT_CTL_SOCKET "/var/run/ez-ipupdate.sock"
+
+/* what the control socket can see and change of an update job */
+struct ctl_job
+{
+  char *name;
+  char address[INET_ADDRSTRLEN];
+  // "" without IPv6
+  char address6[INET6_ADDRSTRLEN];
+  time_t last_update;
+  time_t last_attempt;
+  time_t next_due;
+  int last_result;
+  int failures;
+  int paused;
+  int force;
+};
+
+/* called for "set <option> <value>", returns 0 if it was applied */
+typedef int (*ctl_setter)(char *option, char *value);
+
+extern int ctl_listen(char *path, struct ctl_job *jobs, int njobs, ctl_setter set);
+extern int ctl_adopt(int fd, char *path, struct ctl_job *jobs, int njobs,
+    ctl_setter set);
+extern int ctl_detach(void);
+extern void ctl_close(void);
+extern int ctl_client(char *path, int argc, char **argv);
+
+#endif
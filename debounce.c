@@ -0,0 +1,137 @@
+/* ============================================================================
+ * Copyright (C) 2001 Angus Mackay. All rights reserved; 
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2, or (at your option)
+ * any later version.
+ *
+ * THIS SOFTWARE IS PROVIDED ``AS IS'' AND ANY EXPRESSED OR IMPLIED WARRANTIES,
+ * INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND
+ * FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE
+ * AUTHOR BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY,
+ * OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ * ============================================================================
+ */
+
+/*
+ * debounce.c
+ *
+ * a PPP reconnect or a DHCP server changing its mind can move the address
+ * A to B and back to A within seconds, which is two updates for nothing
+ * and, done often, gets an account blocked.  so a change has to hold for
+ * the settle window before it is pushed, and going back to the pushed
+ * address inside the window cancels it.
+ *
+ * every change is kept in a short history and each one in the last
+ * DEBOUNCE_SPAN seconds past the first stretches the window by another
+ * settle time, so a link that flaps all the time has to hold still for
+ * longer than one that rarely changes.
+ *
+ */
+
+#ifdef HAVE_CONFIG_H
+#  include <config.h>
+#endif
+
+#include <stdio.h>
+#include <string.h>
+
+#include <dprintf.h>
+#include <debounce.h>
+
+void debounce_init(struct debounce *d, int settle)
+{
+  memset(d, 0, sizeof(*d));
+  d->settle = settle;
+}
+
+/*
+ * debounce_window
+ *
+ * how long a change has to hold now, the settle time stretched by the
+ * changes in the last DEBOUNCE_SPAN seconds
+ */
+int debounce_window(struct debounce *d, time_t now)
+{
+  int recent = 0;
+  int i;
+
+  for(i=0; i<DEBOUNCE_HISTORY; i++)
+  {
+    if(d->changes[i] != 0 && now - d->changes[i] < DEBOUNCE_SPAN)
+    {
+      recent++;
+    }
+  }
+  if(recent > DEBOUNCE_MAX_STRETCH)
+  {
+    recent = DEBOUNCE_MAX_STRETCH;
+  }
+  return(d->settle * (recent > 1 ? recent : 1));
+}
+
+/*
+ * debounce_check
+ *
+ * current is the address now, pushed the one the service has.  says
+ * whether to update: DEBOUNCE_GO once a change has held for the window,
+ * DEBOUNCE_WAIT with the seconds still to go in left until then,
+ * DEBOUNCE_REVERTED when a waiting change went back to pushed and
+ * DEBOUNCE_SAME when there's nothing to do.
+ */
+int debounce_check(struct debounce *d, char *pushed, char *current,
+    time_t now, int *left)
+{
+  int window;
+
+  *left = 0;
+  if(strcmp(current, d->seen) != 0)
+  {
+    // the first look isn't a change
+    if(*d->seen != '\0')
+    {
+      d->changes[d->next] = now;
+      d->next = (d->next + 1) % DEBOUNCE_HISTORY;
+    }
+    snprintf(d->seen, sizeof(d->seen), "%s", current);
+  }
+
+  if(strcmp(current, pushed) == 0)
+  {
+    if(*d->pending != '\0')
+    {
+      dprintf((stderr, "change to %s reverted\n", d->pending));
+      *d->pending = '\0';
+      d->suppressed++;
+      return(DEBOUNCE_REVERTED);
+    }
+    return(DEBOUNCE_SAME);
+  }
+  if(d->settle <= 0)
+  {
+    return(DEBOUNCE_GO);
+  }
+
+  // a change to somewhere else again starts the wait over
+  if(strcmp(current, d->pending) != 0)
+  {
+    snprintf(d->pending, sizeof(d->pending), "%s", current);
+    d->since = now;
+  }
+  window = debounce_window(d, now);
+  if(now - d->since >= window)
+  {
+    *d->pending = '\0';
+    return(DEBOUNCE_GO);
+  }
+  *left = window - (now - d->since);
+  dprintf((stderr, "change to %s settling, %d of %d seconds left\n",
+        current, *left, window));
+  return(DEBOUNCE_WAIT);
+}
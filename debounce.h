@@ -0,0 +1,66 @@
+/* ============================================================================
+ * Copyright (C) 2001 Angus Mackay. All rights reserved; 
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2, or (at your option)
+ * any later version.
+ *
+ * THIS SOFTWARE IS PROVIDED ``AS IS'' AND ANY EXPRESSED OR IMPLIED WARRANTIES,
+ * INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND
+ * FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE
+ * AUTHOR BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY,
+ * OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ * ============================================================================
+ */
+
+/*
+ * debounce.h
+ *
+ * holding an address change back until it has settled
+ *
+ */
+
+#ifndef _DEBOUNCE_H
+#define _DEBOUNCE_H
+
+#include <time.h>
+
+#define DEBOUNCE_HISTORY 16
+// changes this recent count against how stable the link is
+#define DEBOUNCE_SPAN 3600
+// the most the window is stretched for a link that keeps flapping
+#define DEBOUNCE_MAX_STRETCH 8
+
+/* what debounce_check() says to do */
+enum {
+  DEBOUNCE_SAME = 0,
+  DEBOUNCE_WAIT,
+  DEBOUNCE_GO,
+  DEBOUNCE_REVERTED,
+};
+
+struct debounce
+{
+  int settle;
+  // when the address was seen to change, a ring
+  time_t changes[DEBOUNCE_HISTORY];
+  int next;
+  // the address last seen and the change waiting out the window
+  char seen[128];
+  char pending[128];
+  time_t since;
+  unsigned long suppressed;
+};
+
+extern void debounce_init(struct debounce *d, int settle);
+extern int debounce_check(struct debounce *d, char *pushed, char *current,
+    time_t now, int *left);
+extern int debounce_window(struct debounce *d, time_t now);
+
+#endif
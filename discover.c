@@ -0,0 +1,776 @@
+/* ============================================================================
+ * Copyright (C) 2001 Angus Mackay. All rights reserved; 
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2, or (at your option)
+ * any later version.
+ *
+ * THIS SOFTWARE IS PROVIDED ``AS IS'' AND ANY EXPRESSED OR IMPLIED WARRANTIES,
+ * INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND
+ * FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE
+ * AUTHOR BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY,
+ * OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ * ============================================================================
+ */
+
+/*
+ * discover.c
+ *
+ * behind NAT the interface has a private address and the public one can
+ * only be learned from outside.  a source is either a checkip page,
+ * given as http://host[:port][/path], whose first dotted quad is the
+ * address, or a STUN server, stun:host[:port], asked with a binding
+ * request.  natpmp[:gateway[:port]] asks a NAT-PMP gateway, the default
+ * route's unless another is given, which is a single UDP exchange with
+ * the box that actually holds the address.  NAT-PMP gateways also
+ * announce a change of address to 224.0.0.1:5350, discover_listen() gives
+ * a socket to hear that on so the daemon can look again at once.
+ *
+ * all the sources are asked at once and the answer is the first address
+ * that quorum of them agree on, by default two when there is more than
+ * one source, so one broken or lying source can't move the name.
+ *
+ */
+
+#ifdef HAVE_CONFIG_H
+#  include <config.h>
+#endif
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <errno.h>
+#include <fcntl.h>
+#if HAVE_SYS_TYPES_H
+#  include <sys/types.h>
+#endif
+#include <sys/time.h>
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <arpa/inet.h>
+#include <netdb.h>
+
+#include <dprintf.h>
+#include <entropy.h>
+#include <ifsnap.h>
+#include <discover.h>
+
+#define DEFAULT_HTTP_PORT 80
+#define DEFAULT_STUN_PORT 3478
+#define DEFAULT_NATPMP_PORT 5351
+#define NATPMP_ANNOUNCE_PORT 5350
+#define NATPMP_ANNOUNCE_GROUP "224.0.0.1"
+// resend a UDP request that got no answer after this many ms
+#define UDP_RESEND 500
+
+#define STUN_BINDING_REQUEST  0x0001
+#define STUN_BINDING_RESPONSE 0x0101
+#define STUN_MAGIC            0x2112A442
+#define STUN_MAPPED_ADDRESS     0x0001
+#define STUN_XOR_MAPPED_ADDRESS 0x0020
+
+enum {
+  SOURCE_HTTP,
+  SOURCE_STUN,
+  SOURCE_NATPMP,
+};
+
+enum {
+  STATE_IDLE,
+  STATE_CONNECTING,
+  STATE_READING,
+  STATE_DONE,
+};
+
+struct source
+{
+  int kind;
+  char host[128];
+  int port;
+  char path[128];
+
+  // the query in progress
+  int fd;
+  int state;
+  char buf[1024];
+  int len;
+  unsigned char tid[12];
+  struct timeval sent;
+  int answered;
+  struct in_addr addr;
+  // who was asked, announcements only count from there
+  struct in_addr server;
+};
+
+// allocated with the first source
+static struct source *sources = NULL;
+static int nsources = 0;
+static int quorum = 0;
+static char error[128] = "";
+static int backoff = 1;
+static int announce_fd = -1;
+
+/*
+ * discover_add
+ *
+ * add the source given by spec, returns -1 if it can't be understood
+ */
+int discover_add(char *spec)
+{
+  struct source *s;
+  char *p;
+
+  if(nsources == DISCOVER_MAX_SOURCES || (sources == NULL &&
+        (sources=calloc(DISCOVER_MAX_SOURCES, sizeof(struct source))) == NULL))
+  {
+    return(-1);
+  }
+  s = &sources[nsources];
+  memset(s, 0, sizeof(*s));
+  s->fd = -1;
+  if(strncmp(spec, "http://", 7) == 0)
+  {
+    s->kind = SOURCE_HTTP;
+    s->port = DEFAULT_HTTP_PORT;
+    spec += 7;
+  }
+  else if(strncmp(spec, "stun:", 5) == 0)
+  {
+    s->kind = SOURCE_STUN;
+    s->port = DEFAULT_STUN_PORT;
+    spec += 5;
+  }
+  else if(strncmp(spec, "natpmp", 6) == 0 && (spec[6] == '\0' ||
+        spec[6] == ':'))
+  {
+    s->kind = SOURCE_NATPMP;
+    s->port = DEFAULT_NATPMP_PORT;
+    spec += spec[6] ? 7 : 6;
+    // no host for the default route's gateway
+    if(*spec == '\0')
+    {
+      nsources++;
+      return(0);
+    }
+  }
+  else
+  {
+    return(-1);
+  }
+
+  snprintf(s->host, sizeof(s->host), "%.*s", (int)strcspn(spec, ":/"), spec);
+  p = spec + strlen(s->host);
+  if(*p == ':')
+  {
+    s->port = atoi(p + 1);
+    p += 1 + strspn(p + 1, "0123456789");
+  }
+  if(*s->host == '\0' || s->port <= 0 || s->port > 65535 ||
+      (*p != '\0' && (s->kind != SOURCE_HTTP || *p != '/')))
+  {
+    return(-1);
+  }
+  snprintf(s->path, sizeof(s->path), "%s", *p ? p : "/");
+  nsources++;
+
+  return(0);
+}
+
+int discover_sources(void)
+{
+  return(nsources);
+}
+
+/* how many sources have to agree, 0 for the default */
+void discover_quorum(int n)
+{
+  quorum = n;
+}
+
+/* why the last discover_run() failed */
+char *discover_error(void)
+{
+  return(error);
+}
+
+static long since_ms(struct timeval *then)
+{
+  struct timeval now;
+
+  gettimeofday(&now, NULL);
+  return((now.tv_sec - then->tv_sec) * 1000 +
+      (now.tv_usec - then->tv_usec) / 1000);
+}
+
+static void finish(struct source *s)
+{
+  if(s->fd != -1)
+  {
+    close(s->fd);
+    s->fd = -1;
+  }
+  s->state = STATE_DONE;
+}
+
+static void natpmp_send(struct source *s)
+{
+  // version 0, opcode 0: what is the external address
+  unsigned char req[2] = { 0, 0 };
+
+  send(s->fd, req, sizeof(req), 0);
+  gettimeofday(&s->sent, NULL);
+}
+
+static void stun_send(struct source *s)
+{
+  unsigned char req[20];
+  unsigned long magic = STUN_MAGIC;
+
+  req[0] = STUN_BINDING_REQUEST >> 8;
+  req[1] = STUN_BINDING_REQUEST & 0xff;
+  req[2] = req[3] = 0;
+  req[4] = magic >> 24;
+  req[5] = (magic >> 16) & 0xff;
+  req[6] = (magic >> 8) & 0xff;
+  req[7] = magic & 0xff;
+  memcpy(req + 8, s->tid, sizeof(s->tid));
+  send(s->fd, req, sizeof(req), 0);
+  gettimeofday(&s->sent, NULL);
+}
+
+/* start asking s, it is finished at once if that can't be done */
+static void ask(struct source *s)
+{
+  struct sockaddr_in sin;
+  struct hostent *hostinfo;
+
+  s->state = STATE_DONE;
+  s->answered = 0;
+  s->len = 0;
+
+  memset(&sin, 0, sizeof(sin));
+  sin.sin_family = AF_INET;
+  sin.sin_port = htons(s->port);
+  if(*s->host == '\0')
+  {
+    struct ifsnap *snap = ifsnap_get();
+
+    if(snap == NULL || !snap->have_gateway)
+    {
+      dprintf((stderr, "natpmp: no default gateway\n"));
+      return;
+    }
+    sin.sin_addr = snap->gateway;
+  }
+  else if(inet_aton(s->host, &sin.sin_addr) == 0)
+  {
+    if((hostinfo=gethostbyname(s->host)) == NULL)
+    {
+      dprintf((stderr, "%s: unknown host\n", s->host));
+      return;
+    }
+    memcpy(&sin.sin_addr, hostinfo->h_addr_list[0], sizeof(sin.sin_addr));
+  }
+
+  s->server = sin.sin_addr;
+
+  if((s->fd=socket(AF_INET, s->kind == SOURCE_HTTP ? SOCK_STREAM :
+          SOCK_DGRAM, 0)) == -1)
+  {
+    return;
+  }
+  fcntl(s->fd, F_SETFL, fcntl(s->fd, F_GETFL) | O_NONBLOCK);
+  if(connect(s->fd, (struct sockaddr *)&sin, sizeof(sin)) == -1 &&
+      errno != EINPROGRESS)
+  {
+    dprintf((stderr, "%s: connect: %s\n", s->host, strerror(errno)));
+    finish(s);
+    return;
+  }
+
+  if(s->kind == SOURCE_STUN)
+  {
+    // the ID is all stun_read() has to tell the answer from a forgery
+    entropy_fill(s->tid, sizeof(s->tid));
+    stun_send(s);
+    s->state = STATE_READING;
+  }
+  else if(s->kind == SOURCE_NATPMP)
+  {
+    natpmp_send(s);
+    s->state = STATE_READING;
+  }
+  else
+  {
+    s->state = STATE_CONNECTING;
+  }
+}
+
+/* the connection is up, send the request */
+static void http_send(struct source *s)
+{
+  char req[512];
+  int err = 0;
+  socklen_t len = sizeof(err);
+  int n;
+
+  if(getsockopt(s->fd, SOL_SOCKET, SO_ERROR, &err, &len) != 0 || err != 0)
+  {
+    dprintf((stderr, "%s: connect: %s\n", s->host, strerror(err)));
+    finish(s);
+    return;
+  }
+  n = snprintf(req, sizeof(req), "GET %s HTTP/1.0\r\n"
+      "Host: %s\r\n"
+      "User-Agent: ez-ipupdate/" VERSION "\r\n"
+      "\r\n", s->path, s->host);
+  // it is small enough to go in one piece on a fresh connection
+  if(send(s->fd, req, n, 0) != n)
+  {
+    finish(s);
+    return;
+  }
+  s->state = STATE_READING;
+}
+
+/* the first dotted quad in text */
+static int find_address(char *text, struct in_addr *addr)
+{
+  char quad[16];
+  char *p;
+  int len;
+  int dots;
+  int i;
+
+  for(p=text; *p != '\0'; p+=len ? len : 1)
+  {
+    len = strspn(p, "0123456789.");
+    if(len < 7 || len >= sizeof(quad))
+    {
+      continue;
+    }
+    memcpy(quad, p, len);
+    quad[len] = '\0';
+    for(i=dots=0; i<len; i++)
+    {
+      dots += quad[i] == '.';
+    }
+    if(dots == 3 && inet_aton(quad, addr) != 0)
+    {
+      return(0);
+    }
+  }
+  return(-1);
+}
+
+static void http_read(struct source *s)
+{
+  char *body;
+  int n;
+
+  if((n=recv(s->fd, s->buf + s->len, sizeof(s->buf) - 1 - s->len, 0)) > 0)
+  {
+    s->len += n;
+    if(s->len < sizeof(s->buf) - 1)
+    {
+      return;
+    }
+  }
+  else if(n == -1 && (errno == EAGAIN || errno == EINTR))
+  {
+    return;
+  }
+
+  // the whole answer, or as much of it as will be looked at
+  s->buf[s->len] = '\0';
+  if(strncmp(s->buf, "HTTP/", 5) == 0 && atoi(s->buf + 9) == 200 &&
+      (body=strstr(s->buf, "\r\n\r\n")) != NULL &&
+      find_address(body, &s->addr) == 0)
+  {
+    s->answered = 1;
+  }
+  else
+  {
+    dprintf((stderr, "%s: no address in the answer\n", s->host));
+  }
+  finish(s);
+}
+
+static void stun_read(struct source *s)
+{
+  unsigned char buf[512];
+  unsigned char *attr;
+  unsigned long magic = STUN_MAGIC;
+  unsigned long a;
+  int type;
+  int alen;
+  int len;
+  int n;
+
+  if((n=recv(s->fd, buf, sizeof(buf), 0)) < 20)
+  {
+    // an ICMP error for an earlier request ends it, anything else is noise
+    if(n == -1 && errno == ECONNREFUSED)
+    {
+      finish(s);
+    }
+    return;
+  }
+  if(((buf[0] << 8) | buf[1]) != STUN_BINDING_RESPONSE ||
+      memcmp(buf + 8, s->tid, sizeof(s->tid)) != 0)
+  {
+    return;
+  }
+  len = (buf[2] << 8) | buf[3];
+  if(len > n - 20)
+  {
+    len = n - 20;
+  }
+
+  for(attr=buf+20; attr + 4 <= buf + 20 + len; attr += 4 + ((alen + 3) & ~3))
+  {
+    type = (attr[0] << 8) | attr[1];
+    alen = (attr[2] << 8) | attr[3];
+    if(attr + 4 + alen > buf + 20 + len || alen < 8 || attr[5] != 0x01 ||
+        (type != STUN_XOR_MAPPED_ADDRESS && type != STUN_MAPPED_ADDRESS))
+    {
+      continue;
+    }
+    a = ((unsigned long)attr[8] << 24) | (attr[9] << 16) | (attr[10] << 8) |
+      attr[11];
+    if(type == STUN_XOR_MAPPED_ADDRESS)
+    {
+      a ^= magic;
+    }
+    s->addr.s_addr = htonl(a);
+    s->answered = 1;
+    // the xor'ed one is the one to trust when there are both
+    if(type == STUN_XOR_MAPPED_ADDRESS)
+    {
+      break;
+    }
+  }
+  finish(s);
+}
+
+/*
+ * a NAT-PMP external address answer, the same whether asked for or
+ * announced: version 0, opcode 128, result 0, the gateway's seconds since
+ * its mappings were reset and the address
+ */
+static int natpmp_answer(unsigned char *buf, int n, struct in_addr *addr)
+{
+  if(n < 12 || buf[0] != 0 || buf[1] != 128 || buf[2] != 0 || buf[3] != 0)
+  {
+    return(-1);
+  }
+  memcpy(&addr->s_addr, buf + 8, 4);
+  return(0);
+}
+
+static void natpmp_read(struct source *s)
+{
+  unsigned char buf[64];
+  int n;
+
+  if((n=recv(s->fd, buf, sizeof(buf), 0)) == -1)
+  {
+    // nothing listening at the gateway
+    if(errno == ECONNREFUSED)
+    {
+      finish(s);
+    }
+    return;
+  }
+  if(natpmp_answer(buf, n, &s->addr) == 0)
+  {
+    s->answered = 1;
+    finish(s);
+  }
+  else if(n >= 4 && buf[1] == 128)
+  {
+    dprintf((stderr, "natpmp: result code %d\n", (buf[2] << 8) | buf[3]));
+    finish(s);
+  }
+}
+
+/* the address quorum sources agree on, if there is one yet */
+static int agreed(int need, struct in_addr *addr)
+{
+  int count;
+  int i;
+  int j;
+
+  for(i=0; i<nsources; i++)
+  {
+    if(!sources[i].answered)
+    {
+      continue;
+    }
+    for(count=0, j=0; j<nsources; j++)
+    {
+      if(sources[j].answered &&
+          sources[j].addr.s_addr == sources[i].addr.s_addr)
+      {
+        count++;
+      }
+    }
+    if(count >= need)
+    {
+      memcpy(addr, &sources[i].addr, sizeof(*addr));
+      return(0);
+    }
+  }
+  return(-1);
+}
+
+/*
+ * discover_run
+ *
+ * ask every source at once and set addr to what enough of them agree on.
+ * returns -1, with discover_error() saying why, if they don't within
+ * DISCOVER_TIMEOUT seconds.
+ */
+int discover_run(struct in_addr *addr)
+{
+  struct timeval start;
+  struct timeval tv;
+  struct source *s;
+  fd_set readfds;
+  fd_set writefds;
+  int need;
+  int max_fd;
+  int pending;
+  int answered;
+  long left;
+  int ret = -1;
+  int i;
+
+  need = quorum > 0 ? quorum : (nsources > 1 ? 2 : 1);
+  if(need > nsources)
+  {
+    need = nsources;
+  }
+
+  gettimeofday(&start, NULL);
+  for(i=0; i<nsources; i++)
+  {
+    ask(&sources[i]);
+  }
+
+  for(;;)
+  {
+    if(agreed(need, addr) == 0)
+    {
+      ret = 0;
+      break;
+    }
+    if((left=DISCOVER_TIMEOUT * 1000 - since_ms(&start)) <= 0)
+    {
+      break;
+    }
+
+    FD_ZERO(&readfds);
+    FD_ZERO(&writefds);
+    max_fd = -1;
+    pending = 0;
+    for(i=0; i<nsources; i++)
+    {
+      s = &sources[i];
+      if(s->state == STATE_CONNECTING)
+      {
+        FD_SET(s->fd, &writefds);
+      }
+      else if(s->state == STATE_READING)
+      {
+        FD_SET(s->fd, &readfds);
+        if(s->kind != SOURCE_HTTP && left > UDP_RESEND - since_ms(&s->sent))
+        {
+          left = UDP_RESEND - since_ms(&s->sent);
+          if(left < 0) { left = 0; }
+        }
+      }
+      else
+      {
+        continue;
+      }
+      pending++;
+      if(s->fd > max_fd) { max_fd = s->fd; }
+    }
+    if(pending == 0)
+    {
+      break;
+    }
+
+    tv.tv_sec = left / 1000;
+    tv.tv_usec = (left % 1000) * 1000;
+    if(select(max_fd + 1, &readfds, &writefds, NULL, &tv) == -1 &&
+        errno != EINTR)
+    {
+      break;
+    }
+    for(i=0; i<nsources; i++)
+    {
+      s = &sources[i];
+      if(s->state == STATE_CONNECTING && FD_ISSET(s->fd, &writefds))
+      {
+        http_send(s);
+      }
+      else if(s->state == STATE_READING && FD_ISSET(s->fd, &readfds))
+      {
+        switch(s->kind)
+        {
+          case SOURCE_STUN:
+            stun_read(s);
+            break;
+          case SOURCE_NATPMP:
+            natpmp_read(s);
+            break;
+          default:
+            http_read(s);
+            break;
+        }
+      }
+      else if(s->state == STATE_READING && s->kind != SOURCE_HTTP &&
+          since_ms(&s->sent) >= UDP_RESEND)
+      {
+        if(s->kind == SOURCE_STUN)
+        {
+          stun_send(s);
+        }
+        else
+        {
+          natpmp_send(s);
+        }
+      }
+    }
+  }
+
+  for(i=answered=0; i<nsources; i++)
+  {
+    answered += sources[i].answered;
+    finish(&sources[i]);
+  }
+  if(ret != 0)
+  {
+    snprintf(error, sizeof(error), "%d of %d sources answered and %d "
+        "had to agree", answered, nsources, need);
+  }
+  return(ret);
+}
+
+/*
+ * discover_listen
+ *
+ * a socket that hears NAT-PMP gateways announce a new address, for
+ * discover_announced() once it is readable. -1 if there are no NAT-PMP
+ * sources or it can't be opened.
+ */
+int discover_listen(void)
+{
+  struct sockaddr_in sin;
+  struct ip_mreq mreq;
+  int on = 1;
+  int i;
+
+  for(i=0; i<nsources && sources[i].kind != SOURCE_NATPMP; i++);
+  if(i == nsources || announce_fd != -1)
+  {
+    return(announce_fd);
+  }
+
+  if((announce_fd=socket(AF_INET, SOCK_DGRAM, 0)) == -1)
+  {
+    return(-1);
+  }
+  setsockopt(announce_fd, SOL_SOCKET, SO_REUSEADDR, &on, sizeof(on));
+  memset(&sin, 0, sizeof(sin));
+  sin.sin_family = AF_INET;
+  sin.sin_port = htons(NATPMP_ANNOUNCE_PORT);
+  sin.sin_addr.s_addr = htonl(INADDR_ANY);
+  if(bind(announce_fd, (struct sockaddr *)&sin, sizeof(sin)) != 0)
+  {
+    dprintf((stderr, "natpmp: bind: %s\n", strerror(errno)));
+    close(announce_fd);
+    announce_fd = -1;
+    return(-1);
+  }
+  // without the group only announcements sent straight here are heard
+  memset(&mreq, 0, sizeof(mreq));
+  inet_aton(NATPMP_ANNOUNCE_GROUP, &mreq.imr_multiaddr);
+  mreq.imr_interface.s_addr = htonl(INADDR_ANY);
+  setsockopt(announce_fd, IPPROTO_IP, IP_ADD_MEMBERSHIP, &mreq, sizeof(mreq));
+  fcntl(announce_fd, F_SETFL, fcntl(announce_fd, F_GETFL) | O_NONBLOCK);
+  fcntl(announce_fd, F_SETFD, FD_CLOEXEC);
+
+  return(announce_fd);
+}
+
+/*
+ * discover_announced
+ *
+ * read an announcement, returns 1 if it came from a gateway we ask and
+ * so the address should be looked at again
+ */
+int discover_announced(int fd)
+{
+  struct sockaddr_in from;
+  socklen_t fromlen = sizeof(from);
+  unsigned char buf[64];
+  struct in_addr addr;
+  int n;
+  int i;
+
+  if((n=recvfrom(fd, buf, sizeof(buf), 0, (struct sockaddr *)&from,
+          &fromlen)) == -1 || natpmp_answer(buf, n, &addr) != 0)
+  {
+    return(0);
+  }
+  for(i=0; i<nsources; i++)
+  {
+    if(sources[i].kind == SOURCE_NATPMP &&
+        sources[i].server.s_addr == from.sin_addr.s_addr)
+    {
+      dprintf((stderr, "natpmp: %s announced ", inet_ntoa(from.sin_addr)));
+      dprintf((stderr, "%s\n", inet_ntoa(addr)));
+      return(1);
+    }
+  }
+  return(0);
+}
+
+void discover_close(void)
+{
+  if(announce_fd != -1)
+  {
+    close(announce_fd);
+    announce_fd = -1;
+  }
+}
+
+/*
+ * discover_interval
+ *
+ * how long to wait before asking again.  every unchanged answer doubles
+ * the wait, up to DISCOVER_MAX_BACKOFF times period, and a change brings
+ * it back to period since one change is often followed by another.
+ */
+int discover_interval(int period, int changed)
+{
+  if(changed)
+  {
+    backoff = 1;
+  }
+  else if(backoff < DISCOVER_MAX_BACKOFF)
+  {
+    backoff *= 2;
+  }
+  return(period * backoff);
+}
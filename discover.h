@@ -0,0 +1,50 @@
+/* ============================================================================
+ * Copyright (C) 2001 Angus Mackay. All rights reserved; 
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2, or (at your option)
+ * any later version.
+ *
+ * THIS SOFTWARE IS PROVIDED ``AS IS'' AND ANY EXPRESSED OR IMPLIED WARRANTIES,
+ * INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND
+ * FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE
+ * AUTHOR BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY,
+ * OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ * ============================================================================
+ */
+
+/*
+ * discover.h
+ *
+ * finding the public address from outside, for hosts behind NAT
+ *
+ */
+
+#ifndef _DISCOVER_H
+#define _DISCOVER_H
+
+#include <netinet/in.h>
+
+#define DISCOVER_MAX_SOURCES 8
+// seconds to wait for the sources to agree
+#define DISCOVER_TIMEOUT 5
+// how many times the update period the polling backs off to
+#define DISCOVER_MAX_BACKOFF 8
+
+extern int discover_add(char *spec);
+extern int discover_sources(void);
+extern void discover_quorum(int n);
+extern int discover_run(struct in_addr *addr);
+extern char *discover_error(void);
+extern int discover_interval(int period, int changed);
+extern int discover_listen(void);
+extern int discover_announced(int fd);
+extern void discover_close(void);
+
+#endif
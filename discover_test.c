@@ -0,0 +1,218 @@
+/* ============================================================================
+ * Copyright (C) 2001 Angus Mackay. All rights reserved; 
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2, or (at your option)
+ * any later version.
+ *
+ * THIS SOFTWARE IS PROVIDED ``AS IS'' AND ANY EXPRESSED OR IMPLIED WARRANTIES,
+ * INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND
+ * FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE
+ * AUTHOR BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY,
+ * OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ * ============================================================================
+ */
+
+/*
+ * discover_test.c
+ *
+ * checks that STUN binding requests can't be answered by someone who
+ * only knows how the daemon starts: two sources asked in one run and the
+ * same source asked in two runs, each run a fresh process as the daemon
+ * would be, must all get different transaction IDs, and an answer with an
+ * ID that wasn't asked must be ignored.
+ *
+ * usage: discover_test
+ *
+ */
+
+#ifdef HAVE_CONFIG_H
+#  include <config.h>
+#endif
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <poll.h>
+#include <signal.h>
+#if HAVE_SYS_TYPES_H
+#  include <sys/types.h>
+#endif
+#if HAVE_SYS_WAIT_H
+#  include <sys/wait.h>
+#endif
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <arpa/inet.h>
+
+#include <discover.h>
+
+#define SOURCES 2
+#define RUNS 2
+#define TID_LEN 12
+// what the real servers say, the forged answer says otherwise
+#define REAL_ADDRESS "192.0.2.7"
+#define FORGED_ADDRESS "198.51.100.1"
+
+int options = 0;
+
+/* a binding response for tid with addr as the MAPPED-ADDRESS */
+static void answer(int fd, struct sockaddr_in *to, unsigned char *tid,
+    char *addr)
+{
+  unsigned char buf[32];
+  struct in_addr in;
+
+  memset(buf, 0, sizeof(buf));
+  buf[0] = 0x01;
+  buf[1] = 0x01;
+  buf[3] = 12;
+  buf[4] = 0x21;
+  buf[5] = 0x12;
+  buf[6] = 0xA4;
+  buf[7] = 0x42;
+  memcpy(buf + 8, tid, TID_LEN);
+  buf[21] = 0x01;
+  buf[23] = 8;
+  buf[25] = 0x01;
+  inet_aton(addr, &in);
+  memcpy(buf + 28, &in.s_addr, 4);
+  sendto(fd, buf, sizeof(buf), 0, (struct sockaddr *)to, sizeof(*to));
+}
+
+/*
+ * one run of the discovery in a child against the servers on fds, the
+ * IDs each was asked with go in tids. returns 0 if the child ended up with
+ * the real address.
+ */
+static int run(int *fds, int *ports, unsigned char tids[][TID_LEN])
+{
+  unsigned char buf[512];
+  unsigned char forged[TID_LEN];
+  struct sockaddr_in from;
+  struct pollfd pfd;
+  struct in_addr addr;
+  char spec[64];
+  socklen_t len;
+  pid_t pid;
+  int status;
+  int i;
+  int j;
+
+  srand(1);
+  if((pid=fork()) == 0)
+  {
+    for(i=0; i<SOURCES; i++)
+    {
+      snprintf(spec, sizeof(spec), "stun:127.0.0.1:%d", ports[i]);
+      discover_add(spec);
+    }
+    if(discover_run(&addr) != 0)
+    {
+      _exit(2);
+    }
+    _exit(strcmp(inet_ntoa(addr), REAL_ADDRESS) == 0 ? 0 : 1);
+  }
+
+  for(i=0; i<SOURCES; i++)
+  {
+    pfd.fd = fds[i];
+    pfd.events = POLLIN;
+    len = sizeof(from);
+    if(poll(&pfd, 1, DISCOVER_TIMEOUT * 1000) != 1 ||
+        recvfrom(fds[i], buf, sizeof(buf), 0, (struct sockaddr *)&from,
+          &len) < 20)
+    {
+      fprintf(stderr, "no request for source %d\n", i);
+      kill(pid, SIGKILL);
+      waitpid(pid, &status, 0);
+      return(-1);
+    }
+    memcpy(tids[i], buf + 8, TID_LEN);
+    // what an off-path host sends first, knowing an unseeded rand()
+    // gives the same IDs on every start
+    for(j=0; j<TID_LEN; j++)
+    {
+      forged[j] = rand() & 0xff;
+    }
+    answer(fds[i], &from, forged, FORGED_ADDRESS);
+    answer(fds[i], &from, tids[i], REAL_ADDRESS);
+  }
+
+  waitpid(pid, &status, 0);
+  if(!WIFEXITED(status) || WEXITSTATUS(status) != 0)
+  {
+    fprintf(stderr, "discovery didn't find " REAL_ADDRESS "\n");
+    return(-1);
+  }
+  return(0);
+}
+
+int main(int argc, char **argv)
+{
+  unsigned char tids[RUNS][SOURCES][TID_LEN];
+  struct sockaddr_in sin;
+  socklen_t len;
+  int fds[SOURCES];
+  int ports[SOURCES];
+  int failed = 0;
+  int i;
+  int j;
+
+  for(i=0; i<SOURCES; i++)
+  {
+    memset(&sin, 0, sizeof(sin));
+    sin.sin_family = AF_INET;
+    sin.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    len = sizeof(sin);
+    if((fds[i]=socket(AF_INET, SOCK_DGRAM, 0)) == -1 ||
+        bind(fds[i], (struct sockaddr *)&sin, sizeof(sin)) != 0 ||
+        getsockname(fds[i], (struct sockaddr *)&sin, &len) != 0)
+    {
+      perror("discover_test: socket");
+      return(1);
+    }
+    ports[i] = ntohs(sin.sin_port);
+  }
+
+  for(i=0; i<RUNS; i++)
+  {
+    if(run(fds, ports, tids[i]) != 0)
+    {
+      return(1);
+    }
+  }
+
+  for(i=0; i<RUNS; i++)
+  {
+    for(j=1; j<SOURCES; j++)
+    {
+      if(memcmp(tids[i][0], tids[i][j], TID_LEN) == 0)
+      {
+        fprintf(stderr, "run %d: sources 0 and %d got the same ID\n", i, j);
+        failed = 1;
+      }
+    }
+  }
+  for(j=0; j<SOURCES; j++)
+  {
+    for(i=1; i<RUNS; i++)
+    {
+      if(memcmp(tids[0][j], tids[i][j], TID_LEN) == 0)
+      {
+        fprintf(stderr, "source %d: runs 0 and %d got the same ID\n", j, i);
+        failed = 1;
+      }
+    }
+  }
+
+  printf("discover_test: %s\n", failed ? "FAIL" : "ok");
+  return(failed);
+}
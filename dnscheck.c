@@ -0,0 +1,962 @@
+/* ============================================================================
+ * Copyright (C) 2001 Angus Mackay. All rights reserved; 
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2, or (at your option)
+ * any later version.
+ *
+ * THIS SOFTWARE IS PROVIDED ``AS IS'' AND ANY EXPRESSED OR IMPLIED WARRANTIES,
+ * INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND
+ * FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE
+ * AUTHOR BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY,
+ * OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ * ============================================================================
+ */
+
+/*
+ * dnscheck.c
+ *
+ * an update that only gets "nochg" back still counts against the
+ * provider's abuse limits, so before the updates that are likely to be
+ * like that (the first one with no cache, the max-interval refreshes) the
+ * record can be looked up and the update skipped if it is already right.
+ *
+ * with "auto" the host's own nameservers are found, through the ones in
+ * /etc/resolv.conf, and asked directly so a cached answer can't say the
+ * record is right when it isn't.  the server found for each host is
+ * remembered until it stops answering, and that there isn't one for
+ * AUTHORITY_RETRY seconds; the ordinary resolvers are asked instead.
+ * given an address, that server is asked.  the same lookups tell when a
+ * change that was sent has reached DNS.
+ *
+ * the queries are plain UDP, one at a time, each given DNSCHECK_TIMEOUT
+ * seconds and sent again half way through.  dnscheck_matches() waits for
+ * them and gives up after DNSCHECK_BUDGET seconds in all;
+ * dnscheck_start() has the event loop wait for them instead.
+ *
+ */
+
+#ifdef HAVE_CONFIG_H
+#  include <config.h>
+#endif
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <ctype.h>
+#include <unistd.h>
+#include <errno.h>
+#include <fcntl.h>
+#if HAVE_SYS_TYPES_H
+#  include <sys/types.h>
+#endif
+#include <sys/time.h>
+#include <time.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <arpa/inet.h>
+
+#include <dprintf.h>
+#include <entropy.h>
+#include <event.h>
+#include <dnscheck.h>
+
+#define RESOLV_CONF "/etc/resolv.conf"
+#define MAX_RESOLVERS 3
+#define MAX_RECORDS 32
+#define MAX_NAME 256
+#define DNS_PORT 53
+#define MAX_AUTHORITIES 8
+// seconds before looking again for nameservers that weren't found
+#define AUTHORITY_RETRY 600
+
+#define TYPE_A 1
+#define TYPE_NS 2
+#define TYPE_CNAME 5
+#define TYPE_AAAA 28
+#define CLASS_IN 1
+
+// header flags
+#define FLAG_QR 0x8000
+#define FLAG_AA 0x0400
+#define FLAG_TC 0x0200
+#define FLAG_RD 0x0100
+
+struct record
+{
+  int section;
+  int type;
+  char name[MAX_NAME];
+  union
+  {
+    struct in_addr v4;
+    struct in6_addr v6;
+    char name[MAX_NAME];
+  } data;
+};
+
+struct answer
+{
+  int flags;
+  int rcode;
+  int nrecords;
+  struct record records[MAX_RECORDS];
+};
+
+enum {
+  SECTION_ANSWER = 0,
+  SECTION_AUTHORITY,
+  SECTION_ADDITIONAL,
+};
+
+static int enabled = 0;
+static int automatic = 1;
+// the server given when not automatic
+static struct in_addr server;
+static struct in_addr resolvers[MAX_RESOLVERS];
+static int nresolvers = -1;
+
+// the nameserver with authority over a host, or that none was found
+struct authority
+{
+  char host[MAX_NAME];
+  struct in_addr server;
+  int found;
+  time_t when;
+};
+
+static struct authority authorities[MAX_AUTHORITIES];
+
+enum {
+  STAGE_DONE = 0,
+  // finding the host's nameserver: the zone's NS records from a resolver,
+  // a nameserver's address and whether it answers with authority
+  STAGE_NS,
+  STAGE_NS_ADDR,
+  STAGE_AA,
+  // the record, from the host's nameserver or from a resolver
+  STAGE_RECORD,
+  STAGE_RESOLVER,
+};
+
+/*
+ * a check of some hosts' records, a query at a time. advance() moves it
+ * on as each query is answered or not.
+ */
+struct lookup
+{
+  int stage;
+  char hosts[1024];
+  char *host;
+  char *next;
+  char v4[64];
+  char v6[64];
+  int type;
+  // finding the host's nameserver
+  char *zone;
+  int resolver;
+  struct answer ns;
+  int nsi;
+  // the query out
+  struct in_addr to;
+  unsigned char req[MAX_NAME + 32];
+  int reqlen;
+  int id;
+  int tries;
+  int fd;
+  struct timeval sent;
+  struct timeval deadline;
+  int res;
+  // dnscheck_start()'s, the query is then watched by event.c
+  dnscheck_cb done;
+  void *arg;
+};
+
+// dnscheck_matches()'s and dnscheck_start()'s
+// allocated when first used, most of a lookup is room for an answer
+static struct lookup *waited = NULL;
+static struct lookup *background = NULL;
+
+static void advance(struct lookup *l, struct answer *ans);
+static void on_readable(int fd, void *arg);
+static void on_timeout(void *arg);
+
+/*
+ * dnscheck_set
+ *
+ * turn the check on, arg is "auto" or the address of the nameserver to
+ * ask. returns -1 if it is neither.
+ */
+int dnscheck_set(char *arg)
+{
+  if(strcmp(arg, DNSCHECK_AUTO) == 0)
+  {
+    automatic = 1;
+  }
+  else if(inet_aton(arg, &server) != 0)
+  {
+    automatic = 0;
+  }
+  else
+  {
+    return(-1);
+  }
+  enabled = 1;
+  return(0);
+}
+
+int dnscheck_enabled(void)
+{
+  return(enabled);
+}
+
+static void read_resolv_conf(void)
+{
+  FILE *fp;
+  char line[256];
+  char addr[64];
+
+  nresolvers = 0;
+  if((fp=fopen(RESOLV_CONF, "r")) != NULL)
+  {
+    while(nresolvers < MAX_RESOLVERS && fgets(line, sizeof(line), fp) != NULL)
+    {
+      if(sscanf(line, "nameserver %63s", addr) == 1 &&
+          inet_aton(addr, &resolvers[nresolvers]) != 0)
+      {
+        nresolvers++;
+      }
+    }
+    fclose(fp);
+  }
+  if(nresolvers == 0)
+  {
+    inet_aton("127.0.0.1", &resolvers[nresolvers++]);
+  }
+}
+
+/* the name at pos in msg, following compression pointers */
+static int read_name(unsigned char *msg, int len, int pos, char *out)
+{
+  int end = -1;
+  int jumps = 0;
+  int n = 0;
+  int l;
+
+  *out = '\0';
+  while(pos < len)
+  {
+    l = msg[pos];
+    if(l == 0)
+    {
+      if(n > 0) { n--; }
+      out[n] = '\0';
+      return(end != -1 ? end : pos + 1);
+    }
+    if((l & 0xc0) == 0xc0)
+    {
+      if(pos + 1 >= len || ++jumps > 16)
+      {
+        return(-1);
+      }
+      if(end == -1) { end = pos + 2; }
+      pos = ((l & 0x3f) << 8) | msg[pos+1];
+      continue;
+    }
+    if(pos + 1 + l > len || n + l + 1 >= MAX_NAME)
+    {
+      return(-1);
+    }
+    memcpy(out + n, msg + pos + 1, l);
+    n += l;
+    out[n++] = '.';
+    pos += 1 + l;
+  }
+  return(-1);
+}
+
+static int build_query(unsigned char *buf, int size, int id, char *name,
+    int type, int rd)
+{
+  char *label;
+  char *dot;
+  int pos = 12;
+  int l;
+
+  memset(buf, 0, 12);
+  buf[0] = id >> 8;
+  buf[1] = id & 0xff;
+  buf[2] = rd ? FLAG_RD >> 8 : 0;
+  buf[5] = 1;
+  for(label=name; label != NULL && *label != '\0'; label=dot ? dot + 1 : NULL)
+  {
+    dot = strchr(label, '.');
+    l = dot ? (int)(dot - label) : (int)strlen(label);
+    if(l == 0 || l > 63 || pos + l + 6 > size)
+    {
+      return(-1);
+    }
+    buf[pos++] = l;
+    memcpy(buf + pos, label, l);
+    pos += l;
+  }
+  buf[pos++] = 0;
+  buf[pos++] = type >> 8;
+  buf[pos++] = type & 0xff;
+  buf[pos++] = 0;
+  buf[pos++] = CLASS_IN;
+  return(pos);
+}
+
+/*
+ * the records in msg if it answers query: the same ID and the one
+ * question asked, with the name's case aside as servers needn't keep it
+ */
+static int parse_answer(unsigned char *msg, int len, unsigned char *query,
+    int qlen, struct answer *ans)
+{
+  char name[MAX_NAME];
+  struct record *r;
+  int counts[3];
+  int section;
+  int type;
+  int rdlen;
+  int pos;
+  int i;
+
+  if(len < qlen || memcmp(msg, query, 2) != 0 ||
+      ((msg[4] << 8) | msg[5]) != 1)
+  {
+    return(-1);
+  }
+  for(i=12; i<qlen; i++)
+  {
+    if(i < qlen - 4 ? tolower(msg[i]) != tolower(query[i]) :
+        msg[i] != query[i])
+    {
+      return(-1);
+    }
+  }
+  ans->flags = (msg[2] << 8) | msg[3];
+  ans->rcode = ans->flags & 0x0f;
+  ans->nrecords = 0;
+  if(!(ans->flags & FLAG_QR) || (ans->flags & FLAG_TC))
+  {
+    return(-1);
+  }
+  counts[SECTION_ANSWER] = (msg[6] << 8) | msg[7];
+  counts[SECTION_AUTHORITY] = (msg[8] << 8) | msg[9];
+  counts[SECTION_ADDITIONAL] = (msg[10] << 8) | msg[11];
+
+  // past the question
+  pos = qlen;
+
+  for(section=0; section<3; section++)
+  {
+    for(i=0; i<counts[section]; i++)
+    {
+      if((pos=read_name(msg, len, pos, name)) == -1 || pos + 10 > len)
+      {
+        return(-1);
+      }
+      type = (msg[pos] << 8) | msg[pos+1];
+      rdlen = (msg[pos+8] << 8) | msg[pos+9];
+      pos += 10;
+      if(pos + rdlen > len)
+      {
+        return(-1);
+      }
+      if(ans->nrecords < MAX_RECORDS &&
+          ((type == TYPE_A && rdlen == 4) ||
+           (type == TYPE_AAAA && rdlen == 16) ||
+           type == TYPE_NS || type == TYPE_CNAME))
+      {
+        r = &ans->records[ans->nrecords];
+        r->section = section;
+        r->type = type;
+        snprintf(r->name, sizeof(r->name), "%s", name);
+        if(type == TYPE_NS || type == TYPE_CNAME)
+        {
+          if(read_name(msg, len, pos, r->data.name) == -1)
+          {
+            return(-1);
+          }
+        }
+        else
+        {
+          memcpy(&r->data, msg + pos, rdlen);
+        }
+        ans->nrecords++;
+      }
+      pos += rdlen;
+    }
+  }
+  return(0);
+}
+
+/* ask to when its half of the timeout is up without an answer */
+#define RETRY_MS (DNSCHECK_TIMEOUT * 500)
+
+static int expired(struct lookup *l)
+{
+  struct timeval now;
+
+  gettimeofday(&now, NULL);
+  return(now.tv_sec > l->deadline.tv_sec ||
+      (now.tv_sec == l->deadline.tv_sec && now.tv_usec > l->deadline.tv_usec));
+}
+
+/* the nameserver remembered for host, or a slot to remember one in */
+static struct authority *authority_for(char *host, int create)
+{
+  struct authority *oldest = &authorities[0];
+  int i;
+
+  for(i=0; i<MAX_AUTHORITIES; i++)
+  {
+    if(strcasecmp(authorities[i].host, host) == 0)
+    {
+      return(&authorities[i]);
+    }
+    if(authorities[i].when < oldest->when)
+    {
+      oldest = &authorities[i];
+    }
+  }
+  if(!create)
+  {
+    return(NULL);
+  }
+  memset(oldest, 0, sizeof(*oldest));
+  snprintf(oldest->host, sizeof(oldest->host), "%s", host);
+  return(oldest);
+}
+
+/* host's nameserver is addr, or there isn't one if addr is NULL */
+static void remember(char *host, struct in_addr *addr)
+{
+  struct authority *a = authority_for(host, 1);
+
+  a->found = addr != NULL;
+  if(addr != NULL)
+  {
+    a->server = *addr;
+  }
+  a->when = time(NULL);
+}
+
+static void stop_query(struct lookup *l)
+{
+  if(l->fd != -1)
+  {
+    if(l->done != NULL)
+    {
+      event_del(l->fd);
+      event_timer_del(on_timeout, l);
+    }
+    close(l->fd);
+    l->fd = -1;
+  }
+}
+
+static void finish(struct lookup *l, int res)
+{
+  dnscheck_cb done = l->done;
+
+  stop_query(l);
+  l->stage = STAGE_DONE;
+  l->res = res;
+  if(done != NULL)
+  {
+    l->done = NULL;
+    done(res, l->arg);
+  }
+}
+
+/*
+ * send to the query for name's records of type, what comes back (or
+ * doesn't) goes to advance() in stage
+ */
+static void ask(struct lookup *l, int stage, struct in_addr *to, char *name,
+    int type, int rd)
+{
+  struct sockaddr_in sin;
+  unsigned short id;
+
+  stop_query(l);
+  if(expired(l))
+  {
+    dprintf((stderr, "dnscheck: out of time looking up %s\n", l->host));
+    finish(l, -1);
+    return;
+  }
+  l->stage = stage;
+  l->to = *to;
+  // a forged answer has to guess this
+  entropy_fill(&id, sizeof(id));
+  l->id = id;
+  l->tries = 1;
+  gettimeofday(&l->sent, NULL);
+  if((l->reqlen=build_query(l->req, sizeof(l->req), l->id, name, type, rd)) == -1 ||
+      (l->fd=socket(AF_INET, SOCK_DGRAM, 0)) == -1)
+  {
+    advance(l, NULL);
+    return;
+  }
+  fcntl(l->fd, F_SETFL, fcntl(l->fd, F_GETFL) | O_NONBLOCK);
+  fcntl(l->fd, F_SETFD, FD_CLOEXEC);
+  memset(&sin, 0, sizeof(sin));
+  sin.sin_family = AF_INET;
+  sin.sin_port = htons(DNS_PORT);
+  sin.sin_addr = l->to;
+  if(connect(l->fd, (struct sockaddr *)&sin, sizeof(sin)) == -1 ||
+      send(l->fd, l->req, l->reqlen, 0) != l->reqlen)
+  {
+    stop_query(l);
+    advance(l, NULL);
+    return;
+  }
+  if(l->done != NULL)
+  {
+    if(event_add(l->fd, on_readable, l) != 0)
+    {
+      close(l->fd);
+      l->fd = -1;
+      advance(l, NULL);
+      return;
+    }
+    if(event_timer(RETRY_MS, on_timeout, l) != 0)
+    {
+      stop_query(l);
+      advance(l, NULL);
+    }
+  }
+}
+
+/* resend once half way through the timeout, after that there's no answer */
+static void retry(struct lookup *l)
+{
+  if(l->tries < 2 && !expired(l) &&
+      send(l->fd, l->req, l->reqlen, 0) == l->reqlen &&
+      (l->done == NULL || event_timer(RETRY_MS, on_timeout, l) == 0))
+  {
+    l->tries++;
+    gettimeofday(&l->sent, NULL);
+    return;
+  }
+  dprintf((stderr, "dnscheck: no answer from %s\n", inet_ntoa(l->to)));
+  stop_query(l);
+  advance(l, NULL);
+}
+
+/* 1 if an answer was read, 0 if not yet and -1 if there won't be one */
+static int receive(struct lookup *l, struct answer *ans)
+{
+  unsigned char buf[1500];
+  int n;
+
+  if((n=recv(l->fd, buf, sizeof(buf), 0)) == -1)
+  {
+    return(errno == ECONNREFUSED ? -1 : 0);
+  }
+  return(parse_answer(buf, n, l->req, l->reqlen, ans) == 0 ? 1 : 0);
+}
+
+static void on_readable(int fd, void *arg)
+{
+  struct lookup *l = (struct lookup *)arg;
+  struct answer ans;
+  int r;
+
+  if((r=receive(l, &ans)) != 0)
+  {
+    stop_query(l);
+    advance(l, r == 1 ? &ans : NULL);
+  }
+}
+
+static void on_timeout(void *arg)
+{
+  retry((struct lookup *)arg);
+}
+
+/* ask for the host's record of l->type, from its own nameserver if known */
+static void ask_record(struct lookup *l)
+{
+  struct authority *a;
+
+  if(!automatic)
+  {
+    ask(l, STAGE_RECORD, &server, l->host, l->type, 1);
+  }
+  else if((a=authority_for(l->host, 0)) != NULL && a->found)
+  {
+    ask(l, STAGE_RECORD, &a->server, l->host, l->type, 0);
+  }
+  else
+  {
+    l->resolver = 0;
+    ask(l, STAGE_RESOLVER, &resolvers[0], l->host, l->type, 1);
+  }
+}
+
+/* on to the next host, finding its nameserver first if need be */
+static void next_host(struct lookup *l)
+{
+  struct authority *a;
+  char *comma;
+
+  do
+  {
+    if(l->next == NULL)
+    {
+      finish(l, 1);
+      return;
+    }
+    l->host = l->next;
+    if((comma=strchr(l->host, ',')) != NULL)
+    {
+      *comma++ = '\0';
+    }
+    l->next = comma;
+  } while(*l->host == '\0');
+  l->type = TYPE_A;
+
+  a = authority_for(l->host, 0);
+  if(!automatic || (a != NULL && (a->found ||
+          time(NULL) - a->when < AUTHORITY_RETRY)))
+  {
+    ask_record(l);
+    return;
+  }
+  // the closest zone with NS records of its own
+  l->zone = l->host;
+  l->resolver = 0;
+  ask(l, STAGE_NS, &resolvers[0], l->zone, TYPE_NS, 1);
+}
+
+/* try the zone's next nameserver for authority over the host */
+static void next_nameserver(struct lookup *l)
+{
+  struct record *r;
+  int i;
+
+  while(++l->nsi < l->ns.nrecords)
+  {
+    r = &l->ns.records[l->nsi];
+    if(r->type != TYPE_NS || r->section != SECTION_ANSWER)
+    {
+      continue;
+    }
+    // glue saves asking for its address
+    for(i=0; i<l->ns.nrecords; i++)
+    {
+      if(l->ns.records[i].type == TYPE_A &&
+          strcasecmp(l->ns.records[i].name, r->data.name) == 0)
+      {
+        ask(l, STAGE_AA, &l->ns.records[i].data.v4, l->host, TYPE_A, 0);
+        return;
+      }
+    }
+    l->resolver = 0;
+    ask(l, STAGE_NS_ADDR, &resolvers[0], r->data.name, TYPE_A, 1);
+    return;
+  }
+  remember(l->host, NULL);
+  ask_record(l);
+}
+
+/* the host's record of l->type is in, is it just the address? */
+static void checked(struct lookup *l, struct answer *ans)
+{
+  struct in6_addr want;
+  int count = 0;
+  int same = 0;
+  int len = l->type == TYPE_A ? 4 : 16;
+  char *addr = l->type == TYPE_A ? l->v4 : l->v6;
+  int i;
+
+  // NXDOMAIN is an answer too, it just isn't right
+  if(ans->rcode != 0 && ans->rcode != 3)
+  {
+    finish(l, -1);
+    return;
+  }
+  inet_pton(l->type == TYPE_A ? AF_INET : AF_INET6, addr, &want);
+  for(i=0; i<ans->nrecords; i++)
+  {
+    if(ans->records[i].section == SECTION_ANSWER &&
+        ans->records[i].type == l->type)
+    {
+      count++;
+      same += memcmp(&ans->records[i].data, &want, len) == 0;
+    }
+  }
+  dprintf((stderr, "dnscheck: %s has %d records of type %d, %d of them %s\n",
+        l->host, count, l->type, same, addr));
+  if(count != 1 || same != 1)
+  {
+    finish(l, 0);
+  }
+  else if(l->type == TYPE_A && *l->v6 != '\0')
+  {
+    l->type = TYPE_AAAA;
+    ask_record(l);
+  }
+  else
+  {
+    next_host(l);
+  }
+}
+
+/*
+ * take the lookup on from its last query, ans is NULL if that got no
+ * usable answer
+ */
+static void advance(struct lookup *l, struct answer *ans)
+{
+  struct authority *a;
+  char *name;
+  int i;
+
+  switch(l->stage)
+  {
+    case STAGE_NS:
+      if(ans == NULL)
+      {
+        // with no resolver answering there's no finding it
+        if(++l->resolver < nresolvers)
+        {
+          ask(l, STAGE_NS, &resolvers[l->resolver], l->zone, TYPE_NS, 1);
+          return;
+        }
+        remember(l->host, NULL);
+        ask_record(l);
+        return;
+      }
+      for(i=0; i<ans->nrecords; i++)
+      {
+        if(ans->records[i].type == TYPE_NS &&
+            ans->records[i].section == SECTION_ANSWER)
+        {
+          l->ns = *ans;
+          l->nsi = -1;
+          next_nameserver(l);
+          return;
+        }
+      }
+      // not a zone of its own, try its parent
+      if((l->zone=strchr(l->zone, '.')) == NULL || *++l->zone == '\0')
+      {
+        remember(l->host, NULL);
+        ask_record(l);
+        return;
+      }
+      l->resolver = 0;
+      ask(l, STAGE_NS, &resolvers[0], l->zone, TYPE_NS, 1);
+      return;
+
+    case STAGE_NS_ADDR:
+      name = l->ns.records[l->nsi].data.name;
+      if(ans == NULL)
+      {
+        if(++l->resolver < nresolvers)
+        {
+          ask(l, STAGE_NS_ADDR, &resolvers[l->resolver], name, TYPE_A, 1);
+        }
+        else
+        {
+          next_nameserver(l);
+        }
+        return;
+      }
+      for(i=0; i<ans->nrecords; i++)
+      {
+        if(ans->records[i].type == TYPE_A &&
+            ans->records[i].section == SECTION_ANSWER)
+        {
+          ask(l, STAGE_AA, &ans->records[i].data.v4, l->host, TYPE_A, 0);
+          return;
+        }
+      }
+      next_nameserver(l);
+      return;
+
+    case STAGE_AA:
+      if(ans != NULL && (ans->flags & FLAG_AA))
+      {
+        dprintf((stderr, "dnscheck: %s is authoritative for %s\n",
+              l->ns.records[l->nsi].data.name, l->host));
+        remember(l->host, &l->to);
+        ask_record(l);
+        return;
+      }
+      next_nameserver(l);
+      return;
+
+    case STAGE_RECORD:
+      if(ans != NULL)
+      {
+        checked(l, ans);
+        return;
+      }
+      if(!automatic)
+      {
+        finish(l, -1);
+        return;
+      }
+      // look for it again next time
+      if((a=authority_for(l->host, 0)) != NULL)
+      {
+        a->found = 0;
+        a->when = 0;
+      }
+      l->resolver = 0;
+      ask(l, STAGE_RESOLVER, &resolvers[0], l->host, l->type, 1);
+      return;
+
+    case STAGE_RESOLVER:
+      if(ans != NULL)
+      {
+        checked(l, ans);
+      }
+      else if(++l->resolver < nresolvers)
+      {
+        ask(l, STAGE_RESOLVER, &resolvers[l->resolver], l->host, l->type, 1);
+      }
+      else
+      {
+        finish(l, -1);
+      }
+      return;
+  }
+}
+
+/* set up l to check hosts, -1 if there is nothing to check them against */
+/* *l, allocating it the first time */
+static struct lookup *lookup_get(struct lookup **l)
+{
+  if(*l == NULL && (*l=calloc(1, sizeof(struct lookup))) == NULL)
+  {
+    dprintf((stderr, "dnscheck: out of memory\n"));
+  }
+  return(*l);
+}
+
+static int begin(struct lookup *l, char *hosts, char *v4, char *v6)
+{
+  struct in6_addr a;
+
+  l->fd = -1;
+  l->done = NULL;
+  l->stage = STAGE_DONE;
+  if(v6 == NULL)
+  {
+    v6 = "";
+  }
+  if(hosts == NULL || v4 == NULL || inet_pton(AF_INET, v4, &a) != 1 ||
+      (*v6 != '\0' && inet_pton(AF_INET6, v6, &a) != 1) ||
+      strlen(v4) >= sizeof(l->v4) || strlen(v6) >= sizeof(l->v6))
+  {
+    return(-1);
+  }
+  if(nresolvers == -1)
+  {
+    read_resolv_conf();
+  }
+  snprintf(l->hosts, sizeof(l->hosts), "%s", hosts);
+  strcpy(l->v4, v4);
+  strcpy(l->v6, v6);
+  l->next = l->hosts;
+  gettimeofday(&l->deadline, NULL);
+  l->deadline.tv_sec += DNSCHECK_BUDGET;
+  return(0);
+}
+
+/*
+ * dnscheck_matches
+ *
+ * 1 if the A record of each of the comma separated hosts is v4 and, if v6
+ * isn't NULL or empty, its AAAA record is v6, 0 if not and -1 if DNS
+ * couldn't be asked
+ */
+int dnscheck_matches(char *hosts, char *v4, char *v6)
+{
+  struct lookup *l;
+  struct pollfd pfd;
+  struct answer ans;
+  struct timeval now;
+  int wait;
+  int r;
+
+  if((l=lookup_get(&waited)) == NULL || begin(l, hosts, v4, v6) != 0)
+  {
+    return(-1);
+  }
+  next_host(l);
+  while(l->stage != STAGE_DONE)
+  {
+    gettimeofday(&now, NULL);
+    wait = RETRY_MS - ((now.tv_sec - l->sent.tv_sec) * 1000 +
+        (now.tv_usec - l->sent.tv_usec) / 1000);
+    if(wait <= 0)
+    {
+      retry(l);
+      continue;
+    }
+    pfd.fd = l->fd;
+    pfd.events = POLLIN;
+    if(poll(&pfd, 1, wait) == 1 && (r=receive(l, &ans)) != 0)
+    {
+      stop_query(l);
+      advance(l, r == 1 ? &ans : NULL);
+    }
+  }
+  return(l->res);
+}
+
+/*
+ * dnscheck_start
+ *
+ * the check dnscheck_matches() makes, run from the event loop. done(res,
+ * arg) gets what dnscheck_matches() would have returned, possibly before
+ * this returns. a check already running is cancelled. returns -1 if there
+ * is nothing to check, in which case done isn't called.
+ */
+int dnscheck_start(char *hosts, char *v4, char *v6, dnscheck_cb done,
+    void *arg)
+{
+  struct lookup *l;
+
+  dnscheck_cancel();
+  if((l=lookup_get(&background)) == NULL || begin(l, hosts, v4, v6) != 0)
+  {
+    return(-1);
+  }
+  l->done = done;
+  l->arg = arg;
+  next_host(l);
+  return(0);
+}
+
+/*
+ * dnscheck_cancel
+ *
+ * stop the check dnscheck_start() is running, without calling its done
+ */
+void dnscheck_cancel(void)
+{
+  if(background != NULL && background->stage != STAGE_DONE)
+  {
+    stop_query(background);
+    background->stage = STAGE_DONE;
+    background->done = NULL;
+  }
+}
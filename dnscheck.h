@@ -0,0 +1,48 @@
+/* ============================================================================
+ * Copyright (C) 2001 Angus Mackay. All rights reserved; 
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2, or (at your option)
+ * any later version.
+ *
+ * THIS SOFTWARE IS PROVIDED ``AS IS'' AND ANY EXPRESSED OR IMPLIED WARRANTIES,
+ * INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND
+ * FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE
+ * AUTHOR BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY,
+ * OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ * ============================================================================
+ */
+
+/*
+ * dnscheck.h
+ *
+ * asking DNS whether an update would change anything
+ *
+ */
+
+#ifndef _DNSCHECK_H
+#define _DNSCHECK_H
+
+// find and ask the host's own nameservers
+#define DNSCHECK_AUTO "auto"
+// seconds to wait for each answer
+#define DNSCHECK_TIMEOUT 2
+// seconds for all of a dnscheck_matches()
+#define DNSCHECK_BUDGET 5
+
+typedef void (*dnscheck_cb)(int res, void *arg);
+
+extern int dnscheck_set(char *arg);
+extern int dnscheck_enabled(void);
+extern int dnscheck_matches(char *hosts, char *v4, char *v6);
+extern int dnscheck_start(char *hosts, char *v4, char *v6, dnscheck_cb done,
+    void *arg);
+extern void dnscheck_cancel(void);
+
+#endif
@@ -0,0 +1,169 @@
+/* ============================================================================
+ * Copyright (C) 2001 Angus Mackay. All rights reserved; 
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2, or (at your option)
+ * any later version.
+ *
+ * THIS SOFTWARE IS PROVIDED ``AS IS'' AND ANY EXPRESSED OR IMPLIED WARRANTIES,
+ * INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND
+ * FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE
+ * AUTHOR BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY,
+ * OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ * ============================================================================
+ */
+
+/*
+ * encode.c
+ *
+ * bounded base64 and url (RFC 3986 percent) encoding.
+ *
+ * both encoders work from lookup tables and never call into the printf
+ * family, the output size is known up front so the caller can size its
+ * buffer (or refuse the input) before anything is written.
+ *
+ */
+
+#ifdef HAVE_CONFIG_H
+#  include <config.h>
+#endif
+
+#include <stdio.h>
+#include <string.h>
+
+#include <encode.h>
+
+static const char table64[] =
+  "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/";
+
+static const char hexdigits[] = "0123456789ABCDEF";
+
+/* non zero for the RFC 3986 unreserved characters */
+static const unsigned char unreserved[256] = {
+  0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,   /* 0x00 */
+  0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,   /* 0x10 */
+  0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 1, 1, 0,   /* 0x20 - . */
+  1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 0, 0, 0, 0, 0, 0,   /* 0x30 0-9 */
+  0, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1,   /* 0x40 A-O */
+  1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 0, 0, 0, 0, 1,   /* 0x50 P-Z _ */
+  0, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1,   /* 0x60 a-o */
+  1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 0, 0, 0, 1, 0,   /* 0x70 p-z ~ */
+  /* the rest are 0 */
+};
+
+/*
+ * base64_encode
+ *
+ * encode inlen bytes of in into out, which holds outlen bytes.
+ * returns the length of the encoded string (not counting the NUL) or -1 if
+ * out is too small, in which case out is left as an empty string.
+ */
+int base64_encode(const char *in, int inlen, char *out, int outlen)
+{
+  const unsigned char *ip = (const unsigned char *)in;
+  char *op = out;
+  unsigned int v;
+
+  if(inlen < 0 || outlen < BASE64_ENCODED_LEN(inlen))
+  {
+    if(outlen > 0) { *out = '\0'; }
+    return(-1);
+  }
+
+  for(; inlen >= 3; inlen -= 3, ip += 3, op += 4)
+  {
+    v = (ip[0] << 16) | (ip[1] << 8) | ip[2];
+    op[0] = table64[(v >> 18) & 0x3F];
+    op[1] = table64[(v >> 12) & 0x3F];
+    op[2] = table64[(v >> 6) & 0x3F];
+    op[3] = table64[v & 0x3F];
+  }
+
+  switch(inlen)
+  {
+    case 2:
+      v = (ip[0] << 16) | (ip[1] << 8);
+      op[0] = table64[(v >> 18) & 0x3F];
+      op[1] = table64[(v >> 12) & 0x3F];
+      op[2] = table64[(v >> 6) & 0x3F];
+      op[3] = '=';
+      op += 4;
+      break;
+    case 1:
+      v = ip[0] << 16;
+      op[0] = table64[(v >> 18) & 0x3F];
+      op[1] = table64[(v >> 12) & 0x3F];
+      op[2] = '=';
+      op[3] = '=';
+      op += 4;
+      break;
+  }
+  *op = '\0';
+
+  return(op - out);
+}
+
+/*
+ * url_encoded_len
+ *
+ * the length of the percent encoded form of in, not counting the NUL.
+ */
+int url_encoded_len(const char *in)
+{
+  const unsigned char *p;
+  int len = 0;
+
+  for(p=(const unsigned char *)in; *p != '\0'; p++)
+  {
+    len += unreserved[*p] ? 1 : 3;
+  }
+
+  return(len);
+}
+
+/*
+ * url_encode
+ *
+ * percent encode in into out, which holds outlen bytes. everything but the
+ * RFC 3986 unreserved set is escaped. returns the length of the encoded
+ * string or -1 if it does not fit, in which case out is an empty string.
+ */
+int url_encode(const char *in, char *out, int outlen)
+{
+  const unsigned char *p;
+  char *op = out;
+
+  if(outlen < 1)
+  {
+    return(-1);
+  }
+  if(url_encoded_len(in) >= outlen)
+  {
+    *out = '\0';
+    return(-1);
+  }
+
+  for(p=(const unsigned char *)in; *p != '\0'; p++)
+  {
+    if(unreserved[*p])
+    {
+      *op++ = *p;
+    }
+    else
+    {
+      *op++ = '%';
+      *op++ = hexdigits[*p >> 4];
+      *op++ = hexdigits[*p & 0x0F];
+    }
+  }
+  *op = '\0';
+
+  return(op - out);
+}
+
@@ -0,0 +1,193 @@
+/* ============================================================================
+ * Copyright (C) 2001 Angus Mackay. All rights reserved; 
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2, or (at your option)
+ * any later version.
+ *
+ * THIS SOFTWARE IS PROVIDED ``AS IS'' AND ANY EXPRESSED OR IMPLIED WARRANTIES,
+ * INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND
+ * FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE
+ * AUTHOR BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY,
+ * OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ * ============================================================================
+ */
+
+/*
+ * encode_bench.c
+ *
+ * micro benchmark for the encoders in encode.c. the old sprintf() based
+ * base64Encode() from ez-ipupdate.c is kept here as the baseline, both are
+ * checked to produce the same output before anything is timed.
+ *
+ * usage: encode_bench [iterations]
+ *
+ */
+
+#ifdef HAVE_CONFIG_H
+#  include <config.h>
+#endif
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#if HAVE_SYS_TIME_H
+#  include <sys/time.h>
+#endif
+
+#include <encode.h>
+
+#define DEFAULT_ITERATIONS 1000000
+
+static char old_table64[]=
+  "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/";
+static void old_base64Encode(char *intext, char *output)
+{
+  unsigned char ibuf[3];
+  unsigned char obuf[4];
+  int i;
+  int inputparts;
+
+  while(*intext) {
+    for (i = inputparts = 0; i < 3; i++) { 
+      if(*intext) {
+        inputparts++;
+        ibuf[i] = *intext;
+        intext++;
+      }
+      else
+        ibuf[i] = 0;
+    }
+
+    obuf [0] = (ibuf [0] & 0xFC) >> 2;
+    obuf [1] = ((ibuf [0] & 0x03) << 4) | ((ibuf [1] & 0xF0) >> 4);
+    obuf [2] = ((ibuf [1] & 0x0F) << 2) | ((ibuf [2] & 0xC0) >> 6);
+    obuf [3] = ibuf [2] & 0x3F;
+
+    switch(inputparts) {
+      case 1: /* only one byte read */
+        sprintf(output, "%c%c==", 
+            old_table64[obuf[0]],
+            old_table64[obuf[1]]);
+        break;
+      case 2: /* two bytes read */
+        sprintf(output, "%c%c%c=", 
+            old_table64[obuf[0]],
+            old_table64[obuf[1]],
+            old_table64[obuf[2]]);
+        break;
+      default:
+        sprintf(output, "%c%c%c%c", 
+            old_table64[obuf[0]],
+            old_table64[obuf[1]],
+            old_table64[obuf[2]],
+            old_table64[obuf[3]] );
+        break;
+    }
+    output += 4;
+  }
+  *output=0;
+}
+
+static double now(void)
+{
+  struct timeval tv;
+
+  gettimeofday(&tv, NULL);
+  return(tv.tv_sec + tv.tv_usec / 1000000.0);
+}
+
+static void report(char *name, int iterations, int bytes, double secs)
+{
+  printf("%-24s %10.1f ns/op %10.1f MB/s\n", name,
+      secs * 1e9 / iterations, (double)bytes * iterations / secs / 1e6);
+}
+
+int main(int argc, char **argv)
+{
+  static char *inputs[] = {
+    "a",
+    "ab",
+    "user:password",
+    "someone@example.com:a rather longer pass phrase with spaces",
+  };
+  char big[256];
+  char out[512];
+  char out2[512];
+  int iterations = DEFAULT_ITERATIONS;
+  volatile int sink = 0;
+  double start;
+  int i;
+  int j;
+
+  if(argc > 1) { iterations = atoi(argv[1]); }
+  if(iterations < 1) { iterations = 1; }
+
+  for(i=0; i<sizeof(big)-1; i++)
+  {
+    big[i] = 'A' + (i % 58);
+  }
+  big[sizeof(big)-1] = '\0';
+
+  /* known answers first */
+  for(i=0; i<sizeof(inputs)/sizeof(inputs[0]); i++)
+  {
+    old_base64Encode(inputs[i], out);
+    base64_encode(inputs[i], strlen(inputs[i]), out2, sizeof(out2));
+    if(strcmp(out, out2) != 0)
+    {
+      fprintf(stderr, "base64 mismatch for \"%s\": %s != %s\n", inputs[i], out, out2);
+      return(1);
+    }
+  }
+  if(base64_encode(big, strlen(big), out, 16) != -1)
+  {
+    fprintf(stderr, "base64_encode did not reject a short buffer\n");
+    return(1);
+  }
+  url_encode("a b&c=d/~e", out, sizeof(out));
+  if(strcmp(out, "a%20b%26c%3Dd%2F~e") != 0)
+  {
+    fprintf(stderr, "url_encode mismatch: %s\n", out);
+    return(1);
+  }
+
+  for(j=0; j<2; j++)
+  {
+    char *in = j == 0 ? inputs[2] : big;
+    int len = strlen(in);
+
+    printf("input length %d, %d iterations\n", len, iterations);
+
+    start = now();
+    for(i=0; i<iterations; i++)
+    {
+      old_base64Encode(in, out);
+      sink += out[0];
+    }
+    report("base64Encode (old)", iterations, len, now() - start);
+
+    start = now();
+    for(i=0; i<iterations; i++)
+    {
+      sink += base64_encode(in, len, out, sizeof(out));
+    }
+    report("base64_encode", iterations, len, now() - start);
+
+    start = now();
+    for(i=0; i<iterations; i++)
+    {
+      sink += url_encode(in, out, sizeof(out));
+    }
+    report("url_encode", iterations, len, now() - start);
+  }
+
+  return(0);
+}
+
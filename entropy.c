@@ -0,0 +1,102 @@
+/* ============================================================================
+ * Copyright (C) 2001 Angus Mackay. All rights reserved; 
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2, or (at your option)
+ * any later version.
+ *
+ * THIS SOFTWARE IS PROVIDED ``AS IS'' AND ANY EXPRESSED OR IMPLIED WARRANTIES,
+ * INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND
+ * FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE
+ * AUTHOR BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY,
+ * OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ * ============================================================================
+ */
+
+/*
+ * entropy.c
+ *
+ * the STUN transaction and DNS query IDs are all that tells an answer to
+ * them from a forged one, so they have to be something another host can't
+ * work out.  they come from getrandom() where the kernel has it, otherwise
+ * /dev/urandom, and only when neither works from rand() seeded once with
+ * what this process has that others don't.
+ *
+ */
+
+#ifdef HAVE_CONFIG_H
+#  include <config.h>
+#endif
+
+#include <stdlib.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <time.h>
+#if HAVE_SYS_TYPES_H
+#  include <sys/types.h>
+#endif
+#include <sys/time.h>
+#ifdef __linux__
+#  include <sys/syscall.h>
+#endif
+
+#include <dprintf.h>
+#include <entropy.h>
+
+/* the bytes read, or -1 */
+static int entropy_read(unsigned char *buf, int len)
+{
+  int fd;
+  int n;
+
+#if defined(__linux__) && defined(SYS_getrandom)
+  if((n=syscall(SYS_getrandom, buf, len, 0)) == len)
+  {
+    return(n);
+  }
+#endif
+  if((fd=open("/dev/urandom", O_RDONLY)) == -1)
+  {
+    return(-1);
+  }
+  n = read(fd, buf, len);
+  close(fd);
+  return(n);
+}
+
+/*
+ * entropy_fill
+ *
+ * fill buf with len bytes nobody else can predict
+ */
+void entropy_fill(void *buf, int len)
+{
+  static int seeded = 0;
+  static unsigned int count = 0;
+  unsigned char *p = (unsigned char *)buf;
+  struct timeval now;
+  int i;
+
+  if(entropy_read(p, len) == len)
+  {
+    return;
+  }
+
+  if(!seeded)
+  {
+    dprintf((stderr, "no random source, falling back to rand()\n"));
+    gettimeofday(&now, NULL);
+    srand(getpid() ^ now.tv_sec ^ now.tv_usec);
+    seeded = 1;
+  }
+  for(i=0; i<len; i++)
+  {
+    p[i] = (rand() ^ count++) & 0xff;
+  }
+}
@@ -0,0 +1,295 @@
+/* ============================================================================
+ * Copyright (C) 2001 Angus Mackay. All rights reserved; 
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2, or (at your option)
+ * any later version.
+ *
+ * THIS SOFTWARE IS PROVIDED ``AS IS'' AND ANY EXPRESSED OR IMPLIED WARRANTIES,
+ * INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND
+ * FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE
+ * AUTHOR BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY,
+ * OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ * ============================================================================
+ */
+
+/*
+ * event.c
+ *
+ * event_wait() replaces sleep() in the daemon loop. it sleeps in select()
+ * on the registered descriptors and runs their callbacks as they become
+ * readable, and the callbacks of timers as they come due, so the sleep
+ * still lasts as long as asked unless a signal arrives.
+ *
+ */
+
+#ifdef HAVE_CONFIG_H
+#  include <config.h>
+#endif
+
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+#if HAVE_SYS_TYPES_H
+#  include <sys/types.h>
+#endif
+#if HAVE_SYS_TIME_H
+#  include <sys/time.h>
+#endif
+#if HAVE_ERRNO_H
+#  include <errno.h>
+#endif
+
+#include <error.h>
+#include <dprintf.h>
+#include <event.h>
+
+#define MAX_EVENT_FDS 16
+#define MAX_EVENT_TIMERS 16
+
+static struct
+{
+  int fd;
+  event_cb cb;
+  void *arg;
+} watched[MAX_EVENT_FDS];
+static int nwatched = 0;
+static struct
+{
+  struct timeval when;
+  event_timer_cb cb;
+  void *arg;
+} timers[MAX_EVENT_TIMERS];
+static int ntimers = 0;
+static unsigned long wakeups = 0;
+static int broken = 0;
+
+int event_add(int fd, event_cb cb, void *arg)
+{
+  if(nwatched >= MAX_EVENT_FDS)
+  {
+    return(-1);
+  }
+  watched[nwatched].fd = fd;
+  watched[nwatched].cb = cb;
+  watched[nwatched].arg = arg;
+  nwatched++;
+
+  return(0);
+}
+
+int event_del(int fd)
+{
+  int i;
+
+  for(i=0; i<nwatched; i++)
+  {
+    if(watched[i].fd == fd)
+    {
+      nwatched--;
+      memmove(&watched[i], &watched[i+1], (nwatched - i) * sizeof(watched[0]));
+      return(0);
+    }
+  }
+
+  return(-1);
+}
+
+/*
+ * event_timer
+ *
+ * call cb(arg) once, msec from now, from within event_wait()
+ */
+int event_timer(int msec, event_timer_cb cb, void *arg)
+{
+  struct timeval *when;
+
+  if(ntimers >= MAX_EVENT_TIMERS)
+  {
+    return(-1);
+  }
+  when = &timers[ntimers].when;
+  gettimeofday(when, NULL);
+  when->tv_sec += msec / 1000;
+  when->tv_usec += (msec % 1000) * 1000;
+  if(when->tv_usec >= 1000000)
+  {
+    when->tv_sec++;
+    when->tv_usec -= 1000000;
+  }
+  timers[ntimers].cb = cb;
+  timers[ntimers].arg = arg;
+  ntimers++;
+
+  return(0);
+}
+
+void event_timer_del(event_timer_cb cb, void *arg)
+{
+  int i;
+
+  for(i=ntimers-1; i>=0; i--)
+  {
+    if(timers[i].cb == cb && timers[i].arg == arg)
+    {
+      ntimers--;
+      memmove(&timers[i], &timers[i+1], (ntimers - i) * sizeof(timers[0]));
+    }
+  }
+}
+
+static int timer_due(struct timeval *when, struct timeval *now)
+{
+  return(when->tv_sec < now->tv_sec ||
+      (when->tv_sec == now->tv_sec && when->tv_usec <= now->tv_usec));
+}
+
+/* run the timers that are due, they may add new ones */
+static void run_timers(void)
+{
+  struct timeval now;
+  event_timer_cb cb;
+  void *arg;
+  int i;
+
+  gettimeofday(&now, NULL);
+  for(i=0; i<ntimers; )
+  {
+    if(!timer_due(&timers[i].when, &now))
+    {
+      i++;
+      continue;
+    }
+    cb = timers[i].cb;
+    arg = timers[i].arg;
+    ntimers--;
+    memmove(&timers[i], &timers[i+1], (ntimers - i) * sizeof(timers[0]));
+    cb(arg);
+    i = 0;
+  }
+}
+
+/*
+ * event_wait
+ *
+ * wait for up to seconds, dispatching callbacks in the meantime. returns 0
+ * once the time is up, 1 if a callback called event_break() and -1 if a
+ * signal (or an error) cut it short.
+ */
+int event_wait(int seconds)
+{
+  struct timeval deadline;
+  struct timeval now;
+  struct timeval tv;
+  fd_set readfds;
+  int max_fd;
+  int ret;
+  int i;
+
+  gettimeofday(&deadline, NULL);
+  deadline.tv_sec += seconds;
+
+  for(;;)
+  {
+    gettimeofday(&now, NULL);
+    tv.tv_sec = deadline.tv_sec - now.tv_sec;
+    tv.tv_usec = deadline.tv_usec - now.tv_usec;
+    if(tv.tv_usec < 0)
+    {
+      tv.tv_sec--;
+      tv.tv_usec += 1000000;
+    }
+    if(tv.tv_sec < 0)
+    {
+      return(0);
+    }
+    // the clock went backwards, don't sleep for longer than asked
+    if(tv.tv_sec > seconds)
+    {
+      deadline.tv_sec = now.tv_sec + seconds;
+      deadline.tv_usec = now.tv_usec;
+      tv.tv_sec = seconds;
+      tv.tv_usec = 0;
+    }
+    // wake up for the first timer due before then
+    for(i=0; i<ntimers; i++)
+    {
+      struct timeval in;
+
+      in.tv_sec = timers[i].when.tv_sec - now.tv_sec;
+      in.tv_usec = timers[i].when.tv_usec - now.tv_usec;
+      if(in.tv_usec < 0)
+      {
+        in.tv_sec--;
+        in.tv_usec += 1000000;
+      }
+      if(in.tv_sec < 0)
+      {
+        in.tv_sec = 0;
+        in.tv_usec = 0;
+      }
+      if(in.tv_sec < tv.tv_sec ||
+          (in.tv_sec == tv.tv_sec && in.tv_usec < tv.tv_usec))
+      {
+        tv = in;
+      }
+    }
+
+    FD_ZERO(&readfds);
+    max_fd = -1;
+    for(i=0; i<nwatched; i++)
+    {
+      FD_SET(watched[i].fd, &readfds);
+      if(watched[i].fd > max_fd) { max_fd = watched[i].fd; }
+    }
+
+    ret = select(max_fd + 1, &readfds, NULL, NULL, &tv);
+    wakeups++;
+
+    if(ret == -1)
+    {
+      if(errno != EINTR)
+      {
+        dprintf((stderr, "select: %s\n", error_string));
+      }
+      return(-1);
+    }
+
+    // callbacks may remove themselves so walk the list backwards
+    for(i=nwatched-1; ret > 0 && i>=0; i--)
+    {
+      if(FD_ISSET(watched[i].fd, &readfds))
+      {
+        watched[i].cb(watched[i].fd, watched[i].arg);
+      }
+    }
+    run_timers();
+    if(broken)
+    {
+      broken = 0;
+      return(1);
+    }
+  }
+}
+
+/*
+ * event_break
+ *
+ * make the current event_wait() return once the callbacks are done
+ */
+void event_break(void)
+{
+  broken = 1;
+}
+
+unsigned long event_wakeups(void)
+{
+  return(wakeups);
+}
+
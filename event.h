@@ -0,0 +1,44 @@
+/* ============================================================================
+ * Copyright (C) 2001 Angus Mackay. All rights reserved; 
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2, or (at your option)
+ * any later version.
+ *
+ * THIS SOFTWARE IS PROVIDED ``AS IS'' AND ANY EXPRESSED OR IMPLIED WARRANTIES,
+ * INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND
+ * FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE
+ * AUTHOR BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY,
+ * OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ * ============================================================================
+ */
+
+/*
+ * event.h
+ *
+ * a tiny select() based event loop for the daemon, lets it sleep between
+ * checks while still answering on its own sockets and running timers.
+ *
+ */
+
+#ifndef _EVENT_H
+#define _EVENT_H
+
+typedef void (*event_cb)(int fd, void *arg);
+typedef void (*event_timer_cb)(void *arg);
+
+extern int event_add(int fd, event_cb cb, void *arg);
+extern int event_del(int fd);
+extern int event_timer(int msec, event_timer_cb cb, void *arg);
+extern void event_timer_del(event_timer_cb cb, void *arg);
+extern int event_wait(int seconds);
+extern void event_break(void);
+extern unsigned long event_wakeups(void);
+
+#endif
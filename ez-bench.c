@@ -0,0 +1,1034 @@
+/* ============================================================================
+ * Copyright (C) 2001 Angus Mackay. All rights reserved;
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2, or (at your option)
+ * any later version.
+ *
+ * THIS SOFTWARE IS PROVIDED ``AS IS'' AND ANY EXPRESSED OR IMPLIED WARRANTIES,
+ * INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND
+ * FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE
+ * AUTHOR BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY,
+ * OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ * ============================================================================
+ */
+
+/*
+ * ez-bench.c
+ *
+ * end to end throughput and latency of the update path.  starts
+ * ez-mockserv on a free port and, for each job count, one ez-ipupdate
+ * daemon against it that is taken through that many address changes.
+ * reports updates/sec, the p50/p99/p999 time from change to ack,
+ * syscalls per update, the daemon's peak RSS and CPU time, and writes the
+ * same numbers as JSON so runs can be compared by a script.
+ *
+ * the daemon finds its address on a checkip page served by ez-bench, so
+ * a job is: "update *" on the control socket, which has the daemon look
+ * at once, the page answering with a new address, the daemon sending the
+ * update to ez-mockserv and "status" then showing the new address (the
+ * daemon doesn't read the control socket again until the update is
+ * done).  syscalls are counted in a separate run of the daemon traced
+ * with ptrace, over a few changes, and are reported as null where that is
+ * not allowed.
+ *
+ * the same job counts are then run through libezipupdate inside this
+ * process, the way an orchestrator embedding the library would: an engine
+ * with as many workers as the concurrency and a session per worker slot,
+ * reused from one job to the next.  latency is from submit to callback.
+ *
+ * last, one update is recorded and replayed a thousand times in a single
+ * ez-ipupdate, which must not need any more memory for its arenas after
+ * the first time through; a non-zero count of later arena mallocs fails
+ * the run.
+ *
+ * usage: ez-bench [-n jobs,jobs,...] [-c concurrency] [-s samples]
+ *          [-d bindir] [-o file.json]
+ *
+ * -s is the number of changes in the traced run, -c the concurrency of
+ * the library runs and of ez-mockserv.
+ *
+ */
+
+#ifdef HAVE_CONFIG_H
+#  include <config.h>
+#endif
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <signal.h>
+#include <poll.h>
+#include <sys/types.h>
+#include <sys/time.h>
+#include <sys/wait.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <netinet/in.h>
+#include <arpa/inet.h>
+#if HAVE_MMAP
+#  include <sys/mman.h>
+#endif
+#if HAVE_SYS_RESOURCE_H
+#  include <sys/resource.h>
+#endif
+#if HAVE_SYS_PTRACE_H
+#  include <sys/ptrace.h>
+#endif
+
+#include <ezipupdate.h>
+
+#define DEFAULT_JOBS "1,100,1000,10000"
+#define DEFAULT_CONCURRENCY 32
+#define DEFAULT_SAMPLES 20
+#define MAX_RUNS 16
+#define MAX_CONCURRENCY 256
+#define REPLAY_PASSES 1000
+#define DAEMON_HOST "daemon.bench.example.com"
+// the address the daemon starts with, the jobs' are all under 10/8
+#define FIRST_ADDRESS "192.0.2.1"
+// ms to wait for the daemon before giving up on the run
+#define IO_TIMEOUT 10000
+
+#if HAVE_SYS_PTRACE_H && HAVE_MMAP && defined(__linux__)
+#  define TRACE_SYSCALLS 1
+#endif
+
+struct run
+{
+  int jobs;
+  int failures;
+  double wall;
+  double p50;
+  double p99;
+  double p999;
+  long syscalls;
+  long max_rss;
+  double cpu_user;
+  double cpu_sys;
+};
+
+static char *bindir = ".";
+static int port = 0;
+static pid_t mock_pid = 0;
+static char *record_to = NULL;
+static int checkip_fd = -1;
+static int checkip_port = 0;
+static char ctl_path[64];
+
+// what the tracer process tells us, in memory shared with it
+struct trace_info
+{
+  pid_t daemon;
+  long stops;
+};
+
+// a session of the library run and the job it is doing
+struct slot
+{
+  struct ez_session session;
+  char host[64];
+  char addr[32];
+  double start;
+  struct slot *next;
+};
+
+static struct slot *free_slots = NULL;
+static double *lib_lat = NULL;
+static int lib_done = 0;
+static int lib_failures = 0;
+
+static double now_us(void)
+{
+  struct timeval tv;
+
+  gettimeofday(&tv, NULL);
+  return(tv.tv_sec * 1e6 + tv.tv_usec);
+}
+
+static double tv_s(struct timeval *tv)
+{
+  return(tv->tv_sec + tv->tv_usec / 1e6);
+}
+
+static int cmp_double(const void *a, const void *b)
+{
+  double x = *(const double *)a;
+  double y = *(const double *)b;
+
+  return(x < y ? -1 : x > y);
+}
+
+static double percentile(double *sorted, int n, double p)
+{
+  int i = (int)(p * n + 0.999999) - 1;
+
+  if(i < 0) { i = 0; }
+  if(i >= n) { i = n - 1; }
+  return(sorted[i]);
+}
+
+/*
+ * start ez-mockserv on a port of its choosing and read back which
+ */
+static int start_mock(int workers)
+{
+  char path[1024];
+  char line[256];
+  char nworkers[16];
+  FILE *fp;
+  int fds[2];
+  char *p;
+
+  snprintf(path, sizeof(path), "%s/ez-mockserv", bindir);
+  snprintf(nworkers, sizeof(nworkers), "%d", workers);
+  if(pipe(fds) != 0)
+  {
+    return(-1);
+  }
+  if((mock_pid=fork()) == 0)
+  {
+    dup2(fds[1], 1);
+    close(fds[0]);
+    close(fds[1]);
+    execl(path, path, "-p", "0", "-q", "-w", nworkers, (char *)NULL);
+    perror(path);
+    _exit(127);
+  }
+  close(fds[1]);
+  fp = fdopen(fds[0], "r");
+  if(mock_pid < 0 || fp == NULL || fgets(line, sizeof(line), fp) == NULL)
+  {
+    return(-1);
+  }
+  fclose(fp);
+  if((p=strrchr(line, ':')) == NULL || (port=atoi(p + 1)) <= 0)
+  {
+    return(-1);
+  }
+  return(0);
+}
+
+static void stop_mock(void)
+{
+  if(mock_pid > 0)
+  {
+    kill(mock_pid, SIGTERM);
+    waitpid(mock_pid, NULL, 0);
+  }
+}
+
+/*
+ * run one update for job i in this (child) process
+ */
+static void exec_update(int i, int round)
+{
+  char path[1024];
+  char server[64];
+  char host[64];
+  char addr[32];
+  char *args[16];
+  int n = 0;
+  int fd;
+
+  snprintf(path, sizeof(path), "%s/ez-ipupdate", bindir);
+  snprintf(server, sizeof(server), "127.0.0.1:%d", port);
+  snprintf(host, sizeof(host), "job%d.bench.example.com", i);
+  snprintf(addr, sizeof(addr), "10.%d.%d.%d", round & 0xff, (i >> 8) & 0xff,
+      i & 0xff);
+
+  if((fd=open("/dev/null", O_RDWR)) >= 0)
+  {
+    dup2(fd, 0);
+    dup2(fd, 1);
+    dup2(fd, 2);
+    if(fd > 2) { close(fd); }
+  }
+  args[n++] = path;
+  args[n++] = "-q";
+  args[n++] = "-S";
+  args[n++] = "dyndns";
+  args[n++] = "-s";
+  args[n++] = server;
+  args[n++] = "-u";
+  args[n++] = "bench:bench";
+  args[n++] = "-h";
+  args[n++] = host;
+  args[n++] = "-a";
+  args[n++] = addr;
+  if(record_to)
+  {
+    args[n++] = "--record";
+    args[n++] = record_to;
+  }
+  args[n] = NULL;
+  execv(path, args);
+  _exit(127);
+}
+
+/*
+ * arena mallocs ez-ipupdate makes replaying one update after the first
+ * pass, or -1 if that can't be measured
+ */
+static long steady_state_mallocs(void)
+{
+  char file[64];
+  char cmd[1200];
+  char line[256];
+  unsigned long n;
+  long mallocs = -1;
+  FILE *fp;
+  pid_t pid;
+  int status;
+
+  snprintf(file, sizeof(file), "/tmp/ez-bench.%d.eztr", (int)getpid());
+  unlink(file);
+  record_to = file;
+  if((pid=fork()) == 0)
+  {
+    exec_update(0, 0);
+  }
+  record_to = NULL;
+  if(pid < 0 || waitpid(pid, &status, 0) != pid ||
+      !WIFEXITED(status) || WEXITSTATUS(status) != 0)
+  {
+    unlink(file);
+    return(-1);
+  }
+
+  snprintf(cmd, sizeof(cmd), "%s/ez-ipupdate replay -n %d %s", bindir,
+      REPLAY_PASSES, file);
+  if((fp=popen(cmd, "r")) != NULL)
+  {
+    while(fgets(line, sizeof(line), fp) != NULL)
+    {
+      if(sscanf(line, "arena: %*u bytes in %*u blocks, %lu mallocs", &n) == 1)
+      {
+        mallocs = n;
+      }
+    }
+    pclose(fp);
+  }
+  unlink(file);
+
+  return(mallocs);
+}
+
+/*
+ * listen for the daemon's checkip requests on a port of our choosing
+ */
+static int start_checkip(void)
+{
+  struct sockaddr_in sin;
+  socklen_t len = sizeof(sin);
+
+  if((checkip_fd=socket(AF_INET, SOCK_STREAM, 0)) == -1)
+  {
+    return(-1);
+  }
+  memset(&sin, 0, sizeof(sin));
+  sin.sin_family = AF_INET;
+  sin.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+  if(bind(checkip_fd, (struct sockaddr *)&sin, sizeof(sin)) != 0 ||
+      listen(checkip_fd, 4) != 0 ||
+      getsockname(checkip_fd, (struct sockaddr *)&sin, &len) != 0)
+  {
+    close(checkip_fd);
+    checkip_fd = -1;
+    return(-1);
+  }
+  checkip_port = ntohs(sin.sin_port);
+
+  return(0);
+}
+
+/*
+ * answer the daemon's next checkip request with addr
+ */
+static int serve_checkip(char *addr)
+{
+  struct pollfd pfd;
+  char req[1024];
+  char reply[128];
+  int len = 0;
+  int fd;
+  int n;
+
+  pfd.fd = checkip_fd;
+  pfd.events = POLLIN;
+  if(poll(&pfd, 1, IO_TIMEOUT) != 1 ||
+      (fd=accept(checkip_fd, NULL, NULL)) == -1)
+  {
+    return(-1);
+  }
+  pfd.fd = fd;
+  while(len < sizeof(req) - 1 && poll(&pfd, 1, IO_TIMEOUT) == 1 &&
+      (n=recv(fd, req + len, sizeof(req) - 1 - len, 0)) > 0)
+  {
+    len += n;
+    req[len] = '\0';
+    if(strstr(req, "\r\n\r\n") != NULL || strstr(req, "\n\n") != NULL)
+    {
+      break;
+    }
+  }
+  n = snprintf(reply, sizeof(reply), "HTTP/1.0 200 OK\r\n"
+      "Content-Type: text/plain\r\n\r\n%s\n", addr);
+  send(fd, reply, n, 0);
+  close(fd);
+
+  return(0);
+}
+
+/*
+ * send cmd on the control connection and read the reply up to its "ok"
+ * or "error" line into buf
+ */
+static int ctl_cmd(int fd, char *cmd, char *buf, int size)
+{
+  struct pollfd pfd;
+  int len = 0;
+  int n;
+
+  if(send(fd, cmd, strlen(cmd), 0) != strlen(cmd))
+  {
+    return(-1);
+  }
+  pfd.fd = fd;
+  pfd.events = POLLIN;
+  while(len < size - 1 && poll(&pfd, 1, IO_TIMEOUT) == 1 &&
+      (n=recv(fd, buf + len, size - 1 - len, 0)) > 0)
+  {
+    len += n;
+    buf[len] = '\0';
+    if((len == 3 || (len > 3 && buf[len-4] == '\n')) &&
+        strcmp(buf + len - 3, "ok\n") == 0)
+    {
+      return(0);
+    }
+    if(strstr(buf, "error:") != NULL && buf[len-1] == '\n')
+    {
+      return(0);
+    }
+  }
+
+  return(-1);
+}
+
+/* non zero if a status reply shows the job at addr */
+static int status_has(char *buf, char *addr)
+{
+  char *p;
+  int len = strlen(addr);
+
+  return((p=strstr(buf, " address=")) != NULL &&
+      strncmp(p + 9, addr, len) == 0 && p[9 + len] == ' ');
+}
+
+/*
+ * run the daemon in this (child) process
+ */
+static void exec_daemon(void)
+{
+  char path[1024];
+  char server[64];
+  char discover[64];
+  int fd;
+
+  snprintf(path, sizeof(path), "%s/ez-ipupdate", bindir);
+  snprintf(server, sizeof(server), "127.0.0.1:%d", port);
+  snprintf(discover, sizeof(discover), "http://127.0.0.1:%d/", checkip_port);
+
+  if((fd=open("/dev/null", O_RDWR)) >= 0)
+  {
+    dup2(fd, 0);
+    dup2(fd, 1);
+    dup2(fd, 2);
+    if(fd > 2) { close(fd); }
+  }
+  close(checkip_fd);
+  execl(path, path, "-S", "dyndns", "-s", server, "-u", "bench:bench",
+      "-h", DAEMON_HOST, "--discover", discover, "-d", "-f", "-P", "60",
+      "--ctl-socket", ctl_path, "--log-target", "stderr", (char *)NULL);
+  _exit(127);
+}
+
+/*
+ * connect to the daemon's control socket once it is there, serving the
+ * checkip request of its first update, and wait for that update
+ */
+static int daemon_ready(void)
+{
+  struct sockaddr_un addr;
+  char buf[1024];
+  int fd = -1;
+  int i;
+
+  if(serve_checkip(FIRST_ADDRESS) != 0)
+  {
+    return(-1);
+  }
+  memset(&addr, 0, sizeof(addr));
+  addr.sun_family = AF_UNIX;
+  snprintf(addr.sun_path, sizeof(addr.sun_path), "%s", ctl_path);
+  for(i=0; i<IO_TIMEOUT/10; i++)
+  {
+    if((fd=socket(AF_UNIX, SOCK_STREAM, 0)) == -1)
+    {
+      return(-1);
+    }
+    if(connect(fd, (struct sockaddr *)&addr, sizeof(addr)) == 0)
+    {
+      break;
+    }
+    close(fd);
+    fd = -1;
+    usleep(10000);
+  }
+  if(fd == -1 || ctl_cmd(fd, "status\n", buf, sizeof(buf)) != 0 ||
+      !status_has(buf, FIRST_ADDRESS))
+  {
+    if(fd != -1) { close(fd); }
+    return(-1);
+  }
+
+  return(fd);
+}
+
+/*
+ * take the daemon through one address change, returns 0 if it got to the
+ * server, 1 if it failed and -1 if the daemon stopped answering
+ */
+static int daemon_change(int ctl, char *addr)
+{
+  char buf[1024];
+
+  if(ctl_cmd(ctl, "update *\n", buf, sizeof(buf)) != 0 ||
+      serve_checkip(addr) != 0 ||
+      ctl_cmd(ctl, "status\n", buf, sizeof(buf)) != 0)
+  {
+    return(-1);
+  }
+
+  return(status_has(buf, addr) ? 0 : 1);
+}
+
+/*
+ * ask the daemon to quit. the daemon only looks at its signals between
+ * sleeps, so wake it up from the control socket as well in case the signal
+ * came in after it last looked.
+ */
+static void stop_daemon(pid_t pid, int ctl)
+{
+  kill(pid, SIGQUIT);
+  if(ctl != -1)
+  {
+    send(ctl, "update *\n", 9, 0);
+    close(ctl);
+  }
+}
+
+static void job_address(char *buf, int size, int i, int round)
+{
+  snprintf(buf, size, "10.%d.%d.%d", round & 0xff, (i >> 8) & 0xff, i & 0xff);
+}
+
+/*
+ * syscalls the daemon makes per address change, or -1 if we can't trace.
+ * a tracer process runs the daemon under ptrace and counts its syscall
+ * stops in memory it shares with us.
+ */
+static long count_syscalls(int samples)
+{
+#ifdef TRACE_SYSCALLS
+  volatile struct trace_info *info;
+  char addr[32];
+  long stops = -1;
+  pid_t tracer;
+  int status;
+  int ctl = -1;
+  int i;
+
+  if(samples < 1)
+  {
+    return(-1);
+  }
+  info = mmap(NULL, sizeof(struct trace_info), PROT_READ | PROT_WRITE,
+      MAP_SHARED | MAP_ANONYMOUS, -1, 0);
+  if(info == MAP_FAILED)
+  {
+    return(-1);
+  }
+  info->daemon = 0;
+  info->stops = 0;
+
+  if((tracer=fork()) == 0)
+  {
+    int sig = 0;
+    pid_t pid;
+
+    if((pid=fork()) == 0)
+    {
+      if(ptrace(PTRACE_TRACEME, 0, NULL, NULL) != 0)
+      {
+        _exit(126);
+      }
+      exec_daemon();
+    }
+    if(pid < 0 || waitpid(pid, &status, 0) != pid || !WIFSTOPPED(status))
+    {
+      _exit(1);
+    }
+    ptrace(PTRACE_SETOPTIONS, pid, NULL, (void *)PTRACE_O_TRACESYSGOOD);
+    info->daemon = pid;
+    for(;;)
+    {
+      if(ptrace(PTRACE_SYSCALL, pid, NULL, (void *)(long)sig) != 0 ||
+          waitpid(pid, &status, 0) != pid ||
+          WIFEXITED(status) || WIFSIGNALED(status))
+      {
+        break;
+      }
+      sig = 0;
+      if(WSTOPSIG(status) == (SIGTRAP | 0x80))
+      {
+        info->stops++;
+      }
+      else if(WSTOPSIG(status) != SIGTRAP)
+      {
+        sig = WSTOPSIG(status);
+      }
+    }
+    _exit(0);
+  }
+
+  if(tracer > 0 && (ctl=daemon_ready()) != -1)
+  {
+    stops = info->stops;
+    for(i=0; i<samples && stops >= 0; i++)
+    {
+      job_address(addr, sizeof(addr), i, 0);
+      if(daemon_change(ctl, addr) != 0)
+      {
+        stops = -1;
+      }
+    }
+    if(stops >= 0)
+    {
+      // an entry and an exit stop each
+      stops = (info->stops - stops) / 2 / samples;
+    }
+  }
+  if(info->daemon > 0)
+  {
+    stop_daemon(info->daemon, ctl);
+  }
+  else if(ctl != -1)
+  {
+    close(ctl);
+  }
+  if(tracer > 0)
+  {
+    waitpid(tracer, NULL, 0);
+  }
+  munmap((void *)info, sizeof(struct trace_info));
+
+  return(stops);
+#else
+  return(-1);
+#endif
+}
+
+/*
+ * one daemon taken through run->jobs address changes
+ */
+static int bench_daemon(struct run *run, int round)
+{
+  struct rusage ru;
+  char addr[32];
+  double *lat;
+  double t0;
+  double t;
+  pid_t pid;
+  int done = 0;
+  int ctl;
+  int res = 0;
+
+  if((lat=malloc(run->jobs * sizeof(double))) == NULL)
+  {
+    return(-1);
+  }
+  run->failures = 0;
+
+  if((pid=fork()) == 0)
+  {
+    exec_daemon();
+  }
+  if(pid < 0 || (ctl=daemon_ready()) == -1)
+  {
+    if(pid > 0)
+    {
+      kill(pid, SIGKILL);
+      waitpid(pid, NULL, 0);
+    }
+    free(lat);
+    return(-1);
+  }
+
+  t0 = now_us();
+  while(done < run->jobs)
+  {
+    job_address(addr, sizeof(addr), done, round);
+    t = now_us();
+    if((res=daemon_change(ctl, addr)) < 0)
+    {
+      break;
+    }
+    lat[done++] = now_us() - t;
+    run->failures += res;
+  }
+  run->wall = (now_us() - t0) / 1e6;
+
+  stop_daemon(pid, ctl);
+  if(wait4(pid, NULL, 0, &ru) == pid)
+  {
+    run->max_rss = ru.ru_maxrss;
+    run->cpu_user = tv_s(&ru.ru_utime);
+    run->cpu_sys = tv_s(&ru.ru_stime);
+  }
+
+  qsort(lat, done, sizeof(double), cmp_double);
+  run->p50 = percentile(lat, done, 0.50);
+  run->p99 = percentile(lat, done, 0.99);
+  run->p999 = percentile(lat, done, 0.999);
+  free(lat);
+
+  return(res < 0 ? -1 : 0);
+}
+
+static void quiet(struct ez_session *s, int level, const char *msg)
+{
+}
+
+static void job_done(struct ez_session *s, void *arg)
+{
+  struct slot *slot = arg;
+
+  lib_lat[lib_done++] = now_us() - slot->start;
+  if(s->result != EZ_OK)
+  {
+    lib_failures++;
+  }
+  slot->next = free_slots;
+  free_slots = slot;
+}
+
+/*
+ * the same jobs as bench(), as sessions on a libezipupdate engine
+ */
+static int bench_library(struct run *run, int concurrency, int round)
+{
+  struct ez_engine *e;
+  struct slot *slots;
+  struct slot *slot;
+  struct rusage ru0;
+  struct rusage ru1;
+  char server_port[16];
+  double t0;
+  int next = 0;
+  int i;
+
+  snprintf(server_port, sizeof(server_port), "%d", port);
+  if((e=ez_engine_new(concurrency)) == NULL ||
+      (slots=calloc(concurrency, sizeof(struct slot))) == NULL ||
+      (lib_lat=malloc(run->jobs * sizeof(double))) == NULL)
+  {
+    return(-1);
+  }
+  free_slots = NULL;
+  for(i=0; i<concurrency; i++)
+  {
+    slot = &slots[i];
+    ez_session_init(&slot->session, ez_service_find("dyndns"));
+    slot->session.server = "127.0.0.1";
+    slot->session.port = server_port;
+    slot->session.user_name = "bench";
+    slot->session.password = "bench";
+    slot->session.host = slot->host;
+    slot->session.address = slot->addr;
+    slot->session.flags = EZ_QUIET;
+    slot->session.message = quiet;
+    slot->next = free_slots;
+    free_slots = slot;
+  }
+  lib_done = 0;
+  lib_failures = 0;
+  run->syscalls = -1;
+
+  getrusage(RUSAGE_SELF, &ru0);
+  t0 = now_us();
+  while(lib_done < run->jobs)
+  {
+    while(free_slots != NULL && next < run->jobs)
+    {
+      slot = free_slots;
+      free_slots = slot->next;
+      snprintf(slot->host, sizeof(slot->host), "job%d.bench.example.com",
+          next);
+      snprintf(slot->addr, sizeof(slot->addr), "10.%d.%d.%d", round & 0xff,
+          (next >> 8) & 0xff, next & 0xff);
+      slot->start = now_us();
+      ez_submit(e, &slot->session, job_done, slot);
+      next++;
+    }
+    ez_poll(e, -1);
+  }
+  run->wall = (now_us() - t0) / 1e6;
+  getrusage(RUSAGE_SELF, &ru1);
+
+  run->failures = lib_failures;
+  run->max_rss = ru1.ru_maxrss;
+  run->cpu_user = tv_s(&ru1.ru_utime) - tv_s(&ru0.ru_utime);
+  run->cpu_sys = tv_s(&ru1.ru_stime) - tv_s(&ru0.ru_stime);
+  qsort(lib_lat, lib_done, sizeof(double), cmp_double);
+  run->p50 = percentile(lib_lat, lib_done, 0.50);
+  run->p99 = percentile(lib_lat, lib_done, 0.99);
+  run->p999 = percentile(lib_lat, lib_done, 0.999);
+
+  ez_engine_free(e);
+  for(i=0; i<concurrency; i++)
+  {
+    ez_session_free(&slots[i].session);
+  }
+  free(slots);
+  free(lib_lat);
+  lib_lat = NULL;
+
+  return(0);
+}
+
+static void print_count(FILE *fp, long n)
+{
+  if(n < 0)
+  {
+    fprintf(fp, "null");
+  }
+  else
+  {
+    fprintf(fp, "%ld", n);
+  }
+}
+
+static void write_runs(FILE *fp, struct run *runs, int nruns)
+{
+  int i;
+
+  for(i=0; i<nruns; i++)
+  {
+    struct run *r = &runs[i];
+
+    fprintf(fp, "    {\"jobs\": %d, \"failures\": %d, \"wall_s\": %.3f, "
+        "\"updates_per_sec\": %.1f, \"latency_us\": {\"p50\": %.0f, "
+        "\"p99\": %.0f, \"p999\": %.0f}, \"syscalls_per_update\": ",
+        r->jobs, r->failures, r->wall, r->jobs / r->wall, r->p50, r->p99,
+        r->p999);
+    print_count(fp, r->syscalls);
+    fprintf(fp, ", \"max_rss_kb\": %ld, \"cpu_user_s\": %.3f, "
+        "\"cpu_sys_s\": %.3f, \"cpu_us_per_update\": %.0f}%s\n",
+        r->max_rss, r->cpu_user, r->cpu_sys,
+        (r->cpu_user + r->cpu_sys) * 1e6 / r->jobs,
+        i < nruns - 1 ? "," : "");
+  }
+}
+
+static int write_json(char *file, struct run *runs, int nruns,
+    struct run *lib_runs, int nlib_runs, int concurrency, long mallocs)
+{
+  FILE *fp;
+
+  if((fp=fopen(file, "w")) == NULL)
+  {
+    perror(file);
+    return(-1);
+  }
+  fprintf(fp, "{\n  \"service\": \"dyndns\",\n  \"concurrency\": %d,\n"
+      "  \"daemon_runs\": [\n", concurrency);
+  write_runs(fp, runs, nruns);
+  fprintf(fp, "  ],\n  \"library_runs\": [\n");
+  write_runs(fp, lib_runs, nlib_runs);
+  fprintf(fp, "  ],\n  \"steady_state_arena_mallocs\": ");
+  print_count(fp, mallocs);
+  fprintf(fp, "\n}\n");
+
+  return(fclose(fp) == 0 ? 0 : -1);
+}
+
+int main(int argc, char **argv)
+{
+  struct run runs[MAX_RUNS];
+  struct run lib_runs[MAX_RUNS];
+  char *jobs = NULL;
+  char *out = "bench.json";
+  int concurrency = DEFAULT_CONCURRENCY;
+  int samples = DEFAULT_SAMPLES;
+  int nruns = 0;
+  int nlib_runs;
+  long mallocs;
+  long syscalls;
+  int ret = 0;
+  char *p;
+  int opt;
+  int i;
+
+  while((opt=getopt(argc, argv, "n:c:s:d:o:")) != -1)
+  {
+    switch(opt)
+    {
+      case 'n':
+        free(jobs);
+        jobs = strdup(optarg);
+        break;
+      case 'c':
+        concurrency = atoi(optarg);
+        break;
+      case 's':
+        samples = atoi(optarg);
+        break;
+      case 'd':
+        bindir = optarg;
+        break;
+      case 'o':
+        out = optarg;
+        break;
+      default:
+        fprintf(stderr, "usage: %s [-n jobs,jobs,...] [-c concurrency] "
+            "[-s samples] [-d bindir] [-o file.json]\n", argv[0]);
+        return(1);
+    }
+  }
+  if(concurrency < 1 || concurrency > MAX_CONCURRENCY)
+  {
+    fprintf(stderr, "%s: concurrency must be 1 to %d\n", argv[0],
+        MAX_CONCURRENCY);
+    return(1);
+  }
+  // strtok() writes into the list
+  if(jobs == NULL && (jobs=strdup(DEFAULT_JOBS)) == NULL)
+  {
+    perror("strdup");
+    return(1);
+  }
+  for(p=strtok(jobs, ","); p != NULL && nruns < MAX_RUNS; p=strtok(NULL, ","))
+  {
+    if((runs[nruns].jobs=atoi(p)) > 0)
+    {
+      nruns++;
+    }
+  }
+
+  free(jobs);
+
+  signal(SIGPIPE, SIG_IGN);
+  snprintf(ctl_path, sizeof(ctl_path), "/tmp/ez-bench.%d.sock", (int)getpid());
+  if(start_checkip() != 0)
+  {
+    perror("checkip socket");
+    return(1);
+  }
+  if(start_mock(concurrency) != 0)
+  {
+    fprintf(stderr, "%s: could not start %s/ez-mockserv\n", argv[0], bindir);
+    stop_mock();
+    return(1);
+  }
+
+  syscalls = count_syscalls(samples);
+  printf("one daemon, an address change per job:\n");
+  printf("%8s %6s %10s %9s %9s %9s %9s %8s %9s\n", "jobs", "fail",
+      "updates/s", "p50 ms", "p99 ms", "p999 ms", "syscalls", "rss KB",
+      "cpu us/up");
+  for(i=0; i<nruns; i++)
+  {
+    struct run *r = &runs[i];
+
+    r->syscalls = syscalls;
+    if(bench_daemon(r, i + 1) != 0)
+    {
+      fprintf(stderr, "%s: daemon run of %d jobs did not finish\n", argv[0],
+          r->jobs);
+      ret = 1;
+      nruns = i;
+      break;
+    }
+    printf("%8d %6d %10.1f %9.2f %9.2f %9.2f %9ld %8ld %9.0f\n", r->jobs,
+        r->failures, r->jobs / r->wall, r->p50 / 1000, r->p99 / 1000,
+        r->p999 / 1000, r->syscalls, r->max_rss,
+        (r->cpu_user + r->cpu_sys) * 1e6 / r->jobs);
+    fflush(stdout);
+    if(r->failures > 0)
+    {
+      ret = 1;
+    }
+  }
+
+  printf("\nin process, libezipupdate:\n");
+  printf("%8s %6s %10s %9s %9s %9s %9s %8s %9s\n", "jobs", "fail",
+      "updates/s", "p50 ms", "p99 ms", "p999 ms", "syscalls", "rss KB",
+      "cpu us/up");
+  for(nlib_runs=0; nlib_runs<nruns; nlib_runs++)
+  {
+    struct run *r = &lib_runs[nlib_runs];
+
+    r->jobs = runs[nlib_runs].jobs;
+    if(bench_library(r, concurrency, nruns + nlib_runs + 1) != 0)
+    {
+      fprintf(stderr, "%s: library run of %d jobs did not finish\n",
+          argv[0], r->jobs);
+      ret = 1;
+      break;
+    }
+    printf("%8d %6d %10.1f %9.2f %9.2f %9.2f %9s %8ld %9.0f\n", r->jobs,
+        r->failures, r->jobs / r->wall, r->p50 / 1000, r->p99 / 1000,
+        r->p999 / 1000, "-", r->max_rss,
+        (r->cpu_user + r->cpu_sys) * 1e6 / r->jobs);
+    fflush(stdout);
+    if(r->failures > 0)
+    {
+      ret = 1;
+    }
+  }
+
+  mallocs = steady_state_mallocs();
+  stop_mock();
+
+  if(mallocs < 0)
+  {
+    printf("steady state arena mallocs: not measured\n");
+  }
+  else
+  {
+    printf("steady state arena mallocs: %ld over %d replays\n", mallocs,
+        REPLAY_PASSES);
+  }
+  if(mallocs != 0)
+  {
+    ret = 1;
+  }
+
+  if(write_json(out, runs, nruns, lib_runs, nlib_runs, concurrency,
+        mallocs) != 0)
+  {
+    ret = 1;
+  }
+
+  return(ret);
+}
@@ -0,0 +1,126 @@
+/* ============================================================================
+ * Copyright (C) 2001 Angus Mackay. All rights reserved; 
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2, or (at your option)
+ * any later version.
+ *
+ * THIS SOFTWARE IS PROVIDED ``AS IS'' AND ANY EXPRESSED OR IMPLIED WARRANTIES,
+ * INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND
+ * FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE
+ * AUTHOR BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY,
+ * OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ * ============================================================================
+ */
+
+/*
+ * ez-ipstatus.c
+ *
+ * print the job table an ez-ipupdate daemon publishes with status-file,
+ * once or every few seconds.
+ *
+ * usage: ez-ipstatus [-w <seconds>] <file | shm:/name>
+ *
+ */
+
+#ifdef HAVE_CONFIG_H
+#  include <config.h>
+#endif
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <time.h>
+
+#include <shm_status.h>
+
+static char *result_name(uint32_t result)
+{
+  switch(result)
+  {
+    case SHM_RESULT_OK: return("ok");
+    case SHM_RESULT_ERROR: return("error");
+    case SHM_RESULT_SHUTDOWN: return("shutdown");
+  }
+  return("none");
+}
+
+static int show(struct shm_status_header *hdr)
+{
+  struct shm_status_job job;
+  time_t now = time(NULL);
+  int i;
+
+  printf("pid=%ld started=%ld jobs=%u\n", (long)hdr->pid, (long)hdr->started,
+      hdr->njobs);
+  for(i=0; i<hdr->njobs; i++)
+  {
+    if(shm_status_read(hdr, i, &job) != 0)
+    {
+      printf("job=%d busy\n", i);
+      continue;
+    }
+    if(!(job.flags & SHM_JOB_ACTIVE))
+    {
+      continue;
+    }
+    printf("job=%s address=%s address6=%s last_success=%ld last_attempt=%ld "
+        "result=%s failures=%u next_due=%+lds paused=%d\n",
+        job.name, *job.address ? job.address : "-",
+        *job.address6 ? job.address6 : "-", (long)job.last_success,
+        (long)job.last_attempt, result_name(job.last_result), job.failures,
+        (long)(job.next_due - now), (job.flags & SHM_JOB_PAUSED) ? 1 : 0);
+  }
+
+  return(0);
+}
+
+int main(int argc, char **argv)
+{
+  struct shm_status_header *hdr;
+  int interval = 0;
+  int opt;
+
+  while((opt=getopt(argc, argv, "w:")) != -1)
+  {
+    switch(opt)
+    {
+      case 'w':
+        interval = atoi(optarg);
+        break;
+      default:
+        fprintf(stderr, "usage: %s [-w <seconds>] <file | shm:/name>\n", argv[0]);
+        return(1);
+    }
+  }
+  if(optind != argc - 1)
+  {
+    fprintf(stderr, "usage: %s [-w <seconds>] <file | shm:/name>\n", argv[0]);
+    return(1);
+  }
+
+  if((hdr=shm_status_attach(argv[optind])) == NULL)
+  {
+    fprintf(stderr, "%s: no status table at %s\n", argv[0], argv[optind]);
+    return(1);
+  }
+
+  show(hdr);
+  while(interval > 0)
+  {
+    sleep(interval);
+    printf("\n");
+    show(hdr);
+    fflush(stdout);
+  }
+
+  return(0);
+}
+
@@ -42,67 +42,8 @@
 // if bad things happend and it has to exit when in daemon mode.
 #define SEND_EMAIL_CMD "mail"
 
-#define EZIP_DEFAULT_SERVER "www.EZ-IP.Net"
-#define EZIP_DEFAULT_PORT "80"
-#define EZIP_REQUEST "/members/update/"
-
-#define PGPOW_DEFAULT_SERVER "www.penguinpowered.com"
-#define PGPOW_DEFAULT_PORT "2345"
-#define PGPOW_REQUEST "update"
-#define PGPOW_VERSION "1.0"
-
-#define DHS_DEFAULT_SERVER "members.dhs.org"
-#define DHS_DEFAULT_PORT "80"
-#define DHS_REQUEST "/nic/hosts"
-#define DHS_SUCKY_TIMEOUT 60
-
-#define DYNDNS_DEFAULT_SERVER "members.dyndns.org"
-#define DYNDNS_DEFAULT_PORT "80"
-#define DYNDNS_REQUEST "/nic/update"
-#define DYNDNS_STAT_REQUEST "/nic/update"
 #define DYNDNS_MAX_INTERVAL (25*24*3600)
 
-#define ODS_DEFAULT_SERVER "update.ods.org"
-#define ODS_DEFAULT_PORT "7070"
-#define ODS_REQUEST "update"
-
-#define TZO_DEFAULT_SERVER "cgi.tzo.com"
-#define TZO_DEFAULT_PORT "80"
-#define TZO_REQUEST "/webclient/signedon.html"
-
-#define GNUDIP_DEFAULT_SERVER ""
-#define GNUDIP_DEFAULT_PORT "3495"
-#define GNUDIP_REQUEST "0"
-
-#define EASYDNS_DEFAULT_SERVER "members.easydns.com"
-#define EASYDNS_DEFAULT_PORT "80"
-#define EASYDNS_REQUEST "/dyn/ez-ipupdate.php"
-
-#define EASYDNS_PARTNER_DEFAULT_SERVER "api.easydns.com"
-#define EASYDNS_PARTNER_DEFAULT_PORT "80"
-#define EASYDNS_PARTNER_REQUEST "/dyn/ez-ipupdate.php"
-
-#define JUSTL_DEFAULT_SERVER "www.justlinux.com"
-#define JUSTL_DEFAULT_PORT "80"
-#define JUSTL_REQUEST "/bin/controlpanel/dyndns/jlc.pl"
-#define JUSTL_VERSION "2.0"
-
-#define DYNS_DEFAULT_SERVER "www.dyns.cx"
-#define DYNS_DEFAULT_PORT "80"
-#define DYNS_REQUEST "/postscript.php"
-
-#define HN_DEFAULT_SERVER "dup.hn.org"
-#define HN_DEFAULT_PORT "80"
-#define HN_REQUEST "/vanity/update"
-
-#define ZONEEDIT_DEFAULT_SERVER "www.zoneedit.com"
-#define ZONEEDIT_DEFAULT_PORT "80"
-#define ZONEEDIT_REQUEST "/auth/dynamic.html"
-
-#define HEIPV6TB_DEFAULT_SERVER "ipv6tb.he.net"
-#define HEIPV6TB_DEFAULT_PORT "80"
-#define HEIPV6TB_REQUEST "/index.cgi"
-
 #define DEFAULT_TIMEOUT 120
 #define DEFAULT_UPDATE_PERIOD 120
 #define DEFAULT_RESOLV_PERIOD 30
@@ -142,6 +83,7 @@
 #if HAVE_SYS_TIME_H
 #  include <sys/time.h>
 #endif
+#include <time.h>
 #if HAVE_SYS_WAIT_H
 #  include <sys/wait.h>
 #endif
@@ -159,10 +101,6 @@
 #if defined(HAVE_FORK) && !defined(HAVE_VFORK)
 #  define vfork fork
 #endif
-#if USE_MD5
-#  include <md5.h>
-#  define MD5_DIGEST_BYTES (16)
-#endif
 
 
 #if __linux__ || __SVR4 || __OpenBSD__ || __FreeBSD__ || __NetBSD__
@@ -178,6 +116,25 @@
 #include <conf_file.h>
 #include <cache_file.h>
 #include <pid_file.h>
+#include <event.h>
+#include <metrics.h>
+#include <logger.h>
+#include <ctl.h>
+#include <shm_status.h>
+#include <transcript.h>
+#include <arena.h>
+#include <hook.h>
+#include <plugin.h>
+#include <upgrade.h>
+#include <ifsnap.h>
+#include <discover.h>
+#include <debounce.h>
+#include <dnscheck.h>
+#include <change.h>
+#include <probes.h>
+#include <schedule.h>
+#include <ifaddr6.h>
+#include <ezipupdate.h>
 
 #if !defined(__GNUC__) && !defined(HAVE_SNPRINTF)
 #error "get gcc, fix this code, or find yourself a snprintf!"
@@ -194,48 +151,28 @@
 #  define  vsnprintf(x, y, z...) vsprintf(x, ## z)
 #endif
 
-#ifndef HAVE_HERROR
-#  define herror(x) fprintf(stderr, "%s: error\n", x)
-#endif
-
 #define ARRAY_LEN(x) (sizeof(x)/sizeof(x[0]))
 #define N_STR(x) (x == NULL ? "(null)" : x)
 
-#ifndef OS
-#  define OS "unknown"
-#endif
-
 // the min period for checking the interface
 #define MIN_UPDATE_PERIOD 10
-// the min/max time to wait if we fail to update
-#define MIN_WAIT_PERIOD 300
-#define MAX_WAIT_PERIOD (2*3600)
+// "<ipv4>,<ipv6>" and its NUL
+#define ADDRESS_TEXT_LEN (INET_ADDRSTRLEN + INET6_ADDRSTRLEN)
 // the min time that max-period can be set to
 #define MIN_MAXINTERVAL (24*3600)
 // the max time we will wait if the server tells us to
-#define MAX_WAITRESPONSE_WAIT (24*3600)
-#define MAX_MESSAGE_LEN 256
-#define ARGLENGTH 32
 
 /**************************************************/
 
-struct service_t
+/*
+ * what the client adds to the library's services: filling in and checking
+ * what an update needs, by asking if need be, before the first one
+ */
+struct client_service
 {
-  char *title;
-  char *names[3];
+  char *name;
   void (*init)(void);
-  int (*update_entry)(void);
   int (*check_info)(void);
-  char **fields_used;
-  char *default_server;
-  char *default_port;
-  char *default_request;
-};
-
-enum {
-  UPDATERES_OK = 0,
-  UPDATERES_ERROR,
-  UPDATERES_SHUTDOWN,
 };
 
 /**************************************************/
@@ -246,10 +183,10 @@ char *config_file = NULL;
 char *server = NULL;
 char *port = NULL;
 char user[256];
-char auth[512];
 char user_name[128];
 char password[128];
 char *address = NULL;
+char *address6 = NULL;
 char *request = NULL;
 char *request_over_ride = NULL;
 int wildcard = 0;
@@ -261,265 +198,183 @@ char *interface = NULL;
 int ntrys = 1;
 int update_period = DEFAULT_UPDATE_PERIOD;
 int resolv_period = DEFAULT_RESOLV_PERIOD;
+// seconds a change has to hold before it is pushed, 0 for none
+int settle_time = 0;
 struct timeval timeout;
 int max_interval = 0;
+// the window refreshes are spread over, 0 for none
+int refresh_spread = 0;
 int service_set = 0;
 char *post_update_cmd = NULL;
-char *post_update_cmd_arg = NULL;
+int hook_timeout = DEFAULT_HOOK_TIMEOUT;
+int hook_batch = 0;
 int connection_type = 1;
 time_t last_update = 0;
 char *notify_email = NULL;
+// the kinds of IPv6 address to look for on the interface, NULL for none
+char *ipv6_policy = NULL;
 char *pid_file = NULL;
 char *partner = NULL;
+char *metrics_file = NULL;
+int metrics_port = 0;
+char *log_target = NULL;
+char *ctl_socket = NULL;
+char *status_file = NULL;
+char *record_file = NULL;
+
+// option strings live as long as the process
+static struct arena config_arena = ARENA_INIT(512);
+
+// the update, filled in from the options by do_update()
+static struct ez_session session;
+
+/*
+ * the network, but waiting the way the daemon does so that signals and
+ * control commands are still seen, and a recorded transcript for replay
+ */
+static void client_pause(struct ez_session *s, int seconds);
+static int replay_connect(struct ez_session *s);
+static int replay_send(struct ez_session *s, char *buf, int len);
+static int replay_recv(struct ez_session *s, char *buf, int len);
+static void replay_pause(struct ez_session *s, int seconds);
+
+static struct ez_transport client_transport = {
+  ez_net_connect, ez_net_send, ez_net_recv, client_pause
+};
+static struct ez_transport replay_transport = {
+  replay_connect, replay_send, replay_recv, replay_pause
+};
 
-static volatile int client_sockfd;
+static struct ctl_job job;
 static volatile int last_sig = 0;
+// SIGUSR2 asked for the daemon to re-exec itself
+static int upgrade_pending = 0;
+// the command line to re-exec with
+static char **saved_argv = NULL;
 
-/* service objects for various services */
+// the checks share this instead of each putting its own on the stack
+static char update_buf[BUFFER_SIZE+1];
+
+/* checks for the services */
 
 // this one is for when people don't configure a default service at build time
 int NULL_check_info(void);
-static char *NULL_fields_used[] = { NULL };
 
-int EZIP_update_entry(void);
+#ifdef USE_EZIP
 int EZIP_check_info(void);
-static char *EZIP_fields_used[] = { "server", "user", "address", "wildcard", "mx", "url", "host", NULL };
+#endif
 
-int PGPOW_update_entry(void);
+#ifdef USE_PGPOW
 int PGPOW_check_info(void);
-static char *PGPOW_fields_used[] = { "server", "host", NULL };
+#endif
 
-int DHS_update_entry(void);
+#ifdef USE_DHS
 int DHS_check_info(void);
-static char *DHS_fields_used[] = { "server", "user", "address", "wildcard", "mx", "url", "host", NULL };
+#endif
 
+#ifdef USE_DYNDNS
 void DYNDNS_init(void);
-int DYNDNS_update_entry(void);
 int DYNDNS_check_info(void);
-static char *DYNDNS_fields_used[] = { "server", "user", "address", "wildcard", "mx", "host", NULL };
-static char *DYNDNS_STAT_fields_used[] = { "server", "user", "address", "wildcard", "mx", "host", NULL };
+#endif
 
-int ODS_update_entry(void);
+#ifdef USE_ODS
 int ODS_check_info(void);
-static char *ODS_fields_used[] = { "server", "host", "address", NULL };
+#endif
 
-int TZO_update_entry(void);
+#ifdef USE_TZO
 int TZO_check_info(void);
-static char *TZO_fields_used[] = { "server", "user", "address", "host", "connection-type", NULL };
+#endif
 
-int EASYDNS_update_entry(void);
+#ifdef USE_EASYDNS
 int EASYDNS_check_info(void);
-static char *EASYDNS_fields_used[] = { "server", "user", "address", "wildcard", "mx", "host", NULL };
+#endif
 
-int EASYDNS_PARTNER_update_entry(void);
+#ifdef USE_EASYDNS_PARTNER
 int EASYDNS_PARTNER_check_info(void);
-static char *EASYDNS_PARTNER_fields_used[] = { "server", "partner", "user", "address", "wildcard", "host", NULL };
+#endif
 
-#ifdef USE_MD5
-int GNUDIP_update_entry(void);
+#if defined(USE_MD5) && defined(USE_GNUDIP)
 int GNUDIP_check_info(void);
-static char *GNUDIP_fields_used[] = { "server", "user", "host", "address", NULL };
 #endif
 
-int JUSTL_update_entry(void);
+#ifdef USE_JUSTL
 int JUSTL_check_info(void);
-static char *JUSTL_fields_used[] = { "server", "user", "host", NULL };
+#endif
 
-int DYNS_update_entry(void);
+#ifdef USE_DYNS
 int DYNS_check_info(void);
-static char *DYNS_fields_used[] = { "server", "user", "host", NULL };
+#endif
 
-int HN_update_entry(void);
+#ifdef USE_HN
 int HN_check_info(void);
-static char *HN_fields_used[] = { "server", "user", "address", NULL };
+#endif
 
-int ZONEEDIT_update_entry(void);
+#ifdef USE_ZONEEDIT
 int ZONEEDIT_check_info(void);
-static char *ZONEEDIT_fields_used[] = { "server", "user", "address", "mx", "host", NULL };
+#endif
 
-int HEIPV6TB_update_entry(void);
+#ifdef USE_HEIPV6TB
 int HEIPV6TB_check_info(void);
-static char *HEIPV6TB_fields_used[] = { "server", "user", NULL };
-
-struct service_t services[] = {
-  { "NULL",
-    { "null", "NULL", 0, },
-    NULL,
-    NULL,
-    NULL_check_info,
-    NULL_fields_used,
-    "",
-    "",
-    ""
-  },
-  { "ez-ip",
-    { "ezip", "ez-ip", 0, },
-    NULL,
-    EZIP_update_entry,
-    EZIP_check_info,
-    EZIP_fields_used,
-    EZIP_DEFAULT_SERVER,
-    EZIP_DEFAULT_PORT,
-    EZIP_REQUEST
-  },
-  { "justlinux v1.0 (penguinpowered)",
-    { "pgpow", "penguinpowered", 0, },
-    NULL,
-    PGPOW_update_entry,
-    PGPOW_check_info,
-    PGPOW_fields_used,
-    PGPOW_DEFAULT_SERVER,
-    PGPOW_DEFAULT_PORT,
-    PGPOW_REQUEST
-  },
-  { "dhs",
-    { "dhs", 0, 0, },
-    NULL,
-    DHS_update_entry,
-    DHS_check_info,
-    DHS_fields_used,
-    DHS_DEFAULT_SERVER,
-    DHS_DEFAULT_PORT,
-    DHS_REQUEST
-  },
-  { "dyndns",
-    { "dyndns", 0, 0, },
-    DYNDNS_init,
-    DYNDNS_update_entry,
-    DYNDNS_check_info,
-    DYNDNS_fields_used,
-    DYNDNS_DEFAULT_SERVER,
-    DYNDNS_DEFAULT_PORT,
-    DYNDNS_REQUEST
-  },
-  { "dyndns-static",
-    { "dyndns-static", "dyndns-stat", "statdns", },
-    DYNDNS_init,
-    DYNDNS_update_entry,
-    DYNDNS_check_info,
-    DYNDNS_STAT_fields_used,
-    DYNDNS_DEFAULT_SERVER,
-    DYNDNS_DEFAULT_PORT,
-    DYNDNS_STAT_REQUEST
-  },
-  { "dyndns-custom",
-    { "dyndns-custom", "mydyndns", 0 },
-    DYNDNS_init,
-    DYNDNS_update_entry,
-    DYNDNS_check_info,
-    DYNDNS_STAT_fields_used,
-    DYNDNS_DEFAULT_SERVER,
-    DYNDNS_DEFAULT_PORT,
-    DYNDNS_REQUEST
-  },
-  { "ods",
-    { "ods", 0, 0, },
-    NULL,
-    ODS_update_entry,
-    ODS_check_info,
-    ODS_fields_used,
-    ODS_DEFAULT_SERVER,
-    ODS_DEFAULT_PORT,
-    ODS_REQUEST
-  },
-  { "tzo",
-    { "tzo", 0, 0, },
-    NULL,
-    TZO_update_entry,
-    TZO_check_info,
-    TZO_fields_used,
-    TZO_DEFAULT_SERVER,
-    TZO_DEFAULT_PORT,
-    TZO_REQUEST
-  },
-  { "easydns",
-    { "easydns", 0, 0, },
-    NULL,
-    EASYDNS_update_entry,
-    EASYDNS_check_info,
-    EASYDNS_fields_used,
-    EASYDNS_DEFAULT_SERVER,
-    EASYDNS_DEFAULT_PORT,
-    EASYDNS_REQUEST
-  },
-  { "easydns-partner",
-    { "easydns-partner", 0, 0, },
-    NULL,
-    EASYDNS_PARTNER_update_entry,
-    EASYDNS_PARTNER_check_info,
-    EASYDNS_PARTNER_fields_used,
-    EASYDNS_PARTNER_DEFAULT_SERVER,
-    EASYDNS_PARTNER_DEFAULT_PORT,
-    EASYDNS_PARTNER_REQUEST
-  },
-#ifdef USE_MD5
-  { "gnudip",
-    { "gnudip", 0, 0, },
-    NULL,
-    GNUDIP_update_entry,
-    GNUDIP_check_info,
-    GNUDIP_fields_used,
-    GNUDIP_DEFAULT_SERVER,
-    GNUDIP_DEFAULT_PORT,
-    GNUDIP_REQUEST
-  },
 #endif
-  { "justlinux v2.0 (penguinpowered)",
-    { "justlinux", 0, 0, },
-    NULL,
-    JUSTL_update_entry,
-    JUSTL_check_info,
-    JUSTL_fields_used,
-    JUSTL_DEFAULT_SERVER,
-    JUSTL_DEFAULT_PORT,
-    JUSTL_REQUEST
-  },
-  { "dyns",
-    { "dyns", 0, 0, },
-    NULL,
-    DYNS_update_entry,
-    DYNS_check_info,
-    DYNS_fields_used,
-    DYNS_DEFAULT_SERVER,
-    DYNS_DEFAULT_PORT,
-    DYNS_REQUEST
-  },
-  { "hammer node",
-    { "hn", 0, 0, },
-    NULL,
-    HN_update_entry,
-    HN_check_info,
-    HN_fields_used,
-    HN_DEFAULT_SERVER,
-    HN_DEFAULT_PORT,
-    HN_REQUEST
-  },
-  { "zoneedit",
-    { "zoneedit", 0, 0, },
-    NULL,
-    ZONEEDIT_update_entry,
-    ZONEEDIT_check_info,
-    ZONEEDIT_fields_used,
-    ZONEEDIT_DEFAULT_SERVER,
-    ZONEEDIT_DEFAULT_PORT,
-    ZONEEDIT_REQUEST
-  },
-  { "heipv6tb",
-    { "heipv6tb", 0, 0, },
-    NULL,
-    HEIPV6TB_update_entry,
-    HEIPV6TB_check_info,
-    HEIPV6TB_fields_used,
-    HEIPV6TB_DEFAULT_SERVER,
-    HEIPV6TB_DEFAULT_PORT,
-    HEIPV6TB_REQUEST
-  },
+
+static struct client_service client_services[] = {
+  { "null", NULL, NULL_check_info },
+#ifdef USE_EZIP
+  { "ezip", NULL, EZIP_check_info },
+#endif
+#ifdef USE_PGPOW
+  { "pgpow", NULL, PGPOW_check_info },
+#endif
+#ifdef USE_DHS
+  { "dhs", NULL, DHS_check_info },
+#endif
+#ifdef USE_DYNDNS
+  { "dyndns", DYNDNS_init, DYNDNS_check_info },
+  { "dyndns-static", DYNDNS_init, DYNDNS_check_info },
+  { "dyndns-custom", DYNDNS_init, DYNDNS_check_info },
+#endif
+#ifdef USE_ODS
+  { "ods", NULL, ODS_check_info },
+#endif
+#ifdef USE_TZO
+  { "tzo", NULL, TZO_check_info },
+#endif
+#ifdef USE_EASYDNS
+  { "easydns", NULL, EASYDNS_check_info },
+#endif
+#ifdef USE_EASYDNS_PARTNER
+  { "easydns-partner", NULL, EASYDNS_PARTNER_check_info },
+#endif
+#if defined(USE_MD5) && defined(USE_GNUDIP)
+  { "gnudip", NULL, GNUDIP_check_info },
+#endif
+#ifdef USE_JUSTL
+  { "justlinux", NULL, JUSTL_check_info },
+#endif
+#ifdef USE_DYNS
+  { "dyns", NULL, DYNS_check_info },
+#endif
+#ifdef USE_HN
+  { "hn", NULL, HN_check_info },
+#endif
+#ifdef USE_ZONEEDIT
+  { "zoneedit", NULL, ZONEEDIT_check_info },
+#endif
+#ifdef USE_HEIPV6TB
+  { "heipv6tb", NULL, HEIPV6TB_check_info },
+#endif
 };
 
-static struct service_t *service = NULL;
+void PLUGIN_init(void);
+int PLUGIN_check_info(void);
+static struct client_service plugin_client_service =
+  { "plugin", PLUGIN_init, PLUGIN_check_info };
+
+static struct ez_service *service = NULL;
 
 int options;
 
+// the ones an update session cares about are the same as its EZ_ flags
 #define OPT_DEBUG       0x0001
 #define OPT_DAEMON      0x0004
 #define OPT_QUIET       0x0008
@@ -557,31 +412,65 @@ enum {
   CMD_pid_file,
   CMD_offline,
   CMD_partner,
+  CMD_metrics_file,
+  CMD_metrics_port,
+  CMD_log_target,
+  CMD_ctl_socket,
+  CMD_status_file,
+  CMD_record,
+  CMD_hook_timeout,
+  CMD_hook_batch,
+  CMD_plugin,
+  CMD_address6,
+  CMD_ipv6,
+  CMD_discover,
+  CMD_discover_quorum,
+  CMD_settle,
+  CMD_dns_check,
+  CMD_propagation_timeout,
+  CMD_refresh_spread,
   CMD__end
 };
 
 int conf_handler(struct conf_cmd *cmd, char *arg);
 static struct conf_cmd conf_commands[] = {
   { CMD_address,         "address",         CONF_NEED_ARG, 1, conf_handler, "%s=<ip address>" },
+  { CMD_address6,        "address6",        CONF_NEED_ARG, 1, conf_handler, "%s=<ipv6 address>" },
   { CMD_cache_file,      "cache-file",      CONF_NEED_ARG, 1, conf_handler, "%s=<cache file>" },
   { CMD_cloak_title,     "cloak-title",     CONF_NEED_ARG, 1, conf_handler, "%s=<title>" },
+  { CMD_ctl_socket,      "ctl-socket",      CONF_NEED_ARG, 1, conf_handler, "%s=<path>" },
+  { CMD_discover,        "discover",        CONF_NEED_ARG, 1, conf_handler, "%s=<http://host/path|stun:host[:port]|natpmp[:gateway]>" },
+  { CMD_discover_quorum, "discover-quorum", CONF_NEED_ARG, 1, conf_handler, "%s=<sources that must agree>" },
   { CMD_daemon,          "daemon",          CONF_NO_ARG,   1, conf_handler, "%s=<command>" },
   { CMD_execute,         "execute",         CONF_NEED_ARG, 1, conf_handler, "%s=<shell command>" },
   { CMD_debug,           "debug",           CONF_NO_ARG,   1, conf_handler, "%s" },
+  { CMD_dns_check,       "dns-check",       CONF_NEED_ARG, 1, conf_handler, "%s=<auto|nameserver address>" },
   { CMD_foreground,      "foreground",      CONF_NO_ARG,   1, conf_handler, "%s" },
   { CMD_pid_file,        "pid-file",        CONF_NEED_ARG, 1, conf_handler, "%s=<file>" },
   { CMD_host,            "host",            CONF_NEED_ARG, 1, conf_handler, "%s=<host>" },
+  { CMD_hook_batch,      "hook-batch",      CONF_NEED_ARG, 1, conf_handler, "%s=<seconds to collect changes for>" },
+  { CMD_hook_timeout,    "hook-timeout",    CONF_NEED_ARG, 1, conf_handler, "%s=<seconds>" },
   { CMD_interface,       "interface",       CONF_NEED_ARG, 1, conf_handler, "%s=<interface>" },
+  { CMD_ipv6,            "ipv6",            CONF_NEED_ARG, 1, conf_handler, "%s=<stable,ula,temporary>" },
+  { CMD_log_target,      "log-target",      CONF_NEED_ARG, 1, conf_handler, "%s=<syslog|stderr|file:<path>>" },
   { CMD_mx,              "mx",              CONF_NEED_ARG, 1, conf_handler, "%s=<mail exchanger>" },
   { CMD_max_interval,    "max-interval",    CONF_NEED_ARG, 1, conf_handler, "%s=<number of seconds between updates>" },
+  { CMD_metrics_file,    "metrics-file",    CONF_NEED_ARG, 1, conf_handler, "%s=<file>" },
+  { CMD_metrics_port,    "metrics-port",    CONF_NEED_ARG, 1, conf_handler, "%s=<port>" },
   { CMD_notify_email,    "notify-email",    CONF_NEED_ARG, 1, conf_handler, "%s=<address to email if bad things happen>" },
   { CMD_offline,         "offline",         CONF_NO_ARG,   1, conf_handler, "%s" },
+  { CMD_propagation_timeout, "propagation-timeout", CONF_NEED_ARG, 1, conf_handler, "%s=<seconds to watch DNS for a change>" },
+  { CMD_refresh_spread,  "refresh-spread",  CONF_NEED_ARG, 1, conf_handler, "%s=<seconds to spread refreshes over>" },
   { CMD_retrys,          "retrys",          CONF_NEED_ARG, 1, conf_handler, "%s=<number of trys>" },
   { CMD_server,          "server",          CONF_NEED_ARG, 1, conf_handler, "%s=<server name>" },
+  { CMD_settle,          "settle",          CONF_NEED_ARG, 1, conf_handler, "%s=<seconds a change has to hold>" },
   { CMD_service_type,    "service-type",    CONF_NEED_ARG, 1, conf_handler, "%s=<service type>" },
+  { CMD_status_file,     "status-file",     CONF_NEED_ARG, 1, conf_handler, "%s=<file|shm:/name>" },
+  { CMD_record,          "record",          CONF_NEED_ARG, 1, conf_handler, "%s=<file>" },
   { CMD_timeout,         "timeout",         CONF_NEED_ARG, 1, conf_handler, "%s=<sec.millisec>" },
   { CMD_resolv_period,   "resolv-period",   CONF_NEED_ARG, 1, conf_handler, "%s=<time between failed resolve attempts>" },
   { CMD_period,          "period",          CONF_NEED_ARG, 1, conf_handler, "%s=<time between update attempts>" },
+  { CMD_plugin,          "plugin",          CONF_NEED_ARG, 1, conf_handler, "%s=<shared object>" },
   { CMD_url,             "url",             CONF_NEED_ARG, 1, conf_handler, "%s=<url>" },
   { CMD_user,            "user",            CONF_NEED_ARG, 1, conf_handler, "%s=<user name>[:password]" },
   { CMD_run_as_user,     "run-as-user",     CONF_NEED_ARG, 1, conf_handler, "%s=<user>" },
@@ -599,11 +488,13 @@ static struct conf_cmd conf_commands[] = {
 void print_usage( void );
 void print_version( void );
 void parse_args( int argc, char **argv );
-int do_connect(int *sock, char *host, char *port);
-void base64Encode(char *intext, char *output);
 int main( int argc, char **argv );
 void warn_fields(char **okay_fields);
 static int is_in_list(char *needle, char **haystack);
+static void plugin_say(int level, const char *msg);
+static char *plugin_ask(const char *what, int secret);
+static void session_from_options(void);
+static void options_from_session(void);
 
 /**************************************************/
 
@@ -613,43 +504,68 @@ void print_usage( void )
   int width;
 
   fprintf(stdout, "usage: ");
-  fprintf(stdout, "%s [options] \n\n", program_name);
+  fprintf(stdout, "%s [options] \n", program_name);
+  fprintf(stdout, "       %s ctl [--socket <path>] <command>\n", program_name);
+  fprintf(stdout, "       %s replay [-n <count>] [-v] <transcript>\n\n", program_name);
+#ifdef USE_HELP
   fprintf(stdout, " Options are:\n");
   fprintf(stdout, "  -a, --address <ip address>\tstring to send as your ip address\n");
+  fprintf(stdout, "      --address6 <address>\tIPv6 address to send as well, for the\n\t\t\t\tservices that take one\n");
   fprintf(stdout, "  -b, --cache-file <file>\tfile to use for caching the ipaddress\n");
   fprintf(stdout, "  -c, --config-file <file>\tconfiguration file, almost all arguments can be\n");
   fprintf(stdout, "\t\t\t\tgiven with: <name>[=<value>]\n\t\t\t\tto see a list of possible config commands\n");
   fprintf(stdout, "\t\t\t\ttry \"echo help | %s -c -\"\n", program_name);
+  fprintf(stdout, "      --ctl-socket <path>\tlisten for control commands on the unix\n\t\t\t\tsocket <path> in daemon mode, try\n\t\t\t\t\"%s ctl help\"\n", program_name);
   fprintf(stdout, "  -d, --daemon\t\t\trun as a daemon periodicly updating if \n\t\t\t\tnecessary\n");
+  fprintf(stdout, "      --discover <source>\tlearn the public address from a checkip page,\n\t\t\t\thttp://host[:port]/path, or a STUN server,\n\t\t\t\tstun:host[:port], or a NAT-PMP gateway,\n\t\t\t\tnatpmp[:gateway] (default: the default route's),\n\t\t\t\trather than the interface, which is then only\n\t\t\t\ta fallback. give it more than once for more\n\t\t\t\tsources\n");
+  fprintf(stdout, "      --discover-quorum <n>\tsources that have to agree on the address\n\t\t\t\t(default: 2, or 1 with one source)\n");
+  fprintf(stdout, "      --dns-check <auto|ns>\tskip the update if DNS already has the\n\t\t\t\taddress, asking the host's own nameservers\n\t\t\t\t(auto) or the nameserver at <ns>\n");
 #ifdef DEBUG
   fprintf(stdout, "  -D, --debug\t\t\tturn on debuggin\n");
 #endif
-  fprintf(stdout, "  -e, --execute <command>\tshell command to execute after a successful\n\t\t\t\tupdate\n");
+  fprintf(stdout, "  -e, --execute <command>\tcommand to run with the new address after a\n\t\t\t\tsuccessful update\n");
   fprintf(stdout, "  -f, --foreground\t\twhen running as a daemon run in the foreground\n");
   fprintf(stdout, "  -F, --pidfile <file>\t\tuse <file> as a pid file\n");
   fprintf(stdout, "  -g, --request-uri <uri>\tURI to send updates to\n");
   fprintf(stdout, "  -h, --host <host>\t\tstring to send as host parameter\n");
-  fprintf(stdout, "  -i, --interface <iface>\twhich interface to use\n");
+  fprintf(stdout, "      --hook-batch <sec>\tin daemon mode run the execute command once\n\t\t\t\tfor the changes in <sec>, passing them as\n\t\t\t\tJSON on its stdin (default: 0, each change)\n");
+  fprintf(stdout, "      --hook-timeout <sec>\tkill the execute command if it runs longer\n\t\t\t\tthan <sec> (default: %d seconds)\n", DEFAULT_HOOK_TIMEOUT);
+  fprintf(stdout, "  -i, --interface <iface>\twhich interface to use, eth0:1 for an alias,\n\t\t\t\teth0#2 for its second address or %s\n\t\t\t\tfor the one the default route uses\n", IFSNAP_DEFAULT_ROUTE);
+  fprintf(stdout, "      --ipv6 <kinds>\t\talso send the interface's IPv6 address, the\n\t\t\t\tfirst of the comma separated kinds it has\n\t\t\t\tout of stable, ula and temporary\n");
   fprintf(stdout, "  -L, --cloak_title <host>\tsome stupid thing for DHS only\n");
+  fprintf(stdout, "      --log-target <target>\twhere daemon mode logs: syslog, stderr or\n\t\t\t\tfile:<path> (default: syslog)\n");
   fprintf(stdout, "  -m, --mx <mail exchange>\tstring to send as your mail exchange\n");
   fprintf(stdout, "  -M, --max-interval <# of sec>\tmax time in between updates\n");
+  fprintf(stdout, "      --metrics-file <file>\twrite update metrics to <file> in the\n\t\t\t\tPrometheus text format\n");
+  fprintf(stdout, "      --metrics-port <port>\tserve metrics on http://127.0.0.1:<port>/\n\t\t\t\tin daemon mode\n");
   fprintf(stdout, "  -N, --notify-email <email>\taddress to send mail to if bad things happen\n");
   fprintf(stdout, "  -o, --offline\t\t\tset to off line mode\n");
   fprintf(stdout, "  -p, --resolv-period <sec>\tperiod to check IP if it can't be resolved\n");
   fprintf(stdout, "  -P, --period <# of sec>\tperiod to check IP in daemon \n\t\t\t\tmode (default: 1800 seconds)\n");
+  fprintf(stdout, "      --plugin <file>\t\tload the plugin <file>, before the\n\t\t\t\tservice-type if it provides the service\n");
+  fprintf(stdout, "      --propagation-timeout <sec>\n\t\t\t\tin daemon mode watch the host's nameservers\n\t\t\t\tfor up to <sec> after each change to time\n\t\t\t\thow long it takes to show (default: 0, off)\n");
   fprintf(stdout, "  -q, --quiet \t\t\tbe quiet\n");
+  fprintf(stdout, "      --record <file>\t\tappend a transcript of what is sent to and\n\t\t\t\treceived from the server to <file>, with\n\t\t\t\tpasswords blanked, see \"%s replay\"\n", program_name);
+  fprintf(stdout, "      --refresh-spread <sec>\trefresh up to <sec> before max-interval is\n\t\t\t\tup, by a hash of the service and host, so\n\t\t\t\tboxes that updated together don't refresh\n\t\t\t\ttogether (default: 0)\n");
   fprintf(stdout, "  -r, --retrys <num>\t\tnumber of trys (default: 1)\n");
   fprintf(stdout, "  -R, --run-as-user <user>\tchange to <user> for running, be ware\n\t\t\t\tthat this can cause problems with handeling\n\t\t\t\tSIGHUP properly if that user can't read the\n\t\t\t\tconfig file. also it can't write it's pid file \n\t\t\t\tto a root directory\n");
   fprintf(stdout, "  -Q, --run-as-euser <user>\tchange to effective <user> for running, \n\t\t\t\tthis is NOT secure but it does solve the \n\t\t\t\tproblems with run-as-user and config files and \n\t\t\t\tpid files.\n");
   fprintf(stdout, "  -s, --server <server[:port]>\tthe server to connect to\n");
+  fprintf(stdout, "      --settle <sec>\t\tin daemon mode only update once a change has\n\t\t\t\theld for <sec>, longer on links that change\n\t\t\t\toften (default: 0, at once)\n");
   fprintf(stdout, "  -S, --service-type <server>\tthe type of service that you are using\n");
   width = fprintf(stdout, "\t\t\t\ttry one of: ") + 4*7;
-  for(i=0; i<ARRAY_LEN(services); i++)
+#else
+  fprintf(stdout, " built without option help, see the README.\n");
+  width = fprintf(stdout, " Services are: ");
+#endif
+  for(i=0; i<ez_nservices; i++)
   {
     if(width > 60) { width = fprintf(stdout, "\n\t\t\t\t") -1 + 4*7; }
-    width += fprintf(stdout, "%s ", services[i].names[0]);
+    width += fprintf(stdout, "%s ", ez_services[i].names[0]);
   }
   fprintf(stdout, "\n");
+#ifdef USE_HELP
+  fprintf(stdout, "      --status-file <file>\tpublish job status in <file> (or shm:/<name>)\n\t\t\t\tfor ez-ipstatus in daemon mode\n");
   fprintf(stdout, "  -t, --timeout <sec.millisec>\tthe amount of time to wait on I/O\n");
   fprintf(stdout, "  -T, --connection-type <num>\tnumber sent to TZO as your connection \n\t\t\t\ttype (default: 1)\n");
   fprintf(stdout, "  -U, --url <url>\t\tstring to send as the url parameter\n");
@@ -660,6 +576,7 @@ void print_usage( void )
   fprintf(stdout, "      --version\t\t\toutput version information and exit\n");
   fprintf(stdout, "      --credits\t\t\tprint the credits and exit\n");
   fprintf(stdout, "      --signalhelp\t\tprint help about signals\n");
+#endif
   fprintf(stdout, "\n");
 }
 
@@ -687,6 +604,7 @@ void print_signalhelp( void )
   fprintf(stdout, "  HUP\t\tcauses it to re-read its config file\n");
   fprintf(stdout, "  TERM\t\twake up and possibly perform an update\n");
   fprintf(stdout, "  QUIT\t\tshutdown\n");
+  fprintf(stdout, "  USR2\t\tre-exec the (upgraded) binary, carrying on where\n\t\tthis one left off\n");
   fprintf(stdout, "\n");
 }
 
@@ -694,7 +612,7 @@ void print_signalhelp( void )
 RETSIGTYPE sigint_handler(int sig)
 {
   char message[] = "interupted.\n";
-  close(client_sockfd);
+  close(session.sock);
   write(2, message, sizeof(message)-1);
 
 #if HAVE_GETPID
@@ -750,15 +668,6 @@ int get_duration(char *str)
   return(duration);
 }
 
-const char* format_time(int seconds)
-{
-  static char buf[16];
-
-  snprintf(buf, sizeof(buf), "%d:%02d:%02d", seconds/(3600),
-          (seconds%(3600))/(60), (seconds%60));
-  return(buf);
-}
-
 /*
  * like "chomp" in perl, take off trailing newline chars
  */
@@ -779,8 +688,8 @@ char *chomp(char *buf)
 /*
  * show_message
  *
- * if we are running in daemon mode then log to syslog, if not just output to
- * stderr.
+ * if we are running in daemon mode then hand it to the logger, if not just
+ * output to stderr.
  *
  */
 void show_message(char *fmt, ...)
@@ -788,17 +697,9 @@ void show_message(char *fmt, ...)
   va_list args; 
   va_start(args, fmt);
 
-  if(options & OPT_DAEMON && !(options & OPT_FOREGROUND))
+  if(options & OPT_DAEMON)
   {
-    char buf[MAX_MESSAGE_LEN];
-
-#if defined(HAVE_VSPRINTF) || defined(HAVE_VSNPRINTF)
-    vsnprintf(buf, sizeof(buf), fmt, args);
-#else
-    sprintf(buf, "message incomplete because your OS sucks: %s\n", fmt);
-#endif
-
-    syslog(LOG_NOTICE, buf);
+    logger_vlog(LOG_NOTICE, fmt, args);
   }
   else
   {
@@ -854,30 +755,55 @@ void parse_service(char *str)
   int i;
   int width;
 
-  for(i=0; i<ARRAY_LEN(services); i++)
+  if((service=ez_service_find(str)) != NULL)
   {
-    int j;
-    for(j=0; j<ARRAY_LEN(services[i].names) && services[i].names[j] != NULL; j++)
-    {
-      if(strcmp(services[i].names[j], str) == 0)
-      {
-        service = &(services[i]);
-        return;
-      }
-    }
+    return;
   }
   fprintf(stderr, "unknown service type: %s\n", str);
   fprintf(stderr, "try one of: \n");
   width = fprintf(stderr, "  ");
-  for(i=0; i<ARRAY_LEN(services); i++)
+  for(i=0; i<ez_nservices; i++)
   {
     if(width > 60) { width = fprintf(stderr, "\n  ") -1; }
-    width += fprintf(stderr, "%s ", services[i].names[0]);
+    width += fprintf(stderr, "%s ", ez_services[i].names[0]);
+  }
+  for(i=0; ez_service_extra(i) != NULL; i++)
+  {
+    if(width > 60) { width = fprintf(stderr, "\n  ") -1; }
+    width += fprintf(stderr, "%s ", ez_service_extra(i)->names[0]);
   }
   fprintf(stderr, "\n");
   exit(1);
 }
 
+/*
+ * the client's part of the service being used
+ */
+static struct client_service *client_service(void)
+{
+  int i;
+
+  for(i=0; i<ARRAY_LEN(client_services); i++)
+  {
+    if(strcmp(client_services[i].name, service->names[0]) == 0)
+    {
+      return(&client_services[i]);
+    }
+  }
+
+  // a service from a plugin only gets the generic checks
+  for(i=0; ez_service_extra(i) != NULL; i++)
+  {
+    if(service == ez_service_extra(i))
+    {
+      return(&plugin_client_service);
+    }
+  }
+
+  // the library and the client are built with the same services
+  return(&client_services[0]);
+}
+
 int option_handler(int id, char *optarg)
 {
 #if HAVE_PWD_H && HAVE_GRP_H
@@ -889,11 +815,63 @@ int option_handler(int id, char *optarg)
   switch(id)
   {
     case CMD_address:
-      if(address) { free(address); }
-      address = strdup(optarg);
+      arena_string(&config_arena, &address, optarg);
       dprintf((stderr, "address: %s\n", address));
       break;
 
+    case CMD_address6:
+      {
+        struct in6_addr in6;
+
+        if(inet_pton(AF_INET6, optarg, &in6) != 1)
+        {
+          fprintf(stderr, "the IPv6 address \"%s\" is invalid\n", optarg);
+          exit(1);
+        }
+      }
+      arena_string(&config_arena, &address6, optarg);
+      dprintf((stderr, "address6: %s\n", address6));
+      break;
+
+    case CMD_ipv6:
+      if(ifaddr6_check_policy(optarg) != 0)
+      {
+        fprintf(stderr, "invalid IPv6 address kinds: %s, try some of "
+            "stable,ula,temporary\n", optarg);
+        exit(1);
+      }
+      arena_string(&config_arena, &ipv6_policy, optarg);
+      dprintf((stderr, "ipv6_policy: %s\n", ipv6_policy));
+      break;
+
+    case CMD_discover:
+      if(discover_add(optarg) != 0)
+      {
+        fprintf(stderr, "invalid discovery source: %s\n", optarg);
+        exit(1);
+      }
+      dprintf((stderr, "discover: %s\n", optarg));
+      break;
+
+    case CMD_discover_quorum:
+      discover_quorum(atoi(optarg));
+      dprintf((stderr, "discover_quorum: %s\n", optarg));
+      break;
+
+    case CMD_dns_check:
+      if(dnscheck_set(optarg) != 0)
+      {
+        fprintf(stderr, "invalid nameserver for dns-check: %s\n", optarg);
+        exit(1);
+      }
+      dprintf((stderr, "dns_check: %s\n", optarg));
+      break;
+
+    case CMD_ctl_socket:
+      arena_string(&config_arena, &ctl_socket, optarg);
+      dprintf((stderr, "ctl_socket: %s\n", ctl_socket));
+      break;
+
     case CMD_daemon:
       options |= OPT_DAEMON;
       dprintf((stderr, "daemon mode\n"));
@@ -902,6 +880,7 @@ int option_handler(int id, char *optarg)
     case CMD_debug:
 #ifdef DEBUG
       options |= OPT_DEBUG;
+      ez_set_debug(1);
       dprintf((stderr, "debugging on\n"));
 #else
       fprintf(stderr, "debugging was not enabled at compile time\n");
@@ -910,10 +889,7 @@ int option_handler(int id, char *optarg)
 
     case CMD_execute:
 #if defined(HAVE_WAITPID) || defined(HAVE_WAIT)
-      if(post_update_cmd) { free(post_update_cmd); }
-      post_update_cmd = malloc(strlen(optarg) + 1 + ARGLENGTH + 1);
-      post_update_cmd_arg = post_update_cmd + strlen(optarg) + 1;
-      sprintf(post_update_cmd, "%s ", optarg);
+      arena_string(&config_arena, &post_update_cmd, optarg);
       dprintf((stderr, "post_update_cmd: %s\n", post_update_cmd));
 #else
       fprintf(stderr, "command execution not enabled at compile time\n");
@@ -921,6 +897,27 @@ int option_handler(int id, char *optarg)
 #endif
       break;
 
+    case CMD_hook_batch:
+      hook_batch = get_duration(optarg);
+      hook_config(hook_timeout, hook_batch);
+      dprintf((stderr, "hook_batch: %d\n", hook_batch));
+      break;
+
+    case CMD_plugin:
+      if(plugin_load(optarg, plugin_say, plugin_ask) != 0)
+      {
+        fprintf(stderr, "unable to load plugin \"%s\": %s\n", optarg,
+            plugin_error());
+        exit(1);
+      }
+      break;
+
+    case CMD_hook_timeout:
+      hook_timeout = get_duration(optarg);
+      hook_config(hook_timeout, hook_batch);
+      dprintf((stderr, "hook_timeout: %d\n", hook_timeout));
+      break;
+
     case CMD_foreground:
       options |= OPT_FOREGROUND;
       dprintf((stderr, "fork()ing off\n"));
@@ -928,8 +925,7 @@ int option_handler(int id, char *optarg)
 
     case CMD_pid_file:
 #if HAVE_GETPID
-      if(pid_file) { free(pid_file); }
-      pid_file = strdup(optarg);
+      arena_string(&config_arena, &pid_file, optarg);
       dprintf((stderr, "pid file: %s\n", pid_file));
 #else
       fprintf(stderr, "pid file support not enabled at compile time\n");
@@ -937,15 +933,13 @@ int option_handler(int id, char *optarg)
       break;
 
     case CMD_host:
-      if(host) { free(host); }
-      host = strdup(optarg);
+      arena_string(&config_arena, &host, optarg);
       dprintf((stderr, "host: %s\n", host));
       break;
 
     case CMD_interface:
 #ifdef IF_LOOKUP
-      if(interface) { free(interface); }
-      interface = strdup(optarg);
+      arena_string(&config_arena, &interface, optarg);
       dprintf((stderr, "interface: %s\n", interface));
 #else
       fprintf(stderr, "interface lookup not enabled at compile time\n");
@@ -953,9 +947,19 @@ int option_handler(int id, char *optarg)
 #endif
       break;
 
+    case CMD_log_target:
+      if(strcmp(optarg, "syslog") != 0 && strcmp(optarg, "stderr") != 0 &&
+          strncmp(optarg, "file:", 5) != 0)
+      {
+        fprintf(stderr, "invalid log target: %s\n", optarg);
+        exit(1);
+      }
+      arena_string(&config_arena, &log_target, optarg);
+      dprintf((stderr, "log_target: %s\n", log_target));
+      break;
+
     case CMD_mx:
-      if(mx) { free(mx); }
-      mx = strdup(optarg);
+      arena_string(&config_arena, &mx, optarg);
       dprintf((stderr, "mx: %s\n", mx));
       break;
 
@@ -970,9 +974,23 @@ int option_handler(int id, char *optarg)
       dprintf((stderr, "max_interval: %d\n", max_interval));
       break;
 
+    case CMD_metrics_file:
+      arena_string(&config_arena, &metrics_file, optarg);
+      dprintf((stderr, "metrics_file: %s\n", metrics_file));
+      break;
+
+    case CMD_metrics_port:
+      metrics_port = atoi(optarg);
+      if(metrics_port <= 0 || metrics_port > 65535)
+      {
+        fprintf(stderr, "invalid metrics port: %s\n", optarg);
+        exit(1);
+      }
+      dprintf((stderr, "metrics_port: %d\n", metrics_port));
+      break;
+
     case CMD_notify_email:
-      if(notify_email) { free(notify_email); }
-      notify_email = strdup(optarg);
+      arena_string(&config_arena, &notify_email, optarg);
       dprintf((stderr, "notify_email: %s\n", notify_email));
       break;
 
@@ -1003,6 +1021,29 @@ int option_handler(int id, char *optarg)
       dprintf((stderr, "resolv_period: %d\n", resolv_period));
       break;
 
+    case CMD_propagation_timeout:
+      change_watch(get_duration(optarg));
+      dprintf((stderr, "propagation_timeout: %s\n", optarg));
+      break;
+
+    case CMD_refresh_spread:
+      refresh_spread = get_duration(optarg);
+      if(refresh_spread < 0)
+      {
+        refresh_spread = 0;
+      }
+      dprintf((stderr, "refresh_spread: %d\n", refresh_spread));
+      break;
+
+    case CMD_settle:
+      settle_time = get_duration(optarg);
+      if(settle_time < 0)
+      {
+        settle_time = 0;
+      }
+      dprintf((stderr, "settle_time: %d\n", settle_time));
+      break;
+
     case CMD_quiet:
       options |= OPT_QUIET;
       dprintf((stderr, "quiet mode\n"));
@@ -1014,28 +1055,24 @@ int option_handler(int id, char *optarg)
       break;
 
     case CMD_server:
-      if(server) { free(server); }
-      server = strdup(optarg);
+      arena_string(&config_arena, &server, optarg);
       tmp = strchr(server, ':');
       if(tmp)
       {
         *tmp++ = '\0';
-        if(port) { free(port); }
-        port = strdup(tmp);
+        arena_string(&config_arena, &port, tmp);
       }
       dprintf((stderr, "server: %s\n", server));
       dprintf((stderr, "port: %s\n", port));
       break;
 
     case CMD_request:
-      if(request_over_ride) { free(request_over_ride); }
-      request_over_ride = strdup(optarg);
+      arena_string(&config_arena, &request_over_ride, optarg);
       dprintf((stderr, "request_over_ride: %s\n", request_over_ride));
       break;
 
     case CMD_partner:
-      if(partner) { free(partner); }
-      partner = strdup(optarg);
+      arena_string(&config_arena, &partner, optarg);
       dprintf((stderr, "easyDNS partner: %s\n", partner));
       break;
 
@@ -1046,6 +1083,21 @@ int option_handler(int id, char *optarg)
       dprintf((stderr, "service->name: %s\n", service->names[0]));
       break;
 
+    case CMD_status_file:
+      arena_string(&config_arena, &status_file, optarg);
+      dprintf((stderr, "status_file: %s\n", status_file));
+      break;
+
+    case CMD_record:
+      arena_string(&config_arena, &record_file, optarg);
+      dprintf((stderr, "record_file: %s\n", record_file));
+      if(transcript_open(record_file) != 0)
+      {
+        show_message("unable to open transcript \"%s\": %s\n", record_file,
+            error_string);
+      }
+      break;
+
     case CMD_user:
       strncpy(user, optarg, sizeof(user));
       user[sizeof(user)-1] = '\0';
@@ -1109,8 +1161,7 @@ int option_handler(int id, char *optarg)
       break;
 
     case CMD_url:
-      if(url) { free(url); }
-      url = strdup(optarg);
+      arena_string(&config_arena, &url, optarg);
       dprintf((stderr, "url: %s\n", url));
       break;
 
@@ -1120,8 +1171,7 @@ int option_handler(int id, char *optarg)
       break;
 
     case CMD_cloak_title:
-      if(cloak_title) { free(cloak_title); }
-      cloak_title = strdup(optarg);
+      arena_string(&config_arena, &cloak_title, optarg);
       dprintf((stderr, "cloak_title: %s\n", cloak_title));
       break;
 
@@ -1137,8 +1187,7 @@ int option_handler(int id, char *optarg)
       break;
 
     case CMD_cache_file:
-      if(cache_file) { free(cache_file); }
-      cache_file = strdup(optarg);
+      arena_string(&config_arena, &cache_file, optarg);
       dprintf((stderr, "cache_file: %s\n", cache_file));
       break;
 
@@ -1162,33 +1211,53 @@ int conf_handler(struct conf_cmd *cmd, char *arg)
 #  define xgetopt( x1, x2, x3, x4, x5 ) getopt( x1, x2, x3 )
 #endif
 
+// options that only have a long form return LONG_OPT(CMD_xxx)
+#define LONG_OPT(cmd) (0x100 + (cmd))
+
 void parse_args( int argc, char **argv )
 {
 #ifdef HAVE_GETOPT_LONG
   struct option long_options[] = {
       {"address",         required_argument,      0, 'a'},
+      {"address6",        required_argument,      0, LONG_OPT(CMD_address6)},
       {"cache-file",      required_argument,      0, 'b'},
       {"config_file",     required_argument,      0, 'c'},
       {"config-file",     required_argument,      0, 'c'},
+      {"ctl-socket",      required_argument,      0, LONG_OPT(CMD_ctl_socket)},
       {"daemon",          no_argument,            0, 'd'},
       {"debug",           no_argument,            0, 'D'},
+      {"discover",        required_argument,      0, LONG_OPT(CMD_discover)},
+      {"dns-check",       required_argument,      0, LONG_OPT(CMD_dns_check)},
+      {"discover-quorum", required_argument,      0, LONG_OPT(CMD_discover_quorum)},
       {"execute",         required_argument,      0, 'e'},
       {"foreground",      no_argument,            0, 'f'},
       {"pid-file",        required_argument,      0, 'F'},
       {"host",            required_argument,      0, 'h'},
+      {"hook-batch",      required_argument,      0, LONG_OPT(CMD_hook_batch)},
+      {"hook-timeout",    required_argument,      0, LONG_OPT(CMD_hook_timeout)},
       {"interface",       required_argument,      0, 'i'},
+      {"ipv6",            required_argument,      0, LONG_OPT(CMD_ipv6)},
       {"cloak_title",     required_argument,      0, 'L'},
+      {"log-target",      required_argument,      0, LONG_OPT(CMD_log_target)},
       {"mx",              required_argument,      0, 'm'},
       {"max-interval",    required_argument,      0, 'M'},
+      {"metrics-file",    required_argument,      0, LONG_OPT(CMD_metrics_file)},
+      {"metrics-port",    required_argument,      0, LONG_OPT(CMD_metrics_port)},
       {"notify-email",    required_argument,      0, 'N'},
       {"resolv-period",   required_argument,      0, 'p'},
       {"period",          required_argument,      0, 'P'},
+      {"plugin",          required_argument,      0, LONG_OPT(CMD_plugin)},
+      {"propagation-timeout", required_argument,  0, LONG_OPT(CMD_propagation_timeout)},
       {"quiet",           no_argument,            0, 'q'},
+      {"record",          required_argument,      0, LONG_OPT(CMD_record)},
+      {"refresh-spread",  required_argument,      0, LONG_OPT(CMD_refresh_spread)},
       {"retrys",          required_argument,      0, 'r'},
       {"run-as-user",     required_argument,      0, 'R'},
       {"run-as-euser",    required_argument,      0, 'Q'},
       {"server",          required_argument,      0, 's'},
       {"service-type",    required_argument,      0, 'S'},
+      {"settle",          required_argument,      0, LONG_OPT(CMD_settle)},
+      {"status-file",     required_argument,      0, LONG_OPT(CMD_status_file)},
       {"timeout",         required_argument,      0, 't'},
       {"connection-type", required_argument,      0, 'T'},
       {"url",             required_argument,      0, 'U'},
@@ -1219,8 +1288,7 @@ void parse_args( int argc, char **argv )
         break;
 
       case 'c':
-        if(config_file) { free(config_file); }
-        config_file = strdup(optarg);
+        arena_string(&config_arena, &config_file, optarg);
         dprintf((stderr, "config_file: %s\n", config_file));
         if(config_file)
         {
@@ -1361,6 +1429,11 @@ void parse_args( int argc, char **argv )
         break;
 
       default:
+        if(opt > LONG_OPT(CMD__start) && opt < LONG_OPT(CMD__end))
+        {
+          option_handler(opt - LONG_OPT(0), optarg);
+          break;
+        }
 #ifdef HAVE_GETOPT_LONG
         fprintf(stderr, "Try `%s --help' for more information\n", argv[0]);
 #else
@@ -1374,256 +1447,162 @@ void parse_args( int argc, char **argv )
   }
 }
 
-/*
- * do_connect
- *
- * connect a socket and return the file descriptor
- *
- */
-int do_connect(int *sock, char *host, char *port)
+#if IF_LOOKUP 
+#  if !defined(HAVE_INET_ATON) 
+#    if defined(HAVE_INET_ADDR)
+int inet_aton(const char *cp, struct in_addr *inp)
 {
-  struct sockaddr_in address;
-  int len;
-  int result;
-  struct hostent *hostinfo;
-  struct servent *servinfo;
+  (*inp).s_addr = inet_addr(cp);
+}
+#  else
+#    error "sorry, can't compile with IF_LOOKUP and no inet_aton"
+#  endif
+#endif
+#endif
 
-  // set up the socket
-  if((*sock=socket(AF_INET, SOCK_STREAM, 0)) == -1)
-  {
-    if(!(options & OPT_QUIET))
-    {
-      perror("socket");
-    }
-    return(-1);
-  }
-  address.sin_family = AF_INET;
+static void client_pause(struct ez_session *s, int seconds)
+{
+  event_wait(seconds);
+}
 
-  // get the host address
-  hostinfo = gethostbyname(host);
-  if(!hostinfo)
+/*
+ * the replay transport, see replay_main()
+ */
+static int replay_connect(struct ez_session *s)
+{
+  if(transcript_replay_connect() != 0)
   {
-    if(!(options & OPT_QUIET))
-    {
-      herror("gethostbyname");
-    }
-    close(*sock);
     return(-1);
   }
-  address.sin_addr = *(struct in_addr *)*hostinfo -> h_addr_list;
-
-  // get the host port
-  servinfo = getservbyname(port, "tcp");
-  if(servinfo)
-  {
-    address.sin_port = servinfo -> s_port;
-  }
-  else
-  {
-    address.sin_port = htons(atoi(port));
-  }
-
-  // connect the socket
-  len = sizeof(address);
-  if((result=connect(*sock, (struct sockaddr *)&address, len)) == -1) 
+  // something the update code can close()
+  if((s->sock=open("/dev/null", O_RDWR)) < 0)
   {
-    if(!(options & OPT_QUIET))
-    {
-      perror("connect");
-    }
-    close(*sock);
     return(-1);
   }
+  return(0);
+}
 
-  // print out some info
-  if(!(options & OPT_QUIET))
-  {
-    fprintf(stderr,
-        "connected to %s (%s) on port %d.\n",
-        host,
-        inet_ntoa(address.sin_addr),
-        ntohs(address.sin_port));
-  }
-
-  return 0;
+static int replay_send(struct ez_session *s, char *buf, int len)
+{
+  return(transcript_replay_send(buf, len));
 }
 
-static char table64[]=
-  "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/";
-void base64Encode(char *intext, char *output)
+static int replay_recv(struct ez_session *s, char *buf, int len)
 {
-  unsigned char ibuf[3];
-  unsigned char obuf[4];
-  int i;
-  int inputparts;
-
-  while(*intext) {
-    for (i = inputparts = 0; i < 3; i++) { 
-      if(*intext) {
-        inputparts++;
-        ibuf[i] = *intext;
-        intext++;
-      }
-      else
-        ibuf[i] = 0;
-    }
+  return(transcript_replay_recv(buf, len));
+}
 
-    obuf [0] = (ibuf [0] & 0xFC) >> 2;
-    obuf [1] = ((ibuf [0] & 0x03) << 4) | ((ibuf [1] & 0xF0) >> 4);
-    obuf [2] = ((ibuf [1] & 0x0F) << 2) | ((ibuf [2] & 0xC0) >> 6);
-    obuf [3] = ibuf [2] & 0x3F;
+static void replay_pause(struct ez_session *s, int seconds)
+{
+}
 
-    switch(inputparts) {
-      case 1: /* only one byte read */
-        sprintf(output, "%c%c==", 
-            table64[obuf[0]],
-            table64[obuf[1]]);
-        break;
-      case 2: /* two bytes read */
-        sprintf(output, "%c%c%c=", 
-            table64[obuf[0]],
-            table64[obuf[1]],
-            table64[obuf[2]]);
-        break;
-      default:
-        sprintf(output, "%c%c%c%c", 
-            table64[obuf[0]],
-            table64[obuf[1]],
-            table64[obuf[2]],
-            table64[obuf[3]] );
-        break;
-    }
-    output += 4;
+/*
+ * where the session's messages go: results to stdout, notices to the log
+ * in daemon mode and the rest to stderr
+ */
+static void client_message(struct ez_session *s, int level, const char *msg)
+{
+  switch(level)
+  {
+    case EZ_MSG_RESULT:
+      fputs(msg, stdout);
+      break;
+    case EZ_MSG_NOTICE:
+      show_message("%s", msg);
+      break;
+    default:
+      fputs(msg, stderr);
+      break;
   }
-  *output=0;
 }
 
-#if IF_LOOKUP 
-#  if !defined(HAVE_INET_ATON) 
-#    if defined(HAVE_INET_ADDR)
-int inet_aton(const char *cp, struct in_addr *inp)
+/* where plugins' messages go */
+static void plugin_say(int level, const char *msg)
 {
-  (*inp).s_addr = inet_addr(cp);
+  client_message(NULL, level, msg);
 }
-#  else
-#    error "sorry, can't compile with IF_LOOKUP and no inet_aton"
-#  endif
-#endif
-#endif
 
-void output(void *buf)
+/* ask the user for what a plugin's service is missing */
+static char *plugin_ask(const char *what, int secret)
 {
-  fd_set writefds;
-  int max_fd;
-  struct timeval tv;
-  int ret;
-
-  dprintf((stderr, "I say: %s\n", (char *)buf));
-
-  // set up our fdset and timeout
-  FD_ZERO(&writefds);
-  FD_SET(client_sockfd, &writefds);
-  max_fd = client_sockfd;
-  memcpy(&tv, &timeout, sizeof(struct timeval));
+  char *buf = update_buf;
+  char *answer = NULL;
 
-  ret = select(max_fd + 1, NULL, &writefds, NULL, &tv);
-  dprintf((stderr, "ret: %d\n", ret));
-
-  if(ret == -1)
-  {
-    dprintf((stderr, "select: %s\n", error_string));
-  }
-  else if(ret == 0)
+  if(options & OPT_DAEMON)
   {
-    fprintf(stderr, "timeout\n");
+    return(NULL);
   }
-  else
+  if(secret)
   {
-    /* if we woke up on client_sockfd do the data passing */
-    if(FD_ISSET(client_sockfd, &writefds))
-    {
-      if(send(client_sockfd, buf, strlen(buf), 0) == -1)
-      {
-        fprintf(stderr, "error send()ing request: %s\n", error_string);
-      }
-    }
-    else
-    {
-      dprintf((stderr, "error: case not handled."));
-    }
+    snprintf(buf, BUFFER_SIZE, "%s: ", what);
+    arena_string(&config_arena, &answer, getpass(buf));
+    return(answer);
   }
+  printf("%s: ", what);
+  *buf = '\0';
+  fgets(buf, BUFFER_SIZE, stdin);
+  chomp(buf);
+  return(arena_string(&config_arena, &answer, buf));
 }
 
-int read_input(char *buf, int len)
+static void client_trace(struct ez_session *s, int type, const char *buf,
+    int len)
 {
-  fd_set readfds;
-  int max_fd;
-  struct timeval tv;
-  int ret;
-  int bread = -1;
-
-  // set up our fdset and timeout
-  FD_ZERO(&readfds);
-  FD_SET(client_sockfd, &readfds);
-  max_fd = client_sockfd;
-  memcpy(&tv, &timeout, sizeof(struct timeval));
-
-  ret = select(max_fd + 1, &readfds, NULL, NULL, &tv);
-  dprintf((stderr, "ret: %d\n", ret));
-
-  if(ret == -1)
-  {
-    dprintf((stderr, "select: %s\n", error_string));
-  }
-  else if(ret == 0)
+  switch(type)
   {
-    fprintf(stderr, "timeout\n");
-  }
-  else
-  {
-    /* if we woke up on client_sockfd do the data passing */
-    if(FD_ISSET(client_sockfd, &readfds))
-    {
-      bread = recv(client_sockfd, buf, len-1, 0);
-      dprintf((stderr, "bread: %d\n", bread));
-      buf[bread] = '\0';
-      dprintf((stderr, "got: %s\n", buf));
-      if(bread == -1)
-      {
-        fprintf(stderr, "error recv()ing reply: %s\n", error_string);
-      }
-    }
-    else
-    {
-      dprintf((stderr, "error: case not handled."));
-    }
+    case EZ_TRACE_CONNECT:
+      transcript_connect(len);
+      break;
+    case EZ_TRACE_SEND:
+      transcript_add(TR_SEND, buf, len);
+      break;
+    case EZ_TRACE_RECV:
+      transcript_add(TR_RECV, buf, len);
+      break;
+    case EZ_TRACE_RECV_FAIL:
+      transcript_add(TR_RECV_FAIL, NULL, 0);
+      break;
   }
-
-  return(bread);
 }
 
+/*
+ * get_if_addr
+ *
+ * the IPv4 address of interface name, from the interface snapshot when
+ * there is one. sock is only needed when there isn't, -1 opens one.
+ */
 int get_if_addr(int sock, char *name, struct sockaddr_in *sin)
 {
 #ifdef IF_LOOKUP
   struct ifreq ifr;
+  int res;
 
-  memset(&ifr, 0, sizeof(ifr));
-  strcpy(ifr.ifr_name, name);
-  /* why does this need to be done twice? */
-  if(ioctl(sock, SIOCGIFADDR, &ifr) < 0) 
-  { 
-    perror("ioctl(SIOCGIFADDR)"); 
-    memset(sin, 0, sizeof(struct sockaddr_in));
-    dprintf((stderr, "%s: %s\n", name, "unknown interface"));
+  memset(sin, 0, sizeof(struct sockaddr_in));
+  sin->sin_family = AF_INET;
+  if((res=ifsnap_addr4(name, &sin->sin_addr, NULL, 0)) == 0)
+  {
+    dprintf((stderr, "%s: %s\n", name, inet_ntoa(sin->sin_addr)));
+    return 0;
+  }
+  if(res == -1)
+  {
+    dprintf((stderr, "%s: %s\n", name, "could not resolve interface"));
     return -1;
   }
-  if(ioctl(sock, SIOCGIFADDR, &ifr) < 0)
+
+  // no snapshot on this system, ask about the one interface
+  memset(&ifr, 0, sizeof(ifr));
+  snprintf(ifr.ifr_name, sizeof(ifr.ifr_name), "%s", name);
+  res = sock < 0 ? socket(AF_INET, SOCK_DGRAM, 0) : sock;
+  if(ioctl(res, SIOCGIFADDR, &ifr) < 0)
   { 
     perror("ioctl(SIOCGIFADDR)"); 
     memset(sin, 0, sizeof(struct sockaddr_in));
     dprintf((stderr, "%s: %s\n", name, "unknown interface"));
+    if(sock < 0) { close(res); }
     return -1;
   }
+  if(sock < 0) { close(res); }
 
   if(ifr.ifr_addr.sa_family == AF_INET)
   {
@@ -1643,59 +1622,6 @@ int get_if_addr(int sock, char *name, struct sockaddr_in *sin)
 #endif
 }
 
-static int PGPOW_read_response(char *buf)
-{
-  int bytes; 
-
-  bytes = read_input(buf, BUFFER_SIZE);
-  if(bytes < 1)
-  {
-    close(client_sockfd);
-    return(-1);
-  }
-  buf[bytes] = '\0';
-
-  dprintf((stderr, "server says: %s\n", buf));
-  
-  if(strncmp("OK", buf, 2) != 0)
-  {
-    return(1);
-  }
-  else
-  {
-    return(0);
-  }
-}
-
-static int ODS_read_response(char *buf, int len)
-{
-  int bytes = 0; 
-  int bread = 0;
-  char* p = buf;
-  int max_iter = 32;
-
-  for(; bytes < len && max_iter > 0; max_iter--)
-  {
-    bread = read_input(p, len-bytes);
-    bytes += bread;
-    if(bytes < 1)
-    {
-      close(client_sockfd);
-      return(-1);
-    }
-    if(strstr(buf, "\r\n") > 0)
-    {
-      break;
-    }
-
-    dprintf((stderr, "server says: %s\n", p));
-    p += bread;
-  }
-  dprintf((stderr, "server said: %s\n", buf));
-  
-  return(atoi(buf));
-}
-
 int NULL_check_info(void)
 {
   char buf[64];
@@ -1716,119 +1642,16 @@ int NULL_check_info(void)
   return(0);
 }
 
+#ifdef USE_EZIP
 int EZIP_check_info(void)
 {
   warn_fields(service->fields_used);
 
   return 0;
 }
+#endif
 
-int EZIP_update_entry(void)
-{
-  char buf[BUFFER_SIZE+1];
-  char *bp = buf;
-  int bytes;
-  int btot;
-  int ret;
-
-  buf[BUFFER_SIZE] = '\0';
-
-  if(do_connect((int*)&client_sockfd, server, port) != 0)
-  {
-    if(!(options & OPT_QUIET))
-    {
-      show_message("error connecting to %s:%s\n", server, port);
-    }
-    return(UPDATERES_ERROR);
-  }
-
-  snprintf(buf, BUFFER_SIZE, "GET %s?mode=update&", request);
-  output(buf);
-  if(address)
-  {
-    snprintf(buf, BUFFER_SIZE, "%s=%s&", "ipaddress", address);
-    output(buf);
-  }
-  snprintf(buf, BUFFER_SIZE, "%s=%s&", "wildcard", wildcard ? "yes" : "no");
-  output(buf);
-  snprintf(buf, BUFFER_SIZE, "%s=%s&", "mx", mx);
-  output(buf);
-  snprintf(buf, BUFFER_SIZE, "%s=%s&", "url", url);
-  output(buf);
-  snprintf(buf, BUFFER_SIZE, "%s=%s&", "host", host);
-  output(buf);
-  snprintf(buf, BUFFER_SIZE, " HTTP/1.0\015\012");
-  output(buf);
-  snprintf(buf, BUFFER_SIZE, "Authorization: Basic %s\015\012", auth);
-  output(buf);
-  snprintf(buf, BUFFER_SIZE, "User-Agent: %s-%s %s [%s] (%s)\015\012", 
-      "ez-update", VERSION, OS, (options & OPT_DAEMON) ? "daemon" : "", "by Angus Mackay");
-  output(buf);
-  snprintf(buf, BUFFER_SIZE, "Host: %s\015\012", server);
-  output(buf);
-  snprintf(buf, BUFFER_SIZE, "\015\012");
-  output(buf);
-
-  bp = buf;
-  bytes = 0;
-  btot = 0;
-  while((bytes=read_input(bp, BUFFER_SIZE-btot)) > 0)
-  {
-    bp += bytes;
-    btot += bytes;
-    dprintf((stderr, "btot: %d\n", btot));
-  }
-  close(client_sockfd);
-  buf[btot] = '\0';
-
-  dprintf((stderr, "server output: %s\n", buf));
-
-  if(sscanf(buf, " HTTP/1.%*c %3d", &ret) != 1)
-  {
-    ret = -1;
-  }
-
-  switch(ret)
-  {
-    case -1:
-      if(!(options & OPT_QUIET))
-      {
-        show_message("strange server response, are you connecting to the right server?\n");
-      }
-      return(UPDATERES_ERROR);
-      break;
-
-    case 200:
-      if(!(options & OPT_QUIET))
-      {
-        printf("request successful\n");
-      }
-      break;
-
-    case 401:
-      if(!(options & OPT_QUIET))
-      {
-        show_message("authentication failure\n");
-      }
-      return(UPDATERES_SHUTDOWN);
-      break;
-
-    default:
-      if(!(options & OPT_QUIET))
-      {
-        // reuse the auth buffer
-        *auth = '\0';
-        sscanf(buf, " HTTP/1.%*c %*3d %255[^\r\n]", auth);
-        show_message("unknown return code: %d\n", ret);
-        fprintf(stderr, "server response: %s\n", auth);
-      }
-      return(UPDATERES_ERROR);
-      break;
-  }
-
-  return(UPDATERES_OK);
-}
-
+#ifdef USE_DYNDNS
 void DYNDNS_init(void)
 {
 
@@ -1843,7 +1666,7 @@ void DYNDNS_init(void)
 
 int DYNDNS_check_info(void)
 {
-  char buf[BUFSIZ+1];
+  char *buf = update_buf;
 
   if((host == NULL) || (*host == '\0'))
   {
@@ -1851,11 +1674,10 @@ int DYNDNS_check_info(void)
     {
       return(-1);
     }
-    if(host) { free(host); }
     printf("host: ");
     *buf = '\0';
-    fgets(buf, BUFSIZ, stdin);
-    host = strdup(buf);
+    fgets(buf, BUFFER_SIZE, stdin);
+    arena_string(&config_arena, &host, buf);
     chomp(host);
   }
 
@@ -1865,17 +1687,16 @@ int DYNDNS_check_info(void)
     return(-1);
   }
 
-  if(interface == NULL && address == NULL)
+  if(interface == NULL && address == NULL && discover_sources() == 0)
   {
     if(options & OPT_DAEMON)
     {
       fprintf(stderr, "you must provide either an interface or an address\n");
       return(-1);
     }
-    if(interface) { free(interface); }
     printf("interface: ");
     *buf = '\0';
-    fgets(buf, BUFSIZ, stdin);
+    fgets(buf, BUFFER_SIZE, stdin);
     chomp(buf);
     option_handler(CMD_interface, buf);
   }
@@ -1884,262 +1705,50 @@ int DYNDNS_check_info(void)
 
   return 0;
 }
+#endif
 
-int DYNDNS_update_entry(void)
+#ifdef USE_PGPOW
+int PGPOW_check_info(void)
 {
-  char buf[BUFFER_SIZE+1];
-  char *bp = buf;
-  int bytes;
-  int btot;
-  int ret;
-  int retval = UPDATERES_OK;
-
-  buf[BUFFER_SIZE] = '\0';
+  char *buf = update_buf;
 
-  if(do_connect((int*)&client_sockfd, server, port) != 0)
+  if((host == NULL) || (*host == '\0'))
   {
-    if(!(options & OPT_QUIET))
+    if(options & OPT_DAEMON)
     {
-      show_message("error connecting to %s:%s\n", server, port);
+      return(-1);
     }
-    return(UPDATERES_ERROR);
-  }
-
-  snprintf(buf, BUFFER_SIZE, "GET %s?", request);
-  output(buf);
-
-  if(is_in_list("dyndns-static", service->names))
-  {
-    snprintf(buf, BUFFER_SIZE, "%s=%s&", "system", "statdns");
-    output(buf);
-  }
-  else if(is_in_list("dyndns-custom", service->names))
-  {
-    snprintf(buf, BUFFER_SIZE, "%s=%s&", "system", "custom");
-    output(buf);
-  }
-
-  snprintf(buf, BUFFER_SIZE, "%s=%s&", "hostname", host);
-  output(buf);
-  if(address != NULL)
-  {
-    snprintf(buf, BUFFER_SIZE, "%s=%s&", "myip", address);
-    output(buf);
-  }
-  snprintf(buf, BUFFER_SIZE, "%s=%s&", "wildcard", wildcard ? "ON" : "OFF");
-  output(buf);
-  if(mx != NULL && *mx != '\0')
-  {
-    snprintf(buf, BUFFER_SIZE, "%s=%s&", "mx", mx);
-    output(buf);
-  }
-  //snprintf(buf, BUFFER_SIZE, "%s=%s&", "backmx", "NO");
-  //output(buf);
-  if(options & OPT_OFFLINE)
-  {
-    snprintf(buf, BUFFER_SIZE, "%s=%s&", "offline", "yes");
-    output(buf);
-  }
-  snprintf(buf, BUFFER_SIZE, " HTTP/1.0\015\012");
-  output(buf);
-  snprintf(buf, BUFFER_SIZE, "Authorization: Basic %s\015\012", auth);
-  output(buf);
-  snprintf(buf, BUFFER_SIZE, "User-Agent: %s-%s %s [%s] (%s)\015\012", 
-      "ez-update", VERSION, OS, (options & OPT_DAEMON) ? "daemon" : "", "by Angus Mackay");
-  output(buf);
-  snprintf(buf, BUFFER_SIZE, "Host: %s\015\012", server);
-  output(buf);
-  snprintf(buf, BUFFER_SIZE, "\015\012");
-  output(buf);
-
-  bp = buf;
-  bytes = 0;
-  btot = 0;
-  while((bytes=read_input(bp, BUFFER_SIZE-btot)) > 0)
-  {
-    bp += bytes;
-    btot += bytes;
-    dprintf((stderr, "btot: %d\n", btot));
+    printf("host: ");
+    *buf = '\0';
+    fgets(buf, BUFFER_SIZE, stdin);
+    arena_string(&config_arena, &host, buf);
+    chomp(host);
   }
-  close(client_sockfd);
-  buf[btot] = '\0';
 
-  dprintf((stderr, "server output: %s\n", buf));
-
-  if(sscanf(buf, " HTTP/1.%*c %3d", &ret) != 1)
+  if(interface == NULL && address == NULL && discover_sources() == 0)
   {
-    ret = -1;
+    if(options & OPT_DAEMON)
+    {
+      fprintf(stderr, "you must provide either an interface or an address\n");
+      return(-1);
+    }
+    printf("interface: ");
+    *buf = '\0';
+    fgets(buf, BUFFER_SIZE, stdin);
+    chomp(buf);
+    option_handler(CMD_interface, buf);
   }
 
-  switch(ret)
-  {
-    case -1:
-      if(!(options & OPT_QUIET))
-      {
-        show_message("strange server response, are you connecting to the right server?\n");
-      }
-      retval = UPDATERES_ERROR;
-      break;
-
-    case 200:
-      if(strstr(buf, "\ngood ") != NULL)
-      {
-        if(!(options & OPT_QUIET))
-        {
-          printf("request successful\n");
-        }
-      }
-      else
-      {
-        if(strstr(buf, "\nnohost") != NULL)
-        {
-          show_message("invalid hostname: %s\n", host);
-          retval = UPDATERES_SHUTDOWN;
-        }
-        else if(strstr(buf, "\nnotfqdn") != NULL)
-        {
-          show_message("malformed hostname: %s\n", host);
-          retval = UPDATERES_SHUTDOWN;
-        }
-        else if(strstr(buf, "\n!yours") != NULL)
-        {
-          show_message("host \"%s\" is not under your control\n", host);
-          retval = UPDATERES_SHUTDOWN;
-        }
-        else if(strstr(buf, "\nabuse") != NULL)
-        {
-          show_message("host \"%s\" has been blocked for abuse\n", host);
-          retval = UPDATERES_SHUTDOWN;
-        }
-        else if(strstr(buf, "\nnochg") != NULL)
-        {
-          show_message("%s says that your IP address has not changed since the last update\n", server);
-          // lets say that this counts as a successful update
-          // but we'll roll back the last update time to max_interval/2
-          if(max_interval > 0)
-          {
-            last_update = time(NULL) - max_interval/2;
-          }
-          retval = UPDATERES_OK;
-        }
-        else if(strstr(buf, "\nbadauth") != NULL)
-        {
-          show_message("authentication failure\n");
-          retval = UPDATERES_SHUTDOWN;
-        }
-        else if(strstr(buf, "\nbadsys") != NULL)
-        {
-          show_message("invalid system parameter\n");
-          retval = UPDATERES_SHUTDOWN;
-        }
-        else if(strstr(buf, "\nbadagent") != NULL)
-        {
-          show_message("this useragent has been blocked\n");
-          retval = UPDATERES_SHUTDOWN;
-        }
-        else if(strstr(buf, "\nnumhost") != NULL)
-        {
-          show_message("Too many or too few hosts found\n");
-          retval = UPDATERES_SHUTDOWN;
-        }
-        else if(strstr(buf, "\ndnserr") != NULL)
-        {
-          char *p = strstr(buf, "\ndnserr");
-          show_message("dyndns internal error, please report this number to "
-              "their support people: %s\n", N_STR(p));
-          retval = UPDATERES_ERROR;
-        }
-        else if(strstr(buf, "\n911") != NULL)
-        {
-          show_message("Ahhhh! call 911!\n");
-          retval = UPDATERES_SHUTDOWN;
-        }
-        else if(strstr(buf, "\n999") != NULL)
-        {
-          show_message("Ahhhh! call 999!\n");
-          retval = UPDATERES_SHUTDOWN;
-        }
-        else if(strstr(buf, "\n!donator") != NULL)
-        {
-          show_message("a feature requested is only available to donators, please donate.\n", host);
-          retval = UPDATERES_OK;
-        }
-        // this one should be last as it is a stupid string to signify waits
-        // with as it is so short
-        else if(strstr(buf, "\nw") != NULL)
-        {
-          int howlong = 0;
-          char *p = strstr(buf, "\nw");
-          char reason[256];
-          char mult;
-
-          // get time and reason
-          if(strlen(p) >= 2)
-          {
-            sscanf(p, "%d%c %255[^\r\n]", &howlong, &mult, reason);
-            if(mult == 'h')
-            {
-              howlong *= 3600;
-            }
-            else if(mult == 'm')
-            {
-              howlong *= 60;
-            }
-            if(howlong > MAX_WAITRESPONSE_WAIT)
-            {
-              howlong = MAX_WAITRESPONSE_WAIT;
-            };
-          }
-          else
-          {
-            sprintf(reason, "problem parsing reason for wait response");
-          }
-
-          show_message("Wait response received, waiting for %s before next update.\n",
-              format_time(howlong));
-          show_message("Wait response reason: %d\n", N_STR(reason));
-          sleep(howlong);
-          retval = UPDATERES_ERROR;
-        }
-        else
-        {
-          show_message("error processing request\n");
-          if(!(options & OPT_QUIET))
-          {
-            fprintf(stderr, "==== server output: ====\n%s\n", buf);
-          }
-          retval = UPDATERES_ERROR;
-        }
-      }
-      break;
-
-    case 401:
-      if(!(options & OPT_QUIET))
-      {
-        show_message("authentication failure\n");
-      }
-      retval = UPDATERES_SHUTDOWN;
-      break;
-
-    default:
-      if(!(options & OPT_QUIET))
-      {
-        // reuse the auth buffer
-        *auth = '\0';
-        sscanf(buf, " HTTP/1.%*c %*3d %255[^\r\n]", auth);
-        show_message("unknown return code: %d\n", ret);
-        fprintf(stderr, "server response: %s\n", auth);
-      }
-      retval = UPDATERES_ERROR;
-      break;
-  }
+  warn_fields(service->fields_used);
 
-  return(retval);
+  return 0;
 }
+#endif
 
-int PGPOW_check_info(void)
+#ifdef USE_DHS
+int DHS_check_info(void)
 {
-  char buf[BUFSIZ+1];
+  char *buf = update_buf;
 
   if((host == NULL) || (*host == '\0'))
   {
@@ -2147,25 +1756,22 @@ int PGPOW_check_info(void)
     {
       return(-1);
     }
-    if(host) { free(host); }
     printf("host: ");
-    *buf = '\0';
-    fgets(buf, BUFSIZ, stdin);
-    host = strdup(buf);
+    fgets(buf, BUFFER_SIZE, stdin);
+    arena_string(&config_arena, &host, buf);
     chomp(host);
   }
 
-  if(interface == NULL && address == NULL)
+  if(interface == NULL && address == NULL && discover_sources() == 0)
   {
     if(options & OPT_DAEMON)
     {
       fprintf(stderr, "you must provide either an interface or an address\n");
       return(-1);
     }
-    if(interface) { free(interface); }
     printf("interface: ");
     *buf = '\0';
-    fgets(buf, BUFSIZ, stdin);
+    fgets(buf, BUFFER_SIZE, stdin);
     chomp(buf);
     option_handler(CMD_interface, buf);
   }
@@ -2174,172 +1780,84 @@ int PGPOW_check_info(void)
 
   return 0;
 }
+#endif
 
-int PGPOW_update_entry(void)
+#ifdef USE_ODS
+int ODS_check_info(void)
 {
-  char buf[BUFFER_SIZE+1];
+  char *buf = update_buf;
 
-  buf[BUFFER_SIZE] = '\0';
-
-  if(do_connect((int*)&client_sockfd, server, port) != 0)
+  if((host == NULL) || (*host == '\0'))
   {
-    if(!(options & OPT_QUIET))
+    if(options & OPT_DAEMON)
     {
-      show_message("error connecting to %s:%s\n", server, port);
+      return(-1);
     }
-    return(UPDATERES_ERROR);
+    printf("host: ");
+    *buf = '\0';
+    fgets(buf, BUFFER_SIZE, stdin);
+    arena_string(&config_arena, &host, buf);
+    chomp(host);
   }
 
-  /* read server message */
-  if(PGPOW_read_response(buf) != 0)
+  if(interface == NULL && address == NULL && discover_sources() == 0)
   {
-    show_message("strange server response, are you connecting to the right server?\n");
-    close(client_sockfd);
-    return(UPDATERES_ERROR);
+    if(options & OPT_DAEMON)
+    {
+      fprintf(stderr, "you must provide either an interface or an address\n");
+      return(-1);
+    }
+    arena_string(&config_arena, &address, "");
   }
 
-  /* send version command */
-  snprintf(buf, BUFFER_SIZE, "VER %s [%s-%s %s (%s)]\015\012", PGPOW_VERSION,
-      "ez-update", VERSION, OS, "by Angus Mackay");
-  output(buf);
+  warn_fields(service->fields_used);
+
+  return 0;
+}
+#endif
+
+#ifdef USE_TZO
+int TZO_check_info(void)
+{
+  char *buf = update_buf;
 
-  if(PGPOW_read_response(buf) != 0)
+  if((host == NULL) || (*host == '\0'))
   {
-    if(strncmp("ERR", buf, 3) == 0)
-    {
-      show_message("error talking to server: %s\n", &(buf[3]));
-    }
-    else
+    if(options & OPT_DAEMON)
     {
-      show_message("error talking to server:\n\t%s\n", buf);
+      return(-1);
     }
-    close(client_sockfd);
-    return(UPDATERES_ERROR);
+    printf("host: ");
+    *buf = '\0';
+    fgets(buf, BUFFER_SIZE, stdin);
+    arena_string(&config_arena, &host, buf);
+    chomp(host);
   }
 
-  /* send user command */
-  snprintf(buf, BUFFER_SIZE, "USER %s\015\012", user_name);
-  output(buf);
-
-  if(PGPOW_read_response(buf) != 0)
+  if(interface == NULL && address == NULL && discover_sources() == 0)
   {
-    if(strncmp("ERR", buf, 3) == 0)
+    if(options & OPT_DAEMON)
     {
-      show_message("error talking to server: %s\n", &(buf[3]));
+      fprintf(stderr, "you must provide either an interface or an address\n");
+      return(-1);
     }
-    else
-    {
-      show_message("error talking to server:\n\t%s\n", buf);
-    }
-    close(client_sockfd);
-    return(UPDATERES_ERROR);
-  }
-
-  /* send pass command */
-  snprintf(buf, BUFFER_SIZE, "PASS %s\015\012", password);
-  output(buf);
-
-  if(PGPOW_read_response(buf) != 0)
-  {
-    if(strncmp("ERR", buf, 3) == 0)
-    {
-      show_message("error talking to server: %s\n", &(buf[3]));
-    }
-    else
-    {
-      show_message("error talking to server:\n\t%s\n", buf);
-    }
-    close(client_sockfd);
-    return(UPDATERES_ERROR);
-  }
-
-  /* send host command */
-  snprintf(buf, BUFFER_SIZE, "HOST %s\015\012", host);
-  output(buf);
-
-  if(PGPOW_read_response(buf) != 0)
-  {
-    if(strncmp("ERR", buf, 3) == 0)
-    {
-      show_message("error talking to server: %s\n", &(buf[3]));
-    }
-    else
-    {
-      show_message("error talking to server:\n\t%s\n", buf);
-    }
-    close(client_sockfd);
-    return(UPDATERES_ERROR);
-  }
-
-  /* send oper command */
-  snprintf(buf, BUFFER_SIZE, "OPER %s\015\012", request);
-  output(buf);
-
-  if(PGPOW_read_response(buf) != 0)
-  {
-    if(strncmp("ERR", buf, 3) == 0)
-    {
-      show_message("error talking to server: %s\n", &(buf[3]));
-    }
-    else
-    {
-      show_message("error talking to server:\n\t%s\n", buf);
-    }
-    close(client_sockfd);
-    return(UPDATERES_ERROR);
-  }
-
-  if(strcmp("update", request) == 0)
-  {
-    /* send ip command */
-    snprintf(buf, BUFFER_SIZE, "IP %s\015\012", address);
-    output(buf);
-
-    if(PGPOW_read_response(buf) != 0)
-    {
-      if(strncmp("ERR", buf, 3) == 0)
-      {
-        show_message("error talking to server: %s\n", &(buf[3]));
-      }
-      else
-      {
-        show_message("error talking to server:\n\t%s\n", buf);
-      }
-      close(client_sockfd);
-      return(UPDATERES_ERROR);
-    }
-  }
-
-  /* send done command */
-  snprintf(buf, BUFFER_SIZE, "DONE\015\012");
-  output(buf);
-
-  if(PGPOW_read_response(buf) != 0)
-  {
-    if(strncmp("ERR", buf, 3) == 0)
-    {
-      show_message("error talking to server: %s\n", &(buf[3]));
-    }
-    else
-    {
-      show_message("error talking to server:\n\t%s\n", buf);
-    }
-    close(client_sockfd);
-    return(UPDATERES_ERROR);
+    printf("interface: ");
+    *buf = '\0';
+    fgets(buf, BUFFER_SIZE, stdin);
+    chomp(buf);
+    option_handler(CMD_interface, buf);
   }
 
-  if(!(options & OPT_QUIET))
-  {
-    printf("request successful\n");
-  }
+  warn_fields(service->fields_used);
 
-  close(client_sockfd);
-  return(UPDATERES_OK);
+  return 0;
 }
+#endif
 
-int DHS_check_info(void)
+#ifdef USE_EASYDNS
+int EASYDNS_check_info(void)
 {
-  char buf[BUFSIZ+1];
+  char *buf = update_buf;
 
   if((host == NULL) || (*host == '\0'))
   {
@@ -2347,24 +1865,23 @@ int DHS_check_info(void)
     {
       return(-1);
     }
-    if(host) { free(host); }
     printf("host: ");
-    fgets(buf, BUFSIZ, stdin);
-    host = strdup(buf);
+    *buf = '\0';
+    fgets(buf, BUFFER_SIZE, stdin);
+    arena_string(&config_arena, &host, buf);
     chomp(host);
   }
 
-  if(interface == NULL && address == NULL)
+  if(interface == NULL && address == NULL && discover_sources() == 0)
   {
     if(options & OPT_DAEMON)
     {
       fprintf(stderr, "you must provide either an interface or an address\n");
       return(-1);
     }
-    if(interface) { free(interface); }
     printf("interface: ");
     *buf = '\0';
-    fgets(buf, BUFSIZ, stdin);
+    fgets(buf, BUFFER_SIZE, stdin);
     chomp(buf);
     option_handler(CMD_interface, buf);
   }
@@ -2373,476 +1890,170 @@ int DHS_check_info(void)
 
   return 0;
 }
+#endif
 
-/*
- * grrrrr, it seems that dhs.org requires us to use POST
- * also DHS doesn't update both the mx record and the address at the same
- * time, this service really stinks. go with justlinix.com (penguinpowered)
- * instead, the only advantage is short host names.
- */
-int DHS_update_entry(void)
+#ifdef USE_EASYDNS_PARTNER
+int EASYDNS_PARTNER_check_info(void)
 {
-  char buf[BUFFER_SIZE+1];
-  char putbuf[BUFFER_SIZE+1];
-  char *bp = buf;
-  int bytes;
-  int btot;
-  int ret;
-  char *domain = NULL;
-  char *hostname = NULL;
-  char *p;
-  int limit;
-  int retval = UPDATERES_OK;
+  char *buf = update_buf;
 
-  buf[BUFFER_SIZE] = '\0';
-  putbuf[BUFFER_SIZE] = '\0';
-
-  /* parse apart the domain and hostname */
-  hostname = strdup(host);
-  if((p=strchr(hostname, '.')) == NULL)
+  if((host == NULL) || (*host == '\0'))
   {
-    if(!(options & OPT_QUIET))
+    if(options & OPT_DAEMON)
     {
-      show_message("error parsing hostname from host %s\n", host);
+      return(-1);
     }
-    return(UPDATERES_ERROR);
+    printf("host: ");
+    *buf = '\0';
+    fgets(buf, BUFFER_SIZE, stdin);
+    arena_string(&config_arena, &host, buf);
+    chomp(host);
   }
-  *p = '\0';
-  p++;
-  if(*p == '\0')
+
+  if((partner == NULL) || (*partner == '\0'))
   {
-    if(!(options & OPT_QUIET))
+    if(options & OPT_DAEMON)
     {
-      show_message("error parsing domain from host %s\n", host);
+      return(-1);
     }
-    return(UPDATERES_ERROR);
+    printf("easyDNS partner: ");
+    *buf = '\0';
+    fgets(buf, BUFFER_SIZE, stdin);
+    arena_string(&config_arena, &partner, buf);
+    chomp(partner);
   }
-  domain = strdup(p);
 
-  dprintf((stderr, "hostname: %s, domain: %s\n", hostname, domain));
-
-  if(do_connect((int*)&client_sockfd, server, port) != 0)
+  if(interface == NULL && address == NULL && discover_sources() == 0)
   {
-    if(!(options & OPT_QUIET))
+    if(options & OPT_DAEMON)
     {
-      show_message("error connecting to %s:%s\n", server, port);
+      fprintf(stderr, "you must provide either an interface or an address\n");
+      return(-1);
     }
-    return(UPDATERES_ERROR);
-  }
-
-  snprintf(buf, BUFFER_SIZE, "POST %s HTTP/1.0\015\012", request);
-  output(buf);
-  snprintf(buf, BUFFER_SIZE, "Authorization: Basic %s\015\012", auth);
-  output(buf);
-  snprintf(buf, BUFFER_SIZE, "User-Agent: %s-%s %s [%s] (%s)\015\012", 
-      "ez-update", VERSION, OS, (options & OPT_DAEMON) ? "daemon" : "", "by Angus Mackay");
-  output(buf);
-  snprintf(buf, BUFFER_SIZE, "Host: %s\015\012", server);
-  output(buf);
-
-  p = putbuf;
-  *p = '\0';
-  limit = BUFFER_SIZE - 1 - strlen(buf);
-  snprintf(p, limit, "hostscmd=edit&hostscmdstage=2&type=4&");
-  p += strlen(p);
-  limit = BUFFER_SIZE - 1 - strlen(buf);
-  snprintf(p, limit, "%s=%s&", "updatetype", "Online");
-  p += strlen(p);
-  limit = BUFFER_SIZE - 1 - strlen(buf);
-  snprintf(p, limit, "%s=%s&", "ip", address);
-  p += strlen(p);
-  limit = BUFFER_SIZE - 1 - strlen(buf);
-  snprintf(p, limit, "%s=%s&", "mx", mx);
-  p += strlen(p);
-  limit = BUFFER_SIZE - 1 - strlen(buf);
-  snprintf(p, limit, "%s=%s&", "offline_url", url);
-  p += strlen(p);
-  limit = BUFFER_SIZE - 1 - strlen(buf);
-  if(cloak_title)
-  {
-    snprintf(p, limit, "%s=%s&", "cloak", "Y");
-    p += strlen(p);
-    limit = BUFFER_SIZE - 1 - strlen(buf);
-    snprintf(p, limit, "%s=%s&", "cloak_title", cloak_title);
-    p += strlen(p);
-    limit = BUFFER_SIZE - 1 - strlen(buf);
-  }
-  else
-  {
-    snprintf(p, limit, "%s=%s&", "cloak_title", "");
-    p += strlen(p);
-    limit = BUFFER_SIZE - 1 - strlen(buf);
-  }
-  snprintf(p, limit, "%s=%s&", "submit", "Update");
-  p += strlen(p);
-  limit = BUFFER_SIZE - 1 - strlen(buf);
-  snprintf(p, limit, "%s=%s&", "domain", domain);
-  p += strlen(p);
-  limit = BUFFER_SIZE - 1 - strlen(buf);
-  snprintf(p, limit, "%s=%s", "hostname", hostname);
-  p += strlen(p);
-  limit = BUFFER_SIZE - 1 - strlen(buf);
-
-  snprintf(buf, BUFFER_SIZE, "Content-length: %d\015\012", strlen(putbuf));
-  output(buf);
-  snprintf(buf, BUFFER_SIZE, "\015\012");
-  output(buf);
-
-  output(putbuf);
-  snprintf(buf, BUFFER_SIZE, "\015\012");
-  output(buf);
-
-  bp = buf;
-  bytes = 0;
-  btot = 0;
-  while((bytes=read_input(bp, BUFFER_SIZE-btot)) > 0)
-  {
-    bp += bytes;
-    btot += bytes;
-    dprintf((stderr, "btot: %d\n", btot));
-  }
-  close(client_sockfd);
-  buf[btot] = '\0';
-
-  dprintf((stderr, "server output: %s\n", buf));
-
-  if(sscanf(buf, " HTTP/1.%*c %3d", &ret) != 1)
-  {
-    ret = -1;
+    printf("interface: ");
+    *buf = '\0';
+    fgets(buf, BUFFER_SIZE, stdin);
+    chomp(buf);
+    option_handler(CMD_interface, buf);
   }
 
-  switch(ret)
-  {
-    case -1:
-      if(!(options & OPT_QUIET))
-      {
-        show_message("strange server response, are you connecting to the right server?\n");
-      }
-      retval = UPDATERES_ERROR;
-      break;
-
-    case 200:
-      if(!(options & OPT_QUIET))
-      {
-        printf("request successful\n");
-      }
-      break;
+  warn_fields(service->fields_used);
 
-    case 401:
-      if(!(options & OPT_QUIET))
-      {
-        show_message("authentication failure\n");
-      }
-      retval = UPDATERES_SHUTDOWN;
-      break;
+  return 0;
+}
+#endif
 
-    default:
-      if(!(options & OPT_QUIET))
-      {
-        // reuse the auth buffer
-        *auth = '\0';
-        sscanf(buf, " HTTP/1.%*c %*3d %255[^\r\n]", auth);
-        show_message("unknown return code: %d\n", ret);
-        show_message("server response: %s\n", auth);
-      }
-      retval = UPDATERES_ERROR;
-      break;
-  }
+#if defined(USE_MD5) && defined(USE_GNUDIP)
+int GNUDIP_check_info(void)
+{
+  char *buf = update_buf;
 
-  // this stupid service requires us to do seperate request if we want to 
-  // update the mail exchanger (mx). grrrrrr
-  if(*mx != '\0')
+  if((server == NULL) || (*server == '\0'))
   {
-    // okay, dhs's service is incredibly stupid and will not work with two
-    // requests right after each other. I could care less that this is ugly,
-    // I personally will NEVER use dhs, it is laughable.
-    sleep(DHS_SUCKY_TIMEOUT < timeout.tv_sec ? DHS_SUCKY_TIMEOUT : timeout.tv_sec);
-
-    if(do_connect((int*)&client_sockfd, server, port) != 0)
-    {
-      if(!(options & OPT_QUIET))
-      {
-        show_message("error connecting to %s:%s\n", server, port);
-      }
-      return(UPDATERES_ERROR);
-    }
-
-    snprintf(buf, BUFFER_SIZE, "POST %s HTTP/1.0\015\012", request);
-    output(buf);
-    snprintf(buf, BUFFER_SIZE, "Authorization: Basic %s\015\012", auth);
-    output(buf);
-    snprintf(buf, BUFFER_SIZE, "User-Agent: %s-%s %s [%s] (%s)\015\012", 
-        "ez-update", VERSION, OS, (options & OPT_DAEMON) ? "daemon" : "", "by Angus Mackay");
-    output(buf);
-    snprintf(buf, BUFFER_SIZE, "Host: %s\015\012", server);
-    output(buf);
-
-    p = putbuf;
-    *p = '\0';
-    limit = BUFFER_SIZE - 1 - strlen(buf);
-    snprintf(p, limit, "hostscmd=edit&hostscmdstage=2&type=4&");
-    p += strlen(p);
-    limit = BUFFER_SIZE - 1 - strlen(buf);
-    snprintf(p, limit, "%s=%s&", "updatetype", "Update+Mail+Exchanger");
-    p += strlen(p);
-    limit = BUFFER_SIZE - 1 - strlen(buf);
-    snprintf(p, limit, "%s=%s&", "ip", address);
-    p += strlen(p);
-    limit = BUFFER_SIZE - 1 - strlen(buf);
-    snprintf(p, limit, "%s=%s&", "mx", mx);
-    p += strlen(p);
-    limit = BUFFER_SIZE - 1 - strlen(buf);
-    snprintf(p, limit, "%s=%s&", "offline_url", url);
-    p += strlen(p);
-    limit = BUFFER_SIZE - 1 - strlen(buf);
-    if(cloak_title)
-    {
-      snprintf(p, limit, "%s=%s&", "cloak", "Y");
-      p += strlen(p);
-      limit = BUFFER_SIZE - 1 - strlen(buf);
-      snprintf(p, limit, "%s=%s&", "cloak_title", cloak_title);
-      p += strlen(p);
-      limit = BUFFER_SIZE - 1 - strlen(buf);
-    }
-    else
-    {
-      snprintf(p, limit, "%s=%s&", "cloak_title", "");
-      p += strlen(p);
-      limit = BUFFER_SIZE - 1 - strlen(buf);
-    }
-    snprintf(p, limit, "%s=%s&", "submit", "Update");
-    p += strlen(p);
-    limit = BUFFER_SIZE - 1 - strlen(buf);
-    snprintf(p, limit, "%s=%s&", "domain", domain);
-    p += strlen(p);
-    limit = BUFFER_SIZE - 1 - strlen(buf);
-    snprintf(p, limit, "%s=%s", "hostname", hostname);
-    p += strlen(p);
-    limit = BUFFER_SIZE - 1 - strlen(buf);
-
-    snprintf(buf, BUFFER_SIZE, "Content-length: %d\015\012", strlen(putbuf));
-    output(buf);
-    snprintf(buf, BUFFER_SIZE, "\015\012");
-    output(buf);
-
-    output(putbuf);
-    snprintf(buf, BUFFER_SIZE, "\015\012");
-    output(buf);
-
-    bp = buf;
-    bytes = 0;
-    btot = 0;
-    while((bytes=read_input(bp, BUFFER_SIZE-btot)) > 0)
-    {
-      bp += bytes;
-      btot += bytes;
-      dprintf((stderr, "btot: %d\n", btot));
-    }
-    close(client_sockfd);
-    buf[btot] = '\0';
-
-    dprintf((stderr, "server output: %s\n", buf));
-
-    if(sscanf(buf, " HTTP/1.%*c %3d", &ret) != 1)
-    {
-      ret = -1;
-    }
-
-    switch(ret)
+    if(options & OPT_DAEMON)
     {
-      case -1:
-        if(!(options & OPT_QUIET))
-        {
-          show_message("strange server response, are you connecting to the right server?\n");
-        }
-        retval = UPDATERES_ERROR;
-        break;
-
-      case 200:
-        if(!(options & OPT_QUIET))
-        {
-          printf("request successful\n");
-        }
-        break;
-
-      case 401:
-        if(!(options & OPT_QUIET))
-        {
-          show_message("authentication failure\n");
-        }
-        retval = UPDATERES_SHUTDOWN;
-        break;
-
-      default:
-        if(!(options & OPT_QUIET))
-        {
-          // reuse the auth buffer
-          *auth = '\0';
-          sscanf(buf, " HTTP/1.%*c %*3d %255[^\r\n]", auth);
-          show_message("unknown return code: %d\n", ret);
-          show_message("server response: %s\n", auth);
-        }
-        retval = UPDATERES_ERROR;
-        break;
+      return(-1);
     }
+    printf("server: ");
+    *buf = '\0';
+    fgets(buf, BUFFER_SIZE, stdin);
+    arena_string(&config_arena, &server, buf);
+    chomp(server);
   }
 
-  return(retval);
-}
-
-int ODS_check_info(void)
-{
-  char buf[BUFSIZ+1];
-
   if((host == NULL) || (*host == '\0'))
   {
     if(options & OPT_DAEMON)
     {
       return(-1);
     }
-    if(host) { free(host); }
     printf("host: ");
     *buf = '\0';
-    fgets(buf, BUFSIZ, stdin);
-    host = strdup(buf);
+    fgets(buf, BUFFER_SIZE, stdin);
+    arena_string(&config_arena, &host, buf);
     chomp(host);
   }
 
-  if(interface == NULL && address == NULL)
+  if((address) && (strcmp(address, "0.0.0.0") != 0))
   {
-    if(options & OPT_DAEMON)
+    if(!(options & OPT_QUIET))
     {
-      fprintf(stderr, "you must provide either an interface or an address\n");
-      return(-1);
+      fprintf(stderr, "warning: for GNUDIP the \"address\" parpameter is only used if set to \"0.0.0.0\" thus making an offline request.\n");
     }
-    if(address) { free(address); }
-    address = strdup("");
   }
 
   warn_fields(service->fields_used);
 
   return 0;
 }
+#endif
 
-int ODS_update_entry(void)
+#ifdef USE_JUSTL
+int JUSTL_check_info(void)
 {
-  char buf[BUFFER_SIZE+1];
-  int response;
-
-  buf[BUFFER_SIZE] = '\0';
-
-  if(do_connect((int*)&client_sockfd, server, port) != 0)
-  {
-    if(!(options & OPT_QUIET))
-    {
-      show_message("error connecting to %s:%s\n", server, port);
-    }
-    return(UPDATERES_ERROR);
-  }
-
-  /* read server message */
-  if(ODS_read_response(buf, sizeof(buf)) != 100)
-  {
-    show_message("strange server response, are you connecting to the right server?\n");
-    close(client_sockfd);
-    return(UPDATERES_ERROR);
-  }
-
-  /* send login command */
-  snprintf(buf, BUFFER_SIZE, "LOGIN %s %s\012", user_name, password);
-  output(buf);
+  char *buf = update_buf;
 
-  response = ODS_read_response(buf, sizeof(buf));
-  if(!(response == 225 || response == 226))
-  {
-    if(strlen(buf) > 4)
-    {
-      show_message("error talking to server: %s\n", &(buf[4]));
-    }
-    else
-    {
-      show_message("error talking to server\n");
-    }
-    close(client_sockfd);
-    return(UPDATERES_ERROR);
-  }
-
-  /* send delete command */
-  snprintf(buf, BUFFER_SIZE, "DELRR %s A\012", host);
-  output(buf);
-
-  if(ODS_read_response(buf, sizeof(buf)) != 901)
+  if(host == NULL)
   {
-    if(strlen(buf) > 4)
-    {
-      show_message("error talking to server: %s\n", &(buf[4]));
-    }
-    else
+    if(options & OPT_DAEMON)
     {
-      show_message("error talking to server\n");
+      return(-1);
     }
-    close(client_sockfd);
-    return(UPDATERES_ERROR);
+    printf("host: ");
+    *buf = '\0';
+    fgets(buf, BUFFER_SIZE, stdin);
+    chomp(buf);
+    arena_string(&config_arena, &host, buf);
   }
 
-  /* send address command */
-  snprintf(buf, BUFFER_SIZE, "ADDRR %s A %s\012", host, 
-                *address == '\0' ? "CONNIP" :  address);
-  output(buf);
-
-  response = ODS_read_response(buf, sizeof(buf));
-  if(!(response == 795 || response == 796))
+  if(interface == NULL && address == NULL && discover_sources() == 0)
   {
-    if(strlen(buf) > 4)
-    {
-      show_message("error talking to server: %s\n", &(buf[4]));
-    }
-    else
+    if(options & OPT_DAEMON)
     {
-      show_message("error talking to server\n");
+      fprintf(stderr, "you must provide either an interface or an address\n");
+      return(-1);
     }
-    close(client_sockfd);
-    return(UPDATERES_ERROR);
+    printf("interface: ");
+    *buf = '\0';
+    fgets(buf, BUFFER_SIZE, stdin);
+    chomp(buf);
+    option_handler(CMD_interface, buf);
   }
 
-  if(!(options & OPT_QUIET))
-  {
-    printf("request successful\n");
-  }
+  warn_fields(service->fields_used);
 
-  close(client_sockfd);
-  return(UPDATERES_OK);
+  return 0;
 }
+#endif
 
-int TZO_check_info(void)
+#ifdef USE_DYNS
+int DYNS_check_info(void)
 {
-  char buf[BUFSIZ+1];
+  char *buf = update_buf;
 
-  if((host == NULL) || (*host == '\0'))
+  if(host == NULL)
   {
     if(options & OPT_DAEMON)
     {
       return(-1);
     }
-    if(host) { free(host); }
     printf("host: ");
     *buf = '\0';
-    fgets(buf, BUFSIZ, stdin);
-    host = strdup(buf);
-    chomp(host);
+    fgets(buf, BUFFER_SIZE, stdin);
+    chomp(buf);
+    arena_string(&config_arena, &host, buf);
   }
 
-  if(interface == NULL && address == NULL)
+  if(interface == NULL && address == NULL && discover_sources() == 0)
   {
     if(options & OPT_DAEMON)
     {
       fprintf(stderr, "you must provide either an interface or an address\n");
       return(-1);
     }
-    if(interface) { free(interface); }
     printf("interface: ");
     *buf = '\0';
-    fgets(buf, BUFSIZ, stdin);
+    fgets(buf, BUFFER_SIZE, stdin);
     chomp(buf);
     option_handler(CMD_interface, buf);
   }
@@ -2851,1494 +2062,667 @@ int TZO_check_info(void)
 
   return 0;
 }
+#endif
 
-int TZO_update_entry(void)
+#ifdef USE_HN
+int HN_check_info(void)
 {
-  char buf[BUFFER_SIZE+1];
-  char *bp = buf;
-  int bytes;
-  int btot;
-  int ret;
+  warn_fields(service->fields_used);
+
+  return 0;
+}
+#endif
 
-  buf[BUFFER_SIZE] = '\0';
+#ifdef USE_ZONEEDIT
+int ZONEEDIT_check_info(void)
+{
+  char *buf = update_buf;
 
-  if(do_connect((int*)&client_sockfd, server, port) != 0)
+  if((host == NULL) || (*host == '\0'))
   {
-    if(!(options & OPT_QUIET))
+    if(options & OPT_DAEMON)
     {
-      show_message("error connecting to %s:%s\n", server, port);
+      return(-1);
     }
-    return(UPDATERES_ERROR);
+    printf("host: ");
+    *buf = '\0';
+    fgets(buf, BUFFER_SIZE, stdin);
+    arena_string(&config_arena, &host, buf);
+    chomp(host);
   }
 
-  snprintf(buf, BUFFER_SIZE, "GET %s?", request);
-  output(buf);
-  snprintf(buf, BUFFER_SIZE, "%s=%s&", "TZOName", host);
-  output(buf);
-  snprintf(buf, BUFFER_SIZE, "%s=%s&", "Email", user_name);
-  output(buf);
-  snprintf(buf, BUFFER_SIZE, "%s=%s&", "TZOKey", password);
-  output(buf);
-  snprintf(buf, BUFFER_SIZE, "%s=%s&", "IPAddress", address);
-  output(buf);
-  snprintf(buf, BUFFER_SIZE, " HTTP/1.0\015\012");
-  output(buf);
-  snprintf(buf, BUFFER_SIZE, "User-Agent: %s-%s %s [%s] (%s)\015\012", 
-      "ez-update", VERSION, OS, (options & OPT_DAEMON) ? "daemon" : "", "by Angus Mackay");
-  output(buf);
-  snprintf(buf, BUFFER_SIZE, "Host: %s\015\012", server);
-  output(buf);
-  snprintf(buf, BUFFER_SIZE, "\015\012");
-  output(buf);
-
-  bp = buf;
-  bytes = 0;
-  btot = 0;
-  while((bytes=read_input(bp, BUFFER_SIZE-btot)) > 0)
-  {
-    bp += bytes;
-    btot += bytes;
-    dprintf((stderr, "btot: %d\n", btot));
-  }
-  close(client_sockfd);
-  buf[btot] = '\0';
+  warn_fields(service->fields_used);
 
-  dprintf((stderr, "server output: %s\n", buf));
+  return 0;
+}
+#endif
 
-  if(sscanf(buf, " HTTP/1.%*c %3d", &ret) != 1)
-  {
-    ret = -1;
-  }
+/* the setup a plugin's service has, if it has any */
+void PLUGIN_init(void)
+{
+  struct ez_plugin_service *ps = plugin_service(service);
 
-  switch(ret)
+  if(ps != NULL && ps->init != NULL)
   {
-    case -1:
-      if(!(options & OPT_QUIET))
-      {
-        show_message("strange server response, are you connecting to the right server?\n");
-      }
-      return(UPDATERES_ERROR);
-      break;
-
-    case 200:
-      if(!(options & OPT_QUIET))
-      {
-        printf("request successful\n");
-      }
-      break;
-
-    case 302:
-      // There is no neat way to determine the exact error other than to
-      // parse the Location part of the mime header to find where we're
-      // being redirected.
-      if(!(options & OPT_QUIET))
-      {
-        // reuse the auth buffer
-        *auth = '\0';
-        bp = strstr(buf, "Location: ");
-        if((bp < strstr(buf, "\r\n\r\n")) && (sscanf(bp, "Location: http://%*[^/]%255[^\r\n]", auth) == 1))
-        {
-          bp = strrchr(auth, '/') + 1;
-        }
-        else
-        {
-          bp = "";
-        }
-        dprintf((stderr, "location: %s\n", bp));
-
-        if(!(strncmp(bp, "domainmismatch.htm", strlen(bp)) && strncmp(bp, "invname.htm", strlen(bp))))
-        {
-          show_message("invalid host name\n");
-        }
-        else if(!strncmp(bp, "invkey.htm", strlen(bp)))
-        {
-          show_message("invalid password(tzo key)\n");
-        }
-        else if(!(strncmp(bp, "emailmismatch.htm", strlen(bp)) && strncmp(bp, "invemail.htm", strlen(bp))))
-        {
-          show_message("invalid user name(email address)\n");
-        }
-        else
-        {
-          show_message("unknown error\n");
-        }
-      }
-      return(UPDATERES_ERROR);
-      break;
-
-    default:
-      if(!(options & OPT_QUIET))
-      {
-        // reuse the auth buffer
-        *auth = '\0';
-        sscanf(buf, " HTTP/1.%*c %*3d %255[^\r\n]", auth);
-        show_message("unknown return code: %d\n", ret);
-        show_message("server response: %s\n", auth);
-      }
-      return(UPDATERES_ERROR);
-      break;
+    session_from_options();
+    ps->init(&session);
+    options_from_session();
   }
-
-  return(UPDATERES_OK);
 }
 
-int EASYDNS_check_info(void)
+/*
+ * the checks a plugin's service has, or the checks any service can have
+ * for the ones that don't
+ */
+int PLUGIN_check_info(void)
 {
-  char buf[BUFSIZ+1];
+  struct ez_plugin_service *ps = plugin_service(service);
+  char *buf = update_buf;
+  int ret;
 
-  if((host == NULL) || (*host == '\0'))
+  if(ps != NULL && ps->check_info != NULL)
+  {
+    session_from_options();
+    ret = ps->check_info(&session);
+    options_from_session();
+    if(ret != 0)
+    {
+      return(-1);
+    }
+    warn_fields(service->fields_used);
+    return 0;
+  }
+
+  if(is_in_list("host", service->fields_used) &&
+      (host == NULL || *host == '\0'))
   {
     if(options & OPT_DAEMON)
     {
+      fprintf(stderr, "you must provide a host\n");
       return(-1);
     }
-    if(host) { free(host); }
     printf("host: ");
     *buf = '\0';
-    fgets(buf, BUFSIZ, stdin);
-    host = strdup(buf);
+    fgets(buf, BUFFER_SIZE, stdin);
+    arena_string(&config_arena, &host, buf);
     chomp(host);
   }
+  warn_fields(service->fields_used);
+
+  return 0;
+}
+
+#ifdef USE_HEIPV6TB
+int HEIPV6TB_check_info(void)
+{
+  char *buf = update_buf;
 
-  if(interface == NULL && address == NULL)
+  if(interface == NULL)
   {
     if(options & OPT_DAEMON)
     {
       fprintf(stderr, "you must provide either an interface or an address\n");
       return(-1);
     }
-    if(interface) { free(interface); }
     printf("interface: ");
     *buf = '\0';
-    fgets(buf, BUFSIZ, stdin);
+    fgets(buf, BUFFER_SIZE, stdin);
     chomp(buf);
     option_handler(CMD_interface, buf);
   }
-
   warn_fields(service->fields_used);
 
   return 0;
 }
+#endif
 
-int EASYDNS_update_entry(void)
+static int is_in_list(char *needle, char **haystack)
 {
-  char buf[BUFFER_SIZE+1];
-  char *bp = buf;
-  int bytes;
-  int btot;
-  int ret;
-
-  buf[BUFFER_SIZE] = '\0';
+  char **p;
+  int found = 0;
 
-  if(do_connect((int*)&client_sockfd, server, port) != 0)
+  for(p=haystack; *p != NULL; p++)
   {
-    if(!(options & OPT_QUIET))
+    if(strcmp(needle, *p) == 0)
     {
-      show_message("error connecting to %s:%s\n", server, port);
+      found = 1;
+      break;
     }
-    return(UPDATERES_ERROR);
   }
 
-  snprintf(buf, BUFFER_SIZE, "GET %s?action=edit&", request);
-  output(buf);
-  if(address != NULL && *address != '\0')
+  return(found);
+}
+
+void warn_fields(char **okay_fields)
+{
+  if(wildcard != 0 && !is_in_list("wildcard", okay_fields))
   {
-    snprintf(buf, BUFFER_SIZE, "%s=%s&", "myip", address);
-    output(buf);
+    fprintf(stderr, "warning: this service does not support the %s option\n",
+        "wildcard");
   }
-  snprintf(buf, BUFFER_SIZE, "%s=%s&", "wildcard", wildcard ? "ON" : "OFF");
-  output(buf);
-  snprintf(buf, BUFFER_SIZE, "%s=%s&", "mx", mx);
-  output(buf);
-  snprintf(buf, BUFFER_SIZE, "%s=%s&", "backmx", *mx == '\0' ? "NO" : "YES");
-  output(buf);
-  snprintf(buf, BUFFER_SIZE, "%s=%s&", "host_id", host);
-  output(buf);
-  snprintf(buf, BUFFER_SIZE, " HTTP/1.0\015\012");
-  output(buf);
-  snprintf(buf, BUFFER_SIZE, "Authorization: Basic %s\015\012", auth);
-  output(buf);
-  snprintf(buf, BUFFER_SIZE, "User-Agent: %s-%s %s [%s] (%s)\015\012", 
-      "ez-update", VERSION, OS, (options & OPT_DAEMON) ? "daemon" : "", "by Angus Mackay");
-  output(buf);
-  snprintf(buf, BUFFER_SIZE, "Host: %s\015\012", server);
-  output(buf);
-  snprintf(buf, BUFFER_SIZE, "\015\012");
-  output(buf);
-
-  bp = buf;
-  bytes = 0;
-  btot = 0;
-  while((bytes=read_input(bp, BUFFER_SIZE-btot)) > 0)
+  if(!(mx == NULL || *mx == '\0') && !is_in_list("mx", okay_fields))
   {
-    bp += bytes;
-    btot += bytes;
-    dprintf((stderr, "btot: %d\n", btot));
+    fprintf(stderr, "warning: this service does not support the %s option\n",
+        "mx");
   }
-  close(client_sockfd);
-  buf[btot] = '\0';
-
-  dprintf((stderr, "server output: %s\n", buf));
-
-  if(sscanf(buf, " HTTP/1.%*c %3d", &ret) != 1)
+  if(!(url == NULL || *url == '\0') && !is_in_list("url", okay_fields))
   {
-    ret = -1;
+    fprintf(stderr, "warning: this service does not support the %s option\n",
+        "url");
   }
-
-  switch(ret)
+  if(!(cloak_title == NULL || *cloak_title == '\0') && !is_in_list("cloak_title", okay_fields))
   {
-    case -1:
-      if(!(options & OPT_QUIET))
-      {
-        show_message("strange server response, are you connecting to the right server?\n");
-      }
-      return(UPDATERES_ERROR);
-      break;
+    fprintf(stderr, "warning: this service does not support the %s option\n",
+        "cloak_title");
+  }
+  if(((address6 != NULL && *address6 != '\0') || ipv6_policy != NULL) &&
+      !is_in_list("address6", okay_fields))
+  {
+    fprintf(stderr, "warning: this service does not support the %s option\n",
+        "ipv6");
+  }
+  if(connection_type != 1 && !is_in_list("connection-type", okay_fields))
+  {
+    fprintf(stderr, "warning: this service does not support the %s option\n",
+        "connection-type");
+  }
+}
 
-    case 200:
-      if(strstr(buf, "NOERROR\n") != NULL)
-      {
-        if(!(options & OPT_QUIET))
-        {
-          printf("request successful\n");
-        }
-      }
-      else
-      {
-        show_message("error processing request\n");
-        if(!(options & OPT_QUIET))
-        {
-          fprintf(stderr, "server output: %s\n", buf);
-        }
-        return(UPDATERES_ERROR);
-      }
-      break;
+/*
+ * post_update_done
+ *
+ * how the post update command went, arg is the host it was run for
+ */
+static void post_update_done(int code, void *arg)
+{
+  char *what = (char *)arg;
 
-    case 401:
-      if(!(options & OPT_QUIET))
-      {
-        show_message("authentication failure\n");
-      }
-      return(UPDATERES_SHUTDOWN);
-      break;
+  if(code == HOOK_FAILED)
+  {
+    show_message("(%s) error running post update command: %s\n",
+        N_STR(what), error_string);
+  }
+  else if(code == HOOK_KILLED)
+  {
+    show_message("(%s) post update command killed after running for too "
+        "long\n", N_STR(what));
+  }
+  else if(code != 0)
+  {
+    show_message(
+        "(%s) error running post update command, command exit code: %d\n",
+        N_STR(what), code);
+  }
+}
 
-    default:
-      if(!(options & OPT_QUIET))
-      {
-        // reuse the auth buffer
-        *auth = '\0';
-        sscanf(buf, " HTTP/1.%*c %*3d %255[^\r\n]", auth);
-        show_message("unknown return code: %d\n", ret);
-        show_message("server response: %s\n", auth);
-      }
-      return(UPDATERES_ERROR);
-      break;
+static void notify_done(int code, void *arg)
+{
+  if(code != 0)
+  {
+    show_message("unable to send mail to %s, %s exit code: %d\n",
+        N_STR(notify_email), SEND_EMAIL_CMD, code);
   }
+}
 
-  return(UPDATERES_OK);
+/* the exit code of the post update command in one shot mode */
+static void oneshot_done(int code, void *arg)
+{
+  *(int *)arg = code;
 }
 
-int EASYDNS_PARTNER_check_info(void)
+/*
+ * ctl_set_option
+ *
+ * "set" from the control socket, only the timing options can be changed
+ * and the value is checked here as option_handler() exits on bad input.
+ */
+static int ctl_set_option(char *option, char *value)
 {
-  char buf[BUFSIZ+1];
+  static char *settable[] = { "period", "resolv-period", "max-interval", "timeout", NULL };
+  struct conf_cmd *cmd;
+  int len;
 
-  if((host == NULL) || (*host == '\0'))
+  if(!is_in_list(option, settable))
   {
-    if(options & OPT_DAEMON)
-    {
-      return(-1);
-    }
-    if(host) { free(host); }
-    printf("host: ");
-    *buf = '\0';
-    fgets(buf, BUFSIZ, stdin);
-    host = strdup(buf);
-    chomp(host);
+    return(-1);
   }
-
-  if((partner == NULL) || (*partner == '\0'))
+  len = strspn(value, "0123456789.");
+  if(len == 0 || (value[len] != '\0' &&
+        (strcmp(option, "timeout") == 0 || value[len+1] != '\0' ||
+         strchr("MHdwfmy", value[len]) == NULL)))
   {
-    if(options & OPT_DAEMON)
-    {
-      return(-1);
-    }
-    if(partner) { free(partner); }
-    printf("easyDNS partner: ");
-    *buf = '\0';
-    fgets(buf, BUFSIZ, stdin);
-    partner = strdup(buf);
-    chomp(partner);
+    return(-1);
   }
 
-  if(interface == NULL && address == NULL)
+  for(cmd=conf_commands; cmd->name != NULL; cmd++)
   {
-    if(options & OPT_DAEMON)
+    if(strcmp(cmd->name, option) == 0)
     {
-      fprintf(stderr, "you must provide either an interface or an address\n");
-      return(-1);
+      show_message("control socket: setting %s to %s\n", option, value);
+      return(option_handler(cmd->id, value));
     }
-    if(interface) { free(interface); }
-    printf("interface: ");
-    *buf = '\0';
-    fgets(buf, BUFSIZ, stdin);
-    chomp(buf);
-    option_handler(CMD_interface, buf);
   }
 
-  warn_fields(service->fields_used);
-
-  return 0;
+  return(-1);
 }
 
-int EASYDNS_PARTNER_update_entry(void)
+/*
+ * publish_status
+ *
+ * copy the job into the shared status table
+ */
+static void publish_status(void)
 {
-  char buf[BUFFER_SIZE+1];
-  char *bp = buf;
-  int bytes;
-  int btot;
-  int ret;
+  struct shm_status_job entry;
+
+  memset(&entry, 0, sizeof(entry));
+  entry.flags = SHM_JOB_ACTIVE | (job.paused ? SHM_JOB_PAUSED : 0);
+  entry.last_success = job.last_update;
+  entry.last_attempt = job.last_attempt;
+  entry.next_due = job.next_due;
+  entry.failures = job.failures;
+  entry.last_result = job.last_attempt ? job.last_result : SHM_RESULT_NONE;
+  snprintf(entry.name, sizeof(entry.name), "%s", job.name);
+  snprintf(entry.address, sizeof(entry.address), "%s", job.address);
+  snprintf(entry.address6, sizeof(entry.address6), "%s", job.address6);
+
+  shm_status_publish(0, &entry);
+}
 
-  buf[BUFFER_SIZE] = '\0';
+/*
+ * address_text
+ *
+ * the addresses as the cache file keeps them, "<ipv4>" or "<ipv4>,<ipv6>"
+ */
+static void address_text(char *buf, int size, char *v4, char *v6)
+{
+  snprintf(buf, size, "%s%s%s", v4 ? v4 : "", v6 && *v6 ? "," : "",
+      v6 && *v6 ? v6 : "");
+}
 
-  if(do_connect((int*)&client_sockfd, server, port) != 0)
-  {
-    if(!(options & OPT_QUIET))
-    {
-      show_message("error connecting to %s:%s\n", server, port);
-    }
-    return(UPDATERES_ERROR);
-  }
+/*
+ * job_set_address
+ *
+ * split text from address_text() into the job's two addresses
+ */
+static void job_set_address(char *text)
+{
+  char *comma;
 
-  snprintf(buf, BUFFER_SIZE, "GET %s?action=edit&", request);
-  output(buf);
-  if(address != NULL && *address != '\0')
+  snprintf(job.address, sizeof(job.address), "%s", text);
+  job.address6[0] = '\0';
+  if((comma=strchr(job.address, ',')) != NULL)
   {
-    snprintf(buf, BUFFER_SIZE, "%s=%s&", "myip", address);
-    output(buf);
+    *comma = '\0';
   }
-  snprintf(buf, BUFFER_SIZE, "%s=%s&", "partner", partner);
-  output(buf);
-  snprintf(buf, BUFFER_SIZE, "%s=%s&", "wildcard", wildcard ? "ON" : "OFF");
-  output(buf);
-  snprintf(buf, BUFFER_SIZE, "%s=%s", "hostname", host);
-  output(buf);
-  snprintf(buf, BUFFER_SIZE, " HTTP/1.0\015\012");
-  output(buf);
-  snprintf(buf, BUFFER_SIZE, "Authorization: Basic %s\015\012", auth);
-  output(buf);
-  snprintf(buf, BUFFER_SIZE, "User-Agent: %s-%s %s [%s] (%s)\015\012", 
-      "ez-update", VERSION, OS, (options & OPT_DAEMON) ? "daemon" : "", "by Angus Mackay");
-  output(buf);
-  snprintf(buf, BUFFER_SIZE, "Host: %s\015\012", server);
-  output(buf);
-  snprintf(buf, BUFFER_SIZE, "\015\012");
-  output(buf);
-
-  bp = buf;
-  bytes = 0;
-  btot = 0;
-  while((bytes=read_input(bp, BUFFER_SIZE-btot)) > 0)
+  if((comma=strchr(text, ',')) != NULL)
   {
-    bp += bytes;
-    btot += bytes;
-    dprintf((stderr, "btot: %d\n", btot));
+    snprintf(job.address6, sizeof(job.address6), "%s", comma + 1);
   }
-  close(client_sockfd);
-  buf[btot] = '\0';
-
-  dprintf((stderr, "server output: %s\n", buf));
+}
 
-  if(sscanf(buf, " HTTP/1.%*c %3d", &ret) != 1)
+#ifdef IF_LOOKUP
+/*
+ * get_address
+ *
+ * the IPv4 address to publish: what the discovery sources agree on if
+ * there are any, otherwise the interface's
+ */
+static int get_address(int sock, struct sockaddr_in *sin)
+{
+  if(discover_sources() > 0)
   {
-    ret = -1;
+    memset(sin, 0, sizeof(struct sockaddr_in));
+    sin->sin_family = AF_INET;
+    // with an interface as well it is the fallback, for when no gateway
+    // answers because there is no NAT
+    if(discover_run(&sin->sin_addr) == 0 || interface == NULL)
+    {
+      return(sin->sin_addr.s_addr ? 0 : -1);
+    }
+    dprintf((stderr, "discovery failed, using %s\n", interface));
   }
+  return(get_if_addr(sock, interface, sin));
+}
 
-  switch(ret)
+/* a NAT-PMP gateway says its address changed, look again now */
+static void gateway_announced(int fd, void *arg)
+{
+  if(discover_announced(fd))
   {
-    case -1:
-      if(!(options & OPT_QUIET))
-      {
-        show_message("strange server response, are you connecting to the right server?\n");
-      }
-      return(UPDATERES_ERROR);
-      break;
-
-    case 200:
-      if(strstr(buf, "OK\n") != NULL)
-      {
-        if(!(options & OPT_QUIET))
-        {
-          printf("request successful\n");
-        }
-      }
-      else
-      {
-        show_message("error processing request\n");
-        if(!(options & OPT_QUIET))
-        {
-          fprintf(stderr, "server output: %s\n", buf);
-        }
-        return(UPDATERES_ERROR);
-      }
-      break;
+    event_break();
+  }
+}
 
-    case 401:
-      if(!(options & OPT_QUIET))
-      {
-        show_message("authentication failure\n");
-      }
-      return(UPDATERES_SHUTDOWN);
-      break;
+/* where the address came from, for messages */
+static char *address_from(void)
+{
+  return(discover_sources() > 0 || interface == NULL ? "public" : interface);
+}
 
-    case 403:
-      if(!(options & OPT_QUIET))
-      {
-        show_message("updating too frequently\n");
-      }
-      show_message("sleeping for %s\n", format_time(MAX_WAITRESPONSE_WAIT));
-      sleep(MAX_WAITRESPONSE_WAIT);
-      return(UPDATERES_ERROR);
-      break;
+/*
+ * address_parse
+ *
+ * the other way, returns -1 if there is no IPv4 address in text
+ */
+static int address_parse(char *text, struct in_addr *v4, struct in6_addr *v6)
+{
+  char buf[ADDRESS_TEXT_LEN];
+  char *comma;
 
-    case 404:
-      if(!(options & OPT_QUIET))
-      {
-        show_message("no dynamic service for this host/domain\n");
-      }
-      return(UPDATERES_SHUTDOWN);
-      break;
+  memset(v6, 0, sizeof(*v6));
+  snprintf(buf, sizeof(buf), "%s", text);
+  if((comma=strchr(buf, ',')) != NULL)
+  {
+    *comma = '\0';
+    inet_pton(AF_INET6, comma + 1, v6);
+  }
+  if(strchr(buf, '.') == NULL || inet_aton(buf, v4) == 0)
+  {
+    return(-1);
+  }
+  return(0);
+}
 
-    case 405:
-      if(!(options & OPT_QUIET))
-      {
-        show_message("partner not supported\n");
-      }
-      return(UPDATERES_SHUTDOWN);
-      break;
+/* the text address_text() gives for a pair of addresses */
+static void addresses_text(char *buf, int size, struct in_addr *v4,
+    struct in6_addr *v6)
+{
+  char v6buf[INET6_ADDRSTRLEN];
 
-    default:
-      if(!(options & OPT_QUIET))
-      {
-        // reuse the auth buffer
-        *auth = '\0';
-        sscanf(buf, " HTTP/1.%*c %*3d %255[^\r\n]", auth);
-        show_message("unknown return code: %d\n", ret);
-        show_message("server response: %s\n", auth);
-      }
-      return(UPDATERES_ERROR);
-      break;
+  *v6buf = '\0';
+  if(!IN6_IS_ADDR_UNSPECIFIED(v6))
+  {
+    inet_ntop(AF_INET6, v6, v6buf, sizeof(v6buf));
   }
-
-  return(UPDATERES_OK);
+  address_text(buf, size, inet_ntoa(*v4), v6buf);
 }
 
-
-#ifdef USE_MD5
-int GNUDIP_check_info(void)
+/* set address and address6 from the interface's addresses */
+static void set_addresses(struct in_addr *v4, struct in6_addr *v6)
 {
-  char buf[BUFSIZ+1];
+  char buf[INET6_ADDRSTRLEN];
 
-  if((server == NULL) || (*server == '\0'))
+  arena_string(&config_arena, &address, inet_ntoa(*v4));
+  if(IN6_IS_ADDR_UNSPECIFIED(v6))
   {
-    if(options & OPT_DAEMON)
-    {
-      return(-1);
-    }
-    if(server) { free(server); }
-    printf("server: ");
     *buf = '\0';
-    fgets(buf, BUFSIZ, stdin);
-    server = strdup(buf);
-    chomp(server);
   }
-
-  if((host == NULL) || (*host == '\0'))
-  {
-    if(options & OPT_DAEMON)
-    {
-      return(-1);
-    }
-    if(host) { free(host); }
-    printf("host: ");
-    *buf = '\0';
-    fgets(buf, BUFSIZ, stdin);
-    host = strdup(buf);
-    chomp(host);
-  }
-
-  if((address) && (strcmp(address, "0.0.0.0") != 0))
-  {
-    if(!(options & OPT_QUIET))
-    {
-      fprintf(stderr, "warning: for GNUDIP the \"address\" parpameter is only used if set to \"0.0.0.0\" thus making an offline request.\n");
-    }
-  }
-
-  warn_fields(service->fields_used);
-
-  return 0;
-}
-
-int GNUDIP_update_entry(void)
-{
-  unsigned char digestbuf[MD5_DIGEST_BYTES];
-  char buf[BUFFER_SIZE+1];
-  char *p;
-  int bytes;
-  int ret;
-  int i;
-  char *domainname;
-  char gnudip_request[2]; 
-
-  // send an offline request if address 0.0.0.0 is used
-  // otherwise, we ignore the address and send an update request
-  gnudip_request[0] = strcmp(address, "0.0.0.0") == 0 ? '1' : '0';
-  gnudip_request[1] = '\0';
-
-  // find domainname
-  for(p=host; *p != '\0' && *p != '.'; p++);
-  if(*p != '\0') { p++; }
-  if(*p == '\0')
-  {
-    return(UPDATERES_ERROR);
-  }
-  domainname = p;
-
-  if(do_connect((int*)&client_sockfd, server, port) != 0)
-  {
-    if(!(options & OPT_QUIET))
-    {
-      show_message("error connecting to %s:%s\n", server, port);
-    }
-    return(UPDATERES_ERROR);
-  }
-
-  if((bytes=read_input(buf, BUFFER_SIZE)) <= 0)
-  {
-    close(client_sockfd);
-    return(UPDATERES_ERROR);
-  }
-  buf[bytes] = '\0';
-  dprintf((stderr, "bytes: %d\n", bytes));
-  dprintf((stderr, "server output: %s\n", buf));
-
-  // buf holds the shared secret
-  chomp(buf);
-
-  // use the auth buffer
-  md5_buffer(password, strlen(password), digestbuf);
-  for(i=0, p=auth; i<MD5_DIGEST_BYTES; i++, p+=2)
-  {
-    sprintf(p, "%02x", digestbuf[i]);
-  }
-  strncat(auth, ".", 255-strlen(auth));
-  strncat(auth, buf, 255-strlen(auth));
-  dprintf((stderr, "auth: %s\n", auth));
-  md5_buffer(auth, strlen(auth), digestbuf);
-  for(i=0, p=buf; i<MD5_DIGEST_BYTES; i++, p+=2)
-  {
-    sprintf(p, "%02x", digestbuf[i]);
-  }
-  strcpy(auth, buf);
-
-  dprintf((stderr, "auth: %s\n", auth));
-
-  snprintf(buf, BUFFER_SIZE, "%s:%s:%s:%s\n", user_name, auth, domainname,
-      gnudip_request);
-  output(buf);
-
-  bytes = 0;
-  if((bytes=read_input(buf, BUFFER_SIZE)) <= 0)
-  {
-    close(client_sockfd);
-    return(UPDATERES_ERROR);
-  }
-  buf[bytes] = '\0';
-
-  dprintf((stderr, "bytes: %d\n", bytes));
-  dprintf((stderr, "server output: %s\n", buf));
-
-  close(client_sockfd);
-
-  if(sscanf(buf, "%d", &ret) != 1)
-  {
-    ret = -1;
-  }
-
-  switch(ret)
-  {
-    case -1:
-      if(!(options & OPT_QUIET))
-      {
-        show_message("strange server response, are you connecting to the right server?\n");
-      }
-      return(UPDATERES_ERROR);
-      break;
-
-    case 0:
-      if(!(options & OPT_QUIET))
-      {
-        printf("update request successful\n");
-      }
-      break;
-
-    case 1:
-      if(!(options & OPT_QUIET))
-      {
-        show_message("invalid login attempt\n");
-      }
-      return(UPDATERES_ERROR);
-      break;
-
-    case 2:
-      if(!(options & OPT_QUIET))
-      {
-        fprintf(stderr, "offline request successful\n");
-      }
-      break;
-
-    default:
-      if(!(options & OPT_QUIET))
-      {
-        show_message("unknown return code: %d\n", ret);
-      }
-      return(UPDATERES_ERROR);
-      break;
-  }
-
-  return(UPDATERES_OK);
-}
-#endif
-
-int JUSTL_check_info(void)
-{
-  char buf[BUFSIZ+1];
-
-  if(host == NULL)
-  {
-    if(options & OPT_DAEMON)
-    {
-      return(-1);
-    }
-    printf("host: ");
-    *buf = '\0';
-    fgets(buf, BUFSIZ, stdin);
-    chomp(buf);
-    host = strdup(buf);
-  }
-
-  if(interface == NULL && address == NULL)
-  {
-    if(options & OPT_DAEMON)
-    {
-      fprintf(stderr, "you must provide either an interface or an address\n");
-      return(-1);
-    }
-    if(interface) { free(interface); }
-    printf("interface: ");
-    *buf = '\0';
-    fgets(buf, BUFSIZ, stdin);
-    chomp(buf);
-    option_handler(CMD_interface, buf);
-  }
-
-  warn_fields(service->fields_used);
-
-  return 0;
-}
-
-int JUSTL_update_entry(void)
-{
-  char buf[BUFFER_SIZE+1];
-  char *bp = buf;
-  int bytes;
-  int btot;
-  int ret;
-
-  buf[BUFFER_SIZE] = '\0';
-
-  if(do_connect((int*)&client_sockfd, server, port) != 0)
-  {
-    if(!(options & OPT_QUIET))
-    {
-      show_message("error connecting to %s:%s\n", server, port);
-    }
-    return(UPDATERES_ERROR);
-  }
-
-  snprintf(buf, BUFFER_SIZE, "GET %s?direct=1&", request);
-  output(buf);
-  snprintf(buf, BUFFER_SIZE, "%s=%s&", "username", user_name);
-  output(buf);
-  snprintf(buf, BUFFER_SIZE, "%s=%s&", "password", password);
-  output(buf);
-  snprintf(buf, BUFFER_SIZE, "%s=%s&", "host", host);
-  output(buf);
-  snprintf(buf, BUFFER_SIZE, "%s=%s&", "ip", address);
-  output(buf);
-  snprintf(buf, BUFFER_SIZE, " HTTP/1.0\015\012");
-  output(buf);
-  snprintf(buf, BUFFER_SIZE, "Authorization: Basic %s\015\012", auth);
-  output(buf);
-  snprintf(buf, BUFFER_SIZE, "User-Agent: %s-%s %s [%s] (%s)\015\012", 
-      "ez-update", VERSION, OS, (options & OPT_DAEMON) ? "daemon" : "", "by Angus Mackay");
-  output(buf);
-  snprintf(buf, BUFFER_SIZE, "Host: %s\015\012", server);
-  output(buf);
-  snprintf(buf, BUFFER_SIZE, "\015\012");
-  output(buf);
-
-  bp = buf;
-  bytes = 0;
-  btot = 0;
-  while((bytes=read_input(bp, BUFFER_SIZE-btot)) > 0)
-  {
-    bp += bytes;
-    btot += bytes;
-    dprintf((stderr, "btot: %d\n", btot));
-  }
-  close(client_sockfd);
-  buf[btot] = '\0';
-
-  dprintf((stderr, "server output: %s\n", buf));
-
-  if(sscanf(buf, " HTTP/1.%*c %3d", &ret) != 1)
-  {
-    ret = -1;
-  }
-
-  switch(ret)
-  {
-    case -1:
-      if(!(options & OPT_QUIET))
-      {
-        show_message("strange server response, are you connecting to the right server?\n");
-      }
-      return(UPDATERES_ERROR);
-      break;
-
-    case 200:
-      if(strstr(buf, " set ") != NULL)
-      {
-        if(!(options & OPT_QUIET))
-        {
-          printf("request successful\n");
-        }
-      }
-      else
-      {
-        show_message("error processing request\n");
-        if(!(options & OPT_QUIET))
-        {
-          fprintf(stderr, "server output: %s\n", buf);
-        }
-        return(UPDATERES_ERROR);
-      }
-      break;
-
-    case 401:
-      if(!(options & OPT_QUIET))
-      {
-        show_message("authentication failure\n");
-      }
-      return(UPDATERES_SHUTDOWN);
-      break;
-
-    default:
-      if(!(options & OPT_QUIET))
-      {
-        // reuse the auth buffer
-        *auth = '\0';
-        sscanf(buf, " HTTP/1.%*c %*3d %255[^\r\n]", auth);
-        show_message("unknown return code: %d\n", ret);
-        show_message("server response: %s\n", auth);
-      }
-      return(UPDATERES_ERROR);
-      break;
-  }
-
-  return(UPDATERES_OK);
-}
-
-int DYNS_check_info(void)
-{
-  char buf[BUFSIZ+1];
-
-  if(host == NULL)
-  {
-    if(options & OPT_DAEMON)
-    {
-      return(-1);
-    }
-    printf("host: ");
-    *buf = '\0';
-    fgets(buf, BUFSIZ, stdin);
-    chomp(buf);
-    host = strdup(buf);
-  }
-
-  if(interface == NULL && address == NULL)
-  {
-    if(options & OPT_DAEMON)
-    {
-      fprintf(stderr, "you must provide either an interface or an address\n");
-      return(-1);
-    }
-    if(interface) { free(interface); }
-    printf("interface: ");
-    *buf = '\0';
-    fgets(buf, BUFSIZ, stdin);
-    chomp(buf);
-    option_handler(CMD_interface, buf);
-  }
-
-  warn_fields(service->fields_used);
-
-  return 0;
-}
-
-int DYNS_update_entry(void)
-{
-  char buf[BUFFER_SIZE+1];
-  char *bp = buf;
-  int bytes;
-  int btot;
-  int ret;
-
-  buf[BUFFER_SIZE] = '\0';
-
-  if(do_connect((int*)&client_sockfd, server, port) != 0)
-  {
-    if(!(options & OPT_QUIET))
-    {
-      show_message("error connecting to %s:%s\n", server, port);
-    }
-    return(UPDATERES_ERROR);
-  }
-
-  snprintf(buf, BUFFER_SIZE, "GET %s?", request);
-  output(buf);
-  snprintf(buf, BUFFER_SIZE, "%s=%s&", "username", user_name);
-  output(buf);
-  snprintf(buf, BUFFER_SIZE, "%s=%s&", "password", password);
-  output(buf);
-  snprintf(buf, BUFFER_SIZE, "%s=%s&", "host", host);
-  output(buf);
-  snprintf(buf, BUFFER_SIZE, "%s=%s", "ip", address);
-  output(buf);
-  snprintf(buf, BUFFER_SIZE, " HTTP/1.0\015\012");
-  output(buf);
-  snprintf(buf, BUFFER_SIZE, "Authorization: Basic %s\015\012", auth);
-  output(buf);
-  snprintf(buf, BUFFER_SIZE, "User-Agent: %s-%s %s [%s] (%s)\015\012", 
-      "ez-update", VERSION, OS, (options & OPT_DAEMON) ? "daemon" : "", "by Angus Mackay");
-  output(buf);
-  snprintf(buf, BUFFER_SIZE, "Host: %s\015\012", server);
-  output(buf);
-  snprintf(buf, BUFFER_SIZE, "\015\012");
-  output(buf);
-
-  bp = buf;
-  bytes = 0;
-  btot = 0;
-  while((bytes=read_input(bp, BUFFER_SIZE-btot)) > 0)
-  {
-    bp += bytes;
-    btot += bytes;
-    dprintf((stderr, "btot: %d\n", btot));
-  }
-  close(client_sockfd);
-  buf[btot] = '\0';
-
-  dprintf((stderr, "server output: %s\n", buf));
-
-  if(sscanf(buf, " HTTP/1.%*c %3d", &ret) != 1)
-  {
-    ret = -1;
-  }
-
-  switch(ret)
-  {
-    case -1:
-      if(!(options & OPT_QUIET))
-      {
-        show_message("strange server response, are you connecting to the right server?\n");
-      }
-      return(UPDATERES_ERROR);
-      break;
-
-    case 200:
-      if(strstr(buf, "200 Host") != NULL ||
-          strstr(buf, "200 host") != NULL)
-      {
-        if(!(options & OPT_QUIET))
-        {
-          printf("request successful\n");
-        }
-      }
-      else if(strstr(buf, "400 Bad Request") != NULL)
-      {
-        if(!(options & OPT_QUIET))
-        {
-          printf("bad request\n");
-        }
-      }
-      else if(strstr(buf, "401 User") != NULL)
-      {
-        if(!(options & OPT_QUIET))
-        {
-          printf("authentication failure (username/password)\n");
-        }
-      }
-      else if(strstr(buf, "405 Hostname") != NULL)
-      {
-        if(!(options & OPT_QUIET))
-        {
-          printf("authentication failure (hostname not found)\n");
-        }
-      }
-
-      else
-      {
-        show_message("error processing request\n");
-        if(!(options & OPT_QUIET))
-        {
-          fprintf(stderr, "server output: %s\n", buf);
-        }
-        return(UPDATERES_ERROR);
-      }
-
-      break;
-
-    case 405:
-      if(!(options & OPT_QUIET))
-      {
-        show_message("authentication failure\n");
-      }
-      return(UPDATERES_ERROR);
-      break;
-
-    default:
-      if(!(options & OPT_QUIET))
-      {
-        // reuse the auth buffer
-        *auth = '\0';
-        sscanf(buf, " HTTP/1.%*c %*3d %255[^\r\n]", auth);
-        show_message("unknown return code: %d\n", ret);
-        show_message("server response: %s\n", auth);
-      }
-      return(UPDATERES_ERROR);
-      break;
-  }
-
-  return(UPDATERES_OK);
-}
-
-int HN_check_info(void)
-{
-  warn_fields(service->fields_used);
-
-  return 0;
-}
-
-int HN_update_entry(void)
-{
-  char buf[BUFFER_SIZE+1];
-  char *bp = buf;
-  int bytes;
-  int btot;
-  int ret;
-
-  buf[BUFFER_SIZE] = '\0';
-
-  if(do_connect((int*)&client_sockfd, server, port) != 0)
-  {
-    if(!(options & OPT_QUIET))
-    {
-      show_message("error connecting to %s:%s\n", server, port);
-    }
-    return(UPDATERES_ERROR);
-  }
-
-  snprintf(buf, BUFFER_SIZE, "GET %s?ver=%d&", request, 1);
-  output(buf);
-  if(address)
-  {
-    snprintf(buf, BUFFER_SIZE, "%s=%s&", "IP", address);
-    output(buf);
-  }
-  snprintf(buf, BUFFER_SIZE, " HTTP/1.0\015\012");
-  output(buf);
-  snprintf(buf, BUFFER_SIZE, "Authorization: Basic %s\015\012", auth);
-  output(buf);
-  snprintf(buf, BUFFER_SIZE, "User-Agent: %s-%s %s [%s] (%s)\015\012", 
-      "ez-update", VERSION, OS, (options & OPT_DAEMON) ? "daemon" : "", "by Angus Mackay");
-  output(buf);
-  snprintf(buf, BUFFER_SIZE, "Host: %s\015\012", server);
-  output(buf);
-  snprintf(buf, BUFFER_SIZE, "\015\012");
-  output(buf);
-
-  bp = buf;
-  bytes = 0;
-  btot = 0;
-  while((bytes=read_input(bp, BUFFER_SIZE-btot)) > 0)
-  {
-    bp += bytes;
-    btot += bytes;
-    dprintf((stderr, "btot: %d\n", btot));
-  }
-  close(client_sockfd);
-  buf[btot] = '\0';
-
-  dprintf((stderr, "server output: %s\n", buf));
-
-  if(sscanf(buf, " HTTP/1.%*c %3d", &ret) != 1)
+  else
   {
-    ret = -1;
+    inet_ntop(AF_INET6, v6, buf, sizeof(buf));
   }
-
-  switch(ret)
-  {
-    char *p;
-
-    case -1:
-      if(!(options & OPT_QUIET))
-      {
-        show_message("strange server response, are you connecting to the right server?\n");
-      }
-      return(UPDATERES_ERROR);
-      break;
-
-    case 200:
-      ret = -1;
-      if((p=strstr(buf, "DDNS_Response_")) != NULL)
-      {
-         sscanf(p, "DDNS_Response_%*code=%3d", &ret);
-      }
-
-      /*
-       * 101 - Successfully Updated
-       * 201 - Failure because previous update occured
-       *       less than 300 seconds ago
-       * 202 - Failure because of server error
-       * 203 - Failure because account is frozen (by admin)
-       * 204 - Failure because account is locked (by user)
-       */
-      switch(ret)
-      {
-        case -1:
-          if(!(options & OPT_QUIET))
-          {
-            show_message("strange server response, are you connecting to the right server?\n");
-          }
-          return(UPDATERES_ERROR);
-          break;
-
-        case 101:
-          if(!(options & OPT_QUIET))
-          {
-            printf("request successful\n");
-          }
-          break;
-
-        case 201:
-          show_message("Last update was less than %d seconds ago.\n", 300);
-          return(UPDATERES_ERROR);
-          break;
-
-        case 202:
-          show_message("Server error.\n");
-          return(UPDATERES_ERROR);
-          break;
-
-        case 203:
-          show_message("Failure because account is frozen (by admin).\n");
-          return(UPDATERES_SHUTDOWN);
-          break;
-
-        case 204:
-          show_message("Failure because account is locked (by user).\n");
-          return(UPDATERES_SHUTDOWN);
-          break;
-
-        default:
-          if(!(options & OPT_QUIET))
-          {
-            show_message("unknown return code: %d\n", ret);
-            fprintf(stderr, "server response: %s\n", buf);
-          }
-          return(UPDATERES_ERROR);
-          break;
-      }
-      break;
-
-    case 401:
-      if(!(options & OPT_QUIET))
-      {
-        show_message("authentication failure\n");
-      }
-      return(UPDATERES_SHUTDOWN);
-      break;
-
-    default:
-      if(!(options & OPT_QUIET))
-      {
-        // reuse the auth buffer
-        *auth = '\0';
-        sscanf(buf, " HTTP/1.%*c %*3d %255[^\r\n]", auth);
-        show_message("unknown return code: %d\n", ret);
-        fprintf(stderr, "server response: %s\n", auth);
-      }
-      return(UPDATERES_ERROR);
-      break;
-  }
-
-  return(UPDATERES_OK);
+  arena_string(&config_arena, &address6, buf);
 }
 
-int ZONEEDIT_check_info(void)
+/*
+ * daemon_upgrade
+ *
+ * re-exec ourselves with the job's state and listening sockets so that the
+ * new binary picks up where this one is.  updates are made one at a time
+ * from the daemon loop so none is in flight here, only hooks may be and
+ * those are waited for.  returns only if the exec failed, carrying on as
+ * before.
+ */
+static void daemon_upgrade(struct sockaddr_in *sin, struct in6_addr *in6,
+    int period)
 {
-  char buf[BUFSIZ+1];
-
-  if((host == NULL) || (*host == '\0'))
-  {
-    if(options & OPT_DAEMON)
-    {
-      return(-1);
-    }
-    if(host) { free(host); }
-    printf("host: ");
-    *buf = '\0';
-    fgets(buf, BUFSIZ, stdin);
-    host = strdup(buf);
-    chomp(host);
+  char buf[INET6_ADDRSTRLEN];
+  char text[ADDRESS_TEXT_LEN];
+  int ctl_fd;
+  int metrics_fd;
+  int err;
+
+  hook_drain();
+
+  upgrade_put("address", "%s", sin->sin_addr.s_addr ?
+      inet_ntoa(sin->sin_addr) : "");
+  upgrade_put("address6", "%s", IN6_IS_ADDR_UNSPECIFIED(in6) ? "" :
+      inet_ntop(AF_INET6, in6, buf, sizeof(buf)));
+  upgrade_put("period", "%d", period);
+  upgrade_put("last_update", "%ld", (long)last_update);
+  address_text(text, sizeof(text), job.address, job.address6);
+  upgrade_put("job_address", "%s", text);
+  upgrade_put("job_last_update", "%ld", (long)job.last_update);
+  upgrade_put("job_last_attempt", "%ld", (long)job.last_attempt);
+  upgrade_put("job_next_due", "%ld", (long)job.next_due);
+  upgrade_put("job_last_result", "%d", job.last_result);
+  upgrade_put("job_failures", "%d", job.failures);
+  upgrade_put("job_paused", "%d", job.paused);
+  upgrade_put("job_force", "%d", job.force);
+  ctl_fd = ctl_detach();
+  metrics_fd = metrics_detach();
+  upgrade_put_fd("ctl_fd", ctl_fd);
+  upgrade_put_fd("metrics_fd", metrics_fd);
+
+  show_message("re-executing %s\n", saved_argv[0]);
+  logger_close();
+  upgrade_exec(saved_argv);
+  err = errno;
+
+  logger_open(log_target, program_name);
+  errno = err;
+  show_message("unable to upgrade, running %s failed: %s\n", saved_argv[0],
+      error_string);
+  if(ctl_fd != -1 && ctl_adopt(ctl_fd, ctl_socket, &job, 1, ctl_set_option) != 0)
+  {
+    close(ctl_fd);
+  }
+  if(metrics_fd != -1 && metrics_adopt(metrics_fd) != 0)
+  {
+    close(metrics_fd);
   }
-
-  warn_fields(service->fields_used);
-
-  return 0;
 }
 
-int ZONEEDIT_update_entry(void)
+/*
+ * daemon_resume
+ *
+ * pick up the state daemon_upgrade() handed over
+ */
+static void daemon_resume(struct sockaddr_in *sin, struct in6_addr *in6,
+    int *period)
 {
-  char buf[BUFFER_SIZE+1];
-  char *bp = buf;
-  int bytes;
-  int btot;
-  int ret;
-
-  buf[BUFFER_SIZE] = '\0';
+  char *str;
 
-  if(do_connect((int*)&client_sockfd, server, port) != 0)
+  if((str=upgrade_get("address")) != NULL && *str != '\0')
   {
-    if(!(options & OPT_QUIET))
-    {
-      show_message("error connecting to %s:%s\n", server, port);
-    }
-    return(UPDATERES_ERROR);
-  }
-
-  snprintf(buf, BUFFER_SIZE, "GET %s?", request);
-  output(buf);
-  snprintf(buf, BUFFER_SIZE, "%s=%s&", "host", host);
-  output(buf);
-  if (address && *address) {
-      snprintf(buf, BUFFER_SIZE, "%s=%s&", "dnsto", address);
-      output(buf);
-  }
-  if (address && *mx && *mx != '0') {
-      snprintf(buf, BUFFER_SIZE, "%s=%s&", "type", "a,mx");
-      output(buf);
+    inet_aton(str, &sin->sin_addr);
   }
-  snprintf(buf, BUFFER_SIZE, " HTTP/1.0\015\012");
-  output(buf);
-  snprintf(buf, BUFFER_SIZE, "User-Agent: %s-%s %s (%s)\015\012", 
-      "zoneedit", VERSION, OS, "by Angus Mackay");
-  output(buf);
-  snprintf(buf, BUFFER_SIZE, "Host: %s\015\012", server);
-  output(buf);
-  snprintf(buf, BUFFER_SIZE, "Authorization: Basic %s\015\012", auth);
-  output(buf);
-  snprintf(buf, BUFFER_SIZE, "\015\012");
-  output(buf);
-
-  bp = buf;
-  bytes = 0;
-  btot = 0;
-  while((bytes=read_input(bp, BUFFER_SIZE-btot)) > 0)
+  if((str=upgrade_get("address6")) != NULL && *str != '\0')
   {
-    bp += bytes;
-    btot += bytes;
-    dprintf((stderr, "btot: %d\n", btot));
-  }
-  close(client_sockfd);
-  buf[btot] = '\0';
-
-  dprintf((stderr, "server output: %s\n", buf));
-
-  if(sscanf(buf, " HTTP/1.%*c %3d", &ret) != 1)
-  {
-    ret = -1;
-  }
-
-  switch(ret)
-  {
-    case -1:
-      if(!(options & OPT_QUIET))
-      {
-        show_message("strange server response, are you connecting to the right server?\n");
-      }
-      return(UPDATERES_ERROR);
-      break;
-
-    case 200:
-      if(strstr(buf, "<SUCCESS") != NULL)
-      {
-        if(!(options & OPT_QUIET))
-        {
-          printf("request successful\n");
-        }
-      }
-      else
-      {
-        show_message("error processing request\n");
-        if(!(options & OPT_QUIET))
-        {
-          fprintf(stderr, "server output: %s\n", buf);
-        }
-        return(UPDATERES_ERROR);
-      }
-      break;
-
-    case 401:
-      if(!(options & OPT_QUIET))
-      {
-        show_message("authentication failure\n");
-      }
-      return(UPDATERES_SHUTDOWN);
-      break;
-
-    default:
-      if(!(options & OPT_QUIET))
-      {
-        // reuse the auth buffer
-        *auth = '\0';
-        sscanf(buf, " HTTP/1.%*c %*3d %255[^\r\n]", auth);
-        show_message("unknown return code: %d\n", ret);
-        show_message("server response: %s\n", auth);
-      }
-      return(UPDATERES_ERROR);
-      break;
+    inet_pton(AF_INET6, str, in6);
   }
-
-  return(UPDATERES_OK);
-}
-
-int HEIPV6TB_check_info(void)
-{
-  char buf[BUFSIZ+1];
-
-  if(interface == NULL)
+  *period = upgrade_get_long("period", *period);
+  last_update = upgrade_get_long("last_update", last_update);
+  if((str=upgrade_get("job_address")) != NULL)
   {
-    if(options & OPT_DAEMON)
-    {
-      fprintf(stderr, "you must provide either an interface or an address\n");
-      return(-1);
-    }
-    if(interface) { free(interface); }
-    printf("interface: ");
-    *buf = '\0';
-    fgets(buf, BUFSIZ, stdin);
-    chomp(buf);
-    option_handler(CMD_interface, buf);
+    job_set_address(str);
   }
-  warn_fields(service->fields_used);
+  job.last_update = upgrade_get_long("job_last_update", job.last_update);
+  job.last_attempt = upgrade_get_long("job_last_attempt", 0);
+  job.next_due = upgrade_get_long("job_next_due", 0);
+  job.last_result = upgrade_get_long("job_last_result", 0);
+  job.failures = upgrade_get_long("job_failures", 0);
+  job.paused = upgrade_get_long("job_paused", 0);
+  job.force = upgrade_get_long("job_force", 0);
 
-  return 0;
+  show_message("resumed after upgrade, address %s, next check in %ld seconds\n",
+      *job.address ? job.address : "unknown",
+      job.next_due > time(NULL) ? (long)(job.next_due - time(NULL)) : 0L);
 }
+#endif
 
-int HEIPV6TB_update_entry(void)
-{
-  char buf[BUFFER_SIZE+1];
-  char *bp = buf;
-  int bytes;
-  int btot;
-  int ret;
-
-  buf[BUFFER_SIZE] = '\0';
-
-  if(do_connect((int*)&client_sockfd, server, port) != 0)
-  {
-    if(!(options & OPT_QUIET))
-    {
-      show_message("error connecting to %s:%s\n", server, port);
-    }
-    return(UPDATERES_ERROR);
-  }
-
-  snprintf(buf, BUFFER_SIZE, "GET %s?menu=%s&", request, "edit_tunnel_address");
-  output(buf);
-  snprintf(buf, BUFFER_SIZE, "aname=%s&", user_name);
-  output(buf);
-  snprintf(buf, BUFFER_SIZE, "auth=%s&", password);
-  output(buf);
-  snprintf(buf, BUFFER_SIZE, "ipv4b=%s", address);
-  output(buf);
-  snprintf(buf, BUFFER_SIZE, " HTTP/1.0\015\012");
-  output(buf);
-  snprintf(buf, BUFFER_SIZE, "User-Agent: %s-%s %s [%s] (%s)\015\012", 
-      "ez-update", VERSION, OS, (options & OPT_DAEMON) ? "daemon" : "", "by Angus Mackay");
-  output(buf);
-  snprintf(buf, BUFFER_SIZE, "Host: %s\015\012", server);
-  output(buf);
-  snprintf(buf, BUFFER_SIZE, "\015\012");
-  output(buf);
-
-  bp = buf;
-  bytes = 0;
-  btot = 0;
-  while((bytes=read_input(bp, BUFFER_SIZE-btot)) > 0)
-  {
-    bp += bytes;
-    btot += bytes;
-    dprintf((stderr, "btot: %d\n", btot));
-  }
-  close(client_sockfd);
-  buf[btot] = '\0';
-
-  dprintf((stderr, "server output: %s\n", buf));
-  if(sscanf(buf, " HTTP/1.%*c %3d", &ret) != 1)
-  {
-    ret = -1;
-  }
-
-  switch(ret)
-  {
-    char *p;
-
-    case -1:
-      if(!(options & OPT_QUIET))
-      {
-        show_message("strange server response, are you connecting to the right server?\n");
-      }
-      return(UPDATERES_ERROR);
-      break;
-    case 200:
-      if(!(options & OPT_QUIET))
-      {
-        printf("request successful\n");
-      }
-      break;
-    default:
-      if(!(options & OPT_QUIET))
-      {
-        // reuse the auth buffer
-        *auth = '\0';
-        sscanf(buf, " HTTP/1.%*c %*3d %255[^\r\n]", auth);
-        show_message("unknown return code: %d\n", ret);
-        fprintf(stderr, "server response: %s\n", auth);
-      }
-      return(UPDATERES_ERROR);
-      break;
-  }
-
-  return(UPDATERES_OK);
+/* rewrite the metrics file, if there is one */
+static void write_metrics(void)
+{
+  if(metrics_file && metrics_write_file(metrics_file) != 0)
+  {
+    show_message("unable to write metrics file \"%s\": %s\n",
+        metrics_file, error_string);
+  }
 }
 
-static int is_in_list(char *needle, char **haystack)
+/* tell the metrics when the next refresh is due */
+static void note_refresh(int spread, int refreshed)
 {
-  char **p;
-  int found = 0;
-
-  for(p=haystack; *p != NULL; p++)
+  if(spread > max_interval/2)
   {
-    if(strcmp(needle, *p) == 0)
-    {
-      found = 1;
-      break;
-    }
+    spread = max_interval/2;
   }
+  metrics_refresh(service->names[0], spread, max_interval > 0 &&
+      last_update > 0 ? last_update + max_interval - spread + 1 : 0,
+      refreshed);
+  write_metrics();
+}
 
-  return(found);
+/* the session for the options as they are now */
+static void session_from_options(void)
+{
+  session.service = service;
+  session.server = server;
+  session.port = port;
+  session.request = request;
+  session.host = host;
+  session.address = address;
+  session.address6 = address6;
+  session.mx = mx;
+  session.url = url;
+  session.cloak_title = cloak_title;
+  session.partner = partner;
+  session.user_name = user_name;
+  session.password = password;
+  session.wildcard = wildcard;
+  session.connection_type = connection_type;
+  session.flags = options & (EZ_DEBUG | EZ_DAEMON | EZ_QUIET | EZ_OFFLINE);
+  session.timeout = timeout;
+  session.transport = &client_transport;
+  session.message = client_message;
+  session.trace = client_trace;
 }
 
-void warn_fields(char **okay_fields)
+/* keep what a plugin's service changed in the session */
+static void options_from_session(void)
 {
-  if(wildcard != 0 && !is_in_list("wildcard", okay_fields))
+  if(session.server != server)
   {
-    fprintf(stderr, "warning: this service does not support the %s option\n",
-        "wildcard");
+    arena_string(&config_arena, &server, session.server);
   }
-  if(!(mx == NULL || *mx == '\0') && !is_in_list("mx", okay_fields))
+  if(session.port != port)
   {
-    fprintf(stderr, "warning: this service does not support the %s option\n",
-        "mx");
+    arena_string(&config_arena, &port, session.port);
   }
-  if(!(url == NULL || *url == '\0') && !is_in_list("url", okay_fields))
+  if(session.request != request)
   {
-    fprintf(stderr, "warning: this service does not support the %s option\n",
-        "url");
+    arena_string(&config_arena, &request, session.request);
   }
-  if(!(cloak_title == NULL || *cloak_title == '\0') && !is_in_list("cloak_title", okay_fields))
+  if(session.host != host)
   {
-    fprintf(stderr, "warning: this service does not support the %s option\n",
-        "cloak_title");
+    arena_string(&config_arena, &host, session.host);
   }
-  if(connection_type != 1 && !is_in_list("connection-type", okay_fields))
+  if(session.mx != mx)
   {
-    fprintf(stderr, "warning: this service does not support the %s option\n",
-        "connection-type");
+    arena_string(&config_arena, &mx, session.mx);
   }
+  if(session.url != url)
+  {
+    arena_string(&config_arena, &url, session.url);
+  }
+  if(session.cloak_title != cloak_title)
+  {
+    arena_string(&config_arena, &cloak_title, session.cloak_title);
+  }
+  if(session.partner != partner)
+  {
+    arena_string(&config_arena, &partner, session.partner);
+  }
+  if(session.user_name != user_name)
+  {
+    snprintf(user_name, sizeof(user_name), "%s",
+        session.user_name ? session.user_name : "");
+  }
+  if(session.password != password)
+  {
+    snprintf(password, sizeof(password), "%s",
+        session.password ? session.password : "");
+  }
+  wildcard = session.wildcard;
+  connection_type = session.connection_type;
 }
 
-int exec_cmd(char *cmd)
+/*
+ * do_update
+ *
+ * run one update for the current service, timing it for the metrics
+ */
+int do_update(void)
 {
-#if (defined(HAVE_WAITPID) || defined(HAVE_WAIT)) && (defined(HAVE_VFORK) || defined(HAVE_FORK))
-  int kid;
-  int exit_code;
+  int res;
+
+  // the options can change between updates (SIGHUP, ctl set)
+  session_from_options();
 
-  switch((kid=vfork()))
+  transcript_begin(service->names[0], server, port, host, address, user_name);
+  res = ez_update(&session);
+  transcript_end(res);
+  metrics_record(&session);
+  if(res == EZ_OK)
   {
-    case -1:
-      if(!(options & OPT_QUIET))
-      {
-        perror("fork");
-      }
-      return(-1);
-      break;
-    case 0:
-      /* child */
-      execl("/bin/sh", "sh", "-c", cmd, (char *)0);
-      if(!(options & OPT_QUIET))
-      {
-        perror("exec");
-      }
-      exit(1);
-      break;
-    default:
-      /* parent */
-      dprintf((stderr, "forked kid: %d\n", kid));
-      break;
+    plugin_updated(&session);
   }
 
-#  ifdef HAVE_WAITPID
-  if(waitpid(kid, &exit_code, 0) != kid)
+  if(options & OPT_DAEMON)
   {
-    return(1);
+    logger_kv(LOG_INFO, "update", "service", service->names[0], "host", host,
+        "address", address, "result", res == EZ_OK ? "ok" :
+        res == EZ_SHUTDOWN ? "shutdown" : "error",
+        address6 != NULL && *address6 != '\0' ? "address6" : "", address6,
+        *change_id() != '\0' ? "change" : "", change_id(), NULL);
   }
-#  else
-  if(wait(&exit_code) != kid)
+  if(res == EZ_OK)
   {
-    return(1);
+    change_acked(service->names[0], host, address, address6);
   }
-#  endif
-  exit_code = WEXITSTATUS(exit_code);
 
-  return(exit_code);
-#else
-  return(-1);
-#endif
+  write_metrics();
+
+  return(res);
+}
+
+/*
+ * already_in_dns
+ *
+ * whether every host already has the addresses about to be sent, in which
+ * case the update is counted as avoided
+ */
+int already_in_dns(void)
+{
+  int res;
+
+  if(host == NULL || address == NULL)
+  {
+    return(0);
+  }
+  res = dnscheck_matches(host, address, address6);
+  if(res == -1)
+  {
+    show_message("could not look %s up, updating anyway\n", host);
+    return(0);
+  }
+  if(res == 0)
+  {
+    return(0);
+  }
+
+  metrics_avoided(service->names[0]);
+  if(options & OPT_DAEMON)
+  {
+    logger_kv(LOG_INFO, "update", "service", service->names[0], "host", host,
+        "address", address, "result", "avoided",
+        address6 != NULL && *address6 != '\0' ? "address6" : NULL, address6,
+        NULL);
+  }
+  write_metrics();
+  return(1);
 }
 
 void handle_sig(int sig)
@@ -4364,9 +2748,9 @@ void handle_sig(int sig)
     case SIGQUIT:
       show_message("received SIGQUIT, shutting down\n");
 
-#if HAVE_SYSLOG_H
-      closelog();
-#endif
+      ctl_close();
+      shm_status_destroy();
+      logger_close();
 
 #if HAVE_GETPID
       if(pid_file)
@@ -4376,12 +2760,177 @@ void handle_sig(int sig)
 #endif
 
       exit(0);
+    case SIGUSR2:
+      show_message("received SIGUSR2, upgrading\n");
+      upgrade_pending = 1;
+      break;
     default:
       dprintf((stderr, "case not handled: %d\n", sig));
       break;
   }
 }
 
+/*
+ * replay_main
+ *
+ * "ez-ipupdate replay [-n <count>] [-v] <transcript>" runs the recorded
+ * sessions through their services' update code again, with the replay
+ * transport feeding it what the server said, and reports any session that
+ * now ends differently. with -n the sessions are replayed count times
+ * more, silently, and the time per session printed.
+ */
+static int replay_main(int argc, char **argv)
+{
+  struct transcript_session *sessions;
+  struct transcript_session *s;
+  struct ez_service *svc;
+  struct timeval t0;
+  struct timeval t1;
+  char *names[] = { "ok", "error", "shutdown" };
+  int nsessions;
+  int count = 0;
+  int verbose = 0;
+  int mismatches = 0;
+  int timed = 0;
+  unsigned long mallocs = 0;
+  int saved_out = -1;
+  int saved_err = -1;
+  int null_fd;
+  int pass;
+  int res;
+  int opt;
+  int i;
+
+  optind = 1;
+  while((opt=getopt(argc, argv, "n:v")) != -1)
+  {
+    switch(opt)
+    {
+      case 'n':
+        count = atoi(optarg);
+        break;
+      case 'v':
+        verbose = 1;
+        break;
+      default:
+        fprintf(stderr, "usage: %s replay [-n <count>] [-v] <transcript>\n",
+            program_name);
+        return(1);
+    }
+  }
+  if(optind != argc - 1)
+  {
+    fprintf(stderr, "usage: %s replay [-n <count>] [-v] <transcript>\n",
+        program_name);
+    return(1);
+  }
+  if((sessions=transcript_load(argv[optind], &nsessions)) == NULL)
+  {
+    fprintf(stderr, "%s: can't read transcript %s\n", program_name,
+        argv[optind]);
+    return(1);
+  }
+
+  ez_session_init(&session, NULL);
+  session.transport = &replay_transport;
+  session.password = "********";
+  if(!verbose)
+  {
+    session.flags |= EZ_QUIET;
+  }
+
+  for(pass=0; pass<=count; pass++)
+  {
+    if(pass == 1)
+    {
+      // the timed passes are quiet, whatever the sessions print
+      fflush(stdout);
+      fflush(stderr);
+      if((null_fd=open("/dev/null", O_WRONLY)) >= 0)
+      {
+        saved_out = dup(1);
+        saved_err = dup(2);
+        dup2(null_fd, 1);
+        dup2(null_fd, 2);
+        close(null_fd);
+      }
+      mallocs = arena_heap_mallocs();
+      gettimeofday(&t0, NULL);
+    }
+
+    for(i=0; i<nsessions; i++)
+    {
+      s = &sessions[i];
+      svc = ez_service_find(s->service);
+      if(svc == NULL || svc->update == NULL || !s->complete)
+      {
+        if(pass == 0)
+        {
+          printf("session %d: %s %s: %s\n", i, s->service, s->host,
+              svc == NULL || svc->update == NULL ?
+              "service not compiled in" : "incomplete, skipped");
+        }
+        continue;
+      }
+
+      // the transcript owns these strings, nothing sets them again after this
+      session.service = svc;
+      session.server = s->server;
+      session.port = s->port;
+      session.request = svc->default_request;
+      session.host = *s->host ? s->host : NULL;
+      session.address = *s->address ? s->address : NULL;
+      session.user_name = s->user;
+
+      transcript_replay(s);
+      res = ez_update(&session);
+      if(pass > 0)
+      {
+        timed++;
+      }
+
+      if(pass == 0 && (res != s->result || verbose))
+      {
+        printf("session %d: %s %s: recorded %s, replayed %s%s\n", i,
+            s->service, s->host,
+            s->result >= 0 && s->result < 3 ? names[s->result] : "?",
+            res >= 0 && res < 3 ? names[res] : "?",
+            res != s->result ? " MISMATCH" : "");
+      }
+      if(pass == 0 && res != s->result)
+      {
+        mismatches++;
+      }
+    }
+  }
+
+  if(count > 0)
+  {
+    gettimeofday(&t1, NULL);
+    fflush(stdout);
+    fflush(stderr);
+    if(saved_out >= 0)
+    {
+      dup2(saved_out, 1);
+      dup2(saved_err, 2);
+      close(saved_out);
+      close(saved_err);
+    }
+    printf("%d sessions replayed in %.3f s, %.0f ns per session\n", timed,
+        (t1.tv_sec - t0.tv_sec) + (t1.tv_usec - t0.tv_usec) / 1e6,
+        timed ? ((t1.tv_sec - t0.tv_sec) * 1e9 +
+          (t1.tv_usec - t0.tv_usec) * 1e3) / timed : 0.0);
+    printf("arena: %lu bytes in %lu blocks, %lu mallocs after the first "
+        "pass\n", arena_heap_bytes(), arena_heap_blocks(),
+        arena_heap_mallocs() - mallocs);
+  }
+  printf("%d sessions, %d mismatched\n", nsessions, mismatches);
+
+  ez_session_free(&session);
+  transcript_free(sessions, nsessions);
+  return(mismatches ? 1 : 0);
+}
+
 int main(int argc, char **argv)
 {
   int ifresolve_warned = 0;
@@ -4399,7 +2948,24 @@ int main(int argc, char **argv)
 
   program_name = argv[0];
   options = 0;
+  // getopt may shuffle argv
+  saved_argv = malloc((argc + 1) * sizeof(char *));
+  memcpy(saved_argv, argv, (argc + 1) * sizeof(char *));
+
+  if(argc > 1 && strcmp(argv[1], "ctl") == 0)
+  {
+    if(argc > 3 && strcmp(argv[2], "--socket") == 0)
+    {
+      return(ctl_client(argv[3], argc-4, argv+4));
+    }
+    return(ctl_client(DEFAULT_CTL_SOCKET, argc-2, argv+2));
+  }
+  if(argc > 1 && strcmp(argv[1], "replay") == 0)
+  {
+    return(replay_main(argc-1, argv+1));
+  }
   *user = '\0';
+  ez_session_init(&session, NULL);
   timeout.tv_sec = DEFAULT_TIMEOUT;
   timeout.tv_usec = 0;
   parse_service(DEF_SERVICE);
@@ -4411,6 +2977,9 @@ int main(int argc, char **argv)
   signal(SIGHUP,  generic_sig_handler);
   signal(SIGTERM, generic_sig_handler);
   signal(SIGQUIT, generic_sig_handler);
+  signal(SIGUSR2, generic_sig_handler);
+  // a server (or metrics client) hanging up shows up as a send() error
+  signal(SIGPIPE, SIG_IGN);
 #endif
 
   parse_args(argc, argv);
@@ -4428,11 +2997,10 @@ int main(int argc, char **argv)
   dprintf((stderr, "address: %s\n", address));
   dprintf((stderr, "wildcard: %d\n", wildcard));
   dprintf((stderr, "mx: %s\n", mx));
-  dprintf((stderr, "auth: %s\n", auth));
 
   while(is_in_list("null", service->names))
   {
-    if(service->check_info() != 0)
+    if(client_service()->check_info() != 0)
     {
       fprintf(stderr, "invalid data to perform requested action.\n");
       exit(1);
@@ -4441,11 +3009,11 @@ int main(int argc, char **argv)
 
   if(server == NULL)
   {
-    server = strdup(service->default_server);
+    arena_string(&config_arena, &server, service->default_server);
   }
   if(port == NULL)
   {
-    port = strdup(service->default_port);
+    arena_string(&config_arena, &port, service->default_port);
   }
 
   *user_name = '\0';
@@ -4464,28 +3032,32 @@ int main(int argc, char **argv)
   }
   if(*password == '\0')
   {
-    strncpy(password, getpass("password: "), sizeof(password));
+    snprintf(password, sizeof(password), "%s", getpass("password: "));
   }
-  sprintf(user, "%s:%s", user_name, password);
 
-  base64Encode(user, auth);
+  // keep them out of --record transcripts, the session encodes the
+  // password in these for each update and auth also holds the GNUDIP hash
+  transcript_secret(password);
+  transcript_secret(session.password_url);
+  transcript_secret(session.auth);
 
-  request = strdup(request_over_ride == NULL ? service->default_request : request_over_ride);
+  arena_string(&config_arena, &request, request_over_ride == NULL ?
+      service->default_request : request_over_ride);
   dprintf((stderr, "request: %s\n", request));
 
-  if(service->init != NULL)
+  if(client_service()->init != NULL)
   {
-    service->init();
+    client_service()->init();
   }
 
-  if(service->check_info() != 0)
+  if(client_service()->check_info() != 0)
   {
     fprintf(stderr, "invalid data to perform requested action.\n");
     exit(1);
   }
 
-  if(mx == NULL) { mx = strdup(""); }
-  if(url == NULL) { url = strdup(""); }
+  if(mx == NULL) { arena_string(&config_arena, &mx, ""); }
+  if(url == NULL) { arena_string(&config_arena, &url, ""); }
 
 #ifdef IF_LOOKUP
   if(options & OPT_DAEMON)
@@ -4497,19 +3069,29 @@ int main(int argc, char **argv)
   if(options & OPT_DAEMON)
   {
     int local_update_period = update_period;
+    // how much early this job refreshes, see schedule.c
+    int spread = 0;
+    // started by daemon_upgrade() rather than by hand
+    int resumed = upgrade_resume();
 #if IF_LOOKUP
     struct sockaddr_in sin;
     struct sockaddr_in sin2;
+    struct in6_addr in6;
+    struct in6_addr in6_2;
+    struct debounce bounce;
+    char ipbuf[ADDRESS_TEXT_LEN];
+    int fd;
 
-    if(interface == NULL) 
+    if(interface == NULL && discover_sources() == 0) 
     { 
       fprintf(stderr, "invalid data to perform requested action.\n");
-      fprintf(stderr, "you must provide an interface for daemon mode");
+      fprintf(stderr, "you must provide an interface or discovery sources "
+          "for daemon mode");
       exit(1);
     }
 
     /* background our selves */
-    if(!(options & OPT_FOREGROUND))
+    if(!(options & OPT_FOREGROUND) && !resumed)
     {
 #  if HAVE_SYSLOG_H
       close(0);
@@ -4520,41 +3102,98 @@ int main(int argc, char **argv)
     }
 
 #if HAVE_GETPID
-    if(pid_file && pid_file_create(pid_file) != 0)
+    // the pid doesn't change with an upgrade
+    if(pid_file && !resumed && pid_file_create(pid_file) != 0)
     {
       fprintf(stderr, "exiting...\n");
       exit(1);
     }
 #endif
 
+    if(log_target == NULL)
+    {
+      arena_string(&config_arena, &log_target, (options & OPT_FOREGROUND) ? "stderr" : "syslog");
+    }
+    if(logger_open(log_target, program_name) != 0)
+    {
+      logger_open((options & OPT_FOREGROUND) ? "stderr" : "syslog", program_name);
+      show_message("unable to log to %s, using the default\n", log_target);
+    }
 #  if HAVE_SYSLOG_H
-    openlog(program_name, LOG_PID, LOG_USER );
     options |= OPT_QUIET;
 #  endif
+
+    if(resumed && (fd=upgrade_get_fd("metrics_fd")) != -1)
+    {
+      metrics_adopt(fd);
+    }
+    else if(metrics_port && metrics_listen(metrics_port) != 0)
+    {
+      show_message("unable to serve metrics on port %d: %s\n", metrics_port,
+          error_string);
+    }
+
+    memset(&job, 0, sizeof(job));
+    job.name = strdup(host ? host : interface);
+    if(resumed && ctl_socket && (fd=upgrade_get_fd("ctl_fd")) != -1)
+    {
+      ctl_adopt(fd, ctl_socket, &job, 1, ctl_set_option);
+    }
+    else if(ctl_socket && ctl_listen(ctl_socket, &job, 1, ctl_set_option) != 0)
+    {
+      show_message("unable to listen on control socket %s: %s\n", ctl_socket,
+          error_string);
+    }
+    if(status_file && shm_status_create(status_file, 1) != 0)
+    {
+      show_message("unable to create status file %s: %s\n", status_file,
+          error_string);
+    }
+    if((fd=discover_listen()) != -1)
+    {
+      event_add(fd, gateway_announced, NULL);
+    }
     show_message("ez-ipupdate Version %s, Copyright (C) 1998-2001 Angus Mackay.\n", 
         VERSION);
     show_message("%s started for interface %s host %s using server %s and service %s\n",
-        program_name, N_STR(interface), N_STR(host), server, service->title);
+        program_name, address_from(), N_STR(host), server, service->title);
 
     memset(&sin, 0, sizeof(sin));
+    memset(&in6, 0, sizeof(in6));
+    debounce_init(&bounce, settle_time);
+    change_on_record(write_metrics);
+    if(refresh_spread > 0)
+    {
+      char key[256];
+
+      snprintf(key, sizeof(key), "%s:%s", service->names[0], N_STR(host));
+      spread = sched_spread(key, refresh_spread);
+    }
 
     if(cache_file)
     {
       time_t ipdate;
       char *ipstr;
+      int cached_spread;
 
-      if(read_cache_file(cache_file, &ipdate, &ipstr) == 0)
+      if(read_cache_file(cache_file, &ipdate, &ipstr, &cached_spread) == 0)
       {
+        // keep the place in the window the last run had
+        if(cached_spread >= 0 && cached_spread < refresh_spread)
+        {
+          spread = cached_spread;
+        }
         dprintf((stderr, "cache date: %ld\n", ipdate));
         dprintf((stderr, "cache IP: %s\n", ipstr));
 
-        if(ipstr && strchr(ipstr, '.'))
+        if(ipstr && address_parse(ipstr, &sin.sin_addr, &in6) == 0)
         {
           struct tm *ts;
           char timebuf[64];
 
-          inet_aton(ipstr, &sin.sin_addr);
           last_update = ipdate;
+          job.last_update = ipdate;
+          job_set_address(ipstr);
 
           ts = localtime(&ipdate);
           strftime(timebuf, sizeof(timebuf), "%Y/%m/%d %H:%M", ts);
@@ -4572,6 +3211,18 @@ int main(int argc, char **argv)
             errno == 0 ? "malformed entry" : strerror(errno));
       }
     }
+    note_refresh(spread, 0);
+
+    // sleep out what was left of the old binary's wait
+    if(resumed)
+    {
+      daemon_resume(&sin, &in6, &local_update_period);
+      publish_status();
+      if(job.next_due > time(NULL) && !job.force)
+      {
+        event_wait(job.next_due - time(NULL));
+      }
+    }
 
     for(;;)
     {
@@ -4583,62 +3234,137 @@ int main(int argc, char **argv)
         last_sig = 0;
       }
 #endif
+      if(upgrade_pending)
+      {
+        upgrade_pending = 0;
+        daemon_upgrade(&sin, &in6, local_update_period);
+      }
 
-      if(get_if_addr(sock, interface, &sin2) == 0)
+      metrics_poll();
+      PROBE2(tick, change_id(), event_wakeups());
+      // a new look at the interfaces each tick, shared by every lookup
+      ifsnap_expire();
+      if(get_address(sock, &sin2) == 0)
       {
+        char current[ADDRESS_TEXT_LEN];
+        int changed;
+        int settling = 0;
+        int wait;
+
         ifresolve_warned = 0;
-        if(memcmp(&sin.sin_addr, &sin2.sin_addr, sizeof(struct in_addr)) != 0 || 
-            (max_interval > 0 && time(NULL) - last_update > max_interval))
+        // having no IPv6 address just means not sending one
+        memset(&in6_2, 0, sizeof(in6_2));
+        if(ipv6_policy && interface)
+        {
+          get_if_addr6(interface, ipv6_policy, &in6_2);
+        }
+        // a change to either address goes out in the one update
+        changed = memcmp(&sin.sin_addr, &sin2.sin_addr,
+            sizeof(struct in_addr)) != 0 || memcmp(&in6, &in6_2,
+              sizeof(in6)) != 0;
+        addresses_text(current, sizeof(current), &sin2.sin_addr, &in6_2);
+        // each change gets an id to follow it by, from here to DNS
+        if(changed)
+        {
+          change_detected(current);
+        }
+        // the first update and the retries after a failure don't wait
+        if(sin.sin_addr.s_addr != 0 && !job.force)
+        {
+          char pushed[128];
+
+          addresses_text(pushed, sizeof(pushed), &sin.sin_addr, &in6);
+          switch(debounce_check(&bounce, pushed, current, time(NULL),
+                &settling))
+          {
+            case DEBOUNCE_REVERTED:
+              show_message("address went back to %s, no update needed "
+                  "(%lu suppressed)\n", pushed, bounce.suppressed);
+              change_dropped("reverted");
+              break;
+            case DEBOUNCE_WAIT:
+              changed = 0;
+              break;
+          }
+        }
+        if(settling == 0 && (changed ||
+            sched_refresh_due(last_update, max_interval, spread, time(NULL)) ||
+            job.force) && (!job.paused || job.force))
         {
           int updateres;
+          int avoided;
+          int refreshing = !changed && !job.force;
+
+          // the first update and the max-interval refreshes are the ones a
+          // server would most likely answer "nochg" to, DNS can say so first
+          avoided = dnscheck_enabled() && !job.force &&
+            (!changed || sin.sin_addr.s_addr == 0);
+          job.force = 0;
 
           // save this new ipaddr
           memcpy(&sin, &sin2, sizeof(sin));
+          memcpy(&in6, &in6_2, sizeof(in6));
 
-          // update the address buffer
-          if(address) { free(address); }
-          address = strdup(inet_ntoa(sin.sin_addr));
+          // update the address buffers
+          set_addresses(&sin.sin_addr, &in6);
+          address_text(ipbuf, sizeof(ipbuf), address, address6);
 
-          if((updateres=service->update_entry()) == UPDATERES_OK)
+          if(avoided && already_in_dns())
+          {
+            updateres = EZ_OK;
+            session.nochg = 0;
+            change_dropped("avoided");
+          }
+          else
           {
-            last_update = time(NULL);
+            avoided = 0;
+            updateres = do_update();
+          }
+          job.last_attempt = time(NULL);
+          job.last_result = updateres;
+          if(updateres == EZ_OK)
+          {
+            last_update = sched_acked(time(NULL), session.nochg, max_interval);
             local_update_period = update_period;
+            job.last_update = last_update;
+            job.failures = 0;
+            job_set_address(ipbuf);
+            note_refresh(spread, refreshing && !avoided);
 
-            show_message("successful update for %s->%s (%s)\n",
-                interface, inet_ntoa(sin.sin_addr), N_STR(host));
-
-            if(post_update_cmd)
+            if(avoided)
+            {
+              show_message("%s already points at %s, update skipped\n",
+                  N_STR(host), ipbuf);
+            }
+            else
             {
-              int res;
+              show_message("successful update for %s->%s (%s)\n",
+                  address_from(), ipbuf, N_STR(host));
+            }
 
-              if(post_update_cmd)
+            // the command runs in the background, post_update_done() says
+            // how it went
+            if(post_update_cmd && !avoided)
+            {
+              struct hook_change change;
+
+              change.service = service->names[0];
+              change.host = host;
+              change.interface = interface;
+              change.address = job.address;
+              change.address6 = job.address6;
+              change.when = last_update;
+              if(hook_changed(post_update_cmd, &change, post_update_done,
+                    host) != 0)
               {
-                sprintf(post_update_cmd_arg, "%s", inet_ntoa(sin.sin_addr));
-
-                if((res=exec_cmd(post_update_cmd)) != 0)
-                {
-                  if(res == -1)
-                  {
-                    show_message("(%s) error running post update command: %s\n",
-                        N_STR(host), error_string);
-                  }
-                  else
-                  {
-                    show_message(
-                        "(%s) error running post update command, command exit code: %d\n",
-                        N_STR(host), res);
-                  }
-                }
+                post_update_done(HOOK_FAILED, host);
               }
             }
 
             if(cache_file)
             {
-              char ipbuf[64];
-
-              snprintf(ipbuf, sizeof(ipbuf), "%s", inet_ntoa(sin.sin_addr));
-
-              if(write_cache_file(cache_file, last_update, ipbuf) != 0)
+              if(write_cache_file(cache_file, last_update, ipbuf,
+                    refresh_spread > 0 ? spread : -1) != 0)
               {
                 show_message("unable to write cache file \"%s\": %s\n",
                     cache_file, error_string);
@@ -4648,58 +3374,76 @@ int main(int argc, char **argv)
           else
           {
             show_message("failure to update %s->%s (%s)\n",
-                interface, inet_ntoa(sin.sin_addr), N_STR(host));
+                address_from(), ipbuf, N_STR(host));
             memset(&sin, 0, sizeof(sin));
+            memset(&in6, 0, sizeof(in6));
+            job.failures++;
 
-            // double the time between attempts between each failure to update
-            // this gets set back to the normal value the next time we get a
-            // successful update
-            if(local_update_period < MIN_WAIT_PERIOD)
-            {
-              local_update_period = MIN_WAIT_PERIOD;
-            }
-            else
-            {
-              local_update_period *= 2;
-            }
-            if(local_update_period > MAX_WAIT_PERIOD)
-            {
-              local_update_period = MAX_WAIT_PERIOD;
-            }
-            dprintf((stderr, "local_update_period: %d\n", local_update_period));
+            local_update_period = sched_backoff(local_update_period);
 
             dprintf((stderr, "updateres: %d\n", updateres));
-            if(updateres == UPDATERES_SHUTDOWN)
+            if(updateres == EZ_SHUTDOWN)
             {
               show_message("shuting down updater for %s due to fatal error\n", 
                   N_STR(host));
 
               if(notify_email && *notify_email != '\0')
               {
+                char *argv[] = { SEND_EMAIL_CMD, notify_email, NULL };
                 char buf[1024];
 
                 dprintf((stderr, "sending email to %s\n", notify_email));
-                snprintf(buf, sizeof(buf), "echo \"ez-ipupdate shuting down"
-                    " updater for %s due to fatal error.\" | %s %s", host,
-                    SEND_EMAIL_CMD,
-                    notify_email);
-                system(buf);
+                snprintf(buf, sizeof(buf), "ez-ipupdate shuting down"
+                    " updater for %s due to fatal error.\n", N_STR(host));
+                if(hook_spawn(argv, buf, notify_done, NULL) != 0)
+                {
+                  show_message("unable to run %s: %s\n", SEND_EMAIL_CMD,
+                      error_string);
+                }
               }
               break;
             }
           }
         }
-        sleep(local_update_period);
+        // pick up a period changed from the control socket
+        if(job.failures == 0)
+        {
+          local_update_period = update_period;
+        }
+        wait = local_update_period;
+        // outside sources are asked less often while the address holds
+        if(discover_sources() > 0 && job.failures == 0)
+        {
+          wait = discover_interval(local_update_period, changed);
+        }
+        // look again when a change waiting to settle is due
+        if(settling > 0 && settling < wait)
+        {
+          wait = settling;
+        }
+        job.next_due = time(NULL) + wait;
+        publish_status();
+        event_wait(wait);
       }
       else
       {
         if(!ifresolve_warned)
         {
           ifresolve_warned = 1;
-          show_message("(%s) unable to resolve interface %s\n",
-              N_STR(host), interface);
+          if(discover_sources() > 0)
+          {
+            show_message("(%s) unable to discover the public address: %s\n",
+                N_STR(host), discover_error());
+          }
+          else
+          {
+            show_message("(%s) unable to resolve interface %s\n",
+                N_STR(host), interface);
+          }
         }
-        sleep(resolv_period);
+        job.next_due = time(NULL) + resolv_period;
+        publish_status();
+        event_wait(resolv_period);
       }
     }
 
@@ -4709,6 +3453,13 @@ int main(int argc, char **argv)
       pid_file_delete(pid_file);
     }
 #endif
+    // let the hooks still running finish while there is a log for them
+    hook_drain();
+    ctl_close();
+    discover_close();
+    shm_status_destroy();
+    if(job.name) { free(job.name); }
+    logger_close();
 
 #else
     fprintf(stderr, "sorry, this mode is only available on platforms that the ");
@@ -4721,13 +3472,43 @@ int main(int argc, char **argv)
   {
     int need_update = 1;
 
+    if(address == NULL && discover_sources() > 0)
+    {
+      struct in_addr in;
+
+      if(discover_run(&in) == 0)
+      {
+        arena_string(&config_arena, &address, inet_ntoa(in));
+      }
+      else if(interface == NULL)
+      {
+        fprintf(stderr, "unable to discover the public address: %s\n",
+            discover_error());
+        exit(1);
+      }
+    }
+
+    if(ipv6_policy && address6 == NULL && interface)
+    {
+      struct in6_addr in6;
+      char buf[INET6_ADDRSTRLEN];
+
+      // without one there is just no IPv6 address to send
+      if(get_if_addr6(interface, ipv6_policy, &in6) == 0)
+      {
+        inet_ntop(AF_INET6, &in6, buf, sizeof(buf));
+        arena_string(&config_arena, &address6, buf);
+      }
+    }
+
     if(cache_file)
     {
       time_t ipdate;
       char *ipstr;
-      char ipbuf[64];
+      char ipbuf[ADDRESS_TEXT_LEN];
+      int spread;
 
-      if(read_cache_file(cache_file, &ipdate, &ipstr) != 0)
+      if(read_cache_file(cache_file, &ipdate, &ipstr, &spread) != 0)
       {
         fprintf(stderr, "error reading cache file \"%s\": %s\n", cache_file, 
             errno == 0 ? "malformed entry" : strerror(errno));
@@ -4743,15 +3524,12 @@ int main(int argc, char **argv)
         {
 #ifdef IF_LOOKUP
           struct sockaddr_in sin;
-          int sock;
 
-          sock = socket(AF_INET, SOCK_STREAM, 0);
-          if(get_if_addr(sock, interface, &sin) != 0)
+          if(get_if_addr(-1, interface, &sin) != 0)
           {
             exit(1);
           }
-          close(sock);
-          snprintf(ipbuf, sizeof(ipbuf), "%s", inet_ntoa(sin.sin_addr));
+          address_text(ipbuf, sizeof(ipbuf), inet_ntoa(sin.sin_addr), address6);
 #else
           fprintf(stderr, "interface lookup not enabled at compile time\n");
           exit(1);
@@ -4759,7 +3537,7 @@ int main(int argc, char **argv)
         }
         else
         {
-          snprintf(ipbuf, sizeof(ipbuf), "%s", address);
+          address_text(ipbuf, sizeof(ipbuf), address, address6);
         }
 
         // check for a change in the IP
@@ -4784,47 +3562,78 @@ int main(int argc, char **argv)
 
     if(need_update)
     {
+      int avoided = 0;
       int res;
 
       if(address == NULL && interface != NULL)
       {
         struct sockaddr_in sin;
-        int sock;
 
-        sock = socket(AF_INET, SOCK_STREAM, 0);
-        if(get_if_addr(sock, interface, &sin) == 0)
+        if(get_if_addr(-1, interface, &sin) == 0)
         {
-          if(address) { free(address); }
-          address = strdup(inet_ntoa(sin.sin_addr));
+          arena_string(&config_arena, &address, inet_ntoa(sin.sin_addr));
         }
         else
         {
           show_message("could not resolve ip address for %s.\n", interface);
           exit(1);
         }
-        close(sock);
       }
 
-      for(i=0; i<ntrys; i++)
+      if(dnscheck_enabled() && already_in_dns())
       {
-        if(service->update_entry() == UPDATERES_OK)
+        show_message("%s already points at %s, update skipped\n",
+            N_STR(host), address);
+        avoided = 1;
+        retval = 0;
+      }
+      for(i=0; i<ntrys && !avoided; i++)
+      {
+        if(do_update() == EZ_OK)
         {
           retval = 0;
           break;
         }
         if(i+1 != ntrys) { sleep(10 + 10*i); }
       }
-      if(retval == 0 && post_update_cmd)
+      if(retval == 0 && post_update_cmd && !avoided)
       {
-        if((res=exec_cmd(post_update_cmd)) != 0)
+        char *args[3];
+
+        args[0] = address;
+        args[1] = address6 && *address6 ? address6 : NULL;
+        args[2] = NULL;
+        if(hook_run(post_update_cmd, address ? args : NULL, NULL,
+              oneshot_done, &res) == 0)
+        {
+          // without a timeout nothing kills it, hook_drain() just stops
+          // waiting
+          res = HOOK_RUNNING;
+          hook_drain();
+        }
+        else
+        {
+          res = HOOK_FAILED;
+        }
+        if(res != 0)
         {
           if(!(options & OPT_QUIET))
           {
-            if(res == -1)
+            if(res == HOOK_FAILED)
             {
               fprintf(stderr, "error running post update command: %s\n",
                   error_string);
             }
+            else if(res == HOOK_KILLED)
+            {
+              fprintf(stderr, "post update command killed after running for "
+                  "too long\n");
+            }
+            else if(res == HOOK_RUNNING)
+            {
+              fprintf(stderr, "post update command still running, not "
+                  "waiting for it\n");
+            }
             else
             {
               fprintf(stderr, 
@@ -4838,21 +3647,18 @@ int main(int argc, char **argv)
       // write cache file
       if(retval == 0 && cache_file)
       {
-        char ipbuf[64];
+        char ipbuf[ADDRESS_TEXT_LEN];
 
         if(address == NULL || *address == '\0')
         {
 #ifdef IF_LOOKUP
           struct sockaddr_in sin;
-          int sock;
 
-          sock = socket(AF_INET, SOCK_STREAM, 0);
-          if(get_if_addr(sock, interface, &sin) != 0)
+          if(get_if_addr(-1, interface, &sin) != 0)
           {
             exit(1);
           }
-          close(sock);
-          snprintf(ipbuf, sizeof(ipbuf), "%s", inet_ntoa(sin.sin_addr));
+          address_text(ipbuf, sizeof(ipbuf), inet_ntoa(sin.sin_addr), address6);
 #else
           fprintf(stderr, "interface lookup not enabled at compile time\n");
           exit(1);
@@ -4860,10 +3666,10 @@ int main(int argc, char **argv)
         }
         else
         {
-          snprintf(ipbuf, sizeof(ipbuf), "%s", address);
+          address_text(ipbuf, sizeof(ipbuf), address, address6);
         }
 
-        if(write_cache_file(cache_file, time(NULL), ipbuf) != 0)
+        if(write_cache_file(cache_file, time(NULL), ipbuf, -1) != 0)
         {
           fprintf(stderr, "unable to write cache file \"%s\": %s\n",
               cache_file, error_string);
@@ -4879,20 +3685,13 @@ int main(int argc, char **argv)
 
 #ifdef IF_LOOKUP
   if(sock > 0) { close(sock); }
+  ifsnap_free();
 #endif
 
-  if(address) { free(address); }
-  if(cache_file) { free(cache_file); }
-  if(config_file) { free(config_file); }
-  if(host) { free(host); }
-  if(interface) { free(interface); }
-  if(mx) { free(mx); }
-  if(port) { free(port); }
-  if(request) { free(request); }
-  if(request_over_ride) { free(request_over_ride); }
-  if(server) { free(server); }
-  if(url) { free(url); }
-  if(partner) { free(partner); }
+  transcript_close();
+  ez_session_free(&session);
+  plugin_unload();
+  arena_free(&config_arena);
 
   dprintf((stderr, "done\n"));
   return(retval);
@@ -0,0 +1,1386 @@
+/* ============================================================================
+ * Copyright (C) 2001 Angus Mackay. All rights reserved;
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2, or (at your option)
+ * any later version.
+ *
+ * THIS SOFTWARE IS PROVIDED ``AS IS'' AND ANY EXPRESSED OR IMPLIED WARRANTIES,
+ * INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND
+ * FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE
+ * AUTHOR BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY,
+ * OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ * ============================================================================
+ */
+
+/*
+ * ez-mockserv.c
+ *
+ * a local stand in for the update servers, for testing and benchmarking
+ * ez-ipupdate without touching the real services.  it speaks the http
+ * services (picked by request path), the pgpow and ods line protocols and
+ * the gnudip salt challenge, one protocol per instance.  it can also stand
+ * in for the address discovery sources: any http path that isn't a
+ * service's is a checkip page, and -P stun answers STUN binding requests
+ * over UDP and -P natpmp NAT-PMP external address requests.  they report
+ * the client's address, or the first of the ones given with -A.  with -N
+ * the natpmp stand in moves on to the next of them every so often and
+ * announces it, as a gateway does when its address changes.
+ *
+ * the answer to each connection comes from a script that is cycled through
+ * by all the workers together:
+ *
+ *   good       the update worked
+ *   nochg      the update worked but nothing changed
+ *   badauth    the credentials were refused
+ *   w30m       come back in 30 minutes
+ *   302        redirect somewhere else (http only, good elsewhere)
+ *   truncated  the connection drops half way through the reply
+ *   reset      the connection is reset instead of answered
+ *
+ * with -u, wrong credentials always get badauth.  every connection is
+ * logged as one key=value line.
+ *
+ * usage: ez-mockserv [-p port] [-b address] [-P http|pgpow|ods|gnudip|stun]
+ *          [-A address,...] [-N sec[@address]] [-s script] [-u user:pass] [-l ms] [-j ms] [-r percent]
+ *          [-D bytes:ms] [-w workers] [-o logfile | -q]
+ *
+ */
+
+#ifdef HAVE_CONFIG_H
+#  include <config.h>
+#endif
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <time.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <signal.h>
+#include <sys/types.h>
+#include <sys/time.h>
+#include <sys/wait.h>
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <arpa/inet.h>
+#if HAVE_MMAP
+#  include <sys/mman.h>
+#endif
+
+#include <md5.h>
+#include <encode.h>
+
+#define DEFAULT_PORT 8245
+#define MAX_WORKERS 256
+#define MAX_SCRIPT 64
+#define REQUEST_SIZE 4096
+#define REPLY_SIZE 2048
+#define READ_TIMEOUT 10
+
+enum {
+  PROTO_HTTP,
+  PROTO_PGPOW,
+  PROTO_ODS,
+  PROTO_GNUDIP,
+  PROTO_STUN,
+  PROTO_NATPMP,
+};
+
+static char *proto_names[] = { "http", "pgpow", "ods", "gnudip", "stun",
+  "natpmp", NULL };
+
+enum {
+  OUT_GOOD,
+  OUT_NOCHG,
+  OUT_BADAUTH,
+  OUT_WAIT,
+  OUT_REDIRECT,
+  OUT_TRUNCATED,
+  OUT_RESET,
+};
+
+static char *outcome_names[] = { "good", "nochg", "badauth", "w30m", "302",
+  "truncated", "reset", NULL };
+
+/*
+ * what each http service answers.  the replies are "<status> <body>" with
+ * %s standing for the address, except that a 302 is followed by the path
+ * to redirect to.  the first entry whose path (and query word, if any)
+ * matches the request is used.
+ */
+struct http_service
+{
+  char *name;
+  char *path;
+  char *query;
+  char *good;
+  char *nochg;
+  char *badauth;
+  char *wait;
+};
+
+static struct http_service http_services[] = {
+  { "ezip", "/members/update/", NULL,
+    "200 ok %s\n", "200 ok %s\n", "401 ", "503 " },
+  { "dhs", "/nic/hosts", NULL,
+    "200 updated %s\n", "200 updated %s\n", "401 ", "503 " },
+  { "dyndns", "/nic/update", NULL,
+    "200 good %s\n", "200 nochg %s\n", "200 badauth\n",
+    "200 w30m too many updates, slow down\n" },
+  { "tzo", "/webclient/signedon.html", NULL,
+    "200 updated %s\n", "200 updated %s\n", "302 /invkey.htm", "503 " },
+  { "easydns-partner", "/dyn/ez-ipupdate.php", "partner=",
+    "200 OK\n", "200 OK\n", "401 ", "503 " },
+  { "easydns", "/dyn/ez-ipupdate.php", NULL,
+    "200 NOERROR\n", "200 NOERROR\n", "401 ", "503 " },
+  { "justlinux", "/bin/controlpanel/dyndns/jlc.pl", NULL,
+    "200 address set to %s\n", "200 address set to %s\n", "401 ", "503 " },
+  { "dyns", "/postscript.php", NULL,
+    "200 200 Host updated to %s\n", "200 200 Host unchanged\n",
+    "200 401 User authentication failed\n", "503 " },
+  { "hn", "/vanity/update", NULL,
+    "200 DDNS_Response_Code=101\n", "200 DDNS_Response_Code=101\n", "401 ",
+    "200 DDNS_Response_Code=201\n" },
+  { "zoneedit", "/auth/dynamic.html", NULL,
+    "200 <SUCCESS CODE=\"200\" TEXT=\"updated to %s\">\n",
+    "200 <SUCCESS CODE=\"201\" TEXT=\"no update required\">\n", "401 ",
+    "503 " },
+  { "heipv6tb", "/index.cgi", NULL,
+    "200 tunnel endpoint is %s\n", "200 tunnel endpoint is %s\n", "401 ",
+    "503 " },
+  // anything else
+  { "checkip", NULL, NULL,
+    "200 Current IP Address: %s\n", "200 Current IP Address: %s\n", "401 ",
+    "503 " },
+  { NULL, NULL, NULL, NULL, NULL, NULL, NULL }
+};
+
+static int proto = PROTO_HTTP;
+static int script[MAX_SCRIPT];
+static int nscript = 0;
+static char *credentials = NULL;
+// the addresses the discovery stand ins report, in turn
+static char *mapped[MAX_SCRIPT];
+static int nmapped = 0;
+static int mapped_pos = 0;
+// seconds between natpmp announcements and where they go
+static int announce_secs = 0;
+static char *announce_to = "224.0.0.1";
+static int latency = 0;
+static int jitter = 0;
+static int reset_percent = 0;
+static int drip_bytes = 0;
+static int drip_ms = 0;
+static int log_fd = 2;
+
+// shared by the workers so they walk the script together
+static unsigned long *script_pos = NULL;
+static unsigned long local_pos = 0;
+
+static volatile sig_atomic_t done = 0;
+
+static void handle_sig(int sig)
+{
+  done = 1;
+}
+
+static void sleep_ms(int ms)
+{
+  struct timeval tv;
+
+  if(ms <= 0)
+  {
+    return;
+  }
+  tv.tv_sec = ms / 1000;
+  tv.tv_usec = (ms % 1000) * 1000;
+  select(0, NULL, NULL, NULL, &tv);
+}
+
+static long elapsed_ms(struct timeval *start)
+{
+  struct timeval now;
+
+  gettimeofday(&now, NULL);
+  return((now.tv_sec - start->tv_sec) * 1000 +
+      (now.tv_usec - start->tv_usec) / 1000);
+}
+
+static int lookup(char **names, const char *name)
+{
+  int i;
+
+  for(i=0; names[i] != NULL; i++)
+  {
+    if(strcmp(names[i], name) == 0)
+    {
+      return(i);
+    }
+  }
+  return(-1);
+}
+
+static int parse_script(char *arg)
+{
+  char *p;
+  int n;
+
+  nscript = 0;
+  for(p=strtok(arg, ","); p != NULL; p=strtok(NULL, ","))
+  {
+    if(nscript == MAX_SCRIPT || (n=lookup(outcome_names, p)) < 0)
+    {
+      return(-1);
+    }
+    script[nscript++] = n;
+  }
+  return(nscript > 0 ? 0 : -1);
+}
+
+static int next_outcome(void)
+{
+  unsigned long pos;
+
+  if(script_pos != NULL)
+  {
+    pos = __sync_fetch_and_add(script_pos, 1);
+  }
+  else
+  {
+    pos = local_pos++;
+  }
+  if(reset_percent > 0 && rand() % 100 < reset_percent)
+  {
+    return(OUT_RESET);
+  }
+  return(script[pos % nscript]);
+}
+
+/*
+ * write the whole buffer, a few bytes at a time if we are dripping.
+ * returns how much got written before any error.
+ */
+static int send_all(int fd, const char *buf, int len)
+{
+  int chunk;
+  int n;
+  int sent = 0;
+
+  while(sent < len)
+  {
+    chunk = len - sent;
+    if(drip_bytes > 0 && chunk > drip_bytes)
+    {
+      chunk = drip_bytes;
+    }
+    if((n=write(fd, buf + sent, chunk)) < 0)
+    {
+      if(errno == EINTR)
+      {
+        continue;
+      }
+      break;
+    }
+    sent += n;
+    if(drip_bytes > 0 && sent < len)
+    {
+      sleep_ms(drip_ms);
+    }
+  }
+  return(sent);
+}
+
+static void reset_conn(int fd)
+{
+  struct linger l;
+
+  l.l_onoff = 1;
+  l.l_linger = 0;
+  setsockopt(fd, SOL_SOCKET, SO_LINGER, &l, sizeof(l));
+}
+
+/*
+ * read one '\n' terminated line, returns its length without the line end
+ */
+static int read_line(int fd, char *buf, int size)
+{
+  int len = 0;
+  int n;
+  char c;
+
+  while(len < size - 1)
+  {
+    if((n=read(fd, &c, 1)) <= 0)
+    {
+      if(n < 0 && errno == EINTR)
+      {
+        continue;
+      }
+      return(len > 0 ? len : -1);
+    }
+    if(c == '\n')
+    {
+      break;
+    }
+    buf[len++] = c;
+  }
+  if(len > 0 && buf[len-1] == '\r')
+  {
+    len--;
+  }
+  buf[len] = '\0';
+  return(len);
+}
+
+/*
+ * the credentials given with -u, split at the colon
+ */
+static void split_credentials(char *user, char *pass, int size)
+{
+  char *p;
+
+  *user = *pass = '\0';
+  if(credentials == NULL)
+  {
+    return;
+  }
+  snprintf(user, size, "%s", credentials);
+  if((p=strchr(user, ':')) != NULL)
+  {
+    *p = '\0';
+    snprintf(pass, size, "%s", p + 1);
+  }
+}
+
+/*
+ * find name=value in a query string or form body
+ */
+static int get_param(const char *query, const char *name, char *out, int size)
+{
+  const char *p = query;
+  int nlen = strlen(name);
+  int len;
+
+  while(p != NULL && *p != '\0')
+  {
+    if(strncmp(p, name, nlen) == 0 && p[nlen] == '=')
+    {
+      p += nlen + 1;
+      len = strcspn(p, "& \r\n");
+      if(len >= size)
+      {
+        len = size - 1;
+      }
+      memcpy(out, p, len);
+      out[len] = '\0';
+      return(0);
+    }
+    if((p=strchr(p, '&')) != NULL)
+    {
+      p++;
+    }
+  }
+  return(-1);
+}
+
+/*
+ * check the -u credentials against basic auth, or against the password
+ * parameter of the services that put it in the query
+ */
+static int http_authorized(char *headers, char *query)
+{
+  char user[256];
+  char pass[256];
+  char given[520];
+  char token[BASE64_ENCODED_LEN(512)];
+  char expect[BASE64_ENCODED_LEN(512)];
+  char *p;
+
+  split_credentials(user, pass, sizeof(user));
+  if((p=strstr(headers, "\nAuthorization: Basic ")) != NULL &&
+      sscanf(p, "\nAuthorization: Basic %699s", token) == 1)
+  {
+    snprintf(given, sizeof(given), "%s:%s", user, pass);
+    base64_encode(given, strlen(given), expect, sizeof(expect));
+    if(strcmp(token, expect) == 0)
+    {
+      return(1);
+    }
+  }
+  if((get_param(query, "password", given, sizeof(given)) == 0 ||
+        get_param(query, "TZOKey", given, sizeof(given)) == 0 ||
+        get_param(query, "auth", given, sizeof(given)) == 0) &&
+      strcmp(given, pass) == 0)
+  {
+    return(1);
+  }
+  return(0);
+}
+
+static char *status_text(int status)
+{
+  switch(status)
+  {
+    case 200: return("OK");
+    case 302: return("Found");
+    case 400: return("Bad Request");
+    case 401: return("Unauthorized");
+    case 404: return("Not Found");
+    case 503: return("Service Unavailable");
+  }
+  return("Error");
+}
+
+/*
+ * build the full http response for a service and outcome
+ */
+static int http_reply(struct http_service *svc, int outcome, char *addr,
+    char *host, char *reply, int size, int *status)
+{
+  char body[REPLY_SIZE];
+  char extra[512];
+  char *fmt;
+  char *p;
+
+  *extra = '\0';
+  if(svc == NULL)
+  {
+    fmt = "404 ";
+  }
+  else
+  {
+    switch(outcome)
+    {
+      case OUT_NOCHG: fmt = svc->nochg; break;
+      case OUT_BADAUTH: fmt = svc->badauth; break;
+      case OUT_WAIT: fmt = svc->wait; break;
+      case OUT_REDIRECT: fmt = "302 /moved.html"; break;
+      default: fmt = svc->good; break;
+    }
+  }
+  *status = atoi(fmt);
+  for(p=fmt; *p != '\0' && *p != ' '; p++);
+  if(*p == ' ') { p++; }
+
+  *body = '\0';
+  if(*status == 302)
+  {
+    snprintf(extra, sizeof(extra), "Location: http://%s%s\r\n", host, p);
+  }
+  else if(*status == 200)
+  {
+    snprintf(body, sizeof(body), p, addr);
+  }
+  else
+  {
+    snprintf(body, sizeof(body), "%d %s\n", *status, status_text(*status));
+    if(*status == 401)
+    {
+      snprintf(extra, sizeof(extra),
+          "WWW-Authenticate: Basic realm=\"ez-mockserv\"\r\n");
+    }
+    else if(*status == 503)
+    {
+      snprintf(extra, sizeof(extra), "Retry-After: 1800\r\n");
+    }
+  }
+
+  return(snprintf(reply, size, "HTTP/1.0 %d %s\r\n"
+        "Server: ez-mockserv\r\n"
+        "Content-Type: text/plain\r\n"
+        "Content-Length: %d\r\n"
+        "%s"
+        "\r\n"
+        "%s", *status, status_text(*status), (int)strlen(body), extra, body));
+}
+
+/*
+ * the serve_ functions answer one connection and return the outcome that
+ * was actually used, which credential checks may have turned to badauth
+ */
+
+static int serve_http(int fd, int outcome, char *peer, char *service,
+    char *req, int *status, int *bytes_in, int *bytes_out)
+{
+  struct http_service *svc;
+  char buf[REQUEST_SIZE+1];
+  char reply[REPLY_SIZE*2];
+  char addr[64];
+  char host[256];
+  char *path;
+  char *headers;
+  char *query;
+  char *body;
+  char *p;
+  int content_length = 0;
+  int len = 0;
+  int n;
+
+  // read the headers and whatever body they promise
+  buf[0] = '\0';
+  while(len < REQUEST_SIZE)
+  {
+    if((n=read(fd, buf + len, REQUEST_SIZE - len)) <= 0)
+    {
+      if(n < 0 && errno == EINTR)
+      {
+        continue;
+      }
+      break;
+    }
+    len += n;
+    buf[len] = '\0';
+    if((body=strstr(buf, "\r\n\r\n")) != NULL)
+    {
+      body += 4;
+      if((p=strstr(buf, "\nContent-length:")) != NULL ||
+          (p=strstr(buf, "\nContent-Length:")) != NULL)
+      {
+        content_length = atoi(p + 16);
+      }
+      if(len - (body - buf) >= content_length)
+      {
+        break;
+      }
+    }
+  }
+  *bytes_in = len;
+  if((body=strstr(buf, "\r\n\r\n")) == NULL)
+  {
+    *status = 400;
+    snprintf(req, 256, "-");
+    n = snprintf(reply, sizeof(reply), "HTTP/1.0 400 Bad Request\r\n\r\n");
+    *bytes_out = send_all(fd, reply, n);
+    return(outcome);
+  }
+  *body = '\0';
+  body += 4;
+
+  // request line
+  path = strchr(buf, ' ');
+  path = path ? path + 1 : buf;
+  path[strcspn(path, " \r\n")] = '\0';
+  headers = path + strlen(path) + 1;
+  // the query can hold passwords, so only the path is logged
+  snprintf(req, 256, "%.*s", (int)strcspn(path, "?"), path);
+  if((query=strchr(path, '?')) != NULL)
+  {
+    *query++ = '\0';
+  }
+  else
+  {
+    query = body;
+  }
+
+  svc = http_services;
+  for(; svc->name != NULL; svc++)
+  {
+    if((svc->path == NULL || strcmp(svc->path, path) == 0) &&
+        (svc->query == NULL || strstr(query, svc->query) != NULL))
+    {
+      break;
+    }
+  }
+  if(svc->name == NULL)
+  {
+    svc = NULL;
+  }
+  snprintf(service, 32, "%s", svc ? svc->name : "-");
+
+  if(get_param(query, "myip", addr, sizeof(addr)) != 0 &&
+      get_param(query, "ip", addr, sizeof(addr)) != 0 &&
+      get_param(query, "ipaddress", addr, sizeof(addr)) != 0 &&
+      get_param(query, "IPAddress", addr, sizeof(addr)) != 0 &&
+      get_param(query, "ipv4b", addr, sizeof(addr)) != 0)
+  {
+    snprintf(addr, sizeof(addr), "%s", nmapped ? mapped[mapped_pos] : peer);
+  }
+  *host = '\0';
+  if((p=strstr(headers, "\nHost: ")) != NULL)
+  {
+    sscanf(p, "\nHost: %255[^\r\n]", host);
+  }
+
+  if(credentials != NULL && outcome != OUT_RESET &&
+      outcome != OUT_TRUNCATED && !http_authorized(headers, query))
+  {
+    outcome = OUT_BADAUTH;
+  }
+
+  if(outcome == OUT_RESET)
+  {
+    *status = 0;
+    reset_conn(fd);
+    return(outcome);
+  }
+
+  sleep_ms(latency + (jitter > 0 ? rand() % (jitter + 1) : 0));
+
+  n = http_reply(svc, outcome, addr, *host ? host : "localhost", reply,
+      sizeof(reply), status);
+  if(n >= sizeof(reply))
+  {
+    n = sizeof(reply) - 1;
+  }
+  if(outcome == OUT_TRUNCATED)
+  {
+    n /= 2;
+  }
+  *bytes_out = send_all(fd, reply, n);
+
+  return(outcome);
+}
+
+/*
+ * send one line of a line protocol, or half of it if we are truncating.
+ * returns -1 once the connection should end.
+ */
+static int send_line(int fd, int outcome, char *line, int *bytes_out)
+{
+  int len = strlen(line);
+  int n;
+
+  if(outcome == OUT_TRUNCATED)
+  {
+    *bytes_out += send_all(fd, line, len / 2);
+    return(-1);
+  }
+  n = send_all(fd, line, len);
+  *bytes_out += n;
+  return(n == len ? 0 : -1);
+}
+
+static int serve_pgpow(int fd, int outcome, char *req, int *status,
+    int *bytes_in, int *bytes_out)
+{
+  char buf[REQUEST_SIZE];
+  char user[256];
+  char pass[256];
+  char *reply;
+  int n;
+
+  split_credentials(user, pass, sizeof(user));
+  snprintf(req, 256, "-");
+  if(send_line(fd, outcome, "OK ez-mockserv pgpow\r\n", bytes_out) != 0)
+  {
+    return(outcome);
+  }
+
+  while((n=read_line(fd, buf, sizeof(buf))) >= 0)
+  {
+    *bytes_in += n + 2;
+    reply = "OK\r\n";
+    if(strncmp(buf, "USER ", 5) == 0)
+    {
+      if(credentials != NULL && strcmp(buf + 5, user) != 0)
+      {
+        outcome = OUT_BADAUTH;
+      }
+    }
+    else if(strncmp(buf, "PASS ", 5) == 0)
+    {
+      if(credentials != NULL && strcmp(buf + 5, pass) != 0)
+      {
+        outcome = OUT_BADAUTH;
+      }
+      if(outcome == OUT_BADAUTH)
+      {
+        reply = "ERR invalid login\r\n";
+      }
+      else if(outcome == OUT_WAIT)
+      {
+        reply = "ERR too many updates, wait 30 minutes\r\n";
+      }
+    }
+    else if(strncmp(buf, "HOST ", 5) == 0)
+    {
+      snprintf(req, 256, "%.255s", buf + 5);
+    }
+    else if(strcmp(buf, "DONE") == 0)
+    {
+      send_line(fd, OUT_GOOD, reply, bytes_out);
+      break;
+    }
+    *status = (*reply == 'O') ? 200 : 400;
+    if(send_line(fd, OUT_GOOD, reply, bytes_out) != 0 || *reply != 'O')
+    {
+      break;
+    }
+  }
+
+  return(outcome);
+}
+
+static int serve_ods(int fd, int outcome, char *req, int *status,
+    int *bytes_in, int *bytes_out)
+{
+  char buf[REQUEST_SIZE];
+  char user[256];
+  char pass[256];
+  char luser[256];
+  char lpass[256];
+  char *reply;
+  int n;
+
+  split_credentials(user, pass, sizeof(user));
+  snprintf(req, 256, "-");
+  if(send_line(fd, outcome, "100 ez-mockserv ods ready\r\n", bytes_out) != 0)
+  {
+    return(outcome);
+  }
+
+  while((n=read_line(fd, buf, sizeof(buf))) >= 0)
+  {
+    *bytes_in += n + 1;
+    if(strncmp(buf, "LOGIN ", 6) == 0)
+    {
+      *luser = *lpass = '\0';
+      sscanf(buf, "LOGIN %255s %255s", luser, lpass);
+      if(credentials != NULL && (strcmp(luser, user) || strcmp(lpass, pass)))
+      {
+        outcome = OUT_BADAUTH;
+      }
+      if(outcome == OUT_BADAUTH)
+      {
+        reply = "227 invalid login\r\n";
+      }
+      else if(outcome == OUT_WAIT)
+      {
+        reply = "300 too many updates, wait 30 minutes\r\n";
+      }
+      else
+      {
+        reply = "225 login ok\r\n";
+      }
+    }
+    else if(strncmp(buf, "DELRR ", 6) == 0)
+    {
+      snprintf(req, 256, "%.*s", (int)strcspn(buf + 6, " "), buf + 6);
+      reply = "901 rr deleted\r\n";
+    }
+    else if(strncmp(buf, "ADDRR ", 6) == 0)
+    {
+      reply = outcome == OUT_NOCHG ? "796 rr unchanged\r\n" :
+        "795 rr added\r\n";
+    }
+    else
+    {
+      reply = "500 unknown command\r\n";
+    }
+    *status = atoi(reply);
+    if(send_line(fd, OUT_GOOD, reply, bytes_out) != 0 ||
+        *status == 227 || *status == 300 || *status == 795 ||
+        *status == 796)
+    {
+      break;
+    }
+  }
+
+  return(outcome);
+}
+
+static int serve_gnudip(int fd, int outcome, char *req, int *status,
+    int *bytes_in, int *bytes_out)
+{
+  char buf[REQUEST_SIZE];
+  char salt[16];
+  char user[256];
+  char pass[256];
+  char fuser[256];
+  char fhash[256];
+  char fdomain[256];
+  char freq[8];
+  char reply[16];
+  int n;
+  int i;
+#ifdef USE_MD5
+  unsigned char digest[16];
+  char hash[128];
+  char *p;
+#endif
+
+  for(i=0; i<10; i++)
+  {
+    salt[i] = 'a' + rand() % 26;
+  }
+  salt[i++] = '\n';
+  salt[i] = '\0';
+  snprintf(req, 256, "-");
+  if(send_line(fd, outcome, salt, bytes_out) != 0)
+  {
+    return(outcome);
+  }
+  salt[10] = '\0';
+
+  if((n=read_line(fd, buf, sizeof(buf))) < 0)
+  {
+    return(outcome);
+  }
+  *bytes_in += n + 1;
+
+  *fuser = *fhash = *fdomain = *freq = '\0';
+  sscanf(buf, "%255[^:]:%255[^:]:%255[^:]:%7s", fuser, fhash, fdomain, freq);
+  snprintf(req, 256, "%s", fdomain);
+
+  if(credentials != NULL)
+  {
+    split_credentials(user, pass, sizeof(user));
+    if(strcmp(fuser, user) != 0)
+    {
+      outcome = OUT_BADAUTH;
+    }
+#ifdef USE_MD5
+    // md5(md5(pass) "." salt), both as lower case hex
+    md5_buffer(pass, strlen(pass), digest);
+    for(i=0, p=hash; i<16; i++, p+=2)
+    {
+      sprintf(p, "%02x", digest[i]);
+    }
+    strcat(hash, ".");
+    strcat(hash, salt);
+    md5_buffer(hash, strlen(hash), digest);
+    for(i=0, p=hash; i<16; i++, p+=2)
+    {
+      sprintf(p, "%02x", digest[i]);
+    }
+    if(strcmp(hash, fhash) != 0)
+    {
+      outcome = OUT_BADAUTH;
+    }
+#endif
+  }
+
+  // 0 updated, 1 bad login, 2 offline request done
+  i = outcome == OUT_BADAUTH ? 1 : strcmp(freq, "1") == 0 ? 2 : 0;
+  *status = i;
+  snprintf(reply, sizeof(reply), "%d\n", i);
+  send_line(fd, OUT_GOOD, reply, bytes_out);
+
+  return(outcome);
+}
+
+static void log_request(char *peer, char *service, char *req, int outcome,
+    int status, int bytes_in, int bytes_out, long ms)
+{
+  char line[1024];
+  char ts[32];
+  time_t now = time(NULL);
+  int len;
+
+  if(log_fd < 0)
+  {
+    return;
+  }
+  strftime(ts, sizeof(ts), "%Y-%m-%dT%H:%M:%S", localtime(&now));
+  len = snprintf(line, sizeof(line), "ts=%s pid=%d peer=%s proto=%s "
+      "service=%s req=%s outcome=%s status=%d in=%d out=%d ms=%ld\n",
+      ts, (int)getpid(), peer, proto_names[proto], service, req,
+      outcome_names[outcome], status, bytes_in, bytes_out, ms);
+  if(len >= sizeof(line))
+  {
+    len = sizeof(line) - 1;
+  }
+  // one write per line so the workers' lines never interleave
+  write(log_fd, line, len);
+}
+
+static void serve(int fd, struct sockaddr_in *from)
+{
+  struct timeval start;
+  struct timeval tv;
+  char peer[64];
+  char service[32];
+  char req[256];
+  int outcome;
+  int status = 0;
+  int bytes_in = 0;
+  int bytes_out = 0;
+
+  gettimeofday(&start, NULL);
+  tv.tv_sec = READ_TIMEOUT;
+  tv.tv_usec = 0;
+  setsockopt(fd, SOL_SOCKET, SO_RCVTIMEO, &tv, sizeof(tv));
+
+  snprintf(peer, sizeof(peer), "%s", inet_ntoa(from->sin_addr));
+  snprintf(service, sizeof(service), "%s", proto_names[proto]);
+  snprintf(req, sizeof(req), "-");
+  outcome = next_outcome();
+
+  if(proto == PROTO_HTTP)
+  {
+    outcome = serve_http(fd, outcome, peer, service, req, &status,
+        &bytes_in, &bytes_out);
+  }
+  else if(outcome == OUT_RESET)
+  {
+    reset_conn(fd);
+  }
+  else
+  {
+    sleep_ms(latency + (jitter > 0 ? rand() % (jitter + 1) : 0));
+    switch(proto)
+    {
+      case PROTO_PGPOW:
+        outcome = serve_pgpow(fd, outcome, req, &status, &bytes_in,
+            &bytes_out);
+        break;
+      case PROTO_ODS:
+        outcome = serve_ods(fd, outcome, req, &status, &bytes_in,
+            &bytes_out);
+        break;
+      case PROTO_GNUDIP:
+        outcome = serve_gnudip(fd, outcome, req, &status, &bytes_in,
+            &bytes_out);
+        break;
+    }
+  }
+  close(fd);
+
+  log_request(peer, service, req, outcome, status, bytes_in, bytes_out,
+      elapsed_ms(&start));
+}
+
+/*
+ * answer the STUN binding requests that come in on sock, with the
+ * address in a XOR-MAPPED-ADDRESS.  reset and truncated drop the request.
+ */
+static void stun_worker(int sock)
+{
+  struct sockaddr_in from;
+  struct timeval start;
+  socklen_t fromlen;
+  unsigned char buf[REQUEST_SIZE];
+  unsigned char reply[32];
+  struct in_addr addr;
+  unsigned long a;
+  char peer[64];
+  int outcome;
+  int status;
+  int out;
+  int n;
+
+  for(;;)
+  {
+    fromlen = sizeof(from);
+    if((n=recvfrom(sock, buf, sizeof(buf), 0, (struct sockaddr *)&from,
+            &fromlen)) < 0)
+    {
+      if(errno == EINTR)
+      {
+        continue;
+      }
+      perror("recvfrom");
+      _exit(1);
+    }
+    gettimeofday(&start, NULL);
+    snprintf(peer, sizeof(peer), "%s", inet_ntoa(from.sin_addr));
+    // a binding request with the magic cookie
+    if(n < 20 || buf[0] != 0x00 || buf[1] != 0x01 || buf[4] != 0x21 ||
+        buf[5] != 0x12 || buf[6] != 0xa4 || buf[7] != 0x42)
+    {
+      log_request(peer, "stun", "-", OUT_GOOD, 400, n, 0,
+          elapsed_ms(&start));
+      continue;
+    }
+
+    outcome = next_outcome();
+    status = 0;
+    out = 0;
+    if(outcome != OUT_RESET && outcome != OUT_TRUNCATED)
+    {
+      if(nmapped == 0 || inet_aton(mapped[mapped_pos], &addr) == 0)
+      {
+        addr = from.sin_addr;
+      }
+      a = ntohl(addr.s_addr) ^ 0x2112a442;
+      memcpy(reply, buf, 20);
+      reply[0] = 0x01;
+      reply[1] = 0x01;
+      reply[2] = 0;
+      reply[3] = 12;
+      reply[20] = 0x00;
+      reply[21] = 0x20;
+      reply[22] = 0;
+      reply[23] = 8;
+      reply[24] = 0;
+      reply[25] = 0x01;
+      reply[26] = ((ntohs(from.sin_port) >> 8) & 0xff) ^ 0x21;
+      reply[27] = (ntohs(from.sin_port) & 0xff) ^ 0x12;
+      reply[28] = a >> 24;
+      reply[29] = (a >> 16) & 0xff;
+      reply[30] = (a >> 8) & 0xff;
+      reply[31] = a & 0xff;
+      sleep_ms(latency + (jitter > 0 ? rand() % (jitter + 1) : 0));
+      out = sendto(sock, reply, sizeof(reply), 0, (struct sockaddr *)&from,
+          fromlen);
+      status = 200;
+    }
+    log_request(peer, "stun", "binding", outcome, status, n, out,
+        elapsed_ms(&start));
+  }
+}
+
+/* a NAT-PMP external address answer, result 0 or an error code */
+static int natpmp_reply(unsigned char *reply, int result, time_t started,
+    struct in_addr *from)
+{
+  struct in_addr addr;
+  unsigned long secs = time(NULL) - started;
+  unsigned long a;
+
+  if(nmapped == 0 || inet_aton(mapped[mapped_pos], &addr) == 0)
+  {
+    addr = *from;
+  }
+  a = ntohl(addr.s_addr);
+  reply[0] = 0;
+  reply[1] = 128;
+  reply[2] = result >> 8;
+  reply[3] = result & 0xff;
+  reply[4] = secs >> 24;
+  reply[5] = (secs >> 16) & 0xff;
+  reply[6] = (secs >> 8) & 0xff;
+  reply[7] = secs & 0xff;
+  reply[8] = a >> 24;
+  reply[9] = (a >> 16) & 0xff;
+  reply[10] = (a >> 8) & 0xff;
+  reply[11] = a & 0xff;
+  return(12);
+}
+
+/*
+ * answer NAT-PMP external address requests on sock and, with -N, move on
+ * to the next -A address every announce_secs and announce it.  badauth
+ * answers with result 2 (not authorized), reset and truncated drop the
+ * request.
+ */
+static void natpmp_worker(int sock)
+{
+  struct sockaddr_in from;
+  struct sockaddr_in to;
+  struct timeval start;
+  struct timeval tv;
+  socklen_t fromlen;
+  unsigned char buf[REQUEST_SIZE];
+  unsigned char reply[16];
+  time_t started = time(NULL);
+  time_t next_announce = started + announce_secs;
+  fd_set readfds;
+  char peer[64];
+  int outcome;
+  int status;
+  int out;
+  int n;
+
+  memset(&to, 0, sizeof(to));
+  to.sin_family = AF_INET;
+  to.sin_port = htons(5350);
+  inet_aton(announce_to, &to.sin_addr);
+
+  for(;;)
+  {
+    FD_ZERO(&readfds);
+    FD_SET(sock, &readfds);
+    tv.tv_sec = announce_secs > 0 ? next_announce - time(NULL) : 60;
+    tv.tv_usec = 0;
+    if(tv.tv_sec < 0) { tv.tv_sec = 0; }
+    if((n=select(sock + 1, &readfds, NULL, NULL, &tv)) == 0)
+    {
+      if(announce_secs > 0 && time(NULL) >= next_announce)
+      {
+        if(nmapped > 0)
+        {
+          mapped_pos = (mapped_pos + 1) % nmapped;
+        }
+        n = natpmp_reply(reply, 0, started, &to.sin_addr);
+        out = sendto(sock, reply, n, 0, (struct sockaddr *)&to, sizeof(to));
+        log_request(announce_to, "natpmp", "announce", OUT_GOOD,
+            out == n ? 200 : 0, 0, out > 0 ? out : 0, 0);
+        next_announce = time(NULL) + announce_secs;
+      }
+      continue;
+    }
+    if(n < 0)
+    {
+      continue;
+    }
+
+    fromlen = sizeof(from);
+    if((n=recvfrom(sock, buf, sizeof(buf), 0, (struct sockaddr *)&from,
+            &fromlen)) < 0)
+    {
+      continue;
+    }
+    gettimeofday(&start, NULL);
+    snprintf(peer, sizeof(peer), "%s", inet_ntoa(from.sin_addr));
+    if(n < 2 || buf[0] != 0 || buf[1] != 0)
+    {
+      log_request(peer, "natpmp", "-", OUT_GOOD, 400, n, 0,
+          elapsed_ms(&start));
+      continue;
+    }
+
+    outcome = next_outcome();
+    status = 0;
+    out = 0;
+    if(outcome != OUT_RESET && outcome != OUT_TRUNCATED)
+    {
+      status = outcome == OUT_BADAUTH ? 401 : 200;
+      n = natpmp_reply(reply, outcome == OUT_BADAUTH ? 2 : 0, started,
+          &from.sin_addr);
+      sleep_ms(latency + (jitter > 0 ? rand() % (jitter + 1) : 0));
+      out = sendto(sock, reply, n, 0, (struct sockaddr *)&from, fromlen);
+    }
+    log_request(peer, "natpmp", "address", outcome, status, 2, out,
+        elapsed_ms(&start));
+  }
+}
+
+static void worker(int sock)
+{
+  struct sockaddr_in from;
+  socklen_t fromlen;
+  int fd;
+
+  signal(SIGINT, SIG_DFL);
+  signal(SIGTERM, SIG_DFL);
+  srand(getpid() ^ time(NULL));
+
+  if(proto == PROTO_STUN)
+  {
+    stun_worker(sock);
+  }
+  if(proto == PROTO_NATPMP)
+  {
+    natpmp_worker(sock);
+  }
+
+  for(;;)
+  {
+    fromlen = sizeof(from);
+    if((fd=accept(sock, (struct sockaddr *)&from, &fromlen)) < 0)
+    {
+      if(errno == EINTR || errno == ECONNABORTED)
+      {
+        continue;
+      }
+      perror("accept");
+      _exit(1);
+    }
+    serve(fd, &from);
+  }
+}
+
+static void usage(char *prog)
+{
+  fprintf(stderr, "usage: %s [options]\n"
+      "  -p port        port to listen on (%d, 0 picks one)\n"
+      "  -b address     address to listen on (127.0.0.1)\n"
+      "  -P protocol    http, pgpow, ods, gnudip, stun or natpmp (http)\n"
+      "  -A addresses   comma separated addresses checkip, stun and natpmp\n"
+      "                 report, the first until natpmp moves on (the client's)\n"
+      "  -N sec[@addr]  natpmp moves on to the next address every sec and\n"
+      "                 announces it to addr (224.0.0.1) port 5350\n"
+      "  -s script      comma separated replies, cycled per connection:\n"
+      "                 good nochg badauth w30m 302 truncated reset (good)\n"
+      "  -u user:pass   refuse other credentials\n"
+      "  -l ms          delay before answering\n"
+      "  -j ms          add up to this much random delay\n"
+      "  -r percent     reset this share of connections\n"
+      "  -D bytes:ms    write replies a few bytes at a time\n"
+      "  -w workers     pre-forked worker processes (1)\n"
+      "  -o file        append the request log to file (stderr)\n"
+      "  -q             no request log\n",
+      prog, DEFAULT_PORT);
+}
+
+int main(int argc, char **argv)
+{
+  struct sigaction sa;
+  struct sockaddr_in sin;
+  socklen_t sinlen;
+  pid_t pids[MAX_WORKERS];
+  pid_t pid;
+  char *bind_addr = "127.0.0.1";
+  int port = DEFAULT_PORT;
+  int nworkers = 1;
+  int sock;
+  int opt;
+  char *p;
+  int on = 1;
+  int i;
+
+  script[nscript++] = OUT_GOOD;
+
+  while((opt=getopt(argc, argv, "p:b:P:A:N:s:u:l:j:r:D:w:o:qh")) != -1)
+  {
+    switch(opt)
+    {
+      case 'p':
+        port = atoi(optarg);
+        break;
+      case 'b':
+        bind_addr = optarg;
+        break;
+      case 'P':
+        if((proto=lookup(proto_names, optarg)) < 0)
+        {
+          fprintf(stderr, "%s: unknown protocol: %s\n", argv[0], optarg);
+          return(1);
+        }
+        break;
+      case 'A':
+        for(p=strtok(optarg, ","); p != NULL && nmapped < MAX_SCRIPT;
+            p=strtok(NULL, ","))
+        {
+          mapped[nmapped++] = p;
+        }
+        break;
+      case 'N':
+        announce_secs = atoi(optarg);
+        if((p=strchr(optarg, '@')) != NULL)
+        {
+          announce_to = p + 1;
+        }
+        break;
+      case 's':
+        if(parse_script(optarg) != 0)
+        {
+          fprintf(stderr, "%s: bad script\n", argv[0]);
+          return(1);
+        }
+        break;
+      case 'u':
+        credentials = optarg;
+        break;
+      case 'l':
+        latency = atoi(optarg);
+        break;
+      case 'j':
+        jitter = atoi(optarg);
+        break;
+      case 'r':
+        reset_percent = atoi(optarg);
+        break;
+      case 'D':
+        if(sscanf(optarg, "%d:%d", &drip_bytes, &drip_ms) != 2 ||
+            drip_bytes < 1)
+        {
+          fprintf(stderr, "%s: bad drip spec: %s\n", argv[0], optarg);
+          return(1);
+        }
+        break;
+      case 'w':
+        nworkers = atoi(optarg);
+        if(nworkers < 1 || nworkers > MAX_WORKERS)
+        {
+          fprintf(stderr, "%s: workers must be 1 to %d\n", argv[0],
+              MAX_WORKERS);
+          return(1);
+        }
+        break;
+      case 'o':
+        if((log_fd=open(optarg, O_WRONLY|O_CREAT|O_APPEND, 0644)) < 0)
+        {
+          perror(optarg);
+          return(1);
+        }
+        break;
+      case 'q':
+        log_fd = -1;
+        break;
+      default:
+        usage(argv[0]);
+        return(1);
+    }
+  }
+
+  memset(&sin, 0, sizeof(sin));
+  sin.sin_family = AF_INET;
+  sin.sin_port = htons(port);
+  if(inet_aton(bind_addr, &sin.sin_addr) == 0)
+  {
+    fprintf(stderr, "%s: bad address: %s\n", argv[0], bind_addr);
+    return(1);
+  }
+  if((sock=socket(AF_INET, proto == PROTO_STUN || proto == PROTO_NATPMP ?
+          SOCK_DGRAM : SOCK_STREAM, 0)) < 0)
+  {
+    perror("socket");
+    return(1);
+  }
+  setsockopt(sock, SOL_SOCKET, SO_REUSEADDR, &on, sizeof(on));
+  if(bind(sock, (struct sockaddr *)&sin, sizeof(sin)) != 0 ||
+      (proto != PROTO_STUN && proto != PROTO_NATPMP &&
+       listen(sock, 1024) != 0))
+  {
+    perror("bind");
+    return(1);
+  }
+  sinlen = sizeof(sin);
+  getsockname(sock, (struct sockaddr *)&sin, &sinlen);
+
+#if HAVE_MMAP
+  script_pos = mmap(NULL, sizeof(*script_pos), PROT_READ|PROT_WRITE,
+      MAP_SHARED|MAP_ANONYMOUS, -1, 0);
+  if(script_pos == MAP_FAILED)
+  {
+    script_pos = NULL;
+  }
+#endif
+
+  // no SA_RESTART, so a signal gets us out of wait()
+  memset(&sa, 0, sizeof(sa));
+  sa.sa_handler = handle_sig;
+  sigaction(SIGINT, &sa, NULL);
+  sigaction(SIGTERM, &sa, NULL);
+  signal(SIGPIPE, SIG_IGN);
+
+  for(i=0; i<nworkers; i++)
+  {
+    if((pids[i]=fork()) == 0)
+    {
+      worker(sock);
+    }
+  }
+
+  printf("ez-mockserv: listening on %s:%d (%s, %d worker%s)\n",
+      inet_ntoa(sin.sin_addr), ntohs(sin.sin_port), proto_names[proto],
+      nworkers, nworkers == 1 ? "" : "s");
+  fflush(stdout);
+
+  // keep the pool full until we are told to stop
+  while(!done)
+  {
+    if((pid=wait(NULL)) < 0)
+    {
+      continue;
+    }
+    for(i=0; i<nworkers; i++)
+    {
+      if(pids[i] == pid && !done)
+      {
+        if((pids[i]=fork()) == 0)
+        {
+          worker(sock);
+        }
+      }
+    }
+  }
+
+  for(i=0; i<nworkers; i++)
+  {
+    kill(pids[i], SIGTERM);
+  }
+  while(wait(NULL) > 0);
+
+  return(0);
+}
@@ -0,0 +1,824 @@
+/* ============================================================================
+ * Copyright (C) 2001 Angus Mackay. All rights reserved; 
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2, or (at your option)
+ * any later version.
+ *
+ * THIS SOFTWARE IS PROVIDED ``AS IS'' AND ANY EXPRESSED OR IMPLIED WARRANTIES,
+ * INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND
+ * FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE
+ * AUTHOR BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY,
+ * OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ * ============================================================================
+ */
+
+/*
+ * ez-sim.c
+ *
+ * the daemon's scheduling in virtual time.  backoff, max-interval
+ * refreshes (25 days for dyndns), wait responses and rate limits can't be
+ * tried out in real time, so this runs many jobs for weeks of simulated
+ * time against a scripted provider in a few seconds.
+ *
+ * each job is a box whose address changes at random (exponentially
+ * distributed, some of the changes flapping straight back) and a daemon
+ * checking it every period the way ez-ipupdate's main loop does, with the
+ * same schedule.c rules and debounce.c settling.  the updates go through
+ * the real service code in libezipupdate over a transport that answers as
+ * the provider would and whose pause (a wait response) moves the clock on
+ * instead of sleeping.  checks that can't do anything, with the address
+ * the same as the one pushed, are skipped over to the next change or
+ * refresh.  the same seed gives the same run.
+ *
+ * reported are the updates sent by result, the load on the provider hour
+ * by hour and how long the provider's record lagged behind the address
+ * (the staleness), with the same numbers as JSON for comparing runs.
+ *
+ * the jobs all start within one period, as after a power cut, so their
+ * max-interval refreshes come due together; -W spreads them the way
+ * --refresh-spread does and the refresh peak shows what that buys.
+ *
+ * usage: ez-sim [-j jobs] [-d days] [-c hours between changes]
+ *          [-f percent of changes that flap] [-P period] [-M max-interval]
+ *          [-W refresh spread] [-S settle] [-L updates a day before waits]
+ *          [-O start+hours] [-E percent of errors] [-r seed] [-o file.json]
+ *          [-D]
+ *
+ * -D turns on the debug output of the daemon code the jobs run through,
+ * in builds configured with --enable-debug.
+ *
+ */
+
+#ifdef HAVE_CONFIG_H
+#  include <config.h>
+#endif
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <math.h>
+#include <sys/time.h>
+#include <time.h>
+
+#include <ezipupdate.h>
+#include <dprintf.h>
+#include <debounce.h>
+#include <schedule.h>
+
+#define DEFAULT_JOBS 10000
+#define DEFAULT_DAYS 30
+#define DEFAULT_CHANGE_HOURS 48
+#define DEFAULT_PERIOD 120
+#define DYNDNS_MAX_INTERVAL (25*24*3600)
+// where the virtual clock starts, 0 would look like "never" to the daemon
+#define SIM_EPOCH 1000000000L
+// a flap goes back after this many seconds
+#define FLAP_MIN 10
+#define FLAP_MAX 600
+#define RATE_WINDOW (24*3600)
+#define MAX_RATE 64
+#define MAX_OUTAGES 8
+
+// as in ez-ipupdate, OPT_DEBUG is -D
+int options = 0;
+
+struct job
+{
+  // the box
+  unsigned long addr;
+  time_t next_change;
+  unsigned long flap_back;
+  time_t flap_at;
+
+  // the daemon
+  unsigned long pushed;
+  time_t last_update;
+  int spread;
+  int period;
+  int failures;
+  int stopped;
+  struct debounce bounce;
+  time_t due;
+
+  // the provider
+  unsigned long record;
+  time_t stale_since;
+  time_t recent[MAX_RATE];
+  int next_recent;
+};
+
+struct outage
+{
+  time_t start;
+  time_t end;
+};
+
+static struct
+{
+  unsigned long checks;
+  unsigned long changes;
+  unsigned long flaps;
+  unsigned long reverted;
+  unsigned long updates;
+  unsigned long refreshes;
+  unsigned long good;
+  unsigned long nochg;
+  unsigned long waits;
+  unsigned long errors;
+  unsigned long unreachable;
+  unsigned long stopped;
+  unsigned long still_stale;
+  long *stale;
+  long nstale;
+  long stale_size;
+  unsigned long *hourly;
+  unsigned long *refresh_hourly;
+  int hours;
+} stats;
+
+// the settings
+static int njobs = DEFAULT_JOBS;
+static int days = DEFAULT_DAYS;
+static double change_hours = DEFAULT_CHANGE_HOURS;
+static int flap_percent = 0;
+static int period = DEFAULT_PERIOD;
+static int max_interval = DYNDNS_MAX_INTERVAL;
+static int refresh_spread = 0;
+static int settle = 0;
+static int rate_limit = 0;
+static int error_percent = 0;
+static struct outage outages[MAX_OUTAGES];
+static int noutages = 0;
+static unsigned long long seed = 1;
+
+static struct job *jobs;
+static int *heap;
+static int nheap = 0;
+static time_t now;
+static struct ez_session session;
+
+// the update in progress
+static struct job *cur;
+static char request[2048];
+static int reqlen;
+static int answered;
+
+/* xorshift64*, the same numbers for the same seed everywhere */
+static unsigned long long rnd(void)
+{
+  seed ^= seed >> 12;
+  seed ^= seed << 25;
+  seed ^= seed >> 27;
+  return(seed * 2685821657736338717ULL);
+}
+
+static double uniform(void)
+{
+  return(((rnd() >> 11) + 0.5) / 9007199254740992.0);
+}
+
+static time_t next_interval(void)
+{
+  return((time_t)(-log(uniform()) * change_hours * 3600) + 1);
+}
+
+static unsigned long new_addr(unsigned long old)
+{
+  unsigned long addr;
+
+  do
+  {
+    addr = 0x0a000000UL | (unsigned long)(rnd() & 0xffffff);
+  } while(addr == old);
+  return(addr);
+}
+
+static void addr_text(char *buf, int size, unsigned long addr)
+{
+  snprintf(buf, size, "%lu.%lu.%lu.%lu", addr >> 24, (addr >> 16) & 0xff,
+      (addr >> 8) & 0xff, addr & 0xff);
+}
+
+static void stale_sample(long seconds)
+{
+  if(stats.nstale == stats.stale_size)
+  {
+    stats.stale_size = stats.stale_size ? stats.stale_size * 2 : 4096;
+    if((stats.stale=realloc(stats.stale, stats.stale_size * sizeof(long))) == NULL)
+    {
+      perror("realloc");
+      exit(1);
+    }
+  }
+  stats.stale[stats.nstale++] = seconds;
+}
+
+/* the provider's record or the address moved, is the record behind? */
+static void compare(struct job *j, time_t when)
+{
+  if(j->addr != j->record)
+  {
+    if(j->stale_since == 0)
+    {
+      j->stale_since = when;
+    }
+  }
+  else if(j->stale_since != 0)
+  {
+    stale_sample(when - j->stale_since);
+    j->stale_since = 0;
+  }
+}
+
+/* play the box's address changes up to t */
+static void world_advance(struct job *j, time_t t)
+{
+  unsigned long old;
+
+  for(;;)
+  {
+    if(j->flap_back != 0 && j->flap_at <= j->next_change)
+    {
+      if(j->flap_at > t)
+      {
+        break;
+      }
+      j->addr = j->flap_back;
+      j->flap_back = 0;
+      compare(j, j->flap_at);
+      continue;
+    }
+    if(j->next_change > t)
+    {
+      break;
+    }
+    old = j->addr;
+    j->addr = new_addr(old);
+    stats.changes++;
+    if(flap_percent > 0 && (int)(rnd() % 100) < flap_percent)
+    {
+      j->flap_back = old;
+      j->flap_at = j->next_change + FLAP_MIN + rnd() % (FLAP_MAX - FLAP_MIN);
+      stats.flaps++;
+    }
+    compare(j, j->next_change);
+    j->next_change += next_interval();
+  }
+}
+
+/* when the box's address changes next */
+static time_t world_next(struct job *j)
+{
+  if(j->flap_back != 0 && j->flap_at < j->next_change)
+  {
+    return(j->flap_at);
+  }
+  return(j->next_change);
+}
+
+/**************************************************/
+
+static int in_outage(time_t t)
+{
+  int i;
+
+  for(i=0; i<noutages; i++)
+  {
+    if(t >= outages[i].start && t < outages[i].end)
+    {
+      return(1);
+    }
+  }
+  return(0);
+}
+
+/* the scripted provider's answer to the request in request[] */
+static int provider_answer(char *buf, int len)
+{
+  char ip[32] = "";
+  char *p;
+  unsigned int a, b, c, d;
+  unsigned long addr;
+  time_t *oldest;
+  int hour;
+
+  stats.updates++;
+  hour = (now - SIM_EPOCH) / 3600;
+  if(hour >= 0 && hour < stats.hours)
+  {
+    stats.hourly[hour]++;
+  }
+
+  if(rate_limit > 0)
+  {
+    oldest = &cur->recent[cur->next_recent];
+    if(*oldest != 0 && now - *oldest < RATE_WINDOW)
+    {
+      stats.waits++;
+      return(snprintf(buf, len, "HTTP/1.0 200 OK\r\n\r\nw30m too many updates\n"));
+    }
+    *oldest = now;
+    cur->next_recent = (cur->next_recent + 1) % rate_limit;
+  }
+  if(error_percent > 0 && (int)(rnd() % 100) < error_percent)
+  {
+    stats.errors++;
+    return(snprintf(buf, len, "HTTP/1.0 200 OK\r\n\r\ndnserr 1\n"));
+  }
+
+  if((p=strstr(request, "myip=")) != NULL)
+  {
+    sscanf(p + 5, "%31[0-9.]", ip);
+  }
+  if(sscanf(ip, "%u.%u.%u.%u", &a, &b, &c, &d) != 4)
+  {
+    stats.errors++;
+    return(snprintf(buf, len, "HTTP/1.0 200 OK\r\n\r\nnumhost\n"));
+  }
+  addr = ((unsigned long)a << 24) | (b << 16) | (c << 8) | d;
+  if(addr == cur->record)
+  {
+    stats.nochg++;
+    return(snprintf(buf, len, "HTTP/1.0 200 OK\r\n\r\nnochg %s\n", ip));
+  }
+  cur->record = addr;
+  compare(cur, now);
+  stats.good++;
+  return(snprintf(buf, len, "HTTP/1.0 200 OK\r\n\r\ngood %s\n", ip));
+}
+
+static int sim_connect(struct ez_session *s)
+{
+  s->sock = -1;
+  if(in_outage(now))
+  {
+    stats.unreachable++;
+    return(-1);
+  }
+  reqlen = 0;
+  answered = 0;
+  return(0);
+}
+
+static int sim_send(struct ez_session *s, char *buf, int len)
+{
+  int n = len;
+
+  if(n > (int)sizeof(request) - 1 - reqlen)
+  {
+    n = sizeof(request) - 1 - reqlen;
+  }
+  memcpy(request + reqlen, buf, n);
+  reqlen += n;
+  request[reqlen] = '\0';
+  return(len);
+}
+
+static int sim_recv(struct ez_session *s, char *buf, int len)
+{
+  if(answered)
+  {
+    return(0);
+  }
+  answered = 1;
+  return(provider_answer(buf, len));
+}
+
+/* a wait response holds the daemon up, in virtual time */
+static void sim_pause(struct ez_session *s, int seconds)
+{
+  now += seconds;
+}
+
+static struct ez_transport sim_transport = {
+  sim_connect, sim_send, sim_recv, sim_pause
+};
+
+static void sim_message(struct ez_session *s, int level, const char *msg)
+{
+}
+
+/**************************************************/
+
+static void heap_push(int i)
+{
+  int n = nheap++;
+  int parent;
+
+  while(n > 0)
+  {
+    parent = (n - 1) / 2;
+    if(jobs[heap[parent]].due <= jobs[i].due)
+    {
+      break;
+    }
+    heap[n] = heap[parent];
+    n = parent;
+  }
+  heap[n] = i;
+}
+
+static int heap_pop(void)
+{
+  int top = heap[0];
+  int last = heap[--nheap];
+  int n = 0;
+  int child;
+
+  while((child=2*n + 1) < nheap)
+  {
+    if(child + 1 < nheap && jobs[heap[child+1]].due < jobs[heap[child]].due)
+    {
+      child++;
+    }
+    if(jobs[last].due <= jobs[heap[child]].due)
+    {
+      break;
+    }
+    heap[n] = heap[child];
+    n = child;
+  }
+  heap[n] = last;
+  return(top);
+}
+
+/**************************************************/
+
+/* one pass of the daemon's main loop for job j, as in ez-ipupdate.c */
+static void check(struct job *j)
+{
+  char pushed[32];
+  char current[32];
+  char host[64];
+  time_t next;
+  int changed;
+  int settling = 0;
+  int wait;
+  int res;
+
+  world_advance(j, now);
+  changed = j->pushed != j->addr;
+  // the first update and the retries after a failure don't wait
+  if(j->pushed != 0)
+  {
+    addr_text(pushed, sizeof(pushed), j->pushed);
+    addr_text(current, sizeof(current), j->addr);
+    switch(debounce_check(&j->bounce, pushed, current, now, &settling))
+    {
+      case DEBOUNCE_REVERTED:
+        stats.reverted++;
+        break;
+      case DEBOUNCE_WAIT:
+        changed = 0;
+        break;
+    }
+  }
+  if(settling == 0 && (changed ||
+        sched_refresh_due(j->last_update, max_interval, j->spread, now)))
+  {
+    if(!changed)
+    {
+      int hour = (now - SIM_EPOCH) / 3600;
+
+      stats.refreshes++;
+      if(hour < stats.hours)
+      {
+        stats.refresh_hourly[hour]++;
+      }
+    }
+    j->pushed = j->addr;
+    addr_text(current, sizeof(current), j->addr);
+    snprintf(host, sizeof(host), "job%ld.sim.example.com", (long)(j - jobs));
+    cur = j;
+    session.host = host;
+    session.address = current;
+    res = ez_update(&session);
+    if(res == EZ_OK)
+    {
+      j->last_update = sched_acked(now, session.nochg, max_interval);
+      j->failures = 0;
+    }
+    else
+    {
+      j->pushed = 0;
+      j->failures++;
+      j->period = sched_backoff(j->period);
+      if(res == EZ_SHUTDOWN)
+      {
+        j->stopped = 1;
+        stats.stopped++;
+        return;
+      }
+    }
+  }
+  if(j->failures == 0)
+  {
+    j->period = period;
+  }
+  wait = j->period;
+  if(settling > 0 && settling < wait)
+  {
+    wait = settling;
+  }
+  stats.checks++;
+
+  // the checks before the next change or refresh can't do anything, go
+  // straight to the first one after it
+  if(j->failures == 0 && settling == 0 && j->pushed == j->addr)
+  {
+    next = world_next(j);
+    if(max_interval > 0 &&
+        j->last_update + max_interval - j->spread + 1 < next)
+    {
+      next = j->last_update + max_interval - j->spread + 1;
+    }
+    if(next > now + wait)
+    {
+      stats.checks += (next - now - 1) / wait;
+      wait *= (next - now + wait - 1) / wait;
+    }
+  }
+  j->due = now + wait;
+}
+
+static int cmp_long(const void *a, const void *b)
+{
+  long x = *(const long *)a;
+  long y = *(const long *)b;
+
+  return(x < y ? -1 : x > y);
+}
+
+static long percentile(double p)
+{
+  long i;
+
+  if(stats.nstale == 0)
+  {
+    return(0);
+  }
+  i = (long)(p * stats.nstale);
+  if(i >= stats.nstale) { i = stats.nstale - 1; }
+  return(stats.stale[i]);
+}
+
+/* the most refreshes sent in any one hour */
+static unsigned long refresh_peak(void)
+{
+  unsigned long peak = 0;
+  int h;
+
+  for(h=0; h<stats.hours; h++)
+  {
+    if(stats.refresh_hourly[h] > peak)
+    {
+      peak = stats.refresh_hourly[h];
+    }
+  }
+  return(peak);
+}
+
+static void write_json(FILE *fp, double wall)
+{
+  int h;
+
+  fprintf(fp, "{\n  \"jobs\": %d,\n  \"days\": %d,\n  \"change_hours\": %g,\n"
+      "  \"flap_percent\": %d,\n  \"period\": %d,\n  \"max_interval\": %d,\n"
+      "  \"refresh_spread\": %d,\n  \"settle\": %d,\n  \"rate_limit\": %d,\n"
+      "  \"error_percent\": %d,\n  \"outages\": %d,\n  \"wall_s\": %.3f,\n",
+      njobs, days, change_hours, flap_percent, period, max_interval,
+      refresh_spread, settle, rate_limit, error_percent, noutages, wall);
+  fprintf(fp, "  \"checks\": %lu,\n  \"changes\": %lu,\n  \"flaps\": %lu,\n"
+      "  \"reverted\": %lu,\n  \"updates\": %lu,\n  \"refreshes\": %lu,\n"
+      "  \"refresh_peak_per_hour\": %lu,\n  \"good\": %lu,\n"
+      "  \"nochg\": %lu,\n  \"waits\": %lu,\n  \"errors\": %lu,\n"
+      "  \"unreachable\": %lu,\n  \"stopped\": %lu,\n",
+      stats.checks, stats.changes, stats.flaps, stats.reverted, stats.updates,
+      stats.refreshes, refresh_peak(), stats.good, stats.nochg, stats.waits, stats.errors, stats.unreachable,
+      stats.stopped);
+  fprintf(fp, "  \"stale_p50_s\": %ld,\n  \"stale_p99_s\": %ld,\n"
+      "  \"stale_p999_s\": %ld,\n  \"stale_max_s\": %ld,\n"
+      "  \"still_stale\": %lu,\n  \"updates_per_hour\": [",
+      percentile(0.5), percentile(0.99), percentile(0.999),
+      percentile(1.0), stats.still_stale);
+  for(h=0; h<stats.hours; h++)
+  {
+    fprintf(fp, "%s%lu", h ? ", " : "", stats.hourly[h]);
+  }
+  fprintf(fp, "]\n}\n");
+}
+
+static int parse_outage(char *arg)
+{
+  double start;
+  double hours;
+
+  if(noutages >= MAX_OUTAGES ||
+      sscanf(arg, "%lf+%lf", &start, &hours) != 2 || start < 0 || hours <= 0)
+  {
+    return(-1);
+  }
+  outages[noutages].start = SIM_EPOCH + (time_t)(start * 3600);
+  outages[noutages].end = outages[noutages].start + (time_t)(hours * 3600);
+  noutages++;
+  return(0);
+}
+
+int main(int argc, char **argv)
+{
+  struct timeval t0;
+  struct timeval t1;
+  struct ez_service *service;
+  struct job *j;
+  char *json_file = NULL;
+  char host[64];
+  FILE *fp;
+  time_t end;
+  unsigned long peak;
+  int peak_hour;
+  unsigned long day_total;
+  unsigned long day_peak;
+  double wall;
+  int opt;
+  int i;
+  int h;
+
+  while((opt=getopt(argc, argv, "j:d:c:f:P:M:W:S:L:O:E:r:o:D")) != -1)
+  {
+    switch(opt)
+    {
+      case 'j': njobs = atoi(optarg); break;
+      case 'd': days = atoi(optarg); break;
+      case 'c': change_hours = atof(optarg); break;
+      case 'f': flap_percent = atoi(optarg); break;
+      case 'P': period = atoi(optarg); break;
+      case 'M': max_interval = atoi(optarg); break;
+      case 'W': refresh_spread = atoi(optarg); break;
+      case 'S': settle = atoi(optarg); break;
+      case 'L': rate_limit = atoi(optarg); break;
+      case 'E': error_percent = atoi(optarg); break;
+      case 'r': seed = strtoull(optarg, NULL, 0); break;
+      case 'o': json_file = optarg; break;
+      case 'D':
+#ifdef DEBUG
+        options |= OPT_DEBUG;
+        ez_set_debug(1);
+#else
+        fprintf(stderr, "debugging was not enabled at compile time\n");
+#endif
+        break;
+      case 'O':
+        if(parse_outage(optarg) != 0)
+        {
+          fprintf(stderr, "%s: bad outage \"%s\", want <start hour>+<hours>"
+              " (at most %d)\n", argv[0], optarg, MAX_OUTAGES);
+          exit(1);
+        }
+        break;
+      default:
+        fprintf(stderr, "usage: %s [-j jobs] [-d days] [-c hours between "
+            "changes]\n\t[-f percent of changes that flap] [-P period] "
+            "[-M max-interval]\n\t[-W refresh spread] [-S settle] "
+            "[-L updates a day before waits]\n\t[-O start+hours] "
+            "[-E percent of errors] [-r seed] [-o file.json] [-D]\n", argv[0]);
+        exit(1);
+    }
+  }
+  if(njobs < 1 || days < 1 || change_hours <= 0 || period < 1 ||
+      rate_limit < 0 || rate_limit > MAX_RATE || seed == 0)
+  {
+    fprintf(stderr, "%s: jobs, days, hours and period must be positive, the "
+        "rate limit at most %d and the seed not 0\n", argv[0], MAX_RATE);
+    exit(1);
+  }
+  if((service=ez_service_find("dyndns")) == NULL)
+  {
+    fprintf(stderr, "%s: built without the dyndns service\n", argv[0]);
+    exit(1);
+  }
+
+  stats.hours = days * 24;
+  jobs = calloc(njobs, sizeof(struct job));
+  heap = calloc(njobs, sizeof(int));
+  stats.hourly = calloc(stats.hours, sizeof(unsigned long));
+  stats.refresh_hourly = calloc(stats.hours, sizeof(unsigned long));
+  if(jobs == NULL || heap == NULL || stats.hourly == NULL ||
+      stats.refresh_hourly == NULL)
+  {
+    perror("calloc");
+    exit(1);
+  }
+
+  ez_session_init(&session, service);
+  session.user_name = "sim";
+  session.password = "sim";
+  session.flags = EZ_DAEMON | EZ_QUIET | (options & OPT_DEBUG ? EZ_DEBUG : 0);
+  session.transport = &sim_transport;
+  session.message = sim_message;
+
+  // the daemons start spread over the first period, with the provider
+  // already right and no cache, as after a reboot
+  now = SIM_EPOCH;
+  end = SIM_EPOCH + (time_t)days * 24 * 3600;
+  for(i=0; i<njobs; i++)
+  {
+    j = &jobs[i];
+    j->addr = new_addr(0);
+    j->record = j->addr;
+    j->next_change = now + next_interval();
+    j->period = period;
+    snprintf(host, sizeof(host), "dyndns:job%d.sim.example.com", i);
+    j->spread = sched_spread(host, refresh_spread);
+    debounce_init(&j->bounce, settle);
+    j->due = now + rnd() % period;
+    heap_push(i);
+  }
+
+  gettimeofday(&t0, NULL);
+  while(nheap > 0 && jobs[heap[0]].due < end)
+  {
+    j = &jobs[heap_pop()];
+    now = j->due;
+    check(j);
+    if(!j->stopped)
+    {
+      heap_push(j - jobs);
+    }
+  }
+  for(i=0; i<njobs; i++)
+  {
+    world_advance(&jobs[i], end);
+    if(jobs[i].stale_since != 0)
+    {
+      stale_sample(end - jobs[i].stale_since);
+      stats.still_stale++;
+    }
+  }
+  gettimeofday(&t1, NULL);
+  wall = (t1.tv_sec - t0.tv_sec) + (t1.tv_usec - t0.tv_usec) / 1000000.0;
+  qsort(stats.stale, stats.nstale, sizeof(long), cmp_long);
+
+  printf("simulated %d jobs for %d days in %.2f seconds, %lu checks\n",
+      njobs, days, wall, stats.checks);
+  printf("%-24s %10lu (%lu flapped back, %lu held back by settling)\n",
+      "address changes", stats.changes, stats.flaps, stats.reverted);
+  printf("%-24s %10lu (%lu refreshes, peak %lu/hour)\n", "updates sent",
+      stats.updates, stats.refreshes, refresh_peak());
+  printf("  %-22s %10lu\n", "good", stats.good);
+  printf("  %-22s %10lu\n", "nochg", stats.nochg);
+  printf("  %-22s %10lu\n", "wait", stats.waits);
+  printf("  %-22s %10lu\n", "error", stats.errors);
+  printf("%-24s %10lu\n", "provider unreachable", stats.unreachable);
+  printf("%-24s %10lu\n", "jobs shut down", stats.stopped);
+  printf("%-24s p50 %lds  p99 %lds  p99.9 %lds  max %lds, %lu still stale "
+      "at the end\n", "staleness", percentile(0.5), percentile(0.99),
+      percentile(0.999), percentile(1.0), stats.still_stale);
+
+  peak = 0;
+  peak_hour = 0;
+  for(h=0; h<stats.hours; h++)
+  {
+    if(stats.hourly[h] > peak)
+    {
+      peak = stats.hourly[h];
+      peak_hour = h;
+    }
+  }
+  printf("%-24s mean %.1f/hour, peak %lu in day %d hour %d\n",
+      "provider load", (double)stats.updates / stats.hours, peak,
+      peak_hour / 24 + 1, peak_hour % 24);
+  printf("\n%5s %10s %10s\n", "day", "updates", "peak/hour");
+  for(i=0; i<days; i++)
+  {
+    day_total = 0;
+    day_peak = 0;
+    for(h=i*24; h<(i+1)*24; h++)
+    {
+      day_total += stats.hourly[h];
+      if(stats.hourly[h] > day_peak) { day_peak = stats.hourly[h]; }
+    }
+    printf("%5d %10lu %10lu\n", i + 1, day_total, day_peak);
+  }
+
+  if(json_file)
+  {
+    if((fp=fopen(json_file, "w")) == NULL)
+    {
+      perror(json_file);
+      exit(1);
+    }
+    write_json(fp, wall);
+    fclose(fp);
+  }
+
+  ez_session_free(&session);
+  return(0);
+}
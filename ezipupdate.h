@@ -0,0 +1,218 @@
+/* ============================================================================
+ * Copyright (C) 2001 Angus Mackay. All rights reserved;
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2, or (at your option)
+ * any later version.
+ *
+ * THIS SOFTWARE IS PROVIDED ``AS IS'' AND ANY EXPRESSED OR IMPLIED WARRANTIES,
+ * INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND
+ * FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE
+ * AUTHOR BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY,
+ * OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ * ============================================================================
+ */
+
+/*
+ * ezipupdate.h
+ *
+ * libezipupdate, the update code of ez-ipupdate as a library.
+ *
+ * everything one update needs is in a struct ez_session: what to send,
+ * where, how to talk to the network and where messages go, and afterwards
+ * how it went.  nothing is kept between calls outside the session, so any
+ * number of sessions can be in use at once, each by one thread at a time.
+ *
+ *   struct ez_session s;
+ *
+ *   ez_session_init(&s, ez_service_find("dyndns"));
+ *   s.host = "myhost.dyndns.org";
+ *   s.address = "10.1.2.3";
+ *   s.user_name = "user";
+ *   s.password = "secret";
+ *   if(ez_update(&s) == EZ_OK) ...
+ *   ez_session_free(&s);
+ *
+ * ez_update() blocks until the server has answered.  to run many updates
+ * at once give the sessions to an engine with ez_submit(), which runs them
+ * on a pool of worker threads, and call ez_poll() (when ez_engine_fd() is
+ * readable, say) to have the callbacks of the finished ones called in the
+ * calling thread.  without pthreads ez_poll() runs the next queued session
+ * itself.
+ *
+ */
+
+#ifndef _EZIPUPDATE_H
+#define _EZIPUPDATE_H
+
+#include <sys/time.h>
+
+/* update results */
+enum {
+  EZ_OK = 0,
+  EZ_ERROR,
+  EZ_SHUTDOWN,
+};
+
+/* session flags */
+#define EZ_DEBUG    0x0001
+#define EZ_DAEMON   0x0004
+#define EZ_QUIET    0x0008
+#define EZ_OFFLINE  0x0020
+
+/*
+ * message levels: notices are what a daemon would log, details are only
+ * for someone watching and results are what a one shot update prints
+ */
+enum {
+  EZ_MSG_DETAIL = 0,
+  EZ_MSG_NOTICE,
+  EZ_MSG_RESULT,
+};
+
+/* what a trace callback is told about, see struct ez_session */
+enum {
+  EZ_TRACE_CONNECT = 1,
+  EZ_TRACE_SEND,
+  EZ_TRACE_RECV,
+  EZ_TRACE_RECV_FAIL,
+};
+
+/* the points in an update that get a timestamp */
+enum {
+  EZ_MARK_START = 0,
+  EZ_MARK_RESOLVED,
+  EZ_MARK_CONNECTED,
+  EZ_MARK_SENT,
+  EZ_MARK_RECEIVED,
+  EZ_MARK_DONE,
+  EZ_NMARKS
+};
+
+#define EZ_DEFAULT_TIMEOUT 120
+
+struct ez_session;
+struct arena;
+
+/*
+ * a service, "dyndns" and so on.  the first, "null", is a placeholder for
+ * no service and can't update anything.
+ */
+struct ez_service
+{
+  char *title;
+  char *names[3];
+  int (*update)(struct ez_session *s);
+  char **fields_used;
+  char *default_server;
+  char *default_port;
+  char *default_request;
+};
+
+/*
+ * how an update reaches the server.  connect() sets s->sock, send() and
+ * recv() return what send() and recv() would and pause() waits when the
+ * service has to.  ez_net_transport is the network, anything else (a
+ * recorded transcript, say) can stand in for it.
+ */
+struct ez_transport
+{
+  int (*connect)(struct ez_session *s);
+  int (*send)(struct ez_session *s, char *buf, int len);
+  int (*recv)(struct ez_session *s, char *buf, int len);
+  void (*pause)(struct ez_session *s, int seconds);
+};
+
+typedef void (*ez_callback)(struct ez_session *s, void *arg);
+
+struct ez_session
+{
+  // the update, ez_session_init() sets the service defaults
+  struct ez_service *service;
+  char *server;
+  char *port;
+  char *request;
+  char *host;
+  char *address;
+  // an IPv6 address to publish too, for the services that can
+  char *address6;
+  char *mx;
+  char *url;
+  char *cloak_title;
+  char *partner;
+  char *user_name;
+  char *password;
+  int wildcard;
+  int connection_type;
+  int flags;
+  struct timeval timeout;
+
+  // how it is done, NULL for the network and stdout/stderr
+  struct ez_transport *transport;
+  void (*message)(struct ez_session *s, int level, const char *msg);
+  void (*trace)(struct ez_session *s, int type, const char *buf, int len);
+  void *arg;
+
+  // how it went, set by ez_update()
+  int result;
+  // the server said nothing had changed since the last update
+  int nochg;
+  // seconds the server asked for before the next update, if it did
+  int wait;
+  // what the server said when it wasn't understood
+  char response[256];
+  struct timeval marks[EZ_NMARKS];
+  int marked[EZ_NMARKS];
+  unsigned long bytes_out;
+  unsigned long bytes_in;
+  int timeouts;
+
+  // the rest is private
+  int sock;
+  // a query value didn't fit, the request is never finished
+  int overflow;
+  char auth[512];
+  char password_url[3*128+1];
+  char *buf;
+  struct arena *arena;
+  ez_callback done;
+  void *done_arg;
+  struct ez_session *next;
+};
+
+struct ez_engine;
+
+extern struct ez_service ez_services[];
+extern int ez_nservices;
+extern struct ez_service *ez_service_find(const char *name);
+extern int ez_service_register(struct ez_service *service);
+extern struct ez_service *ez_service_extra(int i);
+
+// debug output for what isn't tied to a session, see EZ_DEBUG for the rest
+extern void ez_set_debug(int on);
+
+extern void ez_session_init(struct ez_session *s, struct ez_service *service);
+extern void ez_session_free(struct ez_session *s);
+extern int ez_update(struct ez_session *s);
+
+extern struct ez_transport ez_net_transport;
+extern int ez_net_connect(struct ez_session *s);
+extern int ez_net_send(struct ez_session *s, char *buf, int len);
+extern int ez_net_recv(struct ez_session *s, char *buf, int len);
+extern void ez_net_pause(struct ez_session *s, int seconds);
+
+extern struct ez_engine *ez_engine_new(int workers);
+extern int ez_submit(struct ez_engine *e, struct ez_session *s,
+    ez_callback done, void *arg);
+extern int ez_poll(struct ez_engine *e, int timeout_ms);
+extern int ez_engine_fd(struct ez_engine *e);
+extern int ez_engine_pending(struct ez_engine *e);
+extern void ez_engine_free(struct ez_engine *e);
+
+#endif
@@ -0,0 +1,92 @@
+/* ============================================================================
+ * Copyright (C) 2001 Angus Mackay. All rights reserved; 
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2, or (at your option)
+ * any later version.
+ *
+ * THIS SOFTWARE IS PROVIDED ``AS IS'' AND ANY EXPRESSED OR IMPLIED WARRANTIES,
+ * INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND
+ * FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE
+ * AUTHOR BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY,
+ * OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ * ============================================================================
+ */
+
+/*
+ * ezplugin.h
+ *
+ * the interface between ez-ipupdate and its plugins, shared objects loaded
+ * with --plugin that add services and in process post update hooks.  a
+ * plugin defines
+ *
+ *   int ez_plugin_abi = EZ_PLUGIN_ABI;
+ *   int ez_plugin_init(const struct ez_plugin_api *api);
+ *
+ * ez_plugin_init() is called once, when the plugin is loaded and only if
+ * its ez_plugin_abi is the one ez-ipupdate was built with.  it registers
+ * what the plugin provides through api and returns 0, or -1 to not be
+ * loaded after all.
+ *
+ * a service is a struct ez_service, see ezipupdate.h.  its update() talks
+ * to the server through s->transport and reports through s->message like
+ * the built in ones do.  a plugin has to be loaded before its service can
+ * be picked with --service-type.  one added with add_service() gets the
+ * generic checks, only that a host is given if it uses one.  one added
+ * with add_plugin_service() can have its own, like the built in ones:
+ * init() once before the first update to set up the session it is given,
+ * its defaults say, and check_info() to see the session has what update()
+ * needs, asking for what is missing with api->ask(), which returns NULL
+ * when there is nobody to ask.  check_info() returns 0, or -1 if the
+ * update can't be made.  what either changes in the session is kept for
+ * the updates.
+ *
+ * a hook is called after each successful update with the session it was
+ * made with, from the daemon's own thread, so it shouldn't block for long.
+ *
+ * EZ_PLUGIN_ABI goes up whenever this file, struct ez_service or struct
+ * ez_session change in a way that breaks plugins built against the old
+ * ones, or struct ez_plugin_api gains members plugins may need.  members
+ * are only ever added to the end of struct ez_plugin_api, api->size says
+ * how much of it there is, and plugins built for EZ_PLUGIN_ABI_MIN on are
+ * still loaded.
+ *
+ */
+
+#ifndef _EZPLUGIN_H
+#define _EZPLUGIN_H
+
+#include "ezipupdate.h"
+
+#define EZ_PLUGIN_ABI 3
+#define EZ_PLUGIN_ABI_MIN 2
+
+typedef void (*ez_plugin_hook)(struct ez_session *s, void *arg);
+
+/* a service with the checks of its own, both may be NULL */
+struct ez_plugin_service
+{
+  struct ez_service *service;
+  void (*init)(struct ez_session *s);
+  int (*check_info)(struct ez_session *s);
+};
+
+struct ez_plugin_api
+{
+  int abi;
+  int size;
+  int (*add_service)(struct ez_service *service);
+  int (*add_hook)(ez_plugin_hook hook, void *arg);
+  void (*message)(int level, const char *msg);
+  // from ABI 3
+  int (*add_plugin_service)(struct ez_plugin_service *service);
+  char *(*ask)(const char *what, int secret);
+};
+
+#endif
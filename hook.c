@@ -0,0 +1,680 @@
+/* ============================================================================
+ * Copyright (C) 2001 Angus Mackay. All rights reserved; 
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2, or (at your option)
+ * any later version.
+ *
+ * THIS SOFTWARE IS PROVIDED ``AS IS'' AND ANY EXPRESSED OR IMPLIED WARRANTIES,
+ * INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND
+ * FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE
+ * AUTHOR BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY,
+ * OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ * ============================================================================
+ */
+
+/*
+ * hook.c
+ *
+ * the post update command and the failure mail are run in the background
+ * so a slow one can't hold up the daemon.  each is started with
+ * posix_spawn() in its own process group, straight from the command line
+ * unless that needs a shell, and reaped from event_wait(): through a pidfd
+ * where there is one and by polling once a second where there isn't, which
+ * unlike a SIGCHLD handler doesn't cut the daemon's sleep short.  one that
+ * runs past the timeout gets SIGTERM and HOOK_KILL_GRACE seconds later
+ * SIGKILL.
+ *
+ * with a batch window the changes in that window are handed to a single
+ * run of the command as JSON on its stdin:
+ *
+ *   {"jobs":[{"service":"dyndns","host":"a.example.com",
+ *     "interface":"eth0","address":"10.1.2.3","time":1000000000}]}
+ *
+ * with "address6" after "address" for a change that has an IPv6 address.
+ *
+ */
+
+#ifdef HAVE_CONFIG_H
+#  include <config.h>
+#endif
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <signal.h>
+#if HAVE_SYS_TYPES_H
+#  include <sys/types.h>
+#endif
+#if HAVE_SYS_WAIT_H
+#  include <sys/wait.h>
+#endif
+#if HAVE_ERRNO_H
+#  include <errno.h>
+#endif
+#if HAVE_SPAWN_H && HAVE_POSIX_SPAWN
+#  include <spawn.h>
+#endif
+#ifdef __linux__
+#  include <sys/syscall.h>
+#endif
+
+#include <error.h>
+#include <dprintf.h>
+#include <event.h>
+#include <hook.h>
+#include <probes.h>
+
+extern char **environ;
+
+// each running hook may hold one of event.c's descriptors
+#define MAX_HOOKS 8
+#define MAX_HOOK_ARGS 32
+// the most hook_run() adds after the command's own
+#define HOOK_EXTRA_ARGS 2
+#define MAX_BATCH 64
+#define HOOK_KILL_GRACE 2
+#define SHELL_CHARS "|&;<>()$`\\\"'*?[]#~=%{}\n"
+
+struct hook
+{
+  int in_use;
+  pid_t pid;
+  int pidfd;
+  int killed;
+  time_t started;
+  hook_done_cb done;
+  void *arg;
+};
+
+struct batch_entry
+{
+  char service[32];
+  char host[128];
+  char interface[32];
+  char address[64];
+  char address6[64];
+  time_t when;
+};
+
+static struct hook hooks[MAX_HOOKS];
+static int hook_timeout = DEFAULT_HOOK_TIMEOUT;
+static int hook_batch = 0;
+static int draining = 0;
+
+// only allocated once there is a batch, with the buffer it is written to
+static struct batch_entry *batch = NULL;
+static char *batch_input = NULL;
+static int nbatch = 0;
+static char *batch_cmd = NULL;
+static hook_done_cb batch_done = NULL;
+static void *batch_arg = NULL;
+
+static void hook_poll(void *arg);
+static void hook_term(void *arg);
+static void hook_kill(void *arg);
+static void batch_flush(void *arg);
+
+/*
+ * hook_config
+ *
+ * timeout is how many seconds a hook may run, 0 for as long as it likes,
+ * and batch how many seconds of changes hook_changed() collects before
+ * running the command, 0 to run it for each
+ */
+void hook_config(int timeout, int batch_secs)
+{
+  hook_timeout = timeout;
+  hook_batch = batch_secs;
+}
+
+int hook_running(void)
+{
+  int n = 0;
+  int i;
+
+  for(i=0; i<MAX_HOOKS; i++)
+  {
+    if(hooks[i].in_use) { n++; }
+  }
+  return(n);
+}
+
+static void hook_finish(struct hook *h, int status)
+{
+  int code;
+
+  if(h->pidfd != -1)
+  {
+    event_del(h->pidfd);
+    close(h->pidfd);
+  }
+  event_timer_del(hook_poll, h);
+  event_timer_del(hook_term, h);
+  event_timer_del(hook_kill, h);
+  h->in_use = 0;
+
+  if(h->killed)
+  {
+    code = HOOK_KILLED;
+  }
+  else if(WIFSIGNALED(status))
+  {
+    // not a signal of ours, say so the way a shell would
+    code = 128 + WTERMSIG(status);
+  }
+  else
+  {
+    code = WEXITSTATUS(status);
+  }
+  dprintf((stderr, "hook %d finished after %ld seconds: %d\n", (int)h->pid,
+        (long)(time(NULL) - h->started), code));
+  if(h->done)
+  {
+    h->done(code, h->arg);
+  }
+  if(draining && hook_running() == 0)
+  {
+    event_break();
+  }
+}
+
+/* returns 1 once the hook has been reaped */
+static int hook_reap(struct hook *h)
+{
+  int status;
+  pid_t pid;
+
+  pid = waitpid(h->pid, &status, WNOHANG);
+  if(pid == 0)
+  {
+    return(0);
+  }
+  if(pid == -1)
+  {
+    // someone else reaped it, all we know is that it's gone
+    dprintf((stderr, "waitpid %d: %s\n", (int)h->pid, error_string));
+    status = 0;
+  }
+  hook_finish(h, status);
+  return(1);
+}
+
+/* kill a hook there is no timer left to watch and reap it now */
+static void hook_abandon(struct hook *h)
+{
+  int status;
+
+  dprintf((stderr, "no timer for hook %d, killing it\n", (int)h->pid));
+  h->killed = 1;
+  kill(-h->pid, SIGKILL);
+  if(waitpid(h->pid, &status, 0) == -1)
+  {
+    status = 0;
+  }
+  hook_finish(h, status);
+}
+
+static void hook_readable(int fd, void *arg)
+{
+  hook_reap((struct hook *)arg);
+}
+
+static void hook_poll(void *arg)
+{
+  struct hook *h = (struct hook *)arg;
+
+  if(!hook_reap(h) && event_timer(1000, hook_poll, h) != 0)
+  {
+    hook_abandon(h);
+  }
+}
+
+static void hook_term(void *arg)
+{
+  struct hook *h = (struct hook *)arg;
+
+  dprintf((stderr, "hook %d ran too long, terminating\n", (int)h->pid));
+  h->killed = 1;
+  kill(-h->pid, SIGTERM);
+  if(event_timer(HOOK_KILL_GRACE * 1000, hook_kill, h) != 0)
+  {
+    // no grace then
+    hook_kill(h);
+  }
+}
+
+static void hook_kill(void *arg)
+{
+  struct hook *h = (struct hook *)arg;
+
+  kill(-h->pid, SIGKILL);
+}
+
+/* start argv[0] in a process group of its own reading stdin from in_fd */
+static pid_t hook_exec(char **argv, int in_fd)
+{
+  pid_t pid;
+#if HAVE_SPAWN_H && HAVE_POSIX_SPAWN
+  posix_spawn_file_actions_t actions;
+  posix_spawnattr_t attr;
+  sigset_t sigs;
+  int err;
+
+  posix_spawn_file_actions_init(&actions);
+  posix_spawnattr_init(&attr);
+  if(in_fd != -1)
+  {
+    posix_spawn_file_actions_adddup2(&actions, in_fd, 0);
+  }
+  posix_spawnattr_setflags(&attr, POSIX_SPAWN_SETPGROUP |
+      POSIX_SPAWN_SETSIGDEF | POSIX_SPAWN_SETSIGMASK);
+  posix_spawnattr_setpgroup(&attr, 0);
+  sigemptyset(&sigs);
+  sigaddset(&sigs, SIGPIPE);
+  sigaddset(&sigs, SIGCHLD);
+  posix_spawnattr_setsigdefault(&attr, &sigs);
+  sigemptyset(&sigs);
+  posix_spawnattr_setsigmask(&attr, &sigs);
+
+  err = posix_spawnp(&pid, argv[0], &actions, &attr, argv, environ);
+
+  posix_spawnattr_destroy(&attr);
+  posix_spawn_file_actions_destroy(&actions);
+  if(err != 0)
+  {
+    errno = err;
+    return(-1);
+  }
+#else
+  if((pid=fork()) == 0)
+  {
+    setpgid(0, 0);
+    signal(SIGPIPE, SIG_DFL);
+    signal(SIGCHLD, SIG_DFL);
+    if(in_fd != -1)
+    {
+      dup2(in_fd, 0);
+    }
+    execvp(argv[0], argv);
+    _exit(127);
+  }
+#endif
+
+  return(pid);
+}
+
+/*
+ * hook_spawn
+ *
+ * run argv with input, if not NULL, on its stdin. done(code, arg) is called
+ * from event_wait() once it has finished. returns -1 with errno set if it
+ * couldn't be started.
+ */
+int hook_spawn(char **argv, char *input, hook_done_cb done, void *arg)
+{
+  struct hook *h = NULL;
+  int fds[2] = { -1, -1 };
+  int i;
+
+  for(i=0; i<MAX_HOOKS; i++)
+  {
+    if(!hooks[i].in_use)
+    {
+      h = &hooks[i];
+      break;
+    }
+  }
+  if(h == NULL)
+  {
+    errno = EAGAIN;
+    return(-1);
+  }
+
+  if(input != NULL)
+  {
+    if(pipe(fds) != 0)
+    {
+      return(-1);
+    }
+    fcntl(fds[0], F_SETFD, FD_CLOEXEC);
+    fcntl(fds[1], F_SETFD, FD_CLOEXEC);
+  }
+
+  dprintf((stderr, "running hook: %s\n", argv[0]));
+  h->pid = hook_exec(argv, fds[0]);
+  if(fds[0] != -1)
+  {
+    close(fds[0]);
+  }
+  if(h->pid == -1)
+  {
+    if(fds[1] != -1) { close(fds[1]); }
+    return(-1);
+  }
+  PROBE2(hook__spawn, h->pid, argv[0]);
+
+  // the input fits in the pipe so this can't block, a hook that doesn't
+  // read it just doesn't get it
+  if(input != NULL)
+  {
+    fcntl(fds[1], F_SETFL, O_NONBLOCK);
+    if(write(fds[1], input, strlen(input)) == -1)
+    {
+      dprintf((stderr, "write to hook: %s\n", error_string));
+    }
+    close(fds[1]);
+  }
+
+  h->in_use = 1;
+  h->killed = 0;
+  h->started = time(NULL);
+  h->done = done;
+  h->arg = arg;
+  h->pidfd = -1;
+#if defined(__linux__) && defined(SYS_pidfd_open)
+  h->pidfd = syscall(SYS_pidfd_open, h->pid, 0);
+  if(h->pidfd != -1 && event_add(h->pidfd, hook_readable, h) != 0)
+  {
+    close(h->pidfd);
+    h->pidfd = -1;
+  }
+#endif
+  if((h->pidfd == -1 && event_timer(1000, hook_poll, h) != 0) ||
+      (hook_timeout > 0 &&
+       event_timer(hook_timeout * 1000, hook_term, h) != 0))
+  {
+    // the caller reports the failure, not done
+    h->done = NULL;
+    hook_abandon(h);
+    errno = EAGAIN;
+    return(-1);
+  }
+
+  return(0);
+}
+
+/*
+ * hook_run
+ *
+ * run the command line cmd with the NULL terminated args, if any, added as
+ * its last arguments. cmd is split on white space and run directly unless
+ * it uses something only a shell understands, in which case it goes to
+ * /bin/sh -c.
+ */
+int hook_run(char *cmd, char **args, char *input, hook_done_cb done,
+    void *done_arg)
+{
+  char *argv[MAX_HOOK_ARGS+HOOK_EXTRA_ARGS+1];
+  char *line;
+  char *p;
+  int argc = 0;
+  int len;
+  int ret;
+  int i;
+
+  if(strpbrk(cmd, SHELL_CHARS) != NULL)
+  {
+    len = strlen(cmd) + 1;
+    for(i=0; args && args[i]; i++)
+    {
+      len += 1 + strlen(args[i]);
+    }
+    if((line=malloc(len)) == NULL)
+    {
+      return(-1);
+    }
+    strcpy(line, cmd);
+    for(i=0; args && args[i]; i++)
+    {
+      strcat(line, " ");
+      strcat(line, args[i]);
+    }
+    argv[argc++] = "/bin/sh";
+    argv[argc++] = "-c";
+    argv[argc++] = line;
+  }
+  else
+  {
+    if((line=strdup(cmd)) == NULL)
+    {
+      return(-1);
+    }
+    for(p=strtok(line, " \t"); p != NULL && argc < MAX_HOOK_ARGS;
+        p=strtok(NULL, " \t"))
+    {
+      argv[argc++] = p;
+    }
+    if(argc == 0)
+    {
+      free(line);
+      errno = EINVAL;
+      return(-1);
+    }
+    for(i=0; args && args[i] && i<HOOK_EXTRA_ARGS; i++)
+    {
+      argv[argc++] = args[i];
+    }
+  }
+  argv[argc] = NULL;
+
+  ret = hook_spawn(argv, input, done, done_arg);
+  free(line);
+
+  return(ret);
+}
+
+// the whole batch has to fit in a pipe, which holds at least this much
+#define BATCH_INPUT_SIZE 60000
+
+/* append to buf without running off its end */
+static void batch_cat(char *buf, int *len, const char *s, int n)
+{
+  if(*len + n >= BATCH_INPUT_SIZE)
+  {
+    n = BATCH_INPUT_SIZE - 1 - *len;
+  }
+  memcpy(buf + *len, s, n);
+  *len += n;
+  buf[*len] = '\0';
+}
+
+/* append s to buf as a JSON string */
+static void batch_string(char *buf, int *len, const char *s)
+{
+  char esc[8];
+
+  batch_cat(buf, len, "\"", 1);
+  for(; *s != '\0'; s++)
+  {
+    if(*s == '"' || *s == '\\')
+    {
+      esc[0] = '\\';
+      esc[1] = *s;
+      batch_cat(buf, len, esc, 2);
+    }
+    else if((unsigned char)*s < 0x20)
+    {
+      snprintf(esc, sizeof(esc), "\\u%04x", (unsigned char)*s);
+      batch_cat(buf, len, esc, 6);
+    }
+    else
+    {
+      batch_cat(buf, len, s, 1);
+    }
+  }
+  batch_cat(buf, len, "\"", 1);
+}
+
+static void batch_flush(void *arg)
+{
+  char *buf = batch_input;
+  char num[32];
+  int len = 0;
+  int i;
+
+  event_timer_del(batch_flush, NULL);
+  if(nbatch == 0)
+  {
+    return;
+  }
+
+  batch_cat(buf, &len, "{\"jobs\":[", 9);
+  for(i=0; i<nbatch; i++)
+  {
+    if(i > 0)
+    {
+      batch_cat(buf, &len, ",", 1);
+    }
+    batch_cat(buf, &len, "{\"service\":", 11);
+    batch_string(buf, &len, batch[i].service);
+    batch_cat(buf, &len, ",\"host\":", 8);
+    batch_string(buf, &len, batch[i].host);
+    batch_cat(buf, &len, ",\"interface\":", 13);
+    batch_string(buf, &len, batch[i].interface);
+    batch_cat(buf, &len, ",\"address\":", 11);
+    batch_string(buf, &len, batch[i].address);
+    if(*batch[i].address6 != '\0')
+    {
+      batch_cat(buf, &len, ",\"address6\":", 12);
+      batch_string(buf, &len, batch[i].address6);
+    }
+    snprintf(num, sizeof(num), ",\"time\":%ld}", (long)batch[i].when);
+    batch_cat(buf, &len, num, strlen(num));
+  }
+  batch_cat(buf, &len, "]}\n", 3);
+  nbatch = 0;
+
+  if(hook_run(batch_cmd, NULL, buf, batch_done, batch_arg) != 0)
+  {
+    if(batch_done)
+    {
+      batch_done(HOOK_FAILED, batch_arg);
+    }
+  }
+}
+
+/* 0 once there is room for a batch */
+static int batch_alloc(void)
+{
+  if(batch != NULL)
+  {
+    return(0);
+  }
+  batch = calloc(MAX_BATCH, sizeof(struct batch_entry));
+  batch_input = malloc(BATCH_INPUT_SIZE);
+  if(batch == NULL || batch_input == NULL)
+  {
+    free(batch);
+    free(batch_input);
+    batch = NULL;
+    batch_input = NULL;
+    return(-1);
+  }
+  return(0);
+}
+
+/*
+ * hook_changed
+ *
+ * run cmd for the change, with its address and then its IPv6 address, if
+ * it has one, as the arguments, or add it to the batch.  a later change to
+ * the same host replaces the earlier one.
+ */
+int hook_changed(char *cmd, struct hook_change *change, hook_done_cb done,
+    void *arg)
+{
+  struct batch_entry *e;
+  char *args[3];
+  int i;
+
+  // without the memory for a batch the change gets a run of its own
+  if(hook_batch <= 0 || batch_alloc() != 0)
+  {
+    args[0] = change->address;
+    args[1] = change->address6 && *change->address6 ? change->address6 : NULL;
+    args[2] = NULL;
+    return(hook_run(cmd, change->address ? args : NULL, NULL, done, arg));
+  }
+
+  if(batch_cmd != NULL && strcmp(batch_cmd, cmd) != 0)
+  {
+    batch_flush(NULL);
+  }
+  for(i=0; i<nbatch; i++)
+  {
+    if(strcmp(batch[i].host, change->host ? change->host : "") == 0)
+    {
+      break;
+    }
+  }
+  if(i == MAX_BATCH)
+  {
+    batch_flush(NULL);
+    i = 0;
+  }
+  if(i == nbatch)
+  {
+    nbatch++;
+  }
+  e = &batch[i];
+  snprintf(e->service, sizeof(e->service), "%s",
+      change->service ? change->service : "");
+  snprintf(e->host, sizeof(e->host), "%s", change->host ? change->host : "");
+  snprintf(e->interface, sizeof(e->interface), "%s",
+      change->interface ? change->interface : "");
+  snprintf(e->address, sizeof(e->address), "%s",
+      change->address ? change->address : "");
+  snprintf(e->address6, sizeof(e->address6), "%s",
+      change->address6 ? change->address6 : "");
+  e->when = change->when;
+
+  if(batch_cmd == NULL || strcmp(batch_cmd, cmd) != 0)
+  {
+    free(batch_cmd);
+    batch_cmd = strdup(cmd);
+  }
+  batch_done = done;
+  batch_arg = arg;
+  if(nbatch == 1 && event_timer(hook_batch * 1000, batch_flush, NULL) != 0)
+  {
+    // nothing would flush it later
+    batch_flush(NULL);
+  }
+
+  return(0);
+}
+
+/*
+ * hook_drain
+ *
+ * run what is left of the batch and wait for the hooks still running, no
+ * longer than it takes their timeouts to kill them
+ */
+void hook_drain(void)
+{
+  time_t end;
+
+  batch_flush(NULL);
+  if(hook_running() == 0)
+  {
+    return;
+  }
+
+  end = time(NULL) + (hook_timeout > 0 ? hook_timeout + HOOK_KILL_GRACE + 1 :
+      DEFAULT_HOOK_TIMEOUT);
+  draining = 1;
+  while(hook_running() > 0 && time(NULL) < end)
+  {
+    event_wait(end - time(NULL));
+  }
+  draining = 0;
+}
@@ -0,0 +1,70 @@
+/* ============================================================================
+ * Copyright (C) 2001 Angus Mackay. All rights reserved; 
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2, or (at your option)
+ * any later version.
+ *
+ * THIS SOFTWARE IS PROVIDED ``AS IS'' AND ANY EXPRESSED OR IMPLIED WARRANTIES,
+ * INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND
+ * FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE
+ * AUTHOR BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY,
+ * OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ * ============================================================================
+ */
+
+/*
+ * hook.h
+ *
+ * runs the post update command and the failure mail without waiting for
+ * them, see hook.c
+ *
+ */
+
+#ifndef _HOOK_H
+#define _HOOK_H
+
+#include <time.h>
+
+/* seconds a hook may run before it is killed */
+#define DEFAULT_HOOK_TIMEOUT 30
+
+/*
+ * what a hook's done callback gets instead of an exit code when it couldn't
+ * be started (errno says why) or didn't exit by itself
+ */
+#define HOOK_FAILED -1
+#define HOOK_KILLED -2
+/* not from a callback: hook_drain() gave up on a hook still running */
+#define HOOK_RUNNING -3
+
+/* one update a batched hook is told about */
+struct hook_change
+{
+  char *service;
+  char *host;
+  char *interface;
+  char *address;
+  // NULL or "" without IPv6
+  char *address6;
+  time_t when;
+};
+
+typedef void (*hook_done_cb)(int code, void *arg);
+
+extern void hook_config(int timeout, int batch);
+extern int hook_spawn(char **argv, char *input, hook_done_cb done, void *arg);
+extern int hook_run(char *cmd, char **args, char *input, hook_done_cb done,
+    void *done_arg);
+extern int hook_changed(char *cmd, struct hook_change *change,
+    hook_done_cb done, void *arg);
+extern int hook_running(void);
+extern void hook_drain(void);
+
+#endif
@@ -0,0 +1,219 @@
+/* ============================================================================
+ * Copyright (C) 2001 Angus Mackay. All rights reserved; 
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2, or (at your option)
+ * any later version.
+ *
+ * THIS SOFTWARE IS PROVIDED ``AS IS'' AND ANY EXPRESSED OR IMPLIED WARRANTIES,
+ * INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND
+ * FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE
+ * AUTHOR BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY,
+ * OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ * ============================================================================
+ */
+
+/*
+ * ifaddr6.c
+ *
+ * an interface usually has several IPv6 addresses and only some of them
+ * belong in DNS.  link local ones never do, nor do ones that are still
+ * being checked for duplicates (tentative), failed that check or are on
+ * their way out (deprecated).  of the rest the policy says which kinds are
+ * wanted and in what order.
+ *
+ * the addresses come from the interface snapshot.  on linux that has the
+ * flags to tell all that, elsewhere only the addresses so privacy and
+ * deprecated ones can't be told apart from the others.
+ *
+ */
+
+#ifdef HAVE_CONFIG_H
+#  include <config.h>
+#endif
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#if HAVE_SYS_TYPES_H
+#  include <sys/types.h>
+#endif
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <arpa/inet.h>
+#include <net/if.h>
+
+#include <dprintf.h>
+#include <ifsnap.h>
+#include <ifaddr6.h>
+
+enum {
+  KIND_STABLE = 0,
+  KIND_ULA,
+  KIND_TEMPORARY,
+  NKINDS
+};
+
+static char *kind_names[NKINDS] = { "stable", "ula", "temporary" };
+
+#define MAX_POLICY_LEN 64
+
+/*
+ * the rank of each kind under policy, lower is better and -1 is not
+ * wanted. returns -1 if policy names something that isn't a kind.
+ */
+static int policy_ranks(char *policy, int *ranks)
+{
+  char buf[MAX_POLICY_LEN];
+  char *p;
+  int rank = 0;
+  int i;
+
+  for(i=0; i<NKINDS; i++)
+  {
+    ranks[i] = -1;
+  }
+  snprintf(buf, sizeof(buf), "%s", policy);
+  for(p=strtok(buf, ", "); p != NULL; p=strtok(NULL, ", "))
+  {
+    for(i=0; i<NKINDS; i++)
+    {
+      if(strcmp(p, kind_names[i]) == 0)
+      {
+        break;
+      }
+    }
+    if(i == NKINDS)
+    {
+      return(-1);
+    }
+    if(ranks[i] == -1)
+    {
+      ranks[i] = rank++;
+    }
+  }
+
+  return(rank > 0 ? 0 : -1);
+}
+
+int ifaddr6_check_policy(char *policy)
+{
+  int ranks[NKINDS];
+
+  return(policy_ranks(policy, ranks));
+}
+
+struct choice
+{
+  int ranks[NKINDS];
+  int rank;
+  int permanent;
+  struct in6_addr addr;
+};
+
+/* consider addr, which is usable, for the choice */
+static void consider(struct choice *c, struct in6_addr *addr, int temporary,
+    int permanent)
+{
+  int kind;
+  int rank;
+
+  if(IN6_IS_ADDR_LINKLOCAL(addr) || IN6_IS_ADDR_LOOPBACK(addr) ||
+      IN6_IS_ADDR_MULTICAST(addr) || IN6_IS_ADDR_UNSPECIFIED(addr) ||
+      IN6_IS_ADDR_V4MAPPED(addr) || IN6_IS_ADDR_SITELOCAL(addr))
+  {
+    return;
+  }
+
+  if(temporary)
+  {
+    kind = KIND_TEMPORARY;
+  }
+  else if((addr->s6_addr[0] & 0xfe) == 0xfc)
+  {
+    kind = KIND_ULA;
+  }
+  else
+  {
+    kind = KIND_STABLE;
+  }
+
+  if((rank=c->ranks[kind]) == -1)
+  {
+    return;
+  }
+  // a configured address beats an autoconfigured one of the same kind
+  if(c->rank == -1 || rank < c->rank ||
+      (rank == c->rank && permanent && !c->permanent))
+  {
+    c->rank = rank;
+    c->permanent = permanent;
+    memcpy(&c->addr, addr, sizeof(c->addr));
+  }
+}
+
+/* consider the addresses of device in the snapshot */
+static int scan_addrs(char *device, struct choice *c)
+{
+  struct ifsnap *snap;
+  struct ifsnap_addr *a;
+  int found = 0;
+  int i;
+
+  if((snap=ifsnap_get()) == NULL)
+  {
+    return(-1);
+  }
+  for(i=0; i<snap->naddrs; i++)
+  {
+    a = &snap->addrs[i];
+    if(a->family != AF_INET6 || strcmp(a->name, device) != 0)
+    {
+      continue;
+    }
+    found = 1;
+    if((a->flags & IFSNAP_GLOBAL) && !(a->flags & IFSNAP_UNUSABLE))
+    {
+      consider(c, &a->addr.v6, (a->flags & IFSNAP_TEMPORARY) != 0,
+          (a->flags & IFSNAP_PERMANENT) != 0);
+    }
+  }
+
+  return(found ? 0 : -1);
+}
+
+/*
+ * get_if_addr6
+ *
+ * the address of interface name that policy likes best. returns -1, and
+ * the unspecified address, if it has none.
+ */
+int get_if_addr6(char *name, char *policy, struct in6_addr *addr)
+{
+  struct choice c;
+  char device[IF_NAMESIZE];
+
+  memset(addr, 0, sizeof(*addr));
+  memset(&c, 0, sizeof(c));
+  c.rank = -1;
+  if(policy_ranks(policy, c.ranks) != 0)
+  {
+    return(-1);
+  }
+  ifsnap_device(name, device, sizeof(device));
+  if(scan_addrs(device, &c) != 0 || c.rank == -1)
+  {
+    dprintf((stderr, "%s: %s\n", name, "no usable IPv6 address"));
+    return(-1);
+  }
+  memcpy(addr, &c.addr, sizeof(*addr));
+
+  return(0);
+}
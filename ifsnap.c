@@ -0,0 +1,537 @@
+/* ============================================================================
+ * Copyright (C) 2001 Angus Mackay. All rights reserved; 
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2, or (at your option)
+ * any later version.
+ *
+ * THIS SOFTWARE IS PROVIDED ``AS IS'' AND ANY EXPRESSED OR IMPLIED WARRANTIES,
+ * INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND
+ * FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE
+ * AUTHOR BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY,
+ * OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ * ============================================================================
+ */
+
+/*
+ * ifsnap.c
+ *
+ * the addresses of every interface in as few system calls as it can be
+ * done in: on linux one netlink dump of the links, for their names, and one
+ * of the addresses, elsewhere getifaddrs().  the snapshot is kept until
+ * ifsnap_expire() is called, once a tick by the daemon, so however many
+ * lookups are made in between they cost nothing.
+ *
+ * an interface is given as
+ *
+ *   eth0           its primary IPv4 address
+ *   eth0:1         the address labelled eth0:1, an alias
+ *   eth0#2         its second IPv4 address, for secondaries with no label
+ *   default-route  the address the default route sends from, for hosts
+ *                  where the interface's name can't be relied on
+ *
+ */
+
+#ifdef HAVE_CONFIG_H
+#  include <config.h>
+#endif
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#if HAVE_SYS_TYPES_H
+#  include <sys/types.h>
+#endif
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <arpa/inet.h>
+#include <net/if.h>
+#ifdef __linux__
+#  include <linux/netlink.h>
+#  include <linux/rtnetlink.h>
+#elif HAVE_GETIFADDRS
+#  include <ifaddrs.h>
+#endif
+
+#include <dprintf.h>
+#include <ifsnap.h>
+
+static struct ifsnap snap;
+static int naddrs_alloc = 0;
+static int taken = 0;
+
+/* an address added to the snapshot, NULL if there's no memory for it */
+static struct ifsnap_addr *new_addr(void)
+{
+  struct ifsnap_addr *a;
+
+  if(snap.naddrs == naddrs_alloc)
+  {
+    int n = naddrs_alloc ? naddrs_alloc * 2 : 16;
+
+    if((a=realloc(snap.addrs, n * sizeof(*a))) == NULL)
+    {
+      return(NULL);
+    }
+    snap.addrs = a;
+    naddrs_alloc = n;
+  }
+  a = &snap.addrs[snap.naddrs++];
+  memset(a, 0, sizeof(*a));
+
+  return(a);
+}
+
+#ifdef __linux__
+struct iflink
+{
+  int index;
+  char name[IF_NAMESIZE];
+};
+
+static struct iflink *links = NULL;
+static int nlinks = 0;
+static int nlinks_alloc = 0;
+
+static void each_link(struct nlmsghdr *nh)
+{
+  struct ifinfomsg *ifi = (struct ifinfomsg *)NLMSG_DATA(nh);
+  struct rtattr *rta;
+  struct iflink *l;
+  int rtlen = IFLA_PAYLOAD(nh);
+
+  if(nlinks == nlinks_alloc)
+  {
+    int n = nlinks_alloc ? nlinks_alloc * 2 : 8;
+
+    if((l=realloc(links, n * sizeof(*l))) == NULL)
+    {
+      return;
+    }
+    links = l;
+    nlinks_alloc = n;
+  }
+  for(rta=IFLA_RTA(ifi); RTA_OK(rta, rtlen); rta=RTA_NEXT(rta, rtlen))
+  {
+    if(rta->rta_type == IFLA_IFNAME)
+    {
+      l = &links[nlinks++];
+      l->index = ifi->ifi_index;
+      snprintf(l->name, sizeof(l->name), "%s", (char *)RTA_DATA(rta));
+      break;
+    }
+  }
+}
+
+static void link_name(int index, char *name)
+{
+  int i;
+
+  for(i=0; i<nlinks; i++)
+  {
+    if(links[i].index == index)
+    {
+      memcpy(name, links[i].name, IF_NAMESIZE);
+      return;
+    }
+  }
+  // a link that came up between the two dumps
+  if(if_indextoname(index, name) == NULL)
+  {
+    *name = '\0';
+  }
+}
+
+static void each_addr(struct nlmsghdr *nh)
+{
+  struct ifaddrmsg *ifa = (struct ifaddrmsg *)NLMSG_DATA(nh);
+  struct ifsnap_addr *a;
+  struct rtattr *rta;
+  void *address = NULL;
+  void *local = NULL;
+  unsigned int flags = ifa->ifa_flags;
+  int rtlen = IFA_PAYLOAD(nh);
+
+  if((ifa->ifa_family != AF_INET && ifa->ifa_family != AF_INET6) ||
+      (a=new_addr()) == NULL)
+  {
+    return;
+  }
+  a->family = ifa->ifa_family;
+  link_name(ifa->ifa_index, a->name);
+  for(rta=IFA_RTA(ifa); RTA_OK(rta, rtlen); rta=RTA_NEXT(rta, rtlen))
+  {
+    switch(rta->rta_type)
+    {
+      case IFA_ADDRESS:
+        address = RTA_DATA(rta);
+        break;
+      // on a point to point link IFA_ADDRESS is the other end
+      case IFA_LOCAL:
+        local = RTA_DATA(rta);
+        break;
+      case IFA_LABEL:
+        snprintf(a->label, sizeof(a->label), "%s", (char *)RTA_DATA(rta));
+        break;
+      // the flags that don't fit in ifa_flags
+      case IFA_FLAGS:
+        flags = *(unsigned int *)RTA_DATA(rta);
+        break;
+    }
+  }
+  if(local != NULL)
+  {
+    address = local;
+  }
+  if(address == NULL)
+  {
+    snap.naddrs--;
+    return;
+  }
+  memcpy(&a->addr, address, a->family == AF_INET ?
+      sizeof(struct in_addr) : sizeof(struct in6_addr));
+  if(*a->label == '\0')
+  {
+    memcpy(a->label, a->name, IF_NAMESIZE);
+  }
+  if(flags & IFA_F_SECONDARY) { a->flags |= IFSNAP_SECONDARY; }
+  if(flags & IFA_F_TEMPORARY) { a->flags |= IFSNAP_TEMPORARY; }
+  if(flags & IFA_F_PERMANENT) { a->flags |= IFSNAP_PERMANENT; }
+  if(flags & (IFA_F_TENTATIVE | IFA_F_DEPRECATED | IFA_F_DADFAILED))
+  {
+    a->flags |= IFSNAP_UNUSABLE;
+  }
+  if(ifa->ifa_scope == RT_SCOPE_UNIVERSE)
+  {
+    a->flags |= IFSNAP_GLOBAL;
+  }
+}
+
+/* send a dump request of type and pass each answer to each */
+static int dump(int fd, int type, int seq, void (*each)(struct nlmsghdr *nh))
+{
+  struct
+  {
+    struct nlmsghdr nh;
+    // long enough for an ifaddrmsg too, both start with the family
+    struct ifinfomsg ifi;
+  } req;
+  char buf[8192];
+  struct nlmsghdr *nh;
+  int len;
+
+  memset(&req, 0, sizeof(req));
+  req.nh.nlmsg_len = NLMSG_LENGTH(type == RTM_GETLINK ?
+      sizeof(struct ifinfomsg) : sizeof(struct ifaddrmsg));
+  req.nh.nlmsg_type = type;
+  req.nh.nlmsg_flags = NLM_F_REQUEST | NLM_F_DUMP;
+  req.nh.nlmsg_seq = seq;
+  if(send(fd, &req, req.nh.nlmsg_len, 0) == -1)
+  {
+    return(-1);
+  }
+
+  while((len=recv(fd, buf, sizeof(buf), 0)) > 0)
+  {
+    for(nh=(struct nlmsghdr *)buf; NLMSG_OK(nh, len); nh=NLMSG_NEXT(nh, len))
+    {
+      if(nh->nlmsg_seq != seq)
+      {
+        continue;
+      }
+      if(nh->nlmsg_type == NLMSG_DONE)
+      {
+        return(0);
+      }
+      if(nh->nlmsg_type == NLMSG_ERROR)
+      {
+        return(-1);
+      }
+      each(nh);
+    }
+  }
+
+  return(-1);
+}
+
+static int take(void)
+{
+  int fd;
+  int ret;
+
+  if((fd=socket(AF_NETLINK, SOCK_RAW, NETLINK_ROUTE)) == -1)
+  {
+    return(-1);
+  }
+  nlinks = 0;
+  ret = dump(fd, RTM_GETLINK, 1, each_link);
+  if(ret == 0)
+  {
+    ret = dump(fd, RTM_GETADDR, 2, each_addr);
+  }
+  close(fd);
+
+  return(ret);
+}
+#elif HAVE_GETIFADDRS
+static int take(void)
+{
+  struct ifaddrs *ifap;
+  struct ifaddrs *ifa;
+  struct ifsnap_addr *a;
+  int i;
+
+  if(getifaddrs(&ifap) != 0)
+  {
+    return(-1);
+  }
+  for(ifa=ifap; ifa != NULL; ifa=ifa->ifa_next)
+  {
+    if(ifa->ifa_addr == NULL || (ifa->ifa_addr->sa_family != AF_INET &&
+          ifa->ifa_addr->sa_family != AF_INET6) || (a=new_addr()) == NULL)
+    {
+      continue;
+    }
+    a->family = ifa->ifa_addr->sa_family;
+    snprintf(a->label, sizeof(a->label), "%s", ifa->ifa_name);
+    snprintf(a->name, sizeof(a->name), "%s", ifa->ifa_name);
+    a->name[strcspn(a->name, ":")] = '\0';
+    if(a->family == AF_INET)
+    {
+      a->addr.v4 = ((struct sockaddr_in *)ifa->ifa_addr)->sin_addr;
+      a->flags |= IFSNAP_GLOBAL;
+      // the first address of a device is its primary one
+      for(i=0; i<snap.naddrs-1; i++)
+      {
+        if(snap.addrs[i].family == AF_INET &&
+            strcmp(snap.addrs[i].name, a->name) == 0)
+        {
+          a->flags |= IFSNAP_SECONDARY;
+          break;
+        }
+      }
+    }
+    else
+    {
+      a->addr.v6 = ((struct sockaddr_in6 *)ifa->ifa_addr)->sin6_addr;
+      if(!IN6_IS_ADDR_LINKLOCAL(&a->addr.v6) &&
+          !IN6_IS_ADDR_LOOPBACK(&a->addr.v6))
+      {
+        a->flags |= IFSNAP_GLOBAL;
+      }
+    }
+  }
+  freeifaddrs(ifap);
+
+  return(0);
+}
+#else
+static int take(void)
+{
+  return(-1);
+}
+#endif
+
+#ifdef __linux__
+/* the default route's gateway, from the kernel's table */
+static void find_gateway(void)
+{
+  FILE *fp;
+  char line[256];
+  unsigned long dest;
+  unsigned long gateway;
+  unsigned int flags;
+
+  if((fp=fopen("/proc/net/route", "r")) == NULL)
+  {
+    return;
+  }
+  while(fgets(line, sizeof(line), fp) != NULL)
+  {
+    // Iface Destination Gateway Flags ..., in network order hex
+    if(sscanf(line, "%*s %lx %lx %x", &dest, &gateway, &flags) == 3 &&
+        dest == 0 && (flags & 0x2) && gateway != 0)
+    {
+      snap.have_gateway = 1;
+      snap.gateway.s_addr = gateway;
+      break;
+    }
+  }
+  fclose(fp);
+}
+#else
+static void find_gateway(void)
+{
+}
+#endif
+
+/* the address the default route would send from, and its gateway */
+static void find_route(void)
+{
+  struct sockaddr_in sin;
+  socklen_t len = sizeof(sin);
+  int fd;
+
+  snap.have_route = 0;
+  snap.have_gateway = 0;
+  find_gateway();
+  if((fd=socket(AF_INET, SOCK_DGRAM, 0)) == -1)
+  {
+    return;
+  }
+  // nothing is sent, connecting a UDP socket only picks its route. any
+  // address off the local networks would do
+  memset(&sin, 0, sizeof(sin));
+  sin.sin_family = AF_INET;
+  sin.sin_port = htons(53);
+  sin.sin_addr.s_addr = htonl(0x08080808);
+  if(connect(fd, (struct sockaddr *)&sin, sizeof(sin)) == 0 &&
+      getsockname(fd, (struct sockaddr *)&sin, &len) == 0 &&
+      sin.sin_addr.s_addr != INADDR_ANY)
+  {
+    snap.have_route = 1;
+    snap.route_addr = sin.sin_addr;
+  }
+  close(fd);
+}
+
+/* the next lookup takes a new snapshot */
+void ifsnap_expire(void)
+{
+  taken = 0;
+}
+
+/*
+ * ifsnap_get
+ *
+ * the snapshot, taken now if there isn't a current one. NULL if it can't
+ * be taken on this system.
+ */
+struct ifsnap *ifsnap_get(void)
+{
+  if(!taken)
+  {
+    snap.naddrs = 0;
+    if(take() != 0)
+    {
+      dprintf((stderr, "could not take an interface snapshot\n"));
+      return(NULL);
+    }
+    find_route();
+    taken = 1;
+  }
+
+  return(&snap);
+}
+
+/*
+ * ifsnap_addr4
+ *
+ * the IPv4 address of interface spec and, if device isn't NULL, the device
+ * it is on. returns -1 if there is none and -2 if there's no snapshot.
+ */
+int ifsnap_addr4(char *spec, struct in_addr *addr, char *device, int size)
+{
+  struct ifsnap_addr *found = NULL;
+  struct ifsnap_addr *a;
+  char name[IF_NAMESIZE];
+  char *p;
+  int nth = 0;
+  int i;
+
+  if(ifsnap_get() == NULL)
+  {
+    return(-2);
+  }
+
+  snprintf(name, sizeof(name), "%s", spec);
+  if((p=strchr(name, '#')) != NULL)
+  {
+    *p = '\0';
+    if((nth=atoi(p + 1)) < 1)
+    {
+      return(-1);
+    }
+  }
+  for(i=0; i<snap.naddrs; i++)
+  {
+    a = &snap.addrs[i];
+    if(a->family != AF_INET)
+    {
+      continue;
+    }
+    if(strcmp(spec, IFSNAP_DEFAULT_ROUTE) == 0)
+    {
+      if(snap.have_route && a->addr.v4.s_addr == snap.route_addr.s_addr)
+      {
+        found = a;
+        break;
+      }
+    }
+    else if(nth > 0)
+    {
+      if(strcmp(a->name, name) == 0 && --nth == 0)
+      {
+        found = a;
+        break;
+      }
+    }
+    // a primary address beats a secondary with the same label
+    else if(strcmp(a->label, name) == 0 && (found == NULL ||
+          ((found->flags & IFSNAP_SECONDARY) &&
+           !(a->flags & IFSNAP_SECONDARY))))
+    {
+      found = a;
+    }
+  }
+  if(found == NULL)
+  {
+    return(-1);
+  }
+
+  memcpy(addr, &found->addr.v4, sizeof(*addr));
+  if(device != NULL)
+  {
+    snprintf(device, size, "%s", found->name);
+  }
+  return(0);
+}
+
+/*
+ * ifsnap_device
+ *
+ * the device interface spec is on, "" if that can't be told
+ */
+void ifsnap_device(char *spec, char *device, int size)
+{
+  struct in_addr addr;
+
+  if(strcmp(spec, IFSNAP_DEFAULT_ROUTE) == 0)
+  {
+    if(ifsnap_addr4(spec, &addr, device, size) != 0)
+    {
+      *device = '\0';
+    }
+    return;
+  }
+  snprintf(device, size, "%s", spec);
+  device[strcspn(device, ":#")] = '\0';
+}
+
+void ifsnap_free(void)
+{
+  if(snap.addrs) { free(snap.addrs); snap.addrs = NULL; }
+  snap.naddrs = naddrs_alloc = 0;
+#ifdef __linux__
+  if(links) { free(links); links = NULL; }
+  nlinks = nlinks_alloc = 0;
+#endif
+  taken = 0;
+}
@@ -0,0 +1,80 @@
+/* ============================================================================
+ * Copyright (C) 2001 Angus Mackay. All rights reserved; 
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2, or (at your option)
+ * any later version.
+ *
+ * THIS SOFTWARE IS PROVIDED ``AS IS'' AND ANY EXPRESSED OR IMPLIED WARRANTIES,
+ * INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND
+ * FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE
+ * AUTHOR BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY,
+ * OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ * ============================================================================
+ */
+
+/*
+ * ifsnap.h
+ *
+ * one look at every interface's addresses, shared by all the lookups made
+ * until it is expired
+ *
+ */
+
+#ifndef _IFSNAP_H
+#define _IFSNAP_H
+
+#include <netinet/in.h>
+#include <net/if.h>
+
+/* the interface to give for the one the default route goes out of */
+#define IFSNAP_DEFAULT_ROUTE "default-route"
+
+/* address flags */
+#define IFSNAP_SECONDARY  0x0001
+#define IFSNAP_TEMPORARY  0x0002
+#define IFSNAP_PERMANENT  0x0004
+// tentative, deprecated or failed duplicate detection
+#define IFSNAP_UNUSABLE   0x0008
+#define IFSNAP_GLOBAL     0x0010
+
+struct ifsnap_addr
+{
+  // the device and, for an alias like eth0:1, its label
+  char name[IF_NAMESIZE];
+  char label[IF_NAMESIZE];
+  int family;
+  int flags;
+  union
+  {
+    struct in_addr v4;
+    struct in6_addr v6;
+  } addr;
+};
+
+struct ifsnap
+{
+  struct ifsnap_addr *addrs;
+  int naddrs;
+  // the source address of the default route, if there is one
+  int have_route;
+  struct in_addr route_addr;
+  // and its gateway, where that can be found out
+  int have_gateway;
+  struct in_addr gateway;
+};
+
+extern void ifsnap_expire(void);
+extern struct ifsnap *ifsnap_get(void);
+extern int ifsnap_addr4(char *spec, struct in_addr *addr, char *device,
+    int size);
+extern void ifsnap_device(char *spec, char *device, int size);
+extern void ifsnap_free(void);
+
+#endif
@@ -0,0 +1,609 @@
+/* ============================================================================
+ * Copyright (C) 2001 Angus Mackay. All rights reserved; 
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2, or (at your option)
+ * any later version.
+ *
+ * THIS SOFTWARE IS PROVIDED ``AS IS'' AND ANY EXPRESSED OR IMPLIED WARRANTIES,
+ * INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND
+ * FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE
+ * AUTHOR BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY,
+ * OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ * ============================================================================
+ */
+
+/*
+ * logger.c
+ *
+ * messages are formatted by the caller into a fixed size record and put
+ * on a lock-free ring (a bounded MPMC queue in the style of Dmitry Vyukov's,
+ * each slot carries a sequence number saying whose turn it is). a
+ * background thread takes them off and does the actual syslog() or write,
+ * so a backed up syslog socket or a slow disk never stalls an update. if
+ * the ring is full the record is dropped and counted rather than waited
+ * for. without pthreads records are written straight away.
+ *
+ * a message the same as one logged less than LOG_REPEAT_WINDOW seconds
+ * ago, from the same format with the same arguments, is only counted.
+ * one that differs in anything, if only an address, is logged: two
+ * updates to different addresses are both news.  when the window is up a
+ * timer in the event loop logs a "repeated N times" line (so does close).
+ * the table that tracks this is small and best effort, two messages
+ * sharing a slot just evict each other.
+ *
+ * targets are "syslog", "stderr" or "file:<path>". file records are
+ * written as key=value pairs with a timestamp and level, logger_kv()
+ * records are key=value pairs everywhere.
+ *
+ */
+
+#ifdef HAVE_CONFIG_H
+#  include <config.h>
+#endif
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <time.h>
+#if HAVE_LIBPTHREAD && HAVE_PTHREAD_H && HAVE_SEMAPHORE_H
+#  define LOG_THREAD 1
+#  include <pthread.h>
+#  include <semaphore.h>
+#endif
+
+#include <event.h>
+#include <logger.h>
+
+#if !defined(__GNUC__) && !defined(HAVE_SNPRINTF)
+#error "get gcc, fix this code, or find yourself a snprintf!"
+#else
+#  if HAVE_SNPRINTF
+#    define  snprintf(x, y, z...) snprintf(x, y, ## z)
+#  else
+#    define  snprintf(x, y, z...) sprintf(x, ## z)
+#  endif
+#endif
+#if HAVE_VSNPRINTF
+#  define  vsnprintf(x, y, z...) vsnprintf(x, y, ## z)
+#else
+#  define  vsnprintf(x, y, z...) vsprintf(x, ## z)
+#endif
+
+#define LOG_MSG_LEN 256
+#define LOG_RING_SIZE 64
+#define LOG_RING_MASK (LOG_RING_SIZE-1)
+#define DEDUP_SLOTS 32
+#define DEDUP_TEXT_LEN 64
+
+enum { TARGET_STDERR = 0, TARGET_SYSLOG, TARGET_FILE };
+
+struct log_rec
+{
+  unsigned long seq;
+  time_t when;
+  int pri;
+  int kv;
+  char msg[LOG_MSG_LEN];
+};
+
+// allocated by logger_open(), until then records are written directly
+static struct log_rec *ring = NULL;
+static unsigned long ring_head = 0;
+static unsigned long ring_tail = 0;
+
+static struct
+{
+  unsigned long hash;
+  time_t first;
+  unsigned long repeats;
+  int pri;
+  // the message that was held back
+  char text[DEDUP_TEXT_LEN];
+} dedup[DEDUP_SLOTS];
+static int repeats_armed = 0;
+
+static int target = TARGET_STDERR;
+static FILE *logfp = NULL;
+static int opened = 0;
+static int registered = 0;
+static unsigned long dropped = 0;
+static unsigned long suppressed = 0;
+
+#ifdef LOG_THREAD
+static pthread_t flusher;
+static sem_t pending;
+static volatile int stopping = 0;
+#endif
+
+static char *level_name(int pri)
+{
+  switch(pri)
+  {
+    case LOG_ERR: return("err");
+    case LOG_WARNING: return("warning");
+    case LOG_NOTICE: return("notice");
+    case LOG_INFO: return("info");
+    case LOG_DEBUG: return("debug");
+  }
+  return("notice");
+}
+
+static void write_record(struct log_rec *rec)
+{
+  char timebuf[32];
+  char *p;
+  int len;
+
+  // the file format is one record per line
+  len = strlen(rec->msg);
+  while(len > 0 && (rec->msg[len-1] == '\n' || rec->msg[len-1] == '\r'))
+  {
+    rec->msg[--len] = '\0';
+  }
+
+  switch(target)
+  {
+    case TARGET_SYSLOG:
+#if HAVE_SYSLOG_H
+      syslog(rec->pri, "%s", rec->msg);
+      break;
+#endif
+    case TARGET_STDERR:
+      fprintf(stderr, "%s\n", rec->msg);
+      break;
+
+    case TARGET_FILE:
+      strftime(timebuf, sizeof(timebuf), "%Y-%m-%dT%H:%M:%S", localtime(&rec->when));
+      fprintf(logfp, "ts=%s level=%s ", timebuf, level_name(rec->pri));
+      if(rec->kv)
+      {
+        fprintf(logfp, "%s\n", rec->msg);
+      }
+      else
+      {
+        fputs("msg=\"", logfp);
+        for(p=rec->msg; *p != '\0'; p++)
+        {
+          if(*p == '"' || *p == '\\') { fputc('\\', logfp); }
+          fputc(*p, logfp);
+        }
+        fputs("\"\n", logfp);
+      }
+      break;
+  }
+}
+
+static void flush_output(void)
+{
+  if(target == TARGET_FILE) { fflush(logfp); }
+  else if(target == TARGET_STDERR) { fflush(stderr); }
+}
+
+/*
+ * ring_put
+ *
+ * claim the next slot, fill it in and publish it. never waits, returns -1
+ * if the ring is full.
+ */
+static int ring_put(int pri, int kv, char *msg)
+{
+  struct log_rec *rec;
+  unsigned long pos;
+  long diff;
+
+  pos = __atomic_load_n(&ring_head, __ATOMIC_RELAXED);
+  for(;;)
+  {
+    rec = &ring[pos & LOG_RING_MASK];
+    diff = (long)__atomic_load_n(&rec->seq, __ATOMIC_ACQUIRE) - (long)pos;
+    if(diff == 0)
+    {
+      if(__atomic_compare_exchange_n(&ring_head, &pos, pos+1, 0,
+            __ATOMIC_RELAXED, __ATOMIC_RELAXED))
+      {
+        break;
+      }
+    }
+    else if(diff < 0)
+    {
+      __atomic_add_fetch(&dropped, 1, __ATOMIC_RELAXED);
+      return(-1);
+    }
+    else
+    {
+      pos = __atomic_load_n(&ring_head, __ATOMIC_RELAXED);
+    }
+  }
+
+  rec->when = time(NULL);
+  rec->pri = pri;
+  rec->kv = kv;
+  strncpy(rec->msg, msg, LOG_MSG_LEN);
+  rec->msg[LOG_MSG_LEN-1] = '\0';
+  __atomic_store_n(&rec->seq, pos+1, __ATOMIC_RELEASE);
+
+  return(0);
+}
+
+/* only ever called by one thread at a time */
+static void ring_drain(void)
+{
+  struct log_rec *rec;
+  int n = 0;
+
+  for(;;)
+  {
+    rec = &ring[ring_tail & LOG_RING_MASK];
+    if(__atomic_load_n(&rec->seq, __ATOMIC_ACQUIRE) != ring_tail+1)
+    {
+      break;
+    }
+    write_record(rec);
+    __atomic_store_n(&rec->seq, ring_tail + LOG_RING_SIZE, __ATOMIC_RELEASE);
+    ring_tail++;
+    n++;
+  }
+  if(n > 0) { flush_output(); }
+}
+
+#ifdef LOG_THREAD
+static void *flusher_main(void *arg)
+{
+  while(!stopping)
+  {
+    sem_wait(&pending);
+    ring_drain();
+  }
+  ring_drain();
+
+  return(NULL);
+}
+#endif
+
+static void emit(int pri, int kv, char *msg)
+{
+  struct log_rec rec;
+
+  if(!opened)
+  {
+    rec.when = time(NULL);
+    rec.pri = pri;
+    rec.kv = kv;
+    strncpy(rec.msg, msg, LOG_MSG_LEN);
+    rec.msg[LOG_MSG_LEN-1] = '\0';
+    write_record(&rec);
+    return;
+  }
+
+#ifdef LOG_THREAD
+  if(ring_put(pri, kv, msg) == 0)
+  {
+    sem_post(&pending);
+  }
+#else
+  if(ring_put(pri, kv, msg) == 0)
+  {
+    ring_drain();
+  }
+#endif
+}
+
+static void emit_repeats(int slot)
+{
+  char msg[LOG_MSG_LEN];
+  unsigned long n;
+
+  if((n=__atomic_exchange_n(&dedup[slot].repeats, 0, __ATOMIC_RELAXED)) == 0)
+  {
+    return;
+  }
+  snprintf(msg, sizeof(msg), "message repeated %lu times: %s", n,
+      dedup[slot].text);
+  emit(dedup[slot].pri, 0, msg);
+}
+
+static void repeats_due(void *arg);
+
+/* have the event loop call repeats_due() once the window from first is up */
+static void repeats_arm(time_t first)
+{
+  long msec = (first + LOG_REPEAT_WINDOW - time(NULL)) * 1000L;
+
+  if(repeats_armed)
+  {
+    return;
+  }
+  // if the timers are all taken the count still comes out with the next
+  // message in the slot or at close
+  if(event_timer(msec > 0 ? msec : 0, repeats_due, NULL) == 0)
+  {
+    repeats_armed = 1;
+  }
+}
+
+static void repeats_due(void *arg)
+{
+  time_t now = time(NULL);
+  time_t next = 0;
+  int i;
+
+  repeats_armed = 0;
+  for(i=0; i<DEDUP_SLOTS; i++)
+  {
+    if(dedup[i].repeats == 0)
+    {
+      continue;
+    }
+    if(now - dedup[i].first >= LOG_REPEAT_WINDOW)
+    {
+      emit_repeats(i);
+      dedup[i].hash = 0;
+    }
+    else if(next == 0 || dedup[i].first < next)
+    {
+      next = dedup[i].first;
+    }
+  }
+  if(next != 0)
+  {
+    repeats_arm(next);
+  }
+}
+
+/* the hash of the format and the message made from it, so its arguments */
+static unsigned long hash_message(char *fmt, char *msg)
+{
+  unsigned long h = 2166136261UL;
+
+  while(*fmt)
+  {
+    h = (h ^ (unsigned char)*fmt++) * 16777619UL;
+  }
+  while(*msg)
+  {
+    h = (h ^ (unsigned char)*msg++) * 16777619UL;
+  }
+  return(h);
+}
+
+/* remember msg as the message held back in slot */
+static void dedup_text(int slot, char *msg)
+{
+  int len;
+
+  snprintf(dedup[slot].text, sizeof(dedup[slot].text), "%s", msg);
+  len = strlen(dedup[slot].text);
+  if(len > 0 && dedup[slot].text[len-1] == '\n') { dedup[slot].text[len-1] = '\0'; }
+}
+
+void logger_vlog(int pri, char *fmt, va_list args)
+{
+  char msg[LOG_MSG_LEN];
+  unsigned long h;
+  time_t now;
+  int slot;
+
+#if defined(HAVE_VSPRINTF) || defined(HAVE_VSNPRINTF)
+  vsnprintf(msg, sizeof(msg), fmt, args);
+#else
+  snprintf(msg, sizeof(msg), "message incomplete because your OS sucks: %s\n", fmt);
+#endif
+
+  h = hash_message(fmt, msg);
+  slot = h % DEDUP_SLOTS;
+  now = time(NULL);
+
+  if(dedup[slot].hash == h && now - dedup[slot].first < LOG_REPEAT_WINDOW)
+  {
+    __atomic_add_fetch(&dedup[slot].repeats, 1, __ATOMIC_RELAXED);
+    __atomic_add_fetch(&suppressed, 1, __ATOMIC_RELAXED);
+    dedup_text(slot, msg);
+    if(opened)
+    {
+      repeats_arm(dedup[slot].first);
+    }
+    return;
+  }
+
+  emit_repeats(slot);
+  dedup[slot].hash = h;
+  dedup[slot].first = now;
+  dedup[slot].pri = pri;
+  dedup_text(slot, msg);
+
+  emit(pri, 0, msg);
+}
+
+void logger_log(int pri, char *fmt, ...)
+{
+  va_list args;
+
+  va_start(args, fmt);
+  logger_vlog(pri, fmt, args);
+  va_end(args);
+}
+
+/*
+ * logger_kv
+ *
+ * log a structured record: "event=<event>" followed by the NULL terminated
+ * list of key, value string pairs. values with spaces are quoted and pairs
+ * with an empty key are left out, for fields that are only sometimes there.
+ */
+void logger_kv(int pri, char *event, ...)
+{
+  char msg[LOG_MSG_LEN];
+  char *end = msg + sizeof(msg);
+  char *p = msg;
+  char *key;
+  char *val;
+  va_list args;
+
+  p += snprintf(p, end - p, "event=%s", event);
+
+  va_start(args, event);
+  while(p < end && (key=va_arg(args, char *)) != NULL)
+  {
+    val = va_arg(args, char *);
+    if(val == NULL) { val = ""; }
+    if(*key == '\0')
+    {
+      continue;
+    }
+    if(*val == '\0' || strpbrk(val, " \t\"=") != NULL)
+    {
+      p += snprintf(p, end - p, " %s=\"%s\"", key, val);
+    }
+    else
+    {
+      p += snprintf(p, end - p, " %s=%s", key, val);
+    }
+  }
+  va_end(args);
+
+  emit(pri, 1, msg);
+}
+
+/*
+ * logger_open
+ *
+ * start logging to target. this has to be done after any fork() as the
+ * flusher thread doesn't survive one. returns 0 on success.
+ */
+int logger_open(char *where, char *ident)
+{
+  int i;
+
+  if(opened)
+  {
+    logger_close();
+  }
+  if(ring == NULL &&
+      (ring=malloc(LOG_RING_SIZE * sizeof(struct log_rec))) == NULL)
+  {
+    return(-1);
+  }
+
+  if(strcmp(where, "syslog") == 0)
+  {
+#if HAVE_SYSLOG_H
+    openlog(ident, LOG_PID, LOG_USER);
+    target = TARGET_SYSLOG;
+#else
+    return(-1);
+#endif
+  }
+  else if(strcmp(where, "stderr") == 0)
+  {
+    target = TARGET_STDERR;
+  }
+  else if(strncmp(where, "file:", 5) == 0)
+  {
+    if((logfp=fopen(where+5, "a")) == NULL)
+    {
+      return(-1);
+    }
+    target = TARGET_FILE;
+  }
+  else
+  {
+    return(-1);
+  }
+
+  for(i=0; i<LOG_RING_SIZE; i++)
+  {
+    ring[i].seq = i;
+  }
+  ring_head = 0;
+  ring_tail = 0;
+
+#ifdef LOG_THREAD
+  stopping = 0;
+  if(sem_init(&pending, 0, 0) != 0)
+  {
+    return(-1);
+  }
+  if(pthread_create(&flusher, NULL, flusher_main, NULL) != 0)
+  {
+    sem_destroy(&pending);
+    return(-1);
+  }
+#endif
+
+  opened = 1;
+  if(!registered)
+  {
+    atexit(logger_close);
+    registered = 1;
+  }
+
+  return(0);
+}
+
+/*
+ * logger_close
+ *
+ * log any outstanding repeat counts, write out everything still queued
+ * and go back to writing to stderr directly.
+ */
+void logger_close(void)
+{
+  int i;
+
+  if(!opened)
+  {
+    return;
+  }
+
+#ifdef LOG_THREAD
+  stopping = 1;
+  sem_post(&pending);
+  pthread_join(flusher, NULL);
+  sem_destroy(&pending);
+#else
+  ring_drain();
+#endif
+  opened = 0;
+  event_timer_del(repeats_due, NULL);
+  repeats_armed = 0;
+
+  // the queue is empty now, these get written directly
+  for(i=0; i<DEDUP_SLOTS; i++)
+  {
+    emit_repeats(i);
+    dedup[i].hash = 0;
+  }
+  flush_output();
+
+  if(target == TARGET_FILE)
+  {
+    fclose(logfp);
+    logfp = NULL;
+  }
+#if HAVE_SYSLOG_H
+  else if(target == TARGET_SYSLOG)
+  {
+    closelog();
+  }
+#endif
+  target = TARGET_STDERR;
+}
+
+unsigned long logger_dropped(void)
+{
+  return(dropped);
+}
+
+unsigned long logger_suppressed(void)
+{
+  return(suppressed);
+}
+
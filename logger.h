@@ -0,0 +1,56 @@
+/* ============================================================================
+ * Copyright (C) 2001 Angus Mackay. All rights reserved; 
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2, or (at your option)
+ * any later version.
+ *
+ * THIS SOFTWARE IS PROVIDED ``AS IS'' AND ANY EXPRESSED OR IMPLIED WARRANTIES,
+ * INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND
+ * FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE
+ * AUTHOR BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY,
+ * OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ * ============================================================================
+ */
+
+/*
+ * logger.h
+ *
+ * buffered, de-duplicating logger for daemon mode
+ *
+ */
+
+#ifndef _LOGGER_H
+#define _LOGGER_H
+
+#if HAVE_STDARG_H
+#  include <stdarg.h>
+#endif
+#if HAVE_SYSLOG_H
+#  include <syslog.h>
+#else
+#  define LOG_ERR     3
+#  define LOG_WARNING 4
+#  define LOG_NOTICE  5
+#  define LOG_INFO    6
+#  define LOG_DEBUG   7
+#endif
+
+/* how long a message said again is folded into a "repeated" summary */
+#define LOG_REPEAT_WINDOW 300
+
+extern int logger_open(char *target, char *ident);
+extern void logger_close(void);
+extern void logger_vlog(int pri, char *fmt, va_list args);
+extern void logger_log(int pri, char *fmt, ...);
+extern void logger_kv(int pri, char *event, ...);
+extern unsigned long logger_dropped(void);
+extern unsigned long logger_suppressed(void);
+
+#endif
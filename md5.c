@@ -35,6 +35,15 @@
 
 #include "md5.h"
 
+#ifdef HAVE_SYS_TIME_H
+# include <sys/time.h>
+#endif
+
+#if HAVE_LIBPTHREAD && HAVE_PTHREAD_H
+# include <pthread.h>
+# define MB_ONCE 1
+#endif
+
 #ifdef _LIBC
 # include <endian.h>
 # if __BYTE_ORDER == __BIG_ENDIAN
@@ -399,4 +408,416 @@ md5_process_block (const void *buffer, size_t len, struct md5_ctx *ctx)
   ctx->C = C;
   ctx->D = D;
 }
+
+
+/* Multi-buffer interface.
+
+   `md5_buffers' hashes many short, independent messages at once.  The
+   messages are dealt out to the lanes of a SIMD register (4 lanes of 32
+   bits for SSE2 or NEON, 8 for AVX2, 16 for AVX-512) and every lane runs
+   the same MD5 step on its own message.  A lane whose message is shorter
+   than the others in its group is masked off so its state stops changing
+   once its last block has been processed.
+
+   The kernels use the GCC vector extensions so one description of the
+   algorithm serves every width; the wider ones are compiled with a target
+   attribute and only used when the CPU reports support for them.  Wider
+   is not always faster (an AVX2 kernel can lose to SSE2 on CPUs that
+   split 256 bit operations), so the first call times every supported
+   kernel on a small batch and keeps the fastest.
+
+   Each lane's message words are read straight out of the message, one
+   32 bit load per word, and only the last block or two, which hold the
+   padding and length, are copied to a buffer.  */
+
+/* Word index, rotate count and additive constant of each of the 64 steps
+   (RFC 1321, 3.4).  */
+static const unsigned char mb_index[64] =
+{
+  0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11, 12, 13, 14, 15,
+  1, 6, 11, 0, 5, 10, 15, 4, 9, 14, 3, 8, 13, 2, 7, 12,
+  5, 8, 11, 14, 1, 4, 7, 10, 13, 0, 3, 6, 9, 12, 15, 2,
+  0, 7, 14, 5, 12, 3, 10, 1, 8, 15, 6, 13, 4, 11, 2, 9
+};
+
+static const unsigned char mb_shift[64] =
+{
+  7, 12, 17, 22, 7, 12, 17, 22, 7, 12, 17, 22, 7, 12, 17, 22,
+  5, 9, 14, 20, 5, 9, 14, 20, 5, 9, 14, 20, 5, 9, 14, 20,
+  4, 11, 16, 23, 4, 11, 16, 23, 4, 11, 16, 23, 4, 11, 16, 23,
+  6, 10, 15, 21, 6, 10, 15, 21, 6, 10, 15, 21, 6, 10, 15, 21
+};
+
+static const md5_uint32 mb_T[64] =
+{
+  0xd76aa478, 0xe8c7b756, 0x242070db, 0xc1bdceee,
+  0xf57c0faf, 0x4787c62a, 0xa8304613, 0xfd469501,
+  0x698098d8, 0x8b44f7af, 0xffff5bb1, 0x895cd7be,
+  0x6b901122, 0xfd987193, 0xa679438e, 0x49b40821,
+  0xf61e2562, 0xc040b340, 0x265e5a51, 0xe9b6c7aa,
+  0xd62f105d, 0x02441453, 0xd8a1e681, 0xe7d3fbc8,
+  0x21e1cde6, 0xc33707d6, 0xf4d50d87, 0x455a14ed,
+  0xa9e3e905, 0xfcefa3f8, 0x676f02d9, 0x8d2a4c8a,
+  0xfffa3942, 0x8771f681, 0x6d9d6122, 0xfde5380c,
+  0xa4beea44, 0x4bdecfa9, 0xf6bb4b60, 0xbebfbc70,
+  0x289b7ec6, 0xeaa127fa, 0xd4ef3085, 0x04881d05,
+  0xd9d4d039, 0xe6db99e5, 0x1fa27cf8, 0xc4ac5665,
+  0xf4292244, 0x432aff97, 0xab9423a7, 0xfc93a039,
+  0x655b59c3, 0x8f0ccc92, 0xffeff47d, 0x85845dd1,
+  0x6fa87e4f, 0xfe2ce6e0, 0xa3014314, 0x4e0811a1,
+  0xf7537e82, 0xbd3af235, 0x2ad7d2bb, 0xeb86d391
+};
+
+/* Number of 64 byte blocks a LEN byte message occupies once padded.  */
+#define MB_NBLOCKS(len) (((len) + 8) / 64 + 1)
+
+/* Bytes of the message BUFFER/LEN that are in whole blocks, the rest go
+   in the padded tail.  */
+#define MB_FULL(len) ((len) / 64 * 64)
+
+/* A block of words to feed the lanes that have finished.  */
+static const unsigned char mb_zero[64];
+
+/* Store the padded last block or two of the message BUFFER/LEN in TAIL,
+   which holds 128 bytes.  */
+static void
+mb_pad_tail (const char *buffer, size_t len, unsigned char *tail)
+{
+  size_t n = len - MB_FULL (len);
+  size_t end = (MB_NBLOCKS (len) - len / 64) * 64;
+  md5_uint32 lo = (md5_uint32) len << 3;
+  md5_uint32 hi = (md5_uint32) ((unsigned long) len >> 29);
+  int i;
+
+  memcpy (tail, buffer + MB_FULL (len), n);
+  tail[n] = 0x80;
+  memset (tail + n + 1, 0, end - n - 1);
+  for (i = 0; i < 4; i++)
+    {
+      tail[end - 8 + i] = (lo >> (8 * i)) & 0xff;
+      tail[end - 4 + i] = (hi >> (8 * i)) & 0xff;
+    }
+}
+
+/* Store the 16 little endian words at P as W[0], W[STRIDE], ...  */
+static inline void
+mb_load_words (const unsigned char *p, md5_uint32 *w, size_t stride)
+{
+  md5_uint32 v;
+  int i;
+
+  for (i = 0; i < 16; i++)
+    {
+      memcpy (&v, p + 4 * i, 4);
+      w[i * stride] = SWAP (v);
+    }
+}
+
+static void
+mb_store_digest (md5_uint32 A, md5_uint32 B, md5_uint32 C, md5_uint32 D,
+		 void *resblock)
+{
+  unsigned char *r = resblock;
+  md5_uint32 v[4];
+  int i;
+
+  v[0] = A;
+  v[1] = B;
+  v[2] = C;
+  v[3] = D;
+  for (i = 0; i < 16; i++)
+    r[i] = (v[i / 4] >> (8 * (i % 4))) & 0xff;
+}
+
+static void
+md5_buffers_scalar (const char *const *buffers, const size_t *lens,
+		    size_t n, void *const *resblocks)
+{
+  size_t i;
+
+  for (i = 0; i < n; i++)
+    md5_buffer (buffers[i], lens[i], resblocks[i]);
+}
+
+#if defined __GNUC__ && __GNUC__ >= 5
+# define MB_VECTOR 1
+# if defined __x86_64__ || defined __i386__
+#  define MB_X86 1
+# endif
+#endif
+
+#ifdef MB_VECTOR
+
+typedef md5_uint32 mb_v4 __attribute__ ((vector_size (16)));
+# ifdef MB_X86
+typedef md5_uint32 mb_v8 __attribute__ ((vector_size (32)));
+typedef md5_uint32 mb_v16 __attribute__ ((vector_size (64)));
+# endif
+
+/* Define NAME as a kernel hashing up to LANES messages at a time with
+   vectors of type VT.  ATTR carries the target attribute, if any.  */
+# define MB_KERNEL(NAME, VT, LANES, ATTR)				\
+ATTR static void							\
+NAME (const char *const *buffers, const size_t *lens, size_t n,	\
+      void *const *resblocks)						\
+{									\
+  md5_uint32 m[16][LANES] __attribute__ ((aligned (64)));		\
+  md5_uint32 live[LANES] __attribute__ ((aligned (64)));		\
+  unsigned char tail[LANES][128];					\
+  size_t nblocks[LANES];						\
+  size_t full[LANES];							\
+  const unsigned char *p;						\
+  size_t base, blk, maxblocks;						\
+  VT A, B, C, D, a, b, c, d, f, t, mask;				\
+  int i, l, lanes;							\
+									\
+  for (base = 0; base < n; base += LANES)				\
+    {									\
+      lanes = n - base < LANES ? n - base : LANES;			\
+      maxblocks = 0;							\
+      for (l = 0; l < LANES; l++)					\
+	{								\
+	  nblocks[l] = 0;						\
+	  full[l] = 0;							\
+	  if (l < lanes)						\
+	    {								\
+	      nblocks[l] = MB_NBLOCKS (lens[base + l]);			\
+	      full[l] = lens[base + l] / 64;				\
+	      mb_pad_tail (buffers[base + l], lens[base + l], tail[l]);	\
+	    }								\
+	  if (nblocks[l] > maxblocks)					\
+	    maxblocks = nblocks[l];					\
+	}								\
+									\
+      A = (VT) {} + 0x67452301;						\
+      B = (VT) {} + 0xefcdab89;						\
+      C = (VT) {} + 0x98badcfe;						\
+      D = (VT) {} + 0x10325476;						\
+									\
+      for (blk = 0; blk < maxblocks; blk++)				\
+	{								\
+	  for (l = 0; l < LANES; l++)					\
+	    {								\
+	      if (blk < full[l])					\
+		p = (const unsigned char *) buffers[base + l] + blk * 64; \
+	      else if (blk < nblocks[l])				\
+		p = tail[l] + (blk - full[l]) * 64;			\
+	      else							\
+		p = mb_zero;						\
+	      mb_load_words (p, &m[0][l], LANES);			\
+	      live[l] = blk < nblocks[l] ? 0xffffffff : 0;		\
+	    }								\
+									\
+	  a = A;							\
+	  b = B;							\
+	  c = C;							\
+	  d = D;							\
+	  for (i = 0; i < 64; i++)					\
+	    {								\
+	      if (i < 16)						\
+		f = d ^ (b & (c ^ d));					\
+	      else if (i < 32)						\
+		f = c ^ (d & (b ^ c));					\
+	      else if (i < 48)						\
+		f = b ^ c ^ d;						\
+	      else							\
+		f = c ^ (b | ~d);					\
+	      t = a + f + *(const VT *) m[mb_index[i]] + mb_T[i];	\
+	      t = (t << mb_shift[i]) | (t >> (32 - mb_shift[i]));	\
+	      a = d;							\
+	      d = c;							\
+	      c = b;							\
+	      b = b + t;						\
+	    }								\
+									\
+	  mask = *(const VT *) live;					\
+	  A += a & mask;						\
+	  B += b & mask;						\
+	  C += c & mask;						\
+	  D += d & mask;						\
+	}								\
+									\
+      for (l = 0; l < lanes; l++)					\
+	mb_store_digest (A[l], B[l], C[l], D[l], resblocks[base + l]);	\
+    }									\
+}
+
+/* 4 lanes: SSE2 on x86, NEON/AltiVec or whatever the compiler makes of
+   the vectors elsewhere.  */
+# if defined __i386__
+MB_KERNEL (md5_buffers_v4, mb_v4, 4, __attribute__ ((target ("sse2"))))
+# else
+MB_KERNEL (md5_buffers_v4, mb_v4, 4, )
+# endif
+
+# ifdef MB_X86
+MB_KERNEL (md5_buffers_v8, mb_v8, 8, __attribute__ ((target ("avx2"))))
+MB_KERNEL (md5_buffers_v16, mb_v16, 16, __attribute__ ((target ("avx512f"))))
+# endif
+
+#endif /* MB_VECTOR */
+
+struct mb_impl
+{
+  const char *name;
+  void (*fn) (const char *const *, const size_t *, size_t, void *const *);
+};
+
+static const struct mb_impl mb_impls[] =
+{
+  { "scalar", md5_buffers_scalar },
+#ifdef MB_VECTOR
+# ifdef MB_X86
+  { "sse2", md5_buffers_v4 },
+# else
+  { "vec4", md5_buffers_v4 },
+# endif
+# ifdef MB_X86
+  { "avx2", md5_buffers_v8 },
+  { "avx512", md5_buffers_v16 },
+# endif
+#endif
+  { NULL, NULL }
+};
+
+static const struct mb_impl *mb_current = NULL;
+#ifdef MB_ONCE
+static pthread_once_t mb_once = PTHREAD_ONCE_INIT;
+#endif
+
+static int
+mb_supported (const struct mb_impl *impl)
+{
+#ifdef MB_X86
+  __builtin_cpu_init ();
+  if (strcmp (impl->name, "sse2") == 0)
+    return __builtin_cpu_supports ("sse2");
+  if (strcmp (impl->name, "avx2") == 0)
+    return __builtin_cpu_supports ("avx2");
+  if (strcmp (impl->name, "avx512") == 0)
+    return __builtin_cpu_supports ("avx512f");
+#endif
+  return 1;
+}
+
+#ifdef HAVE_SYS_TIME_H
+/* Microseconds IMPL takes for a batch of short messages, the best of a
+   few tries so that an interrupt doesn't decide it.  */
+static long
+mb_time (const struct mb_impl *impl)
+{
+  static char msg[64][40];
+  const char *buffers[64];
+  size_t lens[64];
+  unsigned char digests[64][16];
+  void *resblocks[64];
+  struct timeval t0, t1;
+  long us, best = -1;
+  int i, try;
+
+  for (i = 0; i < 64; i++)
+    {
+      buffers[i] = msg[i];
+      lens[i] = sizeof (msg[i]);
+      resblocks[i] = digests[i];
+    }
+  for (try = 0; try < 3; try++)
+    {
+      gettimeofday (&t0, NULL);
+      for (i = 0; i < 16; i++)
+	impl->fn (buffers, lens, 64, resblocks);
+      gettimeofday (&t1, NULL);
+      us = (t1.tv_sec - t0.tv_sec) * 1000000L + (t1.tv_usec - t0.tv_usec);
+      if (best < 0 || us < best)
+	best = us;
+    }
+
+  return best;
+}
+#endif
+
+static const struct mb_impl *
+mb_choose (void)
+{
+  const struct mb_impl *impl;
+  const struct mb_impl *best = &mb_impls[0];
+#ifdef HAVE_SYS_TIME_H
+  long us, best_us = -1;
+
+  for (impl = mb_impls; impl->name != NULL; impl++)
+    if (mb_supported (impl))
+      {
+	us = mb_time (impl);
+	/* Ties go to the wider kernel, the table is in order of width.  */
+	if (best_us < 0 || us <= best_us)
+	  {
+	    best = impl;
+	    best_us = us;
+	  }
+      }
+#else
+  /* Without a clock the widest one will have to do.  */
+  for (impl = mb_impls; impl->name != NULL; impl++)
+    if (mb_supported (impl))
+      best = impl;
+#endif
+
+  return best;
+}
+
+static void
+mb_init (void)
+{
+  mb_current = mb_choose ();
+}
+
+/* The kernel to use, chosen on the first call.  Sessions hash from the
+   library's worker threads, so with threads the choice is made once.  */
+static const struct mb_impl *
+mb_get (void)
+{
+#ifdef MB_ONCE
+  pthread_once (&mb_once, mb_init);
+#else
+  if (mb_current == NULL)
+    mb_init ();
+#endif
+  return mb_current;
+}
+
+void
+md5_buffers (const char *const *buffers, const size_t *lens, size_t n,
+	     void *const *resblocks)
+{
+  const struct mb_impl *impl = mb_get ();
+
+  /* A single message gains nothing from the lanes.  */
+  if (n == 1)
+    md5_buffer (buffers[0], lens[0], resblocks[0]);
+  else
+    impl->fn (buffers, lens, n, resblocks);
+}
+
+const char *
+md5_buffers_impl (void)
+{
+  return mb_get ()->name;
+}
+
+int
+md5_buffers_select (const char *name)
+{
+  const struct mb_impl *impl;
+
+  /* Choose first so the choice can't overwrite this one later.  */
+  mb_get ();
+  for (impl = mb_impls; impl->name != NULL; impl++)
+    if (strcmp (impl->name, name) == 0 && mb_supported (impl))
+      {
+	mb_current = impl;
+	return 0;
+      }
+
+  return -1;
+}
 #endif
@@ -145,5 +145,27 @@ extern int md5_stream PARAMS ((FILE *stream, void *resblock));
 extern void *md5_buffer PARAMS ((const char *buffer, size_t len,
 				 void *resblock));
 
+/* Compute the MD5 message digests of N independent messages.  Message I
+   is the LENS[I] bytes beginning at BUFFERS[I] and its digest is written
+   into the 16 bytes beginning at RESBLOCKS[I].  The messages are hashed
+   in parallel lanes (4, 8 or 16 wide) using whichever SIMD kernel the CPU
+   supports runs fastest, which is measured on the first call.  The results are identical to
+   calling `md5_buffer' on each message.  Nothing in ez-ipupdate has
+   independent messages to batch, each GNUDIP update's second hash is
+   over the first one's digest, so this is for md5_bench and for other
+   callers that do.  */
+extern void md5_buffers PARAMS ((const char *const *buffers,
+				 const size_t *lens, size_t n,
+				 void *const *resblocks));
+
+/* Name of the implementation `md5_buffers' uses: "scalar", "sse2",
+   "avx2" or "avx512", or "vec4" for the 4 lane kernel on other CPUs.  */
+extern const char *md5_buffers_impl PARAMS ((void));
+
+/* Make `md5_buffers' use the implementation called NAME, mostly useful
+   for testing and benchmarking.  Returns 0 on success and -1 if NAME is
+   unknown or not supported by this CPU.  */
+extern int md5_buffers_select PARAMS ((const char *name));
+
 #endif
 #endif
@@ -0,0 +1,251 @@
+/* ============================================================================
+ * Copyright (C) 2001 Angus Mackay. All rights reserved; 
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2, or (at your option)
+ * any later version.
+ *
+ * THIS SOFTWARE IS PROVIDED ``AS IS'' AND ANY EXPRESSED OR IMPLIED WARRANTIES,
+ * INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND
+ * FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE
+ * AUTHOR BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY,
+ * OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ * ============================================================================
+ */
+
+/*
+ * md5_bench.c
+ *
+ * known answer checks and a benchmark for the multi-buffer md5_buffers()
+ * against the scalar md5_buffer(). every implementation the CPU supports
+ * is first checked against the RFC 1321 test suite and against the scalar
+ * code for messages of every length around the block boundaries, then
+ * timed on a batch of short GNUDIP sized messages.
+ *
+ * usage: md5_bench [messages] [rounds]
+ *
+ */
+
+#ifdef HAVE_CONFIG_H
+#  include <config.h>
+#endif
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#if HAVE_SYS_TIME_H
+#  include <sys/time.h>
+#endif
+
+#include <md5.h>
+
+#ifdef USE_MD5
+
+#define DEFAULT_MESSAGES 4096
+#define DEFAULT_ROUNDS 200
+#define MAX_CHECK_LEN 300
+
+static char *impls[] = { "scalar", "sse2", "vec4", "avx2", "avx512" };
+
+/* RFC 1321, A.5 */
+static struct
+{
+  char *msg;
+  char *digest;
+} kat[] = {
+  { "", "d41d8cd98f00b204e9800998ecf8427e" },
+  { "a", "0cc175b9c0f1b6a831c399e269772661" },
+  { "abc", "900150983cd24fb0d6963f7d28e17f72" },
+  { "message digest", "f96b697d7cb7938d525a2f31aaf161d0" },
+  { "abcdefghijklmnopqrstuvwxyz", "c3fcd3d76192e4007dfb496cca67e13b" },
+  { "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789",
+    "d174ab98d277d9f5a5611c2c9f419d9f" },
+  { "12345678901234567890123456789012345678901234567890123456789012345678901234567890",
+    "57edf4a22be3c955ac49da2e2107b67a" },
+};
+
+static double now(void)
+{
+  struct timeval tv;
+
+  gettimeofday(&tv, NULL);
+  return(tv.tv_sec + tv.tv_usec / 1000000.0);
+}
+
+static void hex(unsigned char *digest, char *out)
+{
+  static char digits[] = "0123456789abcdef";
+  int i;
+
+  for(i=0; i<16; i++)
+  {
+    out[2*i] = digits[digest[i] >> 4];
+    out[2*i+1] = digits[digest[i] & 0x0F];
+  }
+  out[32] = '\0';
+}
+
+static int check(char *impl)
+{
+  const char *bufs[MAX_CHECK_LEN+1];
+  size_t lens[MAX_CHECK_LEN+1];
+  void *res[MAX_CHECK_LEN+1];
+  unsigned char digests[MAX_CHECK_LEN+1][16];
+  unsigned char want[16];
+  char msg[MAX_CHECK_LEN+1];
+  char text[33];
+  int n;
+  int i;
+
+  n = sizeof(kat)/sizeof(kat[0]);
+  for(i=0; i<n; i++)
+  {
+    bufs[i] = kat[i].msg;
+    lens[i] = strlen(kat[i].msg);
+    res[i] = digests[i];
+  }
+  md5_buffers(bufs, lens, n, res);
+  for(i=0; i<n; i++)
+  {
+    hex(digests[i], text);
+    if(strcmp(text, kat[i].digest) != 0)
+    {
+      fprintf(stderr, "%s: MD5(\"%s\") = %s, expected %s\n", impl,
+          kat[i].msg, text, kat[i].digest);
+      return(-1);
+    }
+  }
+
+  // every length from 0 to MAX_CHECK_LEN in one batch, so lanes finish
+  // at different blocks
+  for(i=0; i<=MAX_CHECK_LEN; i++)
+  {
+    msg[i] = (char)(i * 131 + 7);
+  }
+  for(i=0; i<=MAX_CHECK_LEN; i++)
+  {
+    bufs[i] = msg;
+    lens[i] = MAX_CHECK_LEN - i;
+    res[i] = digests[i];
+  }
+  md5_buffers(bufs, lens, MAX_CHECK_LEN+1, res);
+  for(i=0; i<=MAX_CHECK_LEN; i++)
+  {
+    md5_buffer(msg, lens[i], want);
+    if(memcmp(want, digests[i], 16) != 0)
+    {
+      fprintf(stderr, "%s: mismatch against md5_buffer() for length %d\n",
+          impl, (int)lens[i]);
+      return(-1);
+    }
+  }
+
+  return(0);
+}
+
+int main(int argc, char **argv)
+{
+  int nmsgs = DEFAULT_MESSAGES;
+  int rounds = DEFAULT_ROUNDS;
+  const char **bufs;
+  size_t *lens;
+  void **res;
+  unsigned char *digests;
+  char *text;
+  double start;
+  double secs;
+  double base = 0;
+  int failed = 0;
+  int i;
+  int j;
+  int r;
+
+  if(argc > 1) { nmsgs = atoi(argv[1]); }
+  if(argc > 2) { rounds = atoi(argv[2]); }
+  if(nmsgs < 1) { nmsgs = 1; }
+  if(rounds < 1) { rounds = 1; }
+
+  bufs = malloc(nmsgs * sizeof(*bufs));
+  lens = malloc(nmsgs * sizeof(*lens));
+  res = malloc(nmsgs * sizeof(*res));
+  digests = malloc(nmsgs * 16);
+  text = malloc(nmsgs * 64);
+  if(!bufs || !lens || !res || !digests || !text)
+  {
+    fprintf(stderr, "out of memory\n");
+    return(1);
+  }
+
+  // the second GNUDIP hash is "<32 hex digits>.<salt>", about 40-50 bytes
+  for(i=0; i<nmsgs; i++)
+  {
+    lens[i] = snprintf(text + i*64, 64,
+        "%08x%08x%08x%08x.%08x", i, i*7, i*13, i*17, i*31);
+    bufs[i] = text + i*64;
+    res[i] = digests + i*16;
+  }
+
+  printf("default implementation: %s\n", md5_buffers_impl());
+  printf("%d messages of ~%d bytes, %d rounds\n", nmsgs, (int)lens[0], rounds);
+
+  for(j=0; j<sizeof(impls)/sizeof(impls[0]); j++)
+  {
+    if(md5_buffers_select(impls[j]) != 0)
+    {
+      printf("%-8s not supported\n", impls[j]);
+      continue;
+    }
+    if(check(impls[j]) != 0)
+    {
+      failed = 1;
+      continue;
+    }
+
+    start = now();
+    for(r=0; r<rounds; r++)
+    {
+      if(j == 0)
+      {
+        for(i=0; i<nmsgs; i++)
+        {
+          md5_buffer(bufs[i], lens[i], res[i]);
+        }
+      }
+      else
+      {
+        md5_buffers(bufs, lens, nmsgs, res);
+      }
+    }
+    secs = now() - start;
+    if(j == 0) { base = secs; }
+
+    printf("%-8s ok %8.1f ns/msg %10.0f msgs/s  x%.2f\n", impls[j],
+        secs * 1e9 / ((double)nmsgs * rounds),
+        (double)nmsgs * rounds / secs, base / secs);
+  }
+
+  free(bufs);
+  free(lens);
+  free(res);
+  free(digests);
+  free(text);
+
+  return(failed);
+}
+
+#else
+
+int main(int argc, char **argv)
+{
+  printf("MD5 support was disabled at compile time\n");
+  return(0);
+}
+
+#endif
+
@@ -0,0 +1,745 @@
+/* ============================================================================
+ * Copyright (C) 2001 Angus Mackay. All rights reserved; 
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2, or (at your option)
+ * any later version.
+ *
+ * THIS SOFTWARE IS PROVIDED ``AS IS'' AND ANY EXPRESSED OR IMPLIED WARRANTIES,
+ * INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND
+ * FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE
+ * AUTHOR BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY,
+ * OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ * ============================================================================
+ */
+
+/*
+ * metrics.c
+ *
+ * every update is timestamped as it goes through name lookup, connect, the
+ * first byte sent, the first byte received and completion. the time spent
+ * in each phase is folded into per provider histograms along with counters
+ * for results, bytes and retries.
+ *
+ * address changes are timed too, from detection to the provider's
+ * acknowledgement and from there to the new record being seen in DNS.
+ * those can take hours, so their histograms count milliseconds.
+ *
+ * the histograms are log-linear in the style of HdrHistogram: each power
+ * of two of microseconds is split into HIST_SUB equal buckets, so the
+ * relative error is bounded at 1/HIST_SUB whatever the magnitude and a
+ * histogram is a fixed few hundred bytes.
+ *
+ * the results can be written to a file (for node_exporter's textfile
+ * collector) or served over HTTP on the loopback interface.
+ *
+ */
+
+#ifdef HAVE_CONFIG_H
+#  include <config.h>
+#endif
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <fcntl.h>
+#if HAVE_SYS_TYPES_H
+#  include <sys/types.h>
+#endif
+#if HAVE_SYS_TIME_H
+#  include <sys/time.h>
+#endif
+#include <time.h>
+#include <sys/socket.h>
+#include <netinet/in.h>
+#if HAVE_ARPA_INET_H
+#  include <arpa/inet.h>
+#endif
+
+#include <error.h>
+#include <dprintf.h>
+#include <event.h>
+#include <logger.h>
+#include <arena.h>
+#include <metrics.h>
+
+#define HIST_SUB_BITS 2
+#define HIST_SUB (1 << HIST_SUB_BITS)
+// values under 2^HIST_MIN_BITS usec (1ms) go in HIST_SUB linear buckets
+#define HIST_MIN_BITS 10
+// values of 2^HIST_MAX_BITS usec (about 4.5 minutes) and up all overflow
+#define HIST_MAX_BITS 28
+#define HIST_NBUCKETS (HIST_SUB + (HIST_MAX_BITS - HIST_MIN_BITS) * HIST_SUB + 1)
+// scrapers served at once, a new one pushes out the oldest
+#define METRICS_CLIENTS 4
+#define METRICS_REQ_LEN 512
+
+struct histogram
+{
+  unsigned long counts[HIST_NBUCKETS];
+  unsigned long count;
+  double sum;
+};
+
+static struct
+{
+  char *name;
+  int from;
+  int to;
+} phases[] = {
+  { "resolve",    EZ_MARK_START,     EZ_MARK_RESOLVED },
+  { "connect",    EZ_MARK_RESOLVED,  EZ_MARK_CONNECTED },
+  { "first_byte", EZ_MARK_SENT,      EZ_MARK_RECEIVED },
+  { "receive",    EZ_MARK_RECEIVED,  EZ_MARK_DONE },
+  { "total",      EZ_MARK_START,     EZ_MARK_DONE },
+};
+#define NPHASES (sizeof(phases)/sizeof(phases[0]))
+
+static char *result_names[METRICS_NRESULTS] = { "ok", "error", "shutdown" };
+static char *stage_names[METRICS_NSTAGES] = { "detect_to_ack", "ack_to_visible" };
+
+struct provider
+{
+  char *name;
+  struct histogram hist[NPHASES];
+  struct histogram stages[METRICS_NSTAGES];
+  unsigned long results[METRICS_NRESULTS];
+  unsigned long retries;
+  unsigned long timeouts;
+  unsigned long avoided;
+  unsigned long unseen;
+  unsigned long refreshes;
+  int spread;
+  time_t refresh_due;
+  unsigned long bytes_out;
+  unsigned long bytes_in;
+  time_t last_update;
+  int last_result;
+  struct provider *next;
+};
+
+static struct provider *providers = NULL;
+
+static unsigned long polls = 0;
+static int listen_fd = -1;
+static time_t start_time = 0;
+
+// a scraper whose request hasn't all come in yet
+static struct
+{
+  int fd;
+  int len;
+  time_t since;
+  char req[METRICS_REQ_LEN];
+} clients[METRICS_CLIENTS];
+static int clients_init = 0;
+
+static int hist_bucket(unsigned long usec)
+{
+  int msb;
+
+  if(usec < (1UL << HIST_MIN_BITS))
+  {
+    return(usec >> (HIST_MIN_BITS - HIST_SUB_BITS));
+  }
+  for(msb=HIST_MIN_BITS; msb<HIST_MAX_BITS && (usec >> (msb+1)) != 0; msb++);
+  if(msb >= HIST_MAX_BITS)
+  {
+    return(HIST_NBUCKETS-1);
+  }
+  return(HIST_SUB + (msb - HIST_MIN_BITS) * HIST_SUB +
+      ((usec >> (msb - HIST_SUB_BITS)) & (HIST_SUB-1)));
+}
+
+/* the (exclusive) upper edge of a bucket in usec */
+static unsigned long hist_edge(int bucket)
+{
+  int msb;
+  int sub;
+
+  if(bucket < HIST_SUB)
+  {
+    return((unsigned long)(bucket+1) << (HIST_MIN_BITS - HIST_SUB_BITS));
+  }
+  bucket -= HIST_SUB;
+  msb = HIST_MIN_BITS + bucket / HIST_SUB;
+  sub = bucket % HIST_SUB;
+  return((unsigned long)(HIST_SUB + sub + 1) << (msb - HIST_SUB_BITS));
+}
+
+static void hist_record(struct histogram *h, unsigned long usec)
+{
+  h->counts[hist_bucket(usec)]++;
+  h->count++;
+  h->sum += usec / 1000000.0;
+}
+
+static long usec_between(struct timeval *from, struct timeval *to)
+{
+  return((to->tv_sec - from->tv_sec) * 1000000L + (to->tv_usec - from->tv_usec));
+}
+
+static struct provider *find_provider(char *name)
+{
+  struct provider *p;
+
+  for(p=providers; p != NULL; p=p->next)
+  {
+    if(strcmp(p->name, name) == 0)
+    {
+      return(p);
+    }
+  }
+
+  if((p=calloc(1, sizeof(struct provider))) == NULL)
+  {
+    return(NULL);
+  }
+  if((p->name=strdup(name)) == NULL)
+  {
+    free(p);
+    return(NULL);
+  }
+  p->last_result = -1;
+  p->next = providers;
+  providers = p;
+
+  return(p);
+}
+
+/*
+ * metrics_record
+ *
+ * fold a finished update into its provider's histograms and counters
+ */
+void metrics_record(struct ez_session *s)
+{
+  struct provider *cur;
+  long usec;
+  int i;
+
+  if(start_time == 0) { start_time = time(NULL); }
+  if((cur=find_provider(s->service->names[0])) == NULL)
+  {
+    return;
+  }
+
+  // an attempt straight after a failure is a retry
+  if(cur->last_result > 0)
+  {
+    cur->retries++;
+  }
+  for(i=0; i<NPHASES; i++)
+  {
+    if(s->marked[phases[i].from] && s->marked[phases[i].to])
+    {
+      usec = usec_between(&s->marks[phases[i].from], &s->marks[phases[i].to]);
+      hist_record(&cur->hist[i], usec < 0 ? 0 : usec);
+    }
+  }
+  if(s->result >= 0 && s->result < METRICS_NRESULTS)
+  {
+    cur->results[s->result]++;
+  }
+  cur->timeouts += s->timeouts;
+  cur->bytes_out += s->bytes_out;
+  cur->bytes_in += s->bytes_in;
+  cur->last_result = s->result;
+  cur->last_update = s->marks[EZ_MARK_DONE].tv_sec;
+
+  dprintf((stderr, "update for %s took %ld usec, result %d\n", cur->name,
+        usec_between(&s->marks[EZ_MARK_START], &s->marks[EZ_MARK_DONE]),
+        s->result));
+}
+
+/*
+ * metrics_avoided
+ *
+ * count an update not sent because DNS already had the address
+ */
+void metrics_avoided(char *service)
+{
+  struct provider *cur;
+
+  if(start_time == 0) { start_time = time(NULL); }
+  if((cur=find_provider(service)) != NULL)
+  {
+    cur->avoided++;
+  }
+}
+
+/*
+ * metrics_change
+ *
+ * time one stage of an address change
+ */
+void metrics_change(char *service, int stage, struct timeval *from,
+    struct timeval *to)
+{
+  struct provider *cur;
+  struct histogram *h;
+  long msec;
+
+  if(start_time == 0) { start_time = time(NULL); }
+  if(stage < 0 || stage >= METRICS_NSTAGES ||
+      (cur=find_provider(service)) == NULL)
+  {
+    return;
+  }
+  msec = usec_between(from, to) / 1000;
+  if(msec < 0) { msec = 0; }
+  h = &cur->stages[stage];
+  h->counts[hist_bucket(msec)]++;
+  h->count++;
+  h->sum += msec / 1000.0;
+}
+
+/*
+ * metrics_refresh
+ *
+ * where the provider's next refresh falls, spread seconds before its
+ * max-interval is up at due. refreshed says an update just sent was one.
+ */
+void metrics_refresh(char *service, int spread, time_t due, int refreshed)
+{
+  struct provider *cur;
+
+  if(start_time == 0) { start_time = time(NULL); }
+  if((cur=find_provider(service)) != NULL)
+  {
+    cur->spread = spread;
+    cur->refresh_due = due;
+    if(refreshed)
+    {
+      cur->refreshes++;
+    }
+  }
+}
+
+/*
+ * metrics_unseen
+ *
+ * count a change that was acknowledged but never showed up in DNS
+ */
+void metrics_unseen(char *service)
+{
+  struct provider *cur;
+
+  if((cur=find_provider(service)) != NULL)
+  {
+    cur->unseen++;
+  }
+}
+
+void metrics_poll(void)
+{
+  if(start_time == 0) { start_time = time(NULL); }
+  polls++;
+}
+
+static double per_hour(unsigned long count, time_t now)
+{
+  if(now <= start_time)
+  {
+    return(0);
+  }
+  return(count * 3600.0 / (now - start_time));
+}
+
+void metrics_print(FILE *fp)
+{
+  struct provider *p;
+  unsigned long cumulative;
+  time_t now;
+  int i;
+  int b;
+
+  now = time(NULL);
+  if(start_time == 0) { start_time = now; }
+
+  fprintf(fp, "# HELP ez_ipupdate_update_phase_seconds Time spent in each phase of an update.\n");
+  fprintf(fp, "# TYPE ez_ipupdate_update_phase_seconds histogram\n");
+  for(p=providers; p != NULL; p=p->next)
+  {
+    for(i=0; i<NPHASES; i++)
+    {
+      struct histogram *h = &p->hist[i];
+
+      cumulative = 0;
+      for(b=0; b<HIST_NBUCKETS-1; b++)
+      {
+        cumulative += h->counts[b];
+        fprintf(fp, "ez_ipupdate_update_phase_seconds_bucket{provider=\"%s\",phase=\"%s\",le=\"%.6f\"} %lu\n",
+            p->name, phases[i].name, hist_edge(b) / 1000000.0, cumulative);
+      }
+      fprintf(fp, "ez_ipupdate_update_phase_seconds_bucket{provider=\"%s\",phase=\"%s\",le=\"+Inf\"} %lu\n",
+          p->name, phases[i].name, h->count);
+      fprintf(fp, "ez_ipupdate_update_phase_seconds_sum{provider=\"%s\",phase=\"%s\"} %.6f\n",
+          p->name, phases[i].name, h->sum);
+      fprintf(fp, "ez_ipupdate_update_phase_seconds_count{provider=\"%s\",phase=\"%s\"} %lu\n",
+          p->name, phases[i].name, h->count);
+    }
+  }
+
+  fprintf(fp, "# HELP ez_ipupdate_change_seconds Time from an address change being detected to the provider acknowledging it and from then to it being visible in DNS.\n");
+  fprintf(fp, "# TYPE ez_ipupdate_change_seconds histogram\n");
+  for(p=providers; p != NULL; p=p->next)
+  {
+    for(i=0; i<METRICS_NSTAGES; i++)
+    {
+      struct histogram *h = &p->stages[i];
+
+      cumulative = 0;
+      for(b=0; b<HIST_NBUCKETS-1; b++)
+      {
+        cumulative += h->counts[b];
+        fprintf(fp, "ez_ipupdate_change_seconds_bucket{provider=\"%s\",stage=\"%s\",le=\"%.3f\"} %lu\n",
+            p->name, stage_names[i], hist_edge(b) / 1000.0, cumulative);
+      }
+      fprintf(fp, "ez_ipupdate_change_seconds_bucket{provider=\"%s\",stage=\"%s\",le=\"+Inf\"} %lu\n",
+          p->name, stage_names[i], h->count);
+      fprintf(fp, "ez_ipupdate_change_seconds_sum{provider=\"%s\",stage=\"%s\"} %.3f\n",
+          p->name, stage_names[i], h->sum);
+      fprintf(fp, "ez_ipupdate_change_seconds_count{provider=\"%s\",stage=\"%s\"} %lu\n",
+          p->name, stage_names[i], h->count);
+    }
+  }
+
+  fprintf(fp, "# HELP ez_ipupdate_changes_unseen_total Acknowledged changes not seen in DNS before giving up.\n");
+  fprintf(fp, "# TYPE ez_ipupdate_changes_unseen_total counter\n");
+  for(p=providers; p != NULL; p=p->next)
+  {
+    fprintf(fp, "ez_ipupdate_changes_unseen_total{provider=\"%s\"} %lu\n", p->name, p->unseen);
+  }
+
+  fprintf(fp, "# HELP ez_ipupdate_refreshes_total Updates sent only because max-interval was up.\n");
+  fprintf(fp, "# TYPE ez_ipupdate_refreshes_total counter\n");
+  for(p=providers; p != NULL; p=p->next)
+  {
+    fprintf(fp, "ez_ipupdate_refreshes_total{provider=\"%s\"} %lu\n", p->name, p->refreshes);
+  }
+
+  fprintf(fp, "# HELP ez_ipupdate_refresh_spread_seconds How much before max-interval is up this job refreshes, its place in the spread window.\n");
+  fprintf(fp, "# TYPE ez_ipupdate_refresh_spread_seconds gauge\n");
+  for(p=providers; p != NULL; p=p->next)
+  {
+    fprintf(fp, "ez_ipupdate_refresh_spread_seconds{provider=\"%s\"} %d\n", p->name, p->spread);
+  }
+
+  fprintf(fp, "# HELP ez_ipupdate_refresh_due_timestamp_seconds When the next refresh is due if the address holds, 0 for never.\n");
+  fprintf(fp, "# TYPE ez_ipupdate_refresh_due_timestamp_seconds gauge\n");
+  for(p=providers; p != NULL; p=p->next)
+  {
+    fprintf(fp, "ez_ipupdate_refresh_due_timestamp_seconds{provider=\"%s\"} %ld\n", p->name, (long)p->refresh_due);
+  }
+
+  fprintf(fp, "# HELP ez_ipupdate_updates_total Updates attempted, by result.\n");
+  fprintf(fp, "# TYPE ez_ipupdate_updates_total counter\n");
+  for(p=providers; p != NULL; p=p->next)
+  {
+    for(i=0; i<METRICS_NRESULTS; i++)
+    {
+      fprintf(fp, "ez_ipupdate_updates_total{provider=\"%s\",result=\"%s\"} %lu\n",
+          p->name, result_names[i], p->results[i]);
+    }
+  }
+
+  fprintf(fp, "# HELP ez_ipupdate_retries_total Updates attempted right after a failure.\n");
+  fprintf(fp, "# TYPE ez_ipupdate_retries_total counter\n");
+  for(p=providers; p != NULL; p=p->next)
+  {
+    fprintf(fp, "ez_ipupdate_retries_total{provider=\"%s\"} %lu\n", p->name, p->retries);
+  }
+
+  fprintf(fp, "# HELP ez_ipupdate_timeouts_total I/O timeouts talking to the server.\n");
+  fprintf(fp, "# TYPE ez_ipupdate_timeouts_total counter\n");
+  for(p=providers; p != NULL; p=p->next)
+  {
+    fprintf(fp, "ez_ipupdate_timeouts_total{provider=\"%s\"} %lu\n", p->name, p->timeouts);
+  }
+
+  fprintf(fp, "# HELP ez_ipupdate_updates_avoided_total Updates not sent because DNS already had the address.\n");
+  fprintf(fp, "# TYPE ez_ipupdate_updates_avoided_total counter\n");
+  for(p=providers; p != NULL; p=p->next)
+  {
+    fprintf(fp, "ez_ipupdate_updates_avoided_total{provider=\"%s\"} %lu\n", p->name, p->avoided);
+  }
+
+  fprintf(fp, "# HELP ez_ipupdate_sent_bytes_total Bytes sent to the server.\n");
+  fprintf(fp, "# TYPE ez_ipupdate_sent_bytes_total counter\n");
+  for(p=providers; p != NULL; p=p->next)
+  {
+    fprintf(fp, "ez_ipupdate_sent_bytes_total{provider=\"%s\"} %lu\n", p->name, p->bytes_out);
+  }
+
+  fprintf(fp, "# HELP ez_ipupdate_received_bytes_total Bytes received from the server.\n");
+  fprintf(fp, "# TYPE ez_ipupdate_received_bytes_total counter\n");
+  for(p=providers; p != NULL; p=p->next)
+  {
+    fprintf(fp, "ez_ipupdate_received_bytes_total{provider=\"%s\"} %lu\n", p->name, p->bytes_in);
+  }
+
+  fprintf(fp, "# HELP ez_ipupdate_last_update_timestamp_seconds When the last update finished.\n");
+  fprintf(fp, "# TYPE ez_ipupdate_last_update_timestamp_seconds gauge\n");
+  for(p=providers; p != NULL; p=p->next)
+  {
+    fprintf(fp, "ez_ipupdate_last_update_timestamp_seconds{provider=\"%s\"} %ld\n",
+        p->name, (long)p->last_update);
+  }
+
+  fprintf(fp, "# HELP ez_ipupdate_wakeups_total Times the daemon woke up.\n");
+  fprintf(fp, "# TYPE ez_ipupdate_wakeups_total counter\n");
+  fprintf(fp, "ez_ipupdate_wakeups_total %lu\n", event_wakeups());
+  fprintf(fp, "# HELP ez_ipupdate_polls_total Times the interface address was checked.\n");
+  fprintf(fp, "# TYPE ez_ipupdate_polls_total counter\n");
+  fprintf(fp, "ez_ipupdate_polls_total %lu\n", polls);
+  fprintf(fp, "# HELP ez_ipupdate_wakeups_per_hour Wakeups per hour since start.\n");
+  fprintf(fp, "# TYPE ez_ipupdate_wakeups_per_hour gauge\n");
+  fprintf(fp, "ez_ipupdate_wakeups_per_hour %.2f\n", per_hour(event_wakeups(), now));
+  fprintf(fp, "# HELP ez_ipupdate_polls_per_hour Interface checks per hour since start.\n");
+  fprintf(fp, "# TYPE ez_ipupdate_polls_per_hour gauge\n");
+  fprintf(fp, "ez_ipupdate_polls_per_hour %.2f\n", per_hour(polls, now));
+  fprintf(fp, "# HELP ez_ipupdate_log_dropped_total Log records dropped because the queue was full.\n");
+  fprintf(fp, "# TYPE ez_ipupdate_log_dropped_total counter\n");
+  fprintf(fp, "ez_ipupdate_log_dropped_total %lu\n", logger_dropped());
+  fprintf(fp, "# HELP ez_ipupdate_log_suppressed_total Repeated log messages folded into a summary.\n");
+  fprintf(fp, "# TYPE ez_ipupdate_log_suppressed_total counter\n");
+  fprintf(fp, "ez_ipupdate_log_suppressed_total %lu\n", logger_suppressed());
+  fprintf(fp, "# HELP ez_ipupdate_arena_bytes Heap held by the string and buffer arenas.\n");
+  fprintf(fp, "# TYPE ez_ipupdate_arena_bytes gauge\n");
+  fprintf(fp, "ez_ipupdate_arena_bytes %lu\n", arena_heap_bytes());
+  fprintf(fp, "# HELP ez_ipupdate_arena_mallocs_total Blocks the arenas have taken from malloc().\n");
+  fprintf(fp, "# TYPE ez_ipupdate_arena_mallocs_total counter\n");
+  fprintf(fp, "ez_ipupdate_arena_mallocs_total %lu\n", arena_heap_mallocs());
+  fprintf(fp, "# HELP ez_ipupdate_start_time_seconds When the process started.\n");
+  fprintf(fp, "# TYPE ez_ipupdate_start_time_seconds gauge\n");
+  fprintf(fp, "ez_ipupdate_start_time_seconds %ld\n", (long)start_time);
+}
+
+/*
+ * metrics_write_file
+ *
+ * write the metrics to file, via a temporary file and a rename so a
+ * reader never sees half of it.
+ */
+int metrics_write_file(char *file)
+{
+  char *tmp;
+  FILE *fp;
+
+  if((tmp=malloc(strlen(file) + 5)) == NULL)
+  {
+    return(-1);
+  }
+  sprintf(tmp, "%s.tmp", file);
+
+  if((fp=fopen(tmp, "w")) == NULL)
+  {
+    free(tmp);
+    return(-1);
+  }
+  metrics_print(fp);
+  if(fclose(fp) != 0 || rename(tmp, file) != 0)
+  {
+    unlink(tmp);
+    free(tmp);
+    return(-1);
+  }
+  free(tmp);
+
+  return(0);
+}
+
+static void client_drop(int i)
+{
+  event_del(clients[i].fd);
+  close(clients[i].fd);
+  clients[i].fd = -1;
+}
+
+/*
+ * the socket is non-blocking, so a scraper that reads too slowly for the
+ * page to fit in the socket buffer gets a short page rather than holding
+ * up the daemon
+ */
+static void client_answer(int i)
+{
+  FILE *fp;
+
+  event_del(clients[i].fd);
+  if((fp=fdopen(clients[i].fd, "w")) == NULL)
+  {
+    close(clients[i].fd);
+    clients[i].fd = -1;
+    return;
+  }
+  clients[i].fd = -1;
+
+  if(strncmp(clients[i].req, "GET ", 4) != 0)
+  {
+    fprintf(fp, "HTTP/1.0 405 Method Not Allowed\r\n\r\n");
+  }
+  else
+  {
+    fprintf(fp, "HTTP/1.0 200 OK\r\n");
+    fprintf(fp, "Content-Type: text/plain; version=0.0.4\r\n\r\n");
+    metrics_print(fp);
+  }
+  fclose(fp);
+}
+
+static void client_read(int fd, void *arg)
+{
+  int i = (int)(long)arg;
+  int n;
+
+  n = recv(fd, clients[i].req + clients[i].len,
+      sizeof(clients[i].req) - 1 - clients[i].len, 0);
+  if(n == -1 && (errno == EAGAIN || errno == EINTR))
+  {
+    return;
+  }
+  if(n <= 0)
+  {
+    client_drop(i);
+    return;
+  }
+  clients[i].len += n;
+  clients[i].req[clients[i].len] = '\0';
+
+  // the request line is all that matters
+  if(strchr(clients[i].req, '\n') != NULL ||
+      clients[i].len == sizeof(clients[i].req) - 1)
+  {
+    client_answer(i);
+  }
+}
+
+static void metrics_accept(int fd, void *arg)
+{
+  int client;
+  int oldest = 0;
+  int i;
+
+  if((client=accept(fd, NULL, NULL)) == -1)
+  {
+    dprintf((stderr, "accept: %s\n", error_string));
+    return;
+  }
+  fcntl(client, F_SETFL, fcntl(client, F_GETFL) | O_NONBLOCK);
+  fcntl(client, F_SETFD, FD_CLOEXEC);
+
+  if(!clients_init)
+  {
+    for(i=0; i<METRICS_CLIENTS; i++)
+    {
+      clients[i].fd = -1;
+    }
+    clients_init = 1;
+  }
+
+  // take a free slot or the one that has been sending its request longest
+  for(i=0; i<METRICS_CLIENTS && clients[i].fd != -1; i++)
+  {
+    if(clients[i].since < clients[oldest].since)
+    {
+      oldest = i;
+    }
+  }
+  if(i == METRICS_CLIENTS)
+  {
+    client_drop(oldest);
+    i = oldest;
+  }
+
+  if(event_add(client, client_read, (void *)(long)i) != 0)
+  {
+    close(client);
+    return;
+  }
+  clients[i].fd = client;
+  clients[i].len = 0;
+  clients[i].since = time(NULL);
+}
+
+/*
+ * metrics_listen
+ *
+ * serve the metrics over HTTP on 127.0.0.1:port from the event loop.
+ */
+int metrics_listen(int port)
+{
+  struct sockaddr_in sin;
+  int one = 1;
+  int fd;
+
+  if((fd=socket(AF_INET, SOCK_STREAM, 0)) == -1)
+  {
+    return(-1);
+  }
+  setsockopt(fd, SOL_SOCKET, SO_REUSEADDR, &one, sizeof(one));
+
+  memset(&sin, 0, sizeof(sin));
+  sin.sin_family = AF_INET;
+  sin.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+  sin.sin_port = htons(port);
+  if(bind(fd, (struct sockaddr *)&sin, sizeof(sin)) != 0 || listen(fd, 4) != 0 ||
+      metrics_adopt(fd) != 0)
+  {
+    close(fd);
+    return(-1);
+  }
+
+  return(0);
+}
+
+/*
+ * metrics_adopt
+ *
+ * serve the metrics on fd, a socket that is already listening
+ */
+int metrics_adopt(int fd)
+{
+  if(event_add(fd, metrics_accept, NULL) != 0)
+  {
+    return(-1);
+  }
+  fcntl(fd, F_SETFD, FD_CLOEXEC);
+  listen_fd = fd;
+
+  return(0);
+}
+
+/*
+ * metrics_detach
+ *
+ * stop serving the metrics and return the listening socket, or -1
+ */
+int metrics_detach(void)
+{
+  int fd = listen_fd;
+  int i;
+
+  for(i=0; clients_init && i<METRICS_CLIENTS; i++)
+  {
+    if(clients[i].fd != -1)
+    {
+      client_drop(i);
+    }
+  }
+  if(listen_fd != -1)
+  {
+    event_del(listen_fd);
+    listen_fd = -1;
+  }
+
+  return(fd);
+}
+
@@ -0,0 +1,60 @@
+/* ============================================================================
+ * Copyright (C) 2001 Angus Mackay. All rights reserved; 
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2, or (at your option)
+ * any later version.
+ *
+ * THIS SOFTWARE IS PROVIDED ``AS IS'' AND ANY EXPRESSED OR IMPLIED WARRANTIES,
+ * INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND
+ * FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE
+ * AUTHOR BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY,
+ * OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ * ============================================================================
+ */
+
+/*
+ * metrics.h
+ *
+ * per update timing and counters, exported in the Prometheus text format
+ *
+ */
+
+#ifndef _METRICS_H
+#define _METRICS_H
+
+#include <stdio.h>
+#include <ezipupdate.h>
+
+/* update results, in the same order as the EZ_ result codes */
+#define METRICS_NRESULTS 3
+
+/* the timed stages of an address change */
+enum {
+  METRICS_DETECT_ACK = 0,
+  METRICS_ACK_VISIBLE,
+  METRICS_NSTAGES
+};
+
+extern void metrics_record(struct ez_session *s);
+extern void metrics_avoided(char *service);
+extern void metrics_change(char *service, int stage, struct timeval *from,
+    struct timeval *to);
+extern void metrics_unseen(char *service);
+extern void metrics_refresh(char *service, int spread, time_t due,
+    int refreshed);
+extern void metrics_poll(void);
+
+extern void metrics_print(FILE *fp);
+extern int metrics_write_file(char *file);
+extern int metrics_listen(int port);
+extern int metrics_adopt(int fd);
+extern int metrics_detach(void);
+
+#endif
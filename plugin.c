@@ -0,0 +1,255 @@
+/* ============================================================================
+ * Copyright (C) 2001 Angus Mackay. All rights reserved; 
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2, or (at your option)
+ * any later version.
+ *
+ * THIS SOFTWARE IS PROVIDED ``AS IS'' AND ANY EXPRESSED OR IMPLIED WARRANTIES,
+ * INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND
+ * FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE
+ * AUTHOR BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY,
+ * OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ * ============================================================================
+ */
+
+/*
+ * plugin.c
+ *
+ * plugins are dlopen()ed once each and stay loaded until plugin_unload(),
+ * as the services they register are used from the library.
+ *
+ */
+
+#ifdef HAVE_CONFIG_H
+#  include <config.h>
+#endif
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#if HAVE_DLFCN_H && HAVE_DLOPEN
+#  include <dlfcn.h>
+#endif
+
+#include <dprintf.h>
+#include <ezplugin.h>
+#include <plugin.h>
+
+#define MAX_PLUGINS 8
+#define MAX_PLUGIN_HOOKS 16
+#define MAX_PLUGIN_SERVICES 8
+
+static struct
+{
+  char *path;
+  void *handle;
+} plugins[MAX_PLUGINS];
+static int nplugins = 0;
+
+static struct
+{
+  ez_plugin_hook hook;
+  void *arg;
+} hooks[MAX_PLUGIN_HOOKS];
+static int nhooks = 0;
+
+static struct ez_plugin_service *services[MAX_PLUGIN_SERVICES];
+static int nservices = 0;
+
+static void (*plugin_message)(int level, const char *msg) = NULL;
+static char *(*plugin_ask)(const char *what, int secret) = NULL;
+static char error_buf[256] = "";
+
+static int api_add_service(struct ez_service *service)
+{
+  return(ez_service_register(service));
+}
+
+static int api_add_hook(ez_plugin_hook hook, void *arg)
+{
+  if(nhooks >= MAX_PLUGIN_HOOKS)
+  {
+    return(-1);
+  }
+  hooks[nhooks].hook = hook;
+  hooks[nhooks].arg = arg;
+  nhooks++;
+
+  return(0);
+}
+
+static void api_message(int level, const char *msg)
+{
+  if(plugin_message)
+  {
+    plugin_message(level, msg);
+  }
+}
+
+static int api_add_plugin_service(struct ez_plugin_service *service)
+{
+  if(nservices >= MAX_PLUGIN_SERVICES || service->service == NULL ||
+      ez_service_register(service->service) != 0)
+  {
+    return(-1);
+  }
+  services[nservices++] = service;
+
+  return(0);
+}
+
+static char *api_ask(const char *what, int secret)
+{
+  return(plugin_ask ? plugin_ask(what, secret) : NULL);
+}
+
+static struct ez_plugin_api api = {
+  EZ_PLUGIN_ABI,
+  sizeof(struct ez_plugin_api),
+  api_add_service,
+  api_add_hook,
+  api_message,
+  api_add_plugin_service,
+  api_ask,
+};
+
+/*
+ * plugin_load
+ *
+ * load the plugin in path unless it already is, messages from it go to
+ * message and its questions to ask.  returns -1 if it can't be,
+ * plugin_error() says why.
+ */
+int plugin_load(char *path, void (*message)(int level, const char *msg),
+    char *(*ask)(const char *what, int secret))
+{
+#if HAVE_DLFCN_H && HAVE_DLOPEN
+  int (*init)(const struct ez_plugin_api *api);
+  void *handle;
+  int *abi;
+  int i;
+
+  for(i=0; i<nplugins; i++)
+  {
+    if(strcmp(plugins[i].path, path) == 0)
+    {
+      return(0);
+    }
+  }
+  if(nplugins >= MAX_PLUGINS)
+  {
+    snprintf(error_buf, sizeof(error_buf), "too many plugins");
+    return(-1);
+  }
+
+  if((handle=dlopen(path, RTLD_NOW | RTLD_LOCAL)) == NULL)
+  {
+    snprintf(error_buf, sizeof(error_buf), "%s", dlerror());
+    return(-1);
+  }
+  abi = (int *)dlsym(handle, "ez_plugin_abi");
+  *(void **)&init = dlsym(handle, "ez_plugin_init");
+  if(abi == NULL || init == NULL)
+  {
+    snprintf(error_buf, sizeof(error_buf), "not an ez-ipupdate plugin");
+    dlclose(handle);
+    return(-1);
+  }
+  if(*abi < EZ_PLUGIN_ABI_MIN || *abi > EZ_PLUGIN_ABI)
+  {
+    snprintf(error_buf, sizeof(error_buf),
+        "built for plugin ABI %d, this takes %d to %d", *abi,
+        EZ_PLUGIN_ABI_MIN, EZ_PLUGIN_ABI);
+    dlclose(handle);
+    return(-1);
+  }
+
+  plugin_message = message;
+  plugin_ask = ask;
+  if(init(&api) != 0)
+  {
+    // what it registered before failing can't be taken back, so it stays
+    // loaded
+    snprintf(error_buf, sizeof(error_buf), "the plugin failed to start");
+    return(-1);
+  }
+  dprintf((stderr, "loaded plugin %s\n", path));
+
+  plugins[nplugins].path = strdup(path);
+  plugins[nplugins].handle = handle;
+  nplugins++;
+
+  return(0);
+#else
+  snprintf(error_buf, sizeof(error_buf),
+      "plugins are not supported on this platform");
+  return(-1);
+#endif
+}
+
+char *plugin_error(void)
+{
+  return(error_buf);
+}
+
+/*
+ * plugin_service
+ *
+ * the checks for service if a plugin added it with them, or NULL
+ */
+struct ez_plugin_service *plugin_service(struct ez_service *service)
+{
+  int i;
+
+  for(i=0; i<nservices; i++)
+  {
+    if(services[i]->service == service)
+    {
+      return(services[i]);
+    }
+  }
+  return(NULL);
+}
+
+/*
+ * plugin_updated
+ *
+ * call the hooks for the successful update made with s
+ */
+void plugin_updated(struct ez_session *s)
+{
+  int i;
+
+  for(i=0; i<nhooks; i++)
+  {
+    hooks[i].hook(s, hooks[i].arg);
+  }
+}
+
+/*
+ * plugin_unload
+ *
+ * only for on the way out, the services the plugins registered go with them
+ */
+void plugin_unload(void)
+{
+#if HAVE_DLFCN_H && HAVE_DLOPEN
+  int i;
+
+  for(i=0; i<nplugins; i++)
+  {
+    dlclose(plugins[i].handle);
+    free(plugins[i].path);
+  }
+#endif
+  nplugins = 0;
+  nhooks = 0;
+  nservices = 0;
+}
@@ -0,0 +1,38 @@
+#!/bin/sh
+#
+# plugin_test.sh
+#
+# a plugin service's own init() and check_info() are run: the MX it
+# needs is asked for, with nothing to answer the update isn't made, and
+# a plugin built for the ABI before the checks still loads.
+#
+
+fail()
+{
+  echo "plugin_test: $1"
+  echo "$out"
+  exit 1
+}
+
+args="-u u:p -h h.example.com -a 192.0.2.1"
+
+out=`echo mx.example.com | ./ez-ipupdate --plugin ./test_plugin.so -S testsvc $args 2>&1`
+echo "$out" | grep "testsvc: host=h.example.com mx=mx.example.com partner=from-init" > /dev/null ||
+  fail "the checks didn't fill in the session"
+
+echo "partner=given" > plugin_test.conf
+out=`./ez-ipupdate -c plugin_test.conf --plugin ./test_plugin.so -S testsvc $args --mx mx.example.com < /dev/null 2>&1`
+rm -f plugin_test.conf
+echo "$out" | grep "testsvc: host=h.example.com mx=mx.example.com partner=given" > /dev/null ||
+  fail "init() overrode the options"
+
+out=`./ez-ipupdate --plugin ./test_plugin.so -S testsvc $args < /dev/null 2>&1`
+echo "$out" | grep "testsvc:" > /dev/null &&
+  fail "updated without an MX"
+
+out=`./ez-ipupdate --plugin ./test_plugin2.so -S testsvc2 $args < /dev/null 2>&1`
+echo "$out" | grep "testsvc2: host=h.example.com" > /dev/null ||
+  fail "the ABI 2 plugin didn't work"
+
+echo "plugin_test: ok"
+exit 0
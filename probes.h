@@ -0,0 +1,65 @@
+/* ============================================================================
+ * Copyright (C) 2001 Angus Mackay. All rights reserved; 
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2, or (at your option)
+ * any later version.
+ *
+ * THIS SOFTWARE IS PROVIDED ``AS IS'' AND ANY EXPRESSED OR IMPLIED WARRANTIES,
+ * INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND
+ * FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE
+ * AUTHOR BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY,
+ * OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ * ============================================================================
+ */
+
+/*
+ * probes.h
+ *
+ * USDT static probes (the SystemTap <sys/sdt.h> kind) for bpftrace, perf
+ * or stap to attach to a running daemon, no debug build needed.  each one
+ * is a single nop until something attaches and without <sys/sdt.h> they
+ * aren't compiled in at all.
+ *
+ * the probes, all in provider ez_ipupdate:
+ *
+ *   update__start(session, host)
+ *   connect__start(session, server, port)
+ *   connect__done(session, result)
+ *   send(session, bytes)
+ *   recv(session, bytes)
+ *   update__done(session, result, nochg, bytes out, bytes in)
+ *   cache__write(file, address, date)
+ *   hook__spawn(pid, command)
+ *   tick(change id, wakeups)
+ *
+ * session is the address of the struct ez_session, the same in every
+ * probe of one update, and the change id is change.c's ("" if no change
+ * is pending).  ez-trace.bt and ez-latency.bt show them in use.
+ *
+ */
+
+#ifndef _PROBES_H
+#define _PROBES_H
+
+#if HAVE_SYS_SDT_H
+#  include <sys/sdt.h>
+#  define PROBE1(name, a) DTRACE_PROBE1(ez_ipupdate, name, a)
+#  define PROBE2(name, a, b) DTRACE_PROBE2(ez_ipupdate, name, a, b)
+#  define PROBE3(name, a, b, c) DTRACE_PROBE3(ez_ipupdate, name, a, b, c)
+#  define PROBE5(name, a, b, c, d, e) \
+  DTRACE_PROBE5(ez_ipupdate, name, a, b, c, d, e)
+#else
+#  define PROBE1(name, a)
+#  define PROBE2(name, a, b)
+#  define PROBE3(name, a, b, c)
+#  define PROBE5(name, a, b, c, d, e)
+#endif
+
+#endif
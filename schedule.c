@@ -0,0 +1,123 @@
+/* ============================================================================
+ * Copyright (C) 2001 Angus Mackay. All rights reserved; 
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2, or (at your option)
+ * any later version.
+ *
+ * THIS SOFTWARE IS PROVIDED ``AS IS'' AND ANY EXPRESSED OR IMPLIED WARRANTIES,
+ * INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND
+ * FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE
+ * AUTHOR BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY,
+ * OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ * ============================================================================
+ */
+
+/*
+ * schedule.c
+ *
+ * the daemon's rules for when an update is due and how far to back off
+ * after a failure.  they are here rather than in the main loop so that
+ * ez-sim runs the same code in virtual time, and a change to them can be
+ * tried against a month of simulated address changes before it ships.
+ *
+ * refreshes come early by a spread offset, a hash of the job into a
+ * window, so boxes that all updated at once after an outage or a restart
+ * don't go on refreshing at once every max-interval after.
+ *
+ */
+
+#ifdef HAVE_CONFIG_H
+#  include <config.h>
+#endif
+
+#include <stdio.h>
+
+#include <dprintf.h>
+#include <schedule.h>
+
+/*
+ * sched_spread
+ *
+ * the job called key's offset in [0, window), the same every time and
+ * on every box (FNV-1a)
+ */
+int sched_spread(const char *key, int window)
+{
+  unsigned long hash = 2166136261UL;
+
+  if(window <= 0)
+  {
+    return(0);
+  }
+  for(; *key != '\0'; key++)
+  {
+    hash ^= (unsigned char)*key;
+    hash = (hash * 16777619UL) & 0xffffffffUL;
+  }
+  return(hash % window);
+}
+
+/*
+ * sched_refresh_due
+ *
+ * whether an unchanged address is due to be sent again, so the service
+ * doesn't expire it, spread seconds early but never more than half
+ * max-interval
+ */
+int sched_refresh_due(time_t last_update, int max_interval, int spread,
+    time_t now)
+{
+  if(spread > max_interval/2)
+  {
+    spread = max_interval/2;
+  }
+  return(max_interval > 0 && now - last_update > max_interval - spread);
+}
+
+/*
+ * sched_acked
+ *
+ * the time to keep as the last update after one that worked at now.  a
+ * server that says nothing changed gets asked again sooner.
+ */
+time_t sched_acked(time_t now, int nochg, int max_interval)
+{
+  if(nochg && max_interval > 0)
+  {
+    return(now - max_interval/2);
+  }
+  return(now);
+}
+
+/*
+ * sched_backoff
+ *
+ * double the time between attempts after each failure to update, between
+ * MIN_WAIT_PERIOD and MAX_WAIT_PERIOD. this gets set back to the normal
+ * value the next time we get a successful update
+ */
+int sched_backoff(int period)
+{
+  if(period < MIN_WAIT_PERIOD)
+  {
+    period = MIN_WAIT_PERIOD;
+  }
+  else
+  {
+    period *= 2;
+  }
+  if(period > MAX_WAIT_PERIOD)
+  {
+    period = MAX_WAIT_PERIOD;
+  }
+  dprintf((stderr, "local_update_period: %d\n", period));
+
+  return(period);
+}
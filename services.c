@@ -0,0 +1,2572 @@
+/* ============================================================================
+ * Copyright (C) 2001 Angus Mackay. All rights reserved; 
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2, or (at your option)
+ * any later version.
+ *
+ * THIS SOFTWARE IS PROVIDED ``AS IS'' AND ANY EXPRESSED OR IMPLIED WARRANTIES,
+ * INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND
+ * FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE
+ * AUTHOR BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY,
+ * OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ * ============================================================================
+ */
+
+/*
+ * services.c
+ *
+ * the update code for each service libezipupdate knows, each talking to
+ * the server only through the session it is given.
+ *
+ */
+
+#ifdef HAVE_CONFIG_H
+#  include <config.h>
+#endif
+
+#define EZIP_DEFAULT_SERVER "www.EZ-IP.Net"
+#define EZIP_DEFAULT_PORT "80"
+#define EZIP_REQUEST "/members/update/"
+
+#define PGPOW_DEFAULT_SERVER "www.penguinpowered.com"
+#define PGPOW_DEFAULT_PORT "2345"
+#define PGPOW_REQUEST "update"
+#define PGPOW_VERSION "1.0"
+
+#define DHS_DEFAULT_SERVER "members.dhs.org"
+#define DHS_DEFAULT_PORT "80"
+#define DHS_REQUEST "/nic/hosts"
+#define DHS_SUCKY_TIMEOUT 60
+
+#define DYNDNS_DEFAULT_SERVER "members.dyndns.org"
+#define DYNDNS_DEFAULT_PORT "80"
+#define DYNDNS_REQUEST "/nic/update"
+#define DYNDNS_STAT_REQUEST "/nic/update"
+
+#define ODS_DEFAULT_SERVER "update.ods.org"
+#define ODS_DEFAULT_PORT "7070"
+#define ODS_REQUEST "update"
+
+#define TZO_DEFAULT_SERVER "cgi.tzo.com"
+#define TZO_DEFAULT_PORT "80"
+#define TZO_REQUEST "/webclient/signedon.html"
+
+#define GNUDIP_DEFAULT_SERVER ""
+#define GNUDIP_DEFAULT_PORT "3495"
+#define GNUDIP_REQUEST "0"
+
+#define EASYDNS_DEFAULT_SERVER "members.easydns.com"
+#define EASYDNS_DEFAULT_PORT "80"
+#define EASYDNS_REQUEST "/dyn/ez-ipupdate.php"
+
+#define EASYDNS_PARTNER_DEFAULT_SERVER "api.easydns.com"
+#define EASYDNS_PARTNER_DEFAULT_PORT "80"
+#define EASYDNS_PARTNER_REQUEST "/dyn/ez-ipupdate.php"
+
+#define JUSTL_DEFAULT_SERVER "www.justlinux.com"
+#define JUSTL_DEFAULT_PORT "80"
+#define JUSTL_REQUEST "/bin/controlpanel/dyndns/jlc.pl"
+#define JUSTL_VERSION "2.0"
+
+#define DYNS_DEFAULT_SERVER "www.dyns.cx"
+#define DYNS_DEFAULT_PORT "80"
+#define DYNS_REQUEST "/postscript.php"
+
+#define HN_DEFAULT_SERVER "dup.hn.org"
+#define HN_DEFAULT_PORT "80"
+#define HN_REQUEST "/vanity/update"
+
+#define ZONEEDIT_DEFAULT_SERVER "www.zoneedit.com"
+#define ZONEEDIT_DEFAULT_PORT "80"
+#define ZONEEDIT_REQUEST "/auth/dynamic.html"
+
+#define HEIPV6TB_DEFAULT_SERVER "ipv6tb.he.net"
+#define HEIPV6TB_DEFAULT_PORT "80"
+#define HEIPV6TB_REQUEST "/index.cgi"
+
+// the max time we will wait if the server tells us to
+#define MAX_WAITRESPONSE_WAIT (24*3600)
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <time.h>
+#if USE_MD5
+#  include <md5.h>
+#  define MD5_DIGEST_BYTES (16)
+#endif
+
+#include <arena.h>
+#include <session.h>
+
+#if !defined(__GNUC__) && !defined(HAVE_SNPRINTF)
+#error "get gcc, fix this code, or find yourself a snprintf!"
+#else
+#  if HAVE_SNPRINTF
+#    define  snprintf(x, y, z...) snprintf(x, y, ## z)
+#  else
+#    define  snprintf(x, y, z...) sprintf(x, ## z)
+#  endif
+#endif
+
+#ifndef OS
+#  define OS "unknown"
+#endif
+
+#define ARRAY_LEN(x) (sizeof(x)/sizeof(x[0]))
+
+/**************************************************/
+
+static char *NULL_fields_used[] = { NULL };
+
+#ifdef USE_EZIP
+static int EZIP_update_entry(struct ez_session *s);
+static char *EZIP_fields_used[] = { "server", "user", "address", "wildcard", "mx", "url", "host", NULL };
+#endif
+
+#ifdef USE_PGPOW
+static int PGPOW_update_entry(struct ez_session *s);
+static char *PGPOW_fields_used[] = { "server", "host", NULL };
+#endif
+
+#ifdef USE_DHS
+static int DHS_update_entry(struct ez_session *s);
+static char *DHS_fields_used[] = { "server", "user", "address", "wildcard", "mx", "url", "host", NULL };
+#endif
+
+#ifdef USE_DYNDNS
+static int DYNDNS_update_entry(struct ez_session *s);
+static char *DYNDNS_fields_used[] = { "server", "user", "address", "address6", "wildcard", "mx", "host", NULL };
+static char *DYNDNS_STAT_fields_used[] = { "server", "user", "address", "address6", "wildcard", "mx", "host", NULL };
+#endif
+
+#ifdef USE_ODS
+static int ODS_update_entry(struct ez_session *s);
+static char *ODS_fields_used[] = { "server", "host", "address", NULL };
+#endif
+
+#ifdef USE_TZO
+static int TZO_update_entry(struct ez_session *s);
+static char *TZO_fields_used[] = { "server", "user", "address", "host", "connection-type", NULL };
+#endif
+
+#ifdef USE_EASYDNS
+static int EASYDNS_update_entry(struct ez_session *s);
+static char *EASYDNS_fields_used[] = { "server", "user", "address", "wildcard", "mx", "host", NULL };
+#endif
+
+#ifdef USE_EASYDNS_PARTNER
+static int EASYDNS_PARTNER_update_entry(struct ez_session *s);
+static char *EASYDNS_PARTNER_fields_used[] = { "server", "partner", "user", "address", "wildcard", "host", NULL };
+#endif
+
+#if defined(USE_MD5) && defined(USE_GNUDIP)
+static int GNUDIP_update_entry(struct ez_session *s);
+static char *GNUDIP_fields_used[] = { "server", "user", "host", "address", NULL };
+#endif
+
+#ifdef USE_JUSTL
+static int JUSTL_update_entry(struct ez_session *s);
+static char *JUSTL_fields_used[] = { "server", "user", "host", NULL };
+#endif
+
+#ifdef USE_DYNS
+static int DYNS_update_entry(struct ez_session *s);
+static char *DYNS_fields_used[] = { "server", "user", "host", NULL };
+#endif
+
+#ifdef USE_HN
+static int HN_update_entry(struct ez_session *s);
+static char *HN_fields_used[] = { "server", "user", "address", NULL };
+#endif
+
+#ifdef USE_ZONEEDIT
+static int ZONEEDIT_update_entry(struct ez_session *s);
+static char *ZONEEDIT_fields_used[] = { "server", "user", "address", "mx", "host", NULL };
+#endif
+
+#ifdef USE_HEIPV6TB
+static int HEIPV6TB_update_entry(struct ez_session *s);
+static char *HEIPV6TB_fields_used[] = { "server", "user", NULL };
+#endif
+
+struct ez_service ez_services[] = {
+  { "NULL",
+    { "null", "NULL", 0, },
+    NULL,
+    NULL_fields_used,
+    "",
+    "",
+    ""
+  },
+#ifdef USE_EZIP
+  { "ez-ip",
+    { "ezip", "ez-ip", 0, },
+    EZIP_update_entry,
+    EZIP_fields_used,
+    EZIP_DEFAULT_SERVER,
+    EZIP_DEFAULT_PORT,
+    EZIP_REQUEST
+  },
+#endif
+#ifdef USE_PGPOW
+  { "justlinux v1.0 (penguinpowered)",
+    { "pgpow", "penguinpowered", 0, },
+    PGPOW_update_entry,
+    PGPOW_fields_used,
+    PGPOW_DEFAULT_SERVER,
+    PGPOW_DEFAULT_PORT,
+    PGPOW_REQUEST
+  },
+#endif
+#ifdef USE_DHS
+  { "dhs",
+    { "dhs", 0, 0, },
+    DHS_update_entry,
+    DHS_fields_used,
+    DHS_DEFAULT_SERVER,
+    DHS_DEFAULT_PORT,
+    DHS_REQUEST
+  },
+#endif
+#ifdef USE_DYNDNS
+  { "dyndns",
+    { "dyndns", 0, 0, },
+    DYNDNS_update_entry,
+    DYNDNS_fields_used,
+    DYNDNS_DEFAULT_SERVER,
+    DYNDNS_DEFAULT_PORT,
+    DYNDNS_REQUEST
+  },
+  { "dyndns-static",
+    { "dyndns-static", "dyndns-stat", "statdns", },
+    DYNDNS_update_entry,
+    DYNDNS_STAT_fields_used,
+    DYNDNS_DEFAULT_SERVER,
+    DYNDNS_DEFAULT_PORT,
+    DYNDNS_STAT_REQUEST
+  },
+  { "dyndns-custom",
+    { "dyndns-custom", "mydyndns", 0 },
+    DYNDNS_update_entry,
+    DYNDNS_STAT_fields_used,
+    DYNDNS_DEFAULT_SERVER,
+    DYNDNS_DEFAULT_PORT,
+    DYNDNS_REQUEST
+  },
+#endif
+#ifdef USE_ODS
+  { "ods",
+    { "ods", 0, 0, },
+    ODS_update_entry,
+    ODS_fields_used,
+    ODS_DEFAULT_SERVER,
+    ODS_DEFAULT_PORT,
+    ODS_REQUEST
+  },
+#endif
+#ifdef USE_TZO
+  { "tzo",
+    { "tzo", 0, 0, },
+    TZO_update_entry,
+    TZO_fields_used,
+    TZO_DEFAULT_SERVER,
+    TZO_DEFAULT_PORT,
+    TZO_REQUEST
+  },
+#endif
+#ifdef USE_EASYDNS
+  { "easydns",
+    { "easydns", 0, 0, },
+    EASYDNS_update_entry,
+    EASYDNS_fields_used,
+    EASYDNS_DEFAULT_SERVER,
+    EASYDNS_DEFAULT_PORT,
+    EASYDNS_REQUEST
+  },
+#endif
+#ifdef USE_EASYDNS_PARTNER
+  { "easydns-partner",
+    { "easydns-partner", 0, 0, },
+    EASYDNS_PARTNER_update_entry,
+    EASYDNS_PARTNER_fields_used,
+    EASYDNS_PARTNER_DEFAULT_SERVER,
+    EASYDNS_PARTNER_DEFAULT_PORT,
+    EASYDNS_PARTNER_REQUEST
+  },
+#endif
+#if defined(USE_MD5) && defined(USE_GNUDIP)
+  { "gnudip",
+    { "gnudip", 0, 0, },
+    GNUDIP_update_entry,
+    GNUDIP_fields_used,
+    GNUDIP_DEFAULT_SERVER,
+    GNUDIP_DEFAULT_PORT,
+    GNUDIP_REQUEST
+  },
+#endif
+#ifdef USE_JUSTL
+  { "justlinux v2.0 (penguinpowered)",
+    { "justlinux", 0, 0, },
+    JUSTL_update_entry,
+    JUSTL_fields_used,
+    JUSTL_DEFAULT_SERVER,
+    JUSTL_DEFAULT_PORT,
+    JUSTL_REQUEST
+  },
+#endif
+#ifdef USE_DYNS
+  { "dyns",
+    { "dyns", 0, 0, },
+    DYNS_update_entry,
+    DYNS_fields_used,
+    DYNS_DEFAULT_SERVER,
+    DYNS_DEFAULT_PORT,
+    DYNS_REQUEST
+  },
+#endif
+#ifdef USE_HN
+  { "hammer node",
+    { "hn", 0, 0, },
+    HN_update_entry,
+    HN_fields_used,
+    HN_DEFAULT_SERVER,
+    HN_DEFAULT_PORT,
+    HN_REQUEST
+  },
+#endif
+#ifdef USE_ZONEEDIT
+  { "zoneedit",
+    { "zoneedit", 0, 0, },
+    ZONEEDIT_update_entry,
+    ZONEEDIT_fields_used,
+    ZONEEDIT_DEFAULT_SERVER,
+    ZONEEDIT_DEFAULT_PORT,
+    ZONEEDIT_REQUEST
+  },
+#endif
+#ifdef USE_HEIPV6TB
+  { "heipv6tb",
+    { "heipv6tb", 0, 0, },
+    HEIPV6TB_update_entry,
+    HEIPV6TB_fields_used,
+    HEIPV6TB_DEFAULT_SERVER,
+    HEIPV6TB_DEFAULT_PORT,
+    HEIPV6TB_REQUEST
+  },
+#endif
+};
+
+int ez_nservices = ARRAY_LEN(ez_services);
+
+// services added at run time, by plugins say
+#define MAX_EXTRA_SERVICES 16
+static struct ez_service *extra_services[MAX_EXTRA_SERVICES];
+static int nextra_services = 0;
+
+/**************************************************/
+
+static int service_named(struct ez_service *s, const char *name)
+{
+  int j;
+
+  for(j=0; j<ARRAY_LEN(s->names) && s->names[j] != NULL; j++)
+  {
+    if(strcmp(s->names[j], name) == 0)
+    {
+      return(1);
+    }
+  }
+  return(0);
+}
+
+/*
+ * ez_service_find
+ *
+ * the service that goes by name, or NULL
+ */
+struct ez_service *ez_service_find(const char *name)
+{
+  int i;
+
+  for(i=0; i<ARRAY_LEN(ez_services); i++)
+  {
+    if(service_named(&ez_services[i], name))
+    {
+      return(&ez_services[i]);
+    }
+  }
+  for(i=0; i<nextra_services; i++)
+  {
+    if(service_named(extra_services[i], name))
+    {
+      return(extra_services[i]);
+    }
+  }
+
+  return(NULL);
+}
+
+/*
+ * ez_service_register
+ *
+ * make service findable by its names. it must stay around for as long as
+ * the library is used and registering has to be done before any sessions
+ * are running.  returns -1 if one of its names is taken or there are too
+ * many.
+ */
+int ez_service_register(struct ez_service *service)
+{
+  int j;
+
+  if(nextra_services >= MAX_EXTRA_SERVICES || service->update == NULL ||
+      service->names[0] == NULL)
+  {
+    return(-1);
+  }
+  for(j=0; j<ARRAY_LEN(service->names) && service->names[j] != NULL; j++)
+  {
+    if(ez_service_find(service->names[j]) != NULL)
+    {
+      return(-1);
+    }
+  }
+  extra_services[nextra_services++] = service;
+
+  return(0);
+}
+
+/*
+ * ez_service_extra
+ *
+ * the i'th service registered with ez_service_register(), or NULL
+ */
+struct ez_service *ez_service_extra(int i)
+{
+  if(i < 0 || i >= nextra_services)
+  {
+    return(NULL);
+  }
+  return(extra_services[i]);
+}
+
+#ifdef USE_DYNDNS
+static int is_in_list(char *needle, char **haystack)
+{
+  char **p;
+  int found = 0;
+
+  for(p=haystack; *p != NULL; p++)
+  {
+    if(strcmp(needle, *p) == 0)
+    {
+      found = 1;
+      break;
+    }
+  }
+
+  return(found);
+}
+#endif
+
+#if defined(USE_DYNDNS) || defined(USE_EASYDNS_PARTNER)
+static char *format_time(int seconds, char *buf)
+{
+  snprintf(buf, 16, "%d:%02d:%02d", seconds/(3600),
+          (seconds%(3600))/(60), (seconds%60));
+  return(buf);
+}
+#endif
+
+#if defined(USE_MD5) && defined(USE_GNUDIP)
+/*
+ * like "chomp" in perl, take off trailing newline chars
+ */
+static char *chomp(char *buf)
+{
+  char *p;
+
+  for(p=buf; *p != '\0'; p++);
+  if(p != buf) { p--; }
+  while(p>=buf && (*p == '\n' || *p == '\r'))
+  {
+    *p-- = '\0';
+  }
+
+  return(buf);
+}
+#endif
+
+#ifdef USE_PGPOW
+static int PGPOW_read_response(struct ez_session *s, char *buf)
+{
+  int bytes; 
+
+  bytes = ez_read_input(s, buf, BUFFER_SIZE);
+  if(bytes < 1)
+  {
+    close(s->sock);
+    return(-1);
+  }
+  buf[bytes] = '\0';
+
+  dprintf((stderr, "server says: %s\n", buf));
+  
+  if(strncmp("OK", buf, 2) != 0)
+  {
+    return(1);
+  }
+  else
+  {
+    return(0);
+  }
+}
+#endif
+
+#ifdef USE_ODS
+static int ODS_read_response(struct ez_session *s, char *buf, int len)
+{
+  int bytes = 0; 
+  int bread = 0;
+  char* p = buf;
+  int max_iter = 32;
+
+  for(; bytes < len && max_iter > 0; max_iter--)
+  {
+    bread = ez_read_input(s, p, len-bytes);
+    bytes += bread;
+    if(bytes < 1)
+    {
+      close(s->sock);
+      return(-1);
+    }
+    if(bread > 0)
+    {
+      p[bread] = '\0';
+    }
+    if(strstr(buf, "\r\n") > 0)
+    {
+      break;
+    }
+
+    dprintf((stderr, "server says: %s\n", p));
+    p += bread;
+  }
+  dprintf((stderr, "server said: %s\n", buf));
+  
+  return(atoi(buf));
+}
+#endif
+
+#ifdef USE_EZIP
+static int EZIP_update_entry(struct ez_session *s)
+{
+  char *buf = s->buf;
+  char *bp = buf;
+  int bytes;
+  int btot;
+  int ret;
+
+  buf[BUFFER_SIZE] = '\0';
+
+  if(ez_connect(s) != 0)
+  {
+    if(!(s->flags & EZ_QUIET))
+    {
+      ez_message(s, EZ_MSG_NOTICE, "error connecting to %s:%s\n", s->server, s->port);
+    }
+    return(EZ_ERROR);
+  }
+
+  snprintf(buf, BUFFER_SIZE, "GET %s?mode=update&", s->request);
+  ez_output(s, buf);
+  if(s->address)
+  {
+    ez_output_param(s, buf, "ipaddress", s->address, "&");
+  }
+  snprintf(buf, BUFFER_SIZE, "%s=%s&", "wildcard", s->wildcard ? "yes" : "no");
+  ez_output(s, buf);
+  ez_output_param(s, buf, "mx", s->mx, "&");
+  ez_output_param(s, buf, "url", s->url, "&");
+  ez_output_param(s, buf, "host", s->host, "&");
+  snprintf(buf, BUFFER_SIZE, " HTTP/1.0\015\012");
+  ez_output(s, buf);
+  snprintf(buf, BUFFER_SIZE, "Authorization: Basic %s\015\012", s->auth);
+  ez_output(s, buf);
+  snprintf(buf, BUFFER_SIZE, "User-Agent: %s-%s %s [%s] (%s)\015\012", 
+      "ez-update", VERSION, OS, (s->flags & EZ_DAEMON) ? "daemon" : "", "by Angus Mackay");
+  ez_output(s, buf);
+  snprintf(buf, BUFFER_SIZE, "Host: %s\015\012", s->server);
+  ez_output(s, buf);
+  snprintf(buf, BUFFER_SIZE, "\015\012");
+  ez_output(s, buf);
+
+  bp = buf;
+  bytes = 0;
+  btot = 0;
+  while((bytes=ez_read_input(s, bp, BUFFER_SIZE-btot)) > 0)
+  {
+    bp += bytes;
+    btot += bytes;
+    dprintf((stderr, "btot: %d\n", btot));
+  }
+  close(s->sock);
+  buf[btot] = '\0';
+
+  dprintf((stderr, "server output: %s\n", buf));
+
+  if(sscanf(buf, " HTTP/1.%*c %3d", &ret) != 1)
+  {
+    ret = -1;
+  }
+
+  switch(ret)
+  {
+    case -1:
+      if(!(s->flags & EZ_QUIET))
+      {
+        ez_message(s, EZ_MSG_NOTICE, "strange server response, are you connecting to the right server?\n");
+      }
+      return(EZ_ERROR);
+      break;
+
+    case 200:
+      if(!(s->flags & EZ_QUIET))
+      {
+        ez_message(s, EZ_MSG_RESULT, "request successful\n");
+      }
+      break;
+
+    case 401:
+      if(!(s->flags & EZ_QUIET))
+      {
+        ez_message(s, EZ_MSG_NOTICE, "authentication failure\n");
+      }
+      return(EZ_SHUTDOWN);
+      break;
+
+    default:
+      if(!(s->flags & EZ_QUIET))
+      {
+        *s->response = '\0';
+        sscanf(buf, " HTTP/1.%*c %*3d %255[^\r\n]", s->response);
+        ez_message(s, EZ_MSG_NOTICE, "unknown return code: %d\n", ret);
+        ez_message(s, EZ_MSG_DETAIL, "server response: %s\n", s->response);
+      }
+      return(EZ_ERROR);
+      break;
+  }
+
+  return(EZ_OK);
+}
+#endif
+
+#ifdef USE_DYNDNS
+static int DYNDNS_update_entry(struct ez_session *s)
+{
+  char *buf = s->buf;
+  char *bp = buf;
+  int bytes;
+  int btot;
+  int ret;
+  int retval = EZ_OK;
+
+  buf[BUFFER_SIZE] = '\0';
+
+  if(ez_connect(s) != 0)
+  {
+    if(!(s->flags & EZ_QUIET))
+    {
+      ez_message(s, EZ_MSG_NOTICE, "error connecting to %s:%s\n", s->server, s->port);
+    }
+    return(EZ_ERROR);
+  }
+
+  snprintf(buf, BUFFER_SIZE, "GET %s?", s->request);
+  ez_output(s, buf);
+
+  if(is_in_list("dyndns-static", s->service->names))
+  {
+    snprintf(buf, BUFFER_SIZE, "%s=%s&", "system", "statdns");
+    ez_output(s, buf);
+  }
+  else if(is_in_list("dyndns-custom", s->service->names))
+  {
+    snprintf(buf, BUFFER_SIZE, "%s=%s&", "system", "custom");
+    ez_output(s, buf);
+  }
+
+  ez_output_param(s, buf, "hostname", s->host, "&");
+  // both addresses go in the one update as myip=<v4>,<v6>
+  if(s->address6 != NULL && *s->address6 != '\0')
+  {
+    char both[128];
+
+    snprintf(both, sizeof(both), "%s%s%s", s->address ? s->address : "",
+        s->address && *s->address ? "," : "", s->address6);
+    ez_output_param(s, buf, "myip", both, "&");
+  }
+  else if(s->address != NULL)
+  {
+    ez_output_param(s, buf, "myip", s->address, "&");
+  }
+  snprintf(buf, BUFFER_SIZE, "%s=%s&", "wildcard", s->wildcard ? "ON" : "OFF");
+  ez_output(s, buf);
+  if(s->mx != NULL && *s->mx != '\0')
+  {
+    ez_output_param(s, buf, "mx", s->mx, "&");
+  }
+  //snprintf(buf, BUFFER_SIZE, "%s=%s&", "backmx", "NO");
+  //output(buf);
+  if(s->flags & EZ_OFFLINE)
+  {
+    snprintf(buf, BUFFER_SIZE, "%s=%s&", "offline", "yes");
+    ez_output(s, buf);
+  }
+  snprintf(buf, BUFFER_SIZE, " HTTP/1.0\015\012");
+  ez_output(s, buf);
+  snprintf(buf, BUFFER_SIZE, "Authorization: Basic %s\015\012", s->auth);
+  ez_output(s, buf);
+  snprintf(buf, BUFFER_SIZE, "User-Agent: %s-%s %s [%s] (%s)\015\012", 
+      "ez-update", VERSION, OS, (s->flags & EZ_DAEMON) ? "daemon" : "", "by Angus Mackay");
+  ez_output(s, buf);
+  snprintf(buf, BUFFER_SIZE, "Host: %s\015\012", s->server);
+  ez_output(s, buf);
+  snprintf(buf, BUFFER_SIZE, "\015\012");
+  ez_output(s, buf);
+
+  bp = buf;
+  bytes = 0;
+  btot = 0;
+  while((bytes=ez_read_input(s, bp, BUFFER_SIZE-btot)) > 0)
+  {
+    bp += bytes;
+    btot += bytes;
+    dprintf((stderr, "btot: %d\n", btot));
+  }
+  close(s->sock);
+  buf[btot] = '\0';
+
+  dprintf((stderr, "server output: %s\n", buf));
+
+  if(sscanf(buf, " HTTP/1.%*c %3d", &ret) != 1)
+  {
+    ret = -1;
+  }
+
+  switch(ret)
+  {
+    case -1:
+      if(!(s->flags & EZ_QUIET))
+      {
+        ez_message(s, EZ_MSG_NOTICE, "strange server response, are you connecting to the right server?\n");
+      }
+      retval = EZ_ERROR;
+      break;
+
+    case 200:
+      if(strstr(buf, "\ngood ") != NULL)
+      {
+        if(!(s->flags & EZ_QUIET))
+        {
+          ez_message(s, EZ_MSG_RESULT, "request successful\n");
+        }
+      }
+      else
+      {
+        if(strstr(buf, "\nnohost") != NULL)
+        {
+          ez_message(s, EZ_MSG_NOTICE, "invalid hostname: %s\n", s->host);
+          retval = EZ_SHUTDOWN;
+        }
+        else if(strstr(buf, "\nnotfqdn") != NULL)
+        {
+          ez_message(s, EZ_MSG_NOTICE, "malformed hostname: %s\n", s->host);
+          retval = EZ_SHUTDOWN;
+        }
+        else if(strstr(buf, "\n!yours") != NULL)
+        {
+          ez_message(s, EZ_MSG_NOTICE, "host \"%s\" is not under your control\n", s->host);
+          retval = EZ_SHUTDOWN;
+        }
+        else if(strstr(buf, "\nabuse") != NULL)
+        {
+          ez_message(s, EZ_MSG_NOTICE, "host \"%s\" has been blocked for abuse\n", s->host);
+          retval = EZ_SHUTDOWN;
+        }
+        else if(strstr(buf, "\nnochg") != NULL)
+        {
+          ez_message(s, EZ_MSG_NOTICE, "%s says that your IP address has not changed since the last update\n", s->server);
+          // lets say that this counts as a successful update, the caller
+          // rolls back its last update time to max_interval/2
+          s->nochg = 1;
+          retval = EZ_OK;
+        }
+        else if(strstr(buf, "\nbadauth") != NULL)
+        {
+          ez_message(s, EZ_MSG_NOTICE, "authentication failure\n");
+          retval = EZ_SHUTDOWN;
+        }
+        else if(strstr(buf, "\nbadsys") != NULL)
+        {
+          ez_message(s, EZ_MSG_NOTICE, "invalid system parameter\n");
+          retval = EZ_SHUTDOWN;
+        }
+        else if(strstr(buf, "\nbadagent") != NULL)
+        {
+          ez_message(s, EZ_MSG_NOTICE, "this useragent has been blocked\n");
+          retval = EZ_SHUTDOWN;
+        }
+        else if(strstr(buf, "\nnumhost") != NULL)
+        {
+          ez_message(s, EZ_MSG_NOTICE, "Too many or too few hosts found\n");
+          retval = EZ_SHUTDOWN;
+        }
+        else if(strstr(buf, "\ndnserr") != NULL)
+        {
+          char *p = strstr(buf, "\ndnserr");
+          ez_message(s, EZ_MSG_NOTICE, "dyndns internal error, please report this number to "
+              "their support people: %s\n", N_STR(p));
+          retval = EZ_ERROR;
+        }
+        else if(strstr(buf, "\n911") != NULL)
+        {
+          ez_message(s, EZ_MSG_NOTICE, "Ahhhh! call 911!\n");
+          retval = EZ_SHUTDOWN;
+        }
+        else if(strstr(buf, "\n999") != NULL)
+        {
+          ez_message(s, EZ_MSG_NOTICE, "Ahhhh! call 999!\n");
+          retval = EZ_SHUTDOWN;
+        }
+        else if(strstr(buf, "\n!donator") != NULL)
+        {
+          ez_message(s, EZ_MSG_NOTICE, "a feature requested is only available to donators, please donate.\n", s->host);
+          retval = EZ_OK;
+        }
+        // this one should be last as it is a stupid string to signify waits
+        // with as it is so short
+        else if(strstr(buf, "\nw") != NULL)
+        {
+          int howlong = 0;
+          char *p = strstr(buf, "\nw");
+          char reason[256] = "";
+          char when[16];
+          char mult = 's';
+
+          // get time and reason, p points at "\nw<n><s|m|h> <reason>"
+          if(strlen(p) >= 3)
+          {
+            sscanf(p + 2, "%d%c %255[^\r\n]", &howlong, &mult, reason);
+            if(mult == 'h')
+            {
+              howlong *= 3600;
+            }
+            else if(mult == 'm')
+            {
+              howlong *= 60;
+            }
+            if(howlong > MAX_WAITRESPONSE_WAIT)
+            {
+              howlong = MAX_WAITRESPONSE_WAIT;
+            };
+          }
+          else
+          {
+            sprintf(reason, "problem parsing reason for wait response");
+          }
+
+          ez_message(s, EZ_MSG_NOTICE, "Wait response received, waiting for %s before next update.\n",
+              format_time(howlong, when));
+          ez_message(s, EZ_MSG_NOTICE, "Wait response reason: %s\n", N_STR(reason));
+          s->wait = howlong;
+          s->transport->pause(s, howlong);
+          retval = EZ_ERROR;
+        }
+        else
+        {
+          ez_message(s, EZ_MSG_NOTICE, "error processing request\n");
+          if(!(s->flags & EZ_QUIET))
+          {
+            ez_message(s, EZ_MSG_DETAIL, "==== server output: ====\n%s\n", buf);
+          }
+          retval = EZ_ERROR;
+        }
+      }
+      break;
+
+    case 401:
+      if(!(s->flags & EZ_QUIET))
+      {
+        ez_message(s, EZ_MSG_NOTICE, "authentication failure\n");
+      }
+      retval = EZ_SHUTDOWN;
+      break;
+
+    default:
+      if(!(s->flags & EZ_QUIET))
+      {
+        *s->response = '\0';
+        sscanf(buf, " HTTP/1.%*c %*3d %255[^\r\n]", s->response);
+        ez_message(s, EZ_MSG_NOTICE, "unknown return code: %d\n", ret);
+        ez_message(s, EZ_MSG_DETAIL, "server response: %s\n", s->response);
+      }
+      retval = EZ_ERROR;
+      break;
+  }
+
+  return(retval);
+}
+#endif
+
+#ifdef USE_PGPOW
+static int PGPOW_update_entry(struct ez_session *s)
+{
+  char *buf = s->buf;
+
+  buf[BUFFER_SIZE] = '\0';
+
+  if(ez_connect(s) != 0)
+  {
+    if(!(s->flags & EZ_QUIET))
+    {
+      ez_message(s, EZ_MSG_NOTICE, "error connecting to %s:%s\n", s->server, s->port);
+    }
+    return(EZ_ERROR);
+  }
+
+  /* read server message */
+  if(PGPOW_read_response(s, buf) != 0)
+  {
+    ez_message(s, EZ_MSG_NOTICE, "strange server response, are you connecting to the right server?\n");
+    close(s->sock);
+    return(EZ_ERROR);
+  }
+
+  /* send version command */
+  snprintf(buf, BUFFER_SIZE, "VER %s [%s-%s %s (%s)]\015\012", PGPOW_VERSION,
+      "ez-update", VERSION, OS, "by Angus Mackay");
+  ez_output(s, buf);
+
+  if(PGPOW_read_response(s, buf) != 0)
+  {
+    if(strncmp("ERR", buf, 3) == 0)
+    {
+      ez_message(s, EZ_MSG_NOTICE, "error talking to server: %s\n", &(buf[3]));
+    }
+    else
+    {
+      ez_message(s, EZ_MSG_NOTICE, "error talking to server:\n\t%s\n", buf);
+    }
+    close(s->sock);
+    return(EZ_ERROR);
+  }
+
+  /* send user command */
+  snprintf(buf, BUFFER_SIZE, "USER %s\015\012", s->user_name);
+  ez_output(s, buf);
+
+  if(PGPOW_read_response(s, buf) != 0)
+  {
+    if(strncmp("ERR", buf, 3) == 0)
+    {
+      ez_message(s, EZ_MSG_NOTICE, "error talking to server: %s\n", &(buf[3]));
+    }
+    else
+    {
+      ez_message(s, EZ_MSG_NOTICE, "error talking to server:\n\t%s\n", buf);
+    }
+    close(s->sock);
+    return(EZ_ERROR);
+  }
+
+  /* send pass command */
+  snprintf(buf, BUFFER_SIZE, "PASS %s\015\012", s->password);
+  ez_output(s, buf);
+
+  if(PGPOW_read_response(s, buf) != 0)
+  {
+    if(strncmp("ERR", buf, 3) == 0)
+    {
+      ez_message(s, EZ_MSG_NOTICE, "error talking to server: %s\n", &(buf[3]));
+    }
+    else
+    {
+      ez_message(s, EZ_MSG_NOTICE, "error talking to server:\n\t%s\n", buf);
+    }
+    close(s->sock);
+    return(EZ_ERROR);
+  }
+
+  /* send host command */
+  snprintf(buf, BUFFER_SIZE, "HOST %s\015\012", s->host);
+  ez_output(s, buf);
+
+  if(PGPOW_read_response(s, buf) != 0)
+  {
+    if(strncmp("ERR", buf, 3) == 0)
+    {
+      ez_message(s, EZ_MSG_NOTICE, "error talking to server: %s\n", &(buf[3]));
+    }
+    else
+    {
+      ez_message(s, EZ_MSG_NOTICE, "error talking to server:\n\t%s\n", buf);
+    }
+    close(s->sock);
+    return(EZ_ERROR);
+  }
+
+  /* send oper command */
+  snprintf(buf, BUFFER_SIZE, "OPER %s\015\012", s->request);
+  ez_output(s, buf);
+
+  if(PGPOW_read_response(s, buf) != 0)
+  {
+    if(strncmp("ERR", buf, 3) == 0)
+    {
+      ez_message(s, EZ_MSG_NOTICE, "error talking to server: %s\n", &(buf[3]));
+    }
+    else
+    {
+      ez_message(s, EZ_MSG_NOTICE, "error talking to server:\n\t%s\n", buf);
+    }
+    close(s->sock);
+    return(EZ_ERROR);
+  }
+
+  if(strcmp("update", s->request) == 0)
+  {
+    /* send ip command */
+    snprintf(buf, BUFFER_SIZE, "IP %s\015\012", s->address);
+    ez_output(s, buf);
+
+    if(PGPOW_read_response(s, buf) != 0)
+    {
+      if(strncmp("ERR", buf, 3) == 0)
+      {
+        ez_message(s, EZ_MSG_NOTICE, "error talking to server: %s\n", &(buf[3]));
+      }
+      else
+      {
+        ez_message(s, EZ_MSG_NOTICE, "error talking to server:\n\t%s\n", buf);
+      }
+      close(s->sock);
+      return(EZ_ERROR);
+    }
+  }
+
+  /* send done command */
+  snprintf(buf, BUFFER_SIZE, "DONE\015\012");
+  ez_output(s, buf);
+
+  if(PGPOW_read_response(s, buf) != 0)
+  {
+    if(strncmp("ERR", buf, 3) == 0)
+    {
+      ez_message(s, EZ_MSG_NOTICE, "error talking to server: %s\n", &(buf[3]));
+    }
+    else
+    {
+      ez_message(s, EZ_MSG_NOTICE, "error talking to server:\n\t%s\n", buf);
+    }
+    close(s->sock);
+    return(EZ_ERROR);
+  }
+
+  if(!(s->flags & EZ_QUIET))
+  {
+    ez_message(s, EZ_MSG_RESULT, "request successful\n");
+  }
+
+  close(s->sock);
+  return(EZ_OK);
+}
+#endif
+
+#ifdef USE_DHS
+static int DHS_update_entry(struct ez_session *s)
+{
+  char *buf = s->buf;
+  char *putbuf = arena_alloc(s->arena, BUFFER_SIZE+1);
+  char *bp = buf;
+  int bytes;
+  int btot;
+  int ret;
+  char *domain = NULL;
+  char *hostname = NULL;
+  char *p;
+  char *end = putbuf + BUFFER_SIZE;
+  int retval = EZ_OK;
+
+  if(putbuf == NULL)
+  {
+    return(EZ_ERROR);
+  }
+  buf[BUFFER_SIZE] = '\0';
+  putbuf[BUFFER_SIZE] = '\0';
+
+  /* parse apart the domain and hostname */
+  hostname = arena_strdup(s->arena, s->host);
+  if((p=strchr(hostname, '.')) == NULL)
+  {
+    if(!(s->flags & EZ_QUIET))
+    {
+      ez_message(s, EZ_MSG_NOTICE, "error parsing hostname from host %s\n", s->host);
+    }
+    return(EZ_ERROR);
+  }
+  *p = '\0';
+  p++;
+  if(*p == '\0')
+  {
+    if(!(s->flags & EZ_QUIET))
+    {
+      ez_message(s, EZ_MSG_NOTICE, "error parsing domain from host %s\n", s->host);
+    }
+    return(EZ_ERROR);
+  }
+  domain = arena_strdup(s->arena, p);
+
+  dprintf((stderr, "hostname: %s, domain: %s\n", hostname, domain));
+
+  if(ez_connect(s) != 0)
+  {
+    if(!(s->flags & EZ_QUIET))
+    {
+      ez_message(s, EZ_MSG_NOTICE, "error connecting to %s:%s\n", s->server, s->port);
+    }
+    return(EZ_ERROR);
+  }
+
+  snprintf(buf, BUFFER_SIZE, "POST %s HTTP/1.0\015\012", s->request);
+  ez_output(s, buf);
+  snprintf(buf, BUFFER_SIZE, "Authorization: Basic %s\015\012", s->auth);
+  ez_output(s, buf);
+  snprintf(buf, BUFFER_SIZE, "User-Agent: %s-%s %s [%s] (%s)\015\012", 
+      "ez-update", VERSION, OS, (s->flags & EZ_DAEMON) ? "daemon" : "", "by Angus Mackay");
+  ez_output(s, buf);
+  snprintf(buf, BUFFER_SIZE, "Host: %s\015\012", s->server);
+  ez_output(s, buf);
+
+  p = putbuf;
+  *p = '\0';
+  p = ez_append_param(s, p, end, "hostscmd", "edit", "&");
+  p = ez_append_param(s, p, end, "hostscmdstage", "2", "&");
+  p = ez_append_param(s, p, end, "type", "4", "&");
+  p = ez_append_param(s, p, end, "updatetype", "Online", "&");
+  p = ez_append_param(s, p, end, "ip", s->address, "&");
+  p = ez_append_param(s, p, end, "mx", s->mx, "&");
+  p = ez_append_param(s, p, end, "offline_url", s->url, "&");
+  if(s->cloak_title)
+  {
+    p = ez_append_param(s, p, end, "cloak", "Y", "&");
+    p = ez_append_param(s, p, end, "cloak_title", s->cloak_title, "&");
+  }
+  else
+  {
+    p = ez_append_param(s, p, end, "cloak_title", "", "&");
+  }
+  p = ez_append_param(s, p, end, "submit", "Update", "&");
+  p = ez_append_param(s, p, end, "domain", domain, "&");
+  p = ez_append_param(s, p, end, "hostname", hostname, "");
+
+  snprintf(buf, BUFFER_SIZE, "Content-length: %d\015\012", strlen(putbuf));
+  ez_output(s, buf);
+  snprintf(buf, BUFFER_SIZE, "\015\012");
+  ez_output(s, buf);
+
+  ez_output(s, putbuf);
+  snprintf(buf, BUFFER_SIZE, "\015\012");
+  ez_output(s, buf);
+
+  bp = buf;
+  bytes = 0;
+  btot = 0;
+  while((bytes=ez_read_input(s, bp, BUFFER_SIZE-btot)) > 0)
+  {
+    bp += bytes;
+    btot += bytes;
+    dprintf((stderr, "btot: %d\n", btot));
+  }
+  close(s->sock);
+  buf[btot] = '\0';
+
+  dprintf((stderr, "server output: %s\n", buf));
+
+  if(sscanf(buf, " HTTP/1.%*c %3d", &ret) != 1)
+  {
+    ret = -1;
+  }
+
+  switch(ret)
+  {
+    case -1:
+      if(!(s->flags & EZ_QUIET))
+      {
+        ez_message(s, EZ_MSG_NOTICE, "strange server response, are you connecting to the right server?\n");
+      }
+      retval = EZ_ERROR;
+      break;
+
+    case 200:
+      if(!(s->flags & EZ_QUIET))
+      {
+        ez_message(s, EZ_MSG_RESULT, "request successful\n");
+      }
+      break;
+
+    case 401:
+      if(!(s->flags & EZ_QUIET))
+      {
+        ez_message(s, EZ_MSG_NOTICE, "authentication failure\n");
+      }
+      retval = EZ_SHUTDOWN;
+      break;
+
+    default:
+      if(!(s->flags & EZ_QUIET))
+      {
+        *s->response = '\0';
+        sscanf(buf, " HTTP/1.%*c %*3d %255[^\r\n]", s->response);
+        ez_message(s, EZ_MSG_NOTICE, "unknown return code: %d\n", ret);
+        ez_message(s, EZ_MSG_NOTICE, "server response: %s\n", s->response);
+      }
+      retval = EZ_ERROR;
+      break;
+  }
+
+  // this stupid service requires us to do seperate request if we want to 
+  // update the mail exchanger (mx). grrrrrr
+  if(*s->mx != '\0')
+  {
+    // okay, dhs's service is incredibly stupid and will not work with two
+    // requests right after each other. I could care less that this is ugly,
+    // I personally will NEVER use dhs, it is laughable.
+    s->transport->pause(s, DHS_SUCKY_TIMEOUT < s->timeout.tv_sec ? DHS_SUCKY_TIMEOUT : s->timeout.tv_sec);
+
+    if(ez_connect(s) != 0)
+    {
+      if(!(s->flags & EZ_QUIET))
+      {
+        ez_message(s, EZ_MSG_NOTICE, "error connecting to %s:%s\n", s->server, s->port);
+      }
+      return(EZ_ERROR);
+    }
+
+    snprintf(buf, BUFFER_SIZE, "POST %s HTTP/1.0\015\012", s->request);
+    ez_output(s, buf);
+    snprintf(buf, BUFFER_SIZE, "Authorization: Basic %s\015\012", s->auth);
+    ez_output(s, buf);
+    snprintf(buf, BUFFER_SIZE, "User-Agent: %s-%s %s [%s] (%s)\015\012", 
+        "ez-update", VERSION, OS, (s->flags & EZ_DAEMON) ? "daemon" : "", "by Angus Mackay");
+    ez_output(s, buf);
+    snprintf(buf, BUFFER_SIZE, "Host: %s\015\012", s->server);
+    ez_output(s, buf);
+
+    p = putbuf;
+    *p = '\0';
+    p = ez_append_param(s, p, end, "hostscmd", "edit", "&");
+    p = ez_append_param(s, p, end, "hostscmdstage", "2", "&");
+    p = ez_append_param(s, p, end, "type", "4", "&");
+    p = ez_append_param(s, p, end, "updatetype", "Update Mail Exchanger", "&");
+    p = ez_append_param(s, p, end, "ip", s->address, "&");
+    p = ez_append_param(s, p, end, "mx", s->mx, "&");
+    p = ez_append_param(s, p, end, "offline_url", s->url, "&");
+    if(s->cloak_title)
+    {
+      p = ez_append_param(s, p, end, "cloak", "Y", "&");
+      p = ez_append_param(s, p, end, "cloak_title", s->cloak_title, "&");
+    }
+    else
+    {
+      p = ez_append_param(s, p, end, "cloak_title", "", "&");
+    }
+    p = ez_append_param(s, p, end, "submit", "Update", "&");
+    p = ez_append_param(s, p, end, "domain", domain, "&");
+    p = ez_append_param(s, p, end, "hostname", hostname, "");
+
+    snprintf(buf, BUFFER_SIZE, "Content-length: %d\015\012", strlen(putbuf));
+    ez_output(s, buf);
+    snprintf(buf, BUFFER_SIZE, "\015\012");
+    ez_output(s, buf);
+
+    ez_output(s, putbuf);
+    snprintf(buf, BUFFER_SIZE, "\015\012");
+    ez_output(s, buf);
+
+    bp = buf;
+    bytes = 0;
+    btot = 0;
+    while((bytes=ez_read_input(s, bp, BUFFER_SIZE-btot)) > 0)
+    {
+      bp += bytes;
+      btot += bytes;
+      dprintf((stderr, "btot: %d\n", btot));
+    }
+    close(s->sock);
+    buf[btot] = '\0';
+
+    dprintf((stderr, "server output: %s\n", buf));
+
+    if(sscanf(buf, " HTTP/1.%*c %3d", &ret) != 1)
+    {
+      ret = -1;
+    }
+
+    switch(ret)
+    {
+      case -1:
+        if(!(s->flags & EZ_QUIET))
+        {
+          ez_message(s, EZ_MSG_NOTICE, "strange server response, are you connecting to the right server?\n");
+        }
+        retval = EZ_ERROR;
+        break;
+
+      case 200:
+        if(!(s->flags & EZ_QUIET))
+        {
+          ez_message(s, EZ_MSG_RESULT, "request successful\n");
+        }
+        break;
+
+      case 401:
+        if(!(s->flags & EZ_QUIET))
+        {
+          ez_message(s, EZ_MSG_NOTICE, "authentication failure\n");
+        }
+        retval = EZ_SHUTDOWN;
+        break;
+
+      default:
+        if(!(s->flags & EZ_QUIET))
+        {
+          *s->response = '\0';
+          sscanf(buf, " HTTP/1.%*c %*3d %255[^\r\n]", s->response);
+          ez_message(s, EZ_MSG_NOTICE, "unknown return code: %d\n", ret);
+          ez_message(s, EZ_MSG_NOTICE, "server response: %s\n", s->response);
+        }
+        retval = EZ_ERROR;
+        break;
+    }
+  }
+
+  return(retval);
+}
+#endif
+
+#ifdef USE_ODS
+static int ODS_update_entry(struct ez_session *s)
+{
+  char *buf = s->buf;
+  int response;
+
+  buf[BUFFER_SIZE] = '\0';
+
+  if(ez_connect(s) != 0)
+  {
+    if(!(s->flags & EZ_QUIET))
+    {
+      ez_message(s, EZ_MSG_NOTICE, "error connecting to %s:%s\n", s->server, s->port);
+    }
+    return(EZ_ERROR);
+  }
+
+  /* read server message */
+  if(ODS_read_response(s, buf, BUFFER_SIZE) != 100)
+  {
+    ez_message(s, EZ_MSG_NOTICE, "strange server response, are you connecting to the right server?\n");
+    close(s->sock);
+    return(EZ_ERROR);
+  }
+
+  /* send login command */
+  snprintf(buf, BUFFER_SIZE, "LOGIN %s %s\012", s->user_name, s->password);
+  ez_output(s, buf);
+
+  response = ODS_read_response(s, buf, BUFFER_SIZE);
+  if(!(response == 225 || response == 226))
+  {
+    if(strlen(buf) > 4)
+    {
+      ez_message(s, EZ_MSG_NOTICE, "error talking to server: %s\n", &(buf[4]));
+    }
+    else
+    {
+      ez_message(s, EZ_MSG_NOTICE, "error talking to server\n");
+    }
+    close(s->sock);
+    return(EZ_ERROR);
+  }
+
+  /* send delete command */
+  snprintf(buf, BUFFER_SIZE, "DELRR %s A\012", s->host);
+  ez_output(s, buf);
+
+  if(ODS_read_response(s, buf, BUFFER_SIZE) != 901)
+  {
+    if(strlen(buf) > 4)
+    {
+      ez_message(s, EZ_MSG_NOTICE, "error talking to server: %s\n", &(buf[4]));
+    }
+    else
+    {
+      ez_message(s, EZ_MSG_NOTICE, "error talking to server\n");
+    }
+    close(s->sock);
+    return(EZ_ERROR);
+  }
+
+  /* send address command */
+  snprintf(buf, BUFFER_SIZE, "ADDRR %s A %s\012", s->host, 
+                *s->address == '\0' ? "CONNIP" :  s->address);
+  ez_output(s, buf);
+
+  response = ODS_read_response(s, buf, BUFFER_SIZE);
+  if(!(response == 795 || response == 796))
+  {
+    if(strlen(buf) > 4)
+    {
+      ez_message(s, EZ_MSG_NOTICE, "error talking to server: %s\n", &(buf[4]));
+    }
+    else
+    {
+      ez_message(s, EZ_MSG_NOTICE, "error talking to server\n");
+    }
+    close(s->sock);
+    return(EZ_ERROR);
+  }
+
+  if(!(s->flags & EZ_QUIET))
+  {
+    ez_message(s, EZ_MSG_RESULT, "request successful\n");
+  }
+
+  close(s->sock);
+  return(EZ_OK);
+}
+#endif
+
+#ifdef USE_TZO
+static int TZO_update_entry(struct ez_session *s)
+{
+  char *buf = s->buf;
+  char *bp = buf;
+  int bytes;
+  int btot;
+  int ret;
+
+  buf[BUFFER_SIZE] = '\0';
+
+  if(ez_connect(s) != 0)
+  {
+    if(!(s->flags & EZ_QUIET))
+    {
+      ez_message(s, EZ_MSG_NOTICE, "error connecting to %s:%s\n", s->server, s->port);
+    }
+    return(EZ_ERROR);
+  }
+
+  snprintf(buf, BUFFER_SIZE, "GET %s?", s->request);
+  ez_output(s, buf);
+  ez_output_param(s, buf, "TZOName", s->host, "&");
+  ez_output_param(s, buf, "Email", s->user_name, "&");
+  ez_output_param(s, buf, "TZOKey", s->password, "&");
+  ez_output_param(s, buf, "IPAddress", s->address, "&");
+  snprintf(buf, BUFFER_SIZE, " HTTP/1.0\015\012");
+  ez_output(s, buf);
+  snprintf(buf, BUFFER_SIZE, "User-Agent: %s-%s %s [%s] (%s)\015\012", 
+      "ez-update", VERSION, OS, (s->flags & EZ_DAEMON) ? "daemon" : "", "by Angus Mackay");
+  ez_output(s, buf);
+  snprintf(buf, BUFFER_SIZE, "Host: %s\015\012", s->server);
+  ez_output(s, buf);
+  snprintf(buf, BUFFER_SIZE, "\015\012");
+  ez_output(s, buf);
+
+  bp = buf;
+  bytes = 0;
+  btot = 0;
+  while((bytes=ez_read_input(s, bp, BUFFER_SIZE-btot)) > 0)
+  {
+    bp += bytes;
+    btot += bytes;
+    dprintf((stderr, "btot: %d\n", btot));
+  }
+  close(s->sock);
+  buf[btot] = '\0';
+
+  dprintf((stderr, "server output: %s\n", buf));
+
+  if(sscanf(buf, " HTTP/1.%*c %3d", &ret) != 1)
+  {
+    ret = -1;
+  }
+
+  switch(ret)
+  {
+    case -1:
+      if(!(s->flags & EZ_QUIET))
+      {
+        ez_message(s, EZ_MSG_NOTICE, "strange server response, are you connecting to the right server?\n");
+      }
+      return(EZ_ERROR);
+      break;
+
+    case 200:
+      if(!(s->flags & EZ_QUIET))
+      {
+        ez_message(s, EZ_MSG_RESULT, "request successful\n");
+      }
+      break;
+
+    case 302:
+      // There is no neat way to determine the exact error other than to
+      // parse the Location part of the mime header to find where we're
+      // being redirected.
+      if(!(s->flags & EZ_QUIET))
+      {
+        *s->response = '\0';
+        bp = strstr(buf, "Location: ");
+        if((bp < strstr(buf, "\r\n\r\n")) && (sscanf(bp, "Location: http://%*[^/]%255[^\r\n]", s->response) == 1))
+        {
+          bp = strrchr(s->response, '/') + 1;
+        }
+        else
+        {
+          bp = "";
+        }
+        dprintf((stderr, "location: %s\n", bp));
+
+        if(!(strncmp(bp, "domainmismatch.htm", strlen(bp)) && strncmp(bp, "invname.htm", strlen(bp))))
+        {
+          ez_message(s, EZ_MSG_NOTICE, "invalid host name\n");
+        }
+        else if(!strncmp(bp, "invkey.htm", strlen(bp)))
+        {
+          ez_message(s, EZ_MSG_NOTICE, "invalid password(tzo key)\n");
+        }
+        else if(!(strncmp(bp, "emailmismatch.htm", strlen(bp)) && strncmp(bp, "invemail.htm", strlen(bp))))
+        {
+          ez_message(s, EZ_MSG_NOTICE, "invalid user name(email address)\n");
+        }
+        else
+        {
+          ez_message(s, EZ_MSG_NOTICE, "unknown error\n");
+        }
+      }
+      return(EZ_ERROR);
+      break;
+
+    default:
+      if(!(s->flags & EZ_QUIET))
+      {
+        *s->response = '\0';
+        sscanf(buf, " HTTP/1.%*c %*3d %255[^\r\n]", s->response);
+        ez_message(s, EZ_MSG_NOTICE, "unknown return code: %d\n", ret);
+        ez_message(s, EZ_MSG_NOTICE, "server response: %s\n", s->response);
+      }
+      return(EZ_ERROR);
+      break;
+  }
+
+  return(EZ_OK);
+}
+#endif
+
+#ifdef USE_EASYDNS
+static int EASYDNS_update_entry(struct ez_session *s)
+{
+  char *buf = s->buf;
+  char *bp = buf;
+  int bytes;
+  int btot;
+  int ret;
+
+  buf[BUFFER_SIZE] = '\0';
+
+  if(ez_connect(s) != 0)
+  {
+    if(!(s->flags & EZ_QUIET))
+    {
+      ez_message(s, EZ_MSG_NOTICE, "error connecting to %s:%s\n", s->server, s->port);
+    }
+    return(EZ_ERROR);
+  }
+
+  snprintf(buf, BUFFER_SIZE, "GET %s?action=edit&", s->request);
+  ez_output(s, buf);
+  if(s->address != NULL && *s->address != '\0')
+  {
+    ez_output_param(s, buf, "myip", s->address, "&");
+  }
+  snprintf(buf, BUFFER_SIZE, "%s=%s&", "wildcard", s->wildcard ? "ON" : "OFF");
+  ez_output(s, buf);
+  ez_output_param(s, buf, "mx", s->mx, "&");
+  snprintf(buf, BUFFER_SIZE, "%s=%s&", "backmx", *s->mx == '\0' ? "NO" : "YES");
+  ez_output(s, buf);
+  ez_output_param(s, buf, "host_id", s->host, "&");
+  snprintf(buf, BUFFER_SIZE, " HTTP/1.0\015\012");
+  ez_output(s, buf);
+  snprintf(buf, BUFFER_SIZE, "Authorization: Basic %s\015\012", s->auth);
+  ez_output(s, buf);
+  snprintf(buf, BUFFER_SIZE, "User-Agent: %s-%s %s [%s] (%s)\015\012", 
+      "ez-update", VERSION, OS, (s->flags & EZ_DAEMON) ? "daemon" : "", "by Angus Mackay");
+  ez_output(s, buf);
+  snprintf(buf, BUFFER_SIZE, "Host: %s\015\012", s->server);
+  ez_output(s, buf);
+  snprintf(buf, BUFFER_SIZE, "\015\012");
+  ez_output(s, buf);
+
+  bp = buf;
+  bytes = 0;
+  btot = 0;
+  while((bytes=ez_read_input(s, bp, BUFFER_SIZE-btot)) > 0)
+  {
+    bp += bytes;
+    btot += bytes;
+    dprintf((stderr, "btot: %d\n", btot));
+  }
+  close(s->sock);
+  buf[btot] = '\0';
+
+  dprintf((stderr, "server output: %s\n", buf));
+
+  if(sscanf(buf, " HTTP/1.%*c %3d", &ret) != 1)
+  {
+    ret = -1;
+  }
+
+  switch(ret)
+  {
+    case -1:
+      if(!(s->flags & EZ_QUIET))
+      {
+        ez_message(s, EZ_MSG_NOTICE, "strange server response, are you connecting to the right server?\n");
+      }
+      return(EZ_ERROR);
+      break;
+
+    case 200:
+      if(strstr(buf, "NOERROR\n") != NULL)
+      {
+        if(!(s->flags & EZ_QUIET))
+        {
+          ez_message(s, EZ_MSG_RESULT, "request successful\n");
+        }
+      }
+      else
+      {
+        ez_message(s, EZ_MSG_NOTICE, "error processing request\n");
+        if(!(s->flags & EZ_QUIET))
+        {
+          ez_message(s, EZ_MSG_DETAIL, "server output: %s\n", buf);
+        }
+        return(EZ_ERROR);
+      }
+      break;
+
+    case 401:
+      if(!(s->flags & EZ_QUIET))
+      {
+        ez_message(s, EZ_MSG_NOTICE, "authentication failure\n");
+      }
+      return(EZ_SHUTDOWN);
+      break;
+
+    default:
+      if(!(s->flags & EZ_QUIET))
+      {
+        *s->response = '\0';
+        sscanf(buf, " HTTP/1.%*c %*3d %255[^\r\n]", s->response);
+        ez_message(s, EZ_MSG_NOTICE, "unknown return code: %d\n", ret);
+        ez_message(s, EZ_MSG_NOTICE, "server response: %s\n", s->response);
+      }
+      return(EZ_ERROR);
+      break;
+  }
+
+  return(EZ_OK);
+}
+#endif
+
+#ifdef USE_EASYDNS_PARTNER
+static int EASYDNS_PARTNER_update_entry(struct ez_session *s)
+{
+  char *buf = s->buf;
+  char *bp = buf;
+  char when[16];
+  int bytes;
+  int btot;
+  int ret;
+
+  buf[BUFFER_SIZE] = '\0';
+
+  if(ez_connect(s) != 0)
+  {
+    if(!(s->flags & EZ_QUIET))
+    {
+      ez_message(s, EZ_MSG_NOTICE, "error connecting to %s:%s\n", s->server, s->port);
+    }
+    return(EZ_ERROR);
+  }
+
+  snprintf(buf, BUFFER_SIZE, "GET %s?action=edit&", s->request);
+  ez_output(s, buf);
+  if(s->address != NULL && *s->address != '\0')
+  {
+    ez_output_param(s, buf, "myip", s->address, "&");
+  }
+  ez_output_param(s, buf, "partner", s->partner, "&");
+  snprintf(buf, BUFFER_SIZE, "%s=%s&", "wildcard", s->wildcard ? "ON" : "OFF");
+  ez_output(s, buf);
+  ez_output_param(s, buf, "hostname", s->host, "");
+  snprintf(buf, BUFFER_SIZE, " HTTP/1.0\015\012");
+  ez_output(s, buf);
+  snprintf(buf, BUFFER_SIZE, "Authorization: Basic %s\015\012", s->auth);
+  ez_output(s, buf);
+  snprintf(buf, BUFFER_SIZE, "User-Agent: %s-%s %s [%s] (%s)\015\012", 
+      "ez-update", VERSION, OS, (s->flags & EZ_DAEMON) ? "daemon" : "", "by Angus Mackay");
+  ez_output(s, buf);
+  snprintf(buf, BUFFER_SIZE, "Host: %s\015\012", s->server);
+  ez_output(s, buf);
+  snprintf(buf, BUFFER_SIZE, "\015\012");
+  ez_output(s, buf);
+
+  bp = buf;
+  bytes = 0;
+  btot = 0;
+  while((bytes=ez_read_input(s, bp, BUFFER_SIZE-btot)) > 0)
+  {
+    bp += bytes;
+    btot += bytes;
+    dprintf((stderr, "btot: %d\n", btot));
+  }
+  close(s->sock);
+  buf[btot] = '\0';
+
+  dprintf((stderr, "server output: %s\n", buf));
+
+  if(sscanf(buf, " HTTP/1.%*c %3d", &ret) != 1)
+  {
+    ret = -1;
+  }
+
+  switch(ret)
+  {
+    case -1:
+      if(!(s->flags & EZ_QUIET))
+      {
+        ez_message(s, EZ_MSG_NOTICE, "strange server response, are you connecting to the right server?\n");
+      }
+      return(EZ_ERROR);
+      break;
+
+    case 200:
+      if(strstr(buf, "OK\n") != NULL)
+      {
+        if(!(s->flags & EZ_QUIET))
+        {
+          ez_message(s, EZ_MSG_RESULT, "request successful\n");
+        }
+      }
+      else
+      {
+        ez_message(s, EZ_MSG_NOTICE, "error processing request\n");
+        if(!(s->flags & EZ_QUIET))
+        {
+          ez_message(s, EZ_MSG_DETAIL, "server output: %s\n", buf);
+        }
+        return(EZ_ERROR);
+      }
+      break;
+
+    case 401:
+      if(!(s->flags & EZ_QUIET))
+      {
+        ez_message(s, EZ_MSG_NOTICE, "authentication failure\n");
+      }
+      return(EZ_SHUTDOWN);
+      break;
+
+    case 403:
+      if(!(s->flags & EZ_QUIET))
+      {
+        ez_message(s, EZ_MSG_NOTICE, "updating too frequently\n");
+      }
+      ez_message(s, EZ_MSG_NOTICE, "sleeping for %s\n", format_time(MAX_WAITRESPONSE_WAIT, when));
+      s->wait = MAX_WAITRESPONSE_WAIT;
+      s->transport->pause(s, MAX_WAITRESPONSE_WAIT);
+      return(EZ_ERROR);
+      break;
+
+    case 404:
+      if(!(s->flags & EZ_QUIET))
+      {
+        ez_message(s, EZ_MSG_NOTICE, "no dynamic service for this host/domain\n");
+      }
+      return(EZ_SHUTDOWN);
+      break;
+
+    case 405:
+      if(!(s->flags & EZ_QUIET))
+      {
+        ez_message(s, EZ_MSG_NOTICE, "partner not supported\n");
+      }
+      return(EZ_SHUTDOWN);
+      break;
+
+    default:
+      if(!(s->flags & EZ_QUIET))
+      {
+        *s->response = '\0';
+        sscanf(buf, " HTTP/1.%*c %*3d %255[^\r\n]", s->response);
+        ez_message(s, EZ_MSG_NOTICE, "unknown return code: %d\n", ret);
+        ez_message(s, EZ_MSG_NOTICE, "server response: %s\n", s->response);
+      }
+      return(EZ_ERROR);
+      break;
+  }
+
+  return(EZ_OK);
+}
+#endif
+
+#if defined(USE_MD5) && defined(USE_GNUDIP)
+static int GNUDIP_update_entry(struct ez_session *s)
+{
+  unsigned char digestbuf[MD5_DIGEST_BYTES];
+  char *buf = s->buf;
+  char *p;
+  int bytes;
+  int ret;
+  int i;
+  char *domainname;
+  char gnudip_request[2]; 
+
+  // send an offline request if address 0.0.0.0 is used
+  // otherwise, we ignore the address and send an update request
+  gnudip_request[0] = strcmp(s->address, "0.0.0.0") == 0 ? '1' : '0';
+  gnudip_request[1] = '\0';
+
+  // find domainname
+  for(p=s->host; *p != '\0' && *p != '.'; p++);
+  if(*p != '\0') { p++; }
+  if(*p == '\0')
+  {
+    return(EZ_ERROR);
+  }
+  domainname = p;
+
+  if(ez_connect(s) != 0)
+  {
+    if(!(s->flags & EZ_QUIET))
+    {
+      ez_message(s, EZ_MSG_NOTICE, "error connecting to %s:%s\n", s->server, s->port);
+    }
+    return(EZ_ERROR);
+  }
+
+  if((bytes=ez_read_input(s, buf, BUFFER_SIZE)) <= 0)
+  {
+    close(s->sock);
+    return(EZ_ERROR);
+  }
+  buf[bytes] = '\0';
+  dprintf((stderr, "bytes: %d\n", bytes));
+  dprintf((stderr, "server output: %s\n", buf));
+
+  // buf holds the shared secret
+  chomp(buf);
+
+  // use the auth buffer
+  md5_buffer(s->password, strlen(s->password), digestbuf);
+  for(i=0, p=s->auth; i<MD5_DIGEST_BYTES; i++, p+=2)
+  {
+    sprintf(p, "%02x", digestbuf[i]);
+  }
+  strncat(s->auth, ".", 255-strlen(s->auth));
+  strncat(s->auth, buf, 255-strlen(s->auth));
+  dprintf((stderr, "auth: %s\n", s->auth));
+  md5_buffer(s->auth, strlen(s->auth), digestbuf);
+  for(i=0, p=buf; i<MD5_DIGEST_BYTES; i++, p+=2)
+  {
+    sprintf(p, "%02x", digestbuf[i]);
+  }
+  strcpy(s->auth, buf);
+
+  dprintf((stderr, "auth: %s\n", s->auth));
+
+  snprintf(buf, BUFFER_SIZE, "%s:%s:%s:%s\n", s->user_name, s->auth, domainname,
+      gnudip_request);
+  ez_output(s, buf);
+
+  bytes = 0;
+  if((bytes=ez_read_input(s, buf, BUFFER_SIZE)) <= 0)
+  {
+    close(s->sock);
+    return(EZ_ERROR);
+  }
+  buf[bytes] = '\0';
+
+  dprintf((stderr, "bytes: %d\n", bytes));
+  dprintf((stderr, "server output: %s\n", buf));
+
+  close(s->sock);
+
+  if(sscanf(buf, "%d", &ret) != 1)
+  {
+    ret = -1;
+  }
+
+  switch(ret)
+  {
+    case -1:
+      if(!(s->flags & EZ_QUIET))
+      {
+        ez_message(s, EZ_MSG_NOTICE, "strange server response, are you connecting to the right server?\n");
+      }
+      return(EZ_ERROR);
+      break;
+
+    case 0:
+      if(!(s->flags & EZ_QUIET))
+      {
+        ez_message(s, EZ_MSG_RESULT, "update request successful\n");
+      }
+      break;
+
+    case 1:
+      if(!(s->flags & EZ_QUIET))
+      {
+        ez_message(s, EZ_MSG_NOTICE, "invalid login attempt\n");
+      }
+      return(EZ_ERROR);
+      break;
+
+    case 2:
+      if(!(s->flags & EZ_QUIET))
+      {
+        ez_message(s, EZ_MSG_DETAIL, "offline request successful\n");
+      }
+      break;
+
+    default:
+      if(!(s->flags & EZ_QUIET))
+      {
+        ez_message(s, EZ_MSG_NOTICE, "unknown return code: %d\n", ret);
+      }
+      return(EZ_ERROR);
+      break;
+  }
+
+  return(EZ_OK);
+}
+#endif
+
+#ifdef USE_JUSTL
+static int JUSTL_update_entry(struct ez_session *s)
+{
+  char *buf = s->buf;
+  char *bp = buf;
+  int bytes;
+  int btot;
+  int ret;
+
+  buf[BUFFER_SIZE] = '\0';
+
+  if(ez_connect(s) != 0)
+  {
+    if(!(s->flags & EZ_QUIET))
+    {
+      ez_message(s, EZ_MSG_NOTICE, "error connecting to %s:%s\n", s->server, s->port);
+    }
+    return(EZ_ERROR);
+  }
+
+  snprintf(buf, BUFFER_SIZE, "GET %s?direct=1&", s->request);
+  ez_output(s, buf);
+  ez_output_param(s, buf, "username", s->user_name, "&");
+  ez_output_param(s, buf, "password", s->password, "&");
+  ez_output_param(s, buf, "host", s->host, "&");
+  ez_output_param(s, buf, "ip", s->address, "&");
+  snprintf(buf, BUFFER_SIZE, " HTTP/1.0\015\012");
+  ez_output(s, buf);
+  snprintf(buf, BUFFER_SIZE, "Authorization: Basic %s\015\012", s->auth);
+  ez_output(s, buf);
+  snprintf(buf, BUFFER_SIZE, "User-Agent: %s-%s %s [%s] (%s)\015\012", 
+      "ez-update", VERSION, OS, (s->flags & EZ_DAEMON) ? "daemon" : "", "by Angus Mackay");
+  ez_output(s, buf);
+  snprintf(buf, BUFFER_SIZE, "Host: %s\015\012", s->server);
+  ez_output(s, buf);
+  snprintf(buf, BUFFER_SIZE, "\015\012");
+  ez_output(s, buf);
+
+  bp = buf;
+  bytes = 0;
+  btot = 0;
+  while((bytes=ez_read_input(s, bp, BUFFER_SIZE-btot)) > 0)
+  {
+    bp += bytes;
+    btot += bytes;
+    dprintf((stderr, "btot: %d\n", btot));
+  }
+  close(s->sock);
+  buf[btot] = '\0';
+
+  dprintf((stderr, "server output: %s\n", buf));
+
+  if(sscanf(buf, " HTTP/1.%*c %3d", &ret) != 1)
+  {
+    ret = -1;
+  }
+
+  switch(ret)
+  {
+    case -1:
+      if(!(s->flags & EZ_QUIET))
+      {
+        ez_message(s, EZ_MSG_NOTICE, "strange server response, are you connecting to the right server?\n");
+      }
+      return(EZ_ERROR);
+      break;
+
+    case 200:
+      if(strstr(buf, " set ") != NULL)
+      {
+        if(!(s->flags & EZ_QUIET))
+        {
+          ez_message(s, EZ_MSG_RESULT, "request successful\n");
+        }
+      }
+      else
+      {
+        ez_message(s, EZ_MSG_NOTICE, "error processing request\n");
+        if(!(s->flags & EZ_QUIET))
+        {
+          ez_message(s, EZ_MSG_DETAIL, "server output: %s\n", buf);
+        }
+        return(EZ_ERROR);
+      }
+      break;
+
+    case 401:
+      if(!(s->flags & EZ_QUIET))
+      {
+        ez_message(s, EZ_MSG_NOTICE, "authentication failure\n");
+      }
+      return(EZ_SHUTDOWN);
+      break;
+
+    default:
+      if(!(s->flags & EZ_QUIET))
+      {
+        *s->response = '\0';
+        sscanf(buf, " HTTP/1.%*c %*3d %255[^\r\n]", s->response);
+        ez_message(s, EZ_MSG_NOTICE, "unknown return code: %d\n", ret);
+        ez_message(s, EZ_MSG_NOTICE, "server response: %s\n", s->response);
+      }
+      return(EZ_ERROR);
+      break;
+  }
+
+  return(EZ_OK);
+}
+#endif
+
+#ifdef USE_DYNS
+static int DYNS_update_entry(struct ez_session *s)
+{
+  char *buf = s->buf;
+  char *bp = buf;
+  int bytes;
+  int btot;
+  int ret;
+
+  buf[BUFFER_SIZE] = '\0';
+
+  if(ez_connect(s) != 0)
+  {
+    if(!(s->flags & EZ_QUIET))
+    {
+      ez_message(s, EZ_MSG_NOTICE, "error connecting to %s:%s\n", s->server, s->port);
+    }
+    return(EZ_ERROR);
+  }
+
+  snprintf(buf, BUFFER_SIZE, "GET %s?", s->request);
+  ez_output(s, buf);
+  ez_output_param(s, buf, "username", s->user_name, "&");
+  ez_output_param(s, buf, "password", s->password, "&");
+  ez_output_param(s, buf, "host", s->host, "&");
+  ez_output_param(s, buf, "ip", s->address, "");
+  snprintf(buf, BUFFER_SIZE, " HTTP/1.0\015\012");
+  ez_output(s, buf);
+  snprintf(buf, BUFFER_SIZE, "Authorization: Basic %s\015\012", s->auth);
+  ez_output(s, buf);
+  snprintf(buf, BUFFER_SIZE, "User-Agent: %s-%s %s [%s] (%s)\015\012", 
+      "ez-update", VERSION, OS, (s->flags & EZ_DAEMON) ? "daemon" : "", "by Angus Mackay");
+  ez_output(s, buf);
+  snprintf(buf, BUFFER_SIZE, "Host: %s\015\012", s->server);
+  ez_output(s, buf);
+  snprintf(buf, BUFFER_SIZE, "\015\012");
+  ez_output(s, buf);
+
+  bp = buf;
+  bytes = 0;
+  btot = 0;
+  while((bytes=ez_read_input(s, bp, BUFFER_SIZE-btot)) > 0)
+  {
+    bp += bytes;
+    btot += bytes;
+    dprintf((stderr, "btot: %d\n", btot));
+  }
+  close(s->sock);
+  buf[btot] = '\0';
+
+  dprintf((stderr, "server output: %s\n", buf));
+
+  if(sscanf(buf, " HTTP/1.%*c %3d", &ret) != 1)
+  {
+    ret = -1;
+  }
+
+  switch(ret)
+  {
+    case -1:
+      if(!(s->flags & EZ_QUIET))
+      {
+        ez_message(s, EZ_MSG_NOTICE, "strange server response, are you connecting to the right server?\n");
+      }
+      return(EZ_ERROR);
+      break;
+
+    case 200:
+      if(strstr(buf, "200 Host") != NULL ||
+          strstr(buf, "200 host") != NULL)
+      {
+        if(!(s->flags & EZ_QUIET))
+        {
+          ez_message(s, EZ_MSG_RESULT, "request successful\n");
+        }
+      }
+      else if(strstr(buf, "400 Bad Request") != NULL)
+      {
+        if(!(s->flags & EZ_QUIET))
+        {
+          ez_message(s, EZ_MSG_RESULT, "bad request\n");
+        }
+      }
+      else if(strstr(buf, "401 User") != NULL)
+      {
+        if(!(s->flags & EZ_QUIET))
+        {
+          ez_message(s, EZ_MSG_RESULT, "authentication failure (username/password)\n");
+        }
+      }
+      else if(strstr(buf, "405 Hostname") != NULL)
+      {
+        if(!(s->flags & EZ_QUIET))
+        {
+          ez_message(s, EZ_MSG_RESULT, "authentication failure (hostname not found)\n");
+        }
+      }
+
+      else
+      {
+        ez_message(s, EZ_MSG_NOTICE, "error processing request\n");
+        if(!(s->flags & EZ_QUIET))
+        {
+          ez_message(s, EZ_MSG_DETAIL, "server output: %s\n", buf);
+        }
+        return(EZ_ERROR);
+      }
+
+      break;
+
+    case 405:
+      if(!(s->flags & EZ_QUIET))
+      {
+        ez_message(s, EZ_MSG_NOTICE, "authentication failure\n");
+      }
+      return(EZ_ERROR);
+      break;
+
+    default:
+      if(!(s->flags & EZ_QUIET))
+      {
+        *s->response = '\0';
+        sscanf(buf, " HTTP/1.%*c %*3d %255[^\r\n]", s->response);
+        ez_message(s, EZ_MSG_NOTICE, "unknown return code: %d\n", ret);
+        ez_message(s, EZ_MSG_NOTICE, "server response: %s\n", s->response);
+      }
+      return(EZ_ERROR);
+      break;
+  }
+
+  return(EZ_OK);
+}
+#endif
+
+#ifdef USE_HN
+static int HN_update_entry(struct ez_session *s)
+{
+  char *buf = s->buf;
+  char *bp = buf;
+  int bytes;
+  int btot;
+  int ret;
+
+  buf[BUFFER_SIZE] = '\0';
+
+  if(ez_connect(s) != 0)
+  {
+    if(!(s->flags & EZ_QUIET))
+    {
+      ez_message(s, EZ_MSG_NOTICE, "error connecting to %s:%s\n", s->server, s->port);
+    }
+    return(EZ_ERROR);
+  }
+
+  snprintf(buf, BUFFER_SIZE, "GET %s?ver=%d&", s->request, 1);
+  ez_output(s, buf);
+  if(s->address)
+  {
+    ez_output_param(s, buf, "IP", s->address, "&");
+  }
+  snprintf(buf, BUFFER_SIZE, " HTTP/1.0\015\012");
+  ez_output(s, buf);
+  snprintf(buf, BUFFER_SIZE, "Authorization: Basic %s\015\012", s->auth);
+  ez_output(s, buf);
+  snprintf(buf, BUFFER_SIZE, "User-Agent: %s-%s %s [%s] (%s)\015\012", 
+      "ez-update", VERSION, OS, (s->flags & EZ_DAEMON) ? "daemon" : "", "by Angus Mackay");
+  ez_output(s, buf);
+  snprintf(buf, BUFFER_SIZE, "Host: %s\015\012", s->server);
+  ez_output(s, buf);
+  snprintf(buf, BUFFER_SIZE, "\015\012");
+  ez_output(s, buf);
+
+  bp = buf;
+  bytes = 0;
+  btot = 0;
+  while((bytes=ez_read_input(s, bp, BUFFER_SIZE-btot)) > 0)
+  {
+    bp += bytes;
+    btot += bytes;
+    dprintf((stderr, "btot: %d\n", btot));
+  }
+  close(s->sock);
+  buf[btot] = '\0';
+
+  dprintf((stderr, "server output: %s\n", buf));
+
+  if(sscanf(buf, " HTTP/1.%*c %3d", &ret) != 1)
+  {
+    ret = -1;
+  }
+
+  switch(ret)
+  {
+    char *p;
+
+    case -1:
+      if(!(s->flags & EZ_QUIET))
+      {
+        ez_message(s, EZ_MSG_NOTICE, "strange server response, are you connecting to the right server?\n");
+      }
+      return(EZ_ERROR);
+      break;
+
+    case 200:
+      ret = -1;
+      if((p=strstr(buf, "DDNS_Response_")) != NULL)
+      {
+         sscanf(p, "DDNS_Response_%*code=%3d", &ret);
+      }
+
+      /*
+       * 101 - Successfully Updated
+       * 201 - Failure because previous update occured
+       *       less than 300 seconds ago
+       * 202 - Failure because of server error
+       * 203 - Failure because account is frozen (by admin)
+       * 204 - Failure because account is locked (by user)
+       */
+      switch(ret)
+      {
+        case -1:
+          if(!(s->flags & EZ_QUIET))
+          {
+            ez_message(s, EZ_MSG_NOTICE, "strange server response, are you connecting to the right server?\n");
+          }
+          return(EZ_ERROR);
+          break;
+
+        case 101:
+          if(!(s->flags & EZ_QUIET))
+          {
+            ez_message(s, EZ_MSG_RESULT, "request successful\n");
+          }
+          break;
+
+        case 201:
+          ez_message(s, EZ_MSG_NOTICE, "Last update was less than %d seconds ago.\n", 300);
+          return(EZ_ERROR);
+          break;
+
+        case 202:
+          ez_message(s, EZ_MSG_NOTICE, "Server error.\n");
+          return(EZ_ERROR);
+          break;
+
+        case 203:
+          ez_message(s, EZ_MSG_NOTICE, "Failure because account is frozen (by admin).\n");
+          return(EZ_SHUTDOWN);
+          break;
+
+        case 204:
+          ez_message(s, EZ_MSG_NOTICE, "Failure because account is locked (by user).\n");
+          return(EZ_SHUTDOWN);
+          break;
+
+        default:
+          if(!(s->flags & EZ_QUIET))
+          {
+            ez_message(s, EZ_MSG_NOTICE, "unknown return code: %d\n", ret);
+            ez_message(s, EZ_MSG_DETAIL, "server response: %s\n", buf);
+          }
+          return(EZ_ERROR);
+          break;
+      }
+      break;
+
+    case 401:
+      if(!(s->flags & EZ_QUIET))
+      {
+        ez_message(s, EZ_MSG_NOTICE, "authentication failure\n");
+      }
+      return(EZ_SHUTDOWN);
+      break;
+
+    default:
+      if(!(s->flags & EZ_QUIET))
+      {
+        *s->response = '\0';
+        sscanf(buf, " HTTP/1.%*c %*3d %255[^\r\n]", s->response);
+        ez_message(s, EZ_MSG_NOTICE, "unknown return code: %d\n", ret);
+        ez_message(s, EZ_MSG_DETAIL, "server response: %s\n", s->response);
+      }
+      return(EZ_ERROR);
+      break;
+  }
+
+  return(EZ_OK);
+}
+#endif
+
+#ifdef USE_ZONEEDIT
+static int ZONEEDIT_update_entry(struct ez_session *s)
+{
+  char *buf = s->buf;
+  char *bp = buf;
+  int bytes;
+  int btot;
+  int ret;
+
+  buf[BUFFER_SIZE] = '\0';
+
+  if(ez_connect(s) != 0)
+  {
+    if(!(s->flags & EZ_QUIET))
+    {
+      ez_message(s, EZ_MSG_NOTICE, "error connecting to %s:%s\n", s->server, s->port);
+    }
+    return(EZ_ERROR);
+  }
+
+  snprintf(buf, BUFFER_SIZE, "GET %s?", s->request);
+  ez_output(s, buf);
+  ez_output_param(s, buf, "host", s->host, "&");
+  if (s->address && *s->address) {
+      ez_output_param(s, buf, "dnsto", s->address, "&");
+  }
+  if (s->address && *s->mx && *s->mx != '0') {
+      snprintf(buf, BUFFER_SIZE, "%s=%s&", "type", "a,mx");
+      ez_output(s, buf);
+  }
+  snprintf(buf, BUFFER_SIZE, " HTTP/1.0\015\012");
+  ez_output(s, buf);
+  snprintf(buf, BUFFER_SIZE, "User-Agent: %s-%s %s (%s)\015\012", 
+      "zoneedit", VERSION, OS, "by Angus Mackay");
+  ez_output(s, buf);
+  snprintf(buf, BUFFER_SIZE, "Host: %s\015\012", s->server);
+  ez_output(s, buf);
+  snprintf(buf, BUFFER_SIZE, "Authorization: Basic %s\015\012", s->auth);
+  ez_output(s, buf);
+  snprintf(buf, BUFFER_SIZE, "\015\012");
+  ez_output(s, buf);
+
+  bp = buf;
+  bytes = 0;
+  btot = 0;
+  while((bytes=ez_read_input(s, bp, BUFFER_SIZE-btot)) > 0)
+  {
+    bp += bytes;
+    btot += bytes;
+    dprintf((stderr, "btot: %d\n", btot));
+  }
+  close(s->sock);
+  buf[btot] = '\0';
+
+  dprintf((stderr, "server output: %s\n", buf));
+
+  if(sscanf(buf, " HTTP/1.%*c %3d", &ret) != 1)
+  {
+    ret = -1;
+  }
+
+  switch(ret)
+  {
+    case -1:
+      if(!(s->flags & EZ_QUIET))
+      {
+        ez_message(s, EZ_MSG_NOTICE, "strange server response, are you connecting to the right server?\n");
+      }
+      return(EZ_ERROR);
+      break;
+
+    case 200:
+      if(strstr(buf, "<SUCCESS") != NULL)
+      {
+        if(!(s->flags & EZ_QUIET))
+        {
+          ez_message(s, EZ_MSG_RESULT, "request successful\n");
+        }
+      }
+      else
+      {
+        ez_message(s, EZ_MSG_NOTICE, "error processing request\n");
+        if(!(s->flags & EZ_QUIET))
+        {
+          ez_message(s, EZ_MSG_DETAIL, "server output: %s\n", buf);
+        }
+        return(EZ_ERROR);
+      }
+      break;
+
+    case 401:
+      if(!(s->flags & EZ_QUIET))
+      {
+        ez_message(s, EZ_MSG_NOTICE, "authentication failure\n");
+      }
+      return(EZ_SHUTDOWN);
+      break;
+
+    default:
+      if(!(s->flags & EZ_QUIET))
+      {
+        *s->response = '\0';
+        sscanf(buf, " HTTP/1.%*c %*3d %255[^\r\n]", s->response);
+        ez_message(s, EZ_MSG_NOTICE, "unknown return code: %d\n", ret);
+        ez_message(s, EZ_MSG_NOTICE, "server response: %s\n", s->response);
+      }
+      return(EZ_ERROR);
+      break;
+  }
+
+  return(EZ_OK);
+}
+#endif
+
+#ifdef USE_HEIPV6TB
+static int HEIPV6TB_update_entry(struct ez_session *s)
+{
+  char *buf = s->buf;
+  char *bp = buf;
+  int bytes;
+  int btot;
+  int ret;
+
+  buf[BUFFER_SIZE] = '\0';
+
+  if(ez_connect(s) != 0)
+  {
+    if(!(s->flags & EZ_QUIET))
+    {
+      ez_message(s, EZ_MSG_NOTICE, "error connecting to %s:%s\n", s->server, s->port);
+    }
+    return(EZ_ERROR);
+  }
+
+  snprintf(buf, BUFFER_SIZE, "GET %s?menu=%s&", s->request, "edit_tunnel_address");
+  ez_output(s, buf);
+  ez_output_param(s, buf, "aname", s->user_name, "&");
+  ez_output_param(s, buf, "auth", s->password, "&");
+  ez_output_param(s, buf, "ipv4b", s->address, "");
+  snprintf(buf, BUFFER_SIZE, " HTTP/1.0\015\012");
+  ez_output(s, buf);
+  snprintf(buf, BUFFER_SIZE, "User-Agent: %s-%s %s [%s] (%s)\015\012", 
+      "ez-update", VERSION, OS, (s->flags & EZ_DAEMON) ? "daemon" : "", "by Angus Mackay");
+  ez_output(s, buf);
+  snprintf(buf, BUFFER_SIZE, "Host: %s\015\012", s->server);
+  ez_output(s, buf);
+  snprintf(buf, BUFFER_SIZE, "\015\012");
+  ez_output(s, buf);
+
+  bp = buf;
+  bytes = 0;
+  btot = 0;
+  while((bytes=ez_read_input(s, bp, BUFFER_SIZE-btot)) > 0)
+  {
+    bp += bytes;
+    btot += bytes;
+    dprintf((stderr, "btot: %d\n", btot));
+  }
+  close(s->sock);
+  buf[btot] = '\0';
+
+  dprintf((stderr, "server output: %s\n", buf));
+  if(sscanf(buf, " HTTP/1.%*c %3d", &ret) != 1)
+  {
+    ret = -1;
+  }
+
+  switch(ret)
+  {
+    char *p;
+
+    case -1:
+      if(!(s->flags & EZ_QUIET))
+      {
+        ez_message(s, EZ_MSG_NOTICE, "strange server response, are you connecting to the right server?\n");
+      }
+      return(EZ_ERROR);
+      break;
+    case 200:
+      if(!(s->flags & EZ_QUIET))
+      {
+        ez_message(s, EZ_MSG_RESULT, "request successful\n");
+      }
+      break;
+    default:
+      if(!(s->flags & EZ_QUIET))
+      {
+        *s->response = '\0';
+        sscanf(buf, " HTTP/1.%*c %*3d %255[^\r\n]", s->response);
+        ez_message(s, EZ_MSG_NOTICE, "unknown return code: %d\n", ret);
+        ez_message(s, EZ_MSG_DETAIL, "server response: %s\n", s->response);
+      }
+      return(EZ_ERROR);
+      break;
+  }
+
+  return(EZ_OK);
+}
+#endif
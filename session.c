@@ -0,0 +1,872 @@
+/* ============================================================================
+ * Copyright (C) 2001 Angus Mackay. All rights reserved; 
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2, or (at your option)
+ * any later version.
+ *
+ * THIS SOFTWARE IS PROVIDED ``AS IS'' AND ANY EXPRESSED OR IMPLIED WARRANTIES,
+ * INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND
+ * FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE
+ * AUTHOR BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY,
+ * OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ * ============================================================================
+ */
+
+/*
+ * session.c
+ *
+ * running updates for libezipupdate: the session, the network transport
+ * and the helpers the services talk to the server through, and the engine
+ * that runs submitted sessions on a pool of worker threads.
+ *
+ * the engine keeps two lists, sessions waiting for a worker and sessions
+ * done but whose callbacks haven't been called yet.  a worker that puts
+ * the first session on the done list writes a byte to a pipe so that
+ * ez_engine_fd() goes readable, ez_poll() empties the pipe and the list.
+ * sessions are linked through themselves so submitting allocates nothing.
+ *
+ */
+
+#ifdef HAVE_CONFIG_H
+#  include <config.h>
+#endif
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#if HAVE_FCNTL_H
+#  include <fcntl.h>
+#endif
+#if HAVE_STDARG_H
+#  include <stdarg.h>
+#endif
+#include <netinet/in.h>
+#if HAVE_ARPA_INET_H
+#  include <arpa/inet.h>
+#endif
+#include <netdb.h>
+#include <sys/socket.h>
+#if HAVE_SYS_TYPES_H
+#  include <sys/types.h>
+#endif
+#if HAVE_SYS_TIME_H
+#  include <sys/time.h>
+#endif
+#include <poll.h>
+#if HAVE_LIBPTHREAD && HAVE_PTHREAD_H
+#  define EZ_THREADS 1
+#  include <pthread.h>
+#endif
+
+#include <error.h>
+#include <encode.h>
+#include <arena.h>
+#include <session.h>
+#include <probes.h>
+
+#if HAVE_VSNPRINTF
+#  define  vsnprintf(x, y, z...) vsnprintf(x, y, ## z)
+#else
+#  define  vsnprintf(x, y, z...) vsprintf(x, ## z)
+#endif
+
+#define ARENA_BLOCK (2*(BUFFER_SIZE+1))
+// messages that fit are formatted on the stack
+#define MESSAGE_LEN 256
+
+struct ez_engine
+{
+  struct ez_session *queue;
+  struct ez_session *queue_tail;
+  struct ez_session *done;
+  struct ez_session *done_tail;
+  int pending;
+  int wake[2];
+#ifdef EZ_THREADS
+  pthread_mutex_t lock;
+  pthread_cond_t work;
+  pthread_t *workers;
+  int nworkers;
+  int stopping;
+#endif
+};
+
+struct ez_transport ez_net_transport = {
+  ez_net_connect, ez_net_send, ez_net_recv, ez_net_pause
+};
+
+/**************************************************/
+
+/*
+ * ez_set_debug
+ *
+ * turn on the debug output of the library's code that has no session to
+ * take EZ_DEBUG from, such as its arenas
+ */
+void ez_set_debug(int on)
+{
+  arena_set_debug(on);
+}
+
+/*
+ * ez_session_init
+ *
+ * clear a session and fill in the defaults for service
+ */
+void ez_session_init(struct ez_session *s, struct ez_service *service)
+{
+  memset(s, 0, sizeof(struct ez_session));
+  s->service = service;
+  if(service != NULL)
+  {
+    s->server = service->default_server;
+    s->port = service->default_port;
+    s->request = service->default_request;
+  }
+  s->connection_type = 1;
+  s->timeout.tv_sec = EZ_DEFAULT_TIMEOUT;
+  s->sock = -1;
+}
+
+/*
+ * ez_session_free
+ *
+ * give back what the session's updates kept for the next one
+ */
+void ez_session_free(struct ez_session *s)
+{
+  if(s->arena != NULL)
+  {
+    arena_free(s->arena);
+    free(s->arena);
+    s->arena = NULL;
+  }
+}
+
+/*
+ * ez_message
+ *
+ * hand a message to the session's message callback, or print it: results
+ * on stdout and the rest on stderr.
+ */
+void ez_message(struct ez_session *s, int level, char *fmt, ...)
+{
+  char buf[MESSAGE_LEN];
+  char *msg = buf;
+  va_list args;
+  int len;
+
+  va_start(args, fmt);
+  if(s->message == NULL)
+  {
+    vfprintf(level == EZ_MSG_RESULT ? stdout : stderr, fmt, args);
+    va_end(args);
+    return;
+  }
+  len = vsnprintf(buf, sizeof(buf), fmt, args);
+  va_end(args);
+
+  // the server's output can be a lot longer than most messages
+  if(len >= (int)sizeof(buf) && (msg=malloc(len + 1)) != NULL)
+  {
+    va_start(args, fmt);
+    vsnprintf(msg, len + 1, fmt, args);
+    va_end(args);
+  }
+  s->message(s, level, msg ? msg : buf);
+  if(msg != buf && msg != NULL)
+  {
+    free(msg);
+  }
+}
+
+void ez_mark(struct ez_session *s, int mark)
+{
+  if(s->marked[mark])
+  {
+    return;
+  }
+  gettimeofday(&s->marks[mark], NULL);
+  s->marked[mark] = 1;
+}
+
+static void trace(struct ez_session *s, int type, const char *buf, int len)
+{
+  if(s->trace != NULL)
+  {
+    s->trace(s, type, buf, len);
+  }
+}
+
+/*
+ * ez_connect
+ *
+ * connect the session's socket to its server
+ *
+ */
+int ez_connect(struct ez_session *s)
+{
+  int ret;
+
+  PROBE3(connect__start, s, s->server, s->port);
+  ret = s->transport->connect(s);
+  PROBE2(connect__done, s, ret);
+  trace(s, EZ_TRACE_CONNECT, NULL, ret);
+
+  return(ret);
+}
+
+int ez_net_connect(struct ez_session *s)
+{
+#ifdef HAVE_GETADDRINFO
+  struct addrinfo hints;
+  struct addrinfo *res;
+  char addr[64];
+  int err;
+
+  // getaddrinfo() is reentrant where gethostbyname() is not
+  memset(&hints, 0, sizeof(hints));
+  hints.ai_family = AF_INET;
+  hints.ai_socktype = SOCK_STREAM;
+  if((err=getaddrinfo(s->server, s->port, &hints, &res)) != 0)
+  {
+    if(!(s->flags & EZ_QUIET))
+    {
+      ez_message(s, EZ_MSG_DETAIL, "getaddrinfo: %s\n", gai_strerror(err));
+    }
+    return(-1);
+  }
+  ez_mark(s, EZ_MARK_RESOLVED);
+
+  // set up the socket
+  if((s->sock=socket(res->ai_family, res->ai_socktype, res->ai_protocol)) == -1)
+  {
+    if(!(s->flags & EZ_QUIET))
+    {
+      ez_message(s, EZ_MSG_DETAIL, "socket: %s\n", error_string);
+    }
+    freeaddrinfo(res);
+    return(-1);
+  }
+
+  // connect the socket
+  if(connect(s->sock, res->ai_addr, res->ai_addrlen) == -1)
+  {
+    if(!(s->flags & EZ_QUIET))
+    {
+      ez_message(s, EZ_MSG_DETAIL, "connect: %s\n", error_string);
+    }
+    close(s->sock);
+    freeaddrinfo(res);
+    return(-1);
+  }
+  ez_mark(s, EZ_MARK_CONNECTED);
+
+  // print out some info
+  if(!(s->flags & EZ_QUIET))
+  {
+    struct sockaddr_in *sin = (struct sockaddr_in *)res->ai_addr;
+
+    ez_message(s, EZ_MSG_DETAIL, "connected to %s (%s) on port %d.\n",
+        s->server,
+        inet_ntop(AF_INET, &sin->sin_addr, addr, sizeof(addr)) ? addr : "?",
+        ntohs(sin->sin_port));
+  }
+  freeaddrinfo(res);
+
+  return 0;
+#else
+  struct sockaddr_in address;
+  struct hostent *hostinfo;
+  struct servent *servinfo;
+
+  // set up the socket
+  if((s->sock=socket(AF_INET, SOCK_STREAM, 0)) == -1)
+  {
+    if(!(s->flags & EZ_QUIET))
+    {
+      ez_message(s, EZ_MSG_DETAIL, "socket: %s\n", error_string);
+    }
+    return(-1);
+  }
+  memset(&address, 0, sizeof(address));
+  address.sin_family = AF_INET;
+
+  // get the host address, not thread safe
+  hostinfo = gethostbyname(s->server);
+  if(!hostinfo)
+  {
+    if(!(s->flags & EZ_QUIET))
+    {
+      ez_message(s, EZ_MSG_DETAIL, "gethostbyname: error\n");
+    }
+    close(s->sock);
+    return(-1);
+  }
+  address.sin_addr = *(struct in_addr *)*hostinfo -> h_addr_list;
+  ez_mark(s, EZ_MARK_RESOLVED);
+
+  // get the host port
+  servinfo = getservbyname(s->port, "tcp");
+  if(servinfo)
+  {
+    address.sin_port = servinfo -> s_port;
+  }
+  else
+  {
+    address.sin_port = htons(atoi(s->port));
+  }
+
+  // connect the socket
+  if(connect(s->sock, (struct sockaddr *)&address, sizeof(address)) == -1)
+  {
+    if(!(s->flags & EZ_QUIET))
+    {
+      ez_message(s, EZ_MSG_DETAIL, "connect: %s\n", error_string);
+    }
+    close(s->sock);
+    return(-1);
+  }
+  ez_mark(s, EZ_MARK_CONNECTED);
+
+  // print out some info
+  if(!(s->flags & EZ_QUIET))
+  {
+    ez_message(s, EZ_MSG_DETAIL, "connected to %s (%s) on port %d.\n",
+        s->server, inet_ntoa(address.sin_addr), ntohs(address.sin_port));
+  }
+
+  return 0;
+#endif
+}
+
+void ez_output(struct ez_session *s, char *buf)
+{
+  int ret;
+
+  // what went out so far stays an unfinished request
+  if(s->overflow)
+  {
+    return;
+  }
+  dprintf((stderr, "I say: %s\n", buf));
+
+  ret = s->transport->send(s, buf, strlen(buf));
+  PROBE2(send, s, ret);
+  if(ret > 0)
+  {
+    trace(s, EZ_TRACE_SEND, buf, ret);
+  }
+}
+
+/* the session's timeout in milliseconds, for poll() */
+static int timeout_ms(struct ez_session *s)
+{
+  return(s->timeout.tv_sec * 1000 + s->timeout.tv_usec / 1000);
+}
+
+int ez_net_send(struct ez_session *s, char *buf, int len)
+{
+  struct pollfd pfd;
+  int ret;
+
+  pfd.fd = s->sock;
+  pfd.events = POLLOUT;
+  pfd.revents = 0;
+
+  ret = poll(&pfd, 1, timeout_ms(s));
+  dprintf((stderr, "ret: %d\n", ret));
+
+  if(ret == -1)
+  {
+    dprintf((stderr, "poll: %s\n", error_string));
+  }
+  else if(ret == 0)
+  {
+    ez_message(s, EZ_MSG_DETAIL, "timeout sending request to %s\n",
+        N_STR(s->server));
+    s->timeouts++;
+    ret = -1;
+  }
+  else
+  {
+    /* if we woke up on sock do the data passing, send() tells of errors */
+    if(pfd.revents & (POLLOUT | POLLERR | POLLHUP))
+    {
+      if((ret=send(s->sock, buf, len, 0)) == -1)
+      {
+        ez_message(s, EZ_MSG_DETAIL, "error send()ing request: %s\n",
+            error_string);
+      }
+      else
+      {
+        ez_mark(s, EZ_MARK_SENT);
+        s->bytes_out += ret;
+      }
+    }
+    else
+    {
+      dprintf((stderr, "error: case not handled."));
+      ret = -1;
+    }
+  }
+
+  return(ret);
+}
+
+/*
+ * ez_append_param
+ *
+ * append "name=value<sep>" at p with the value percent encoded, never
+ * writing at or past end. returns the new end of the string, if the pair
+ * does not fit nothing is appended and the update fails: nothing more is
+ * sent and reading the answer fails.
+ */
+char *ez_append_param(struct ez_session *s, char *p, char *end, char *name,
+    char *value, char *sep)
+{
+  int nlen = strlen(name);
+  int slen = strlen(sep);
+  int vlen;
+
+  if(value == NULL) { value = ""; }
+  if(p + nlen + 1 + slen >= end)
+  {
+    ez_message(s, EZ_MSG_NOTICE, "no room for \"%s\" in the request\n", name);
+    s->overflow = 1;
+    return(p);
+  }
+  memcpy(p, name, nlen);
+  p[nlen] = '=';
+  if((vlen=url_encode(value, p + nlen + 1, end - p - nlen - 1 - slen)) < 0)
+  {
+    ez_message(s, EZ_MSG_NOTICE, "value for \"%s\" is too long\n", name);
+    s->overflow = 1;
+    *p = '\0';
+    return(p);
+  }
+  memcpy(p + nlen + 1 + vlen, sep, slen + 1);
+
+  return(p + nlen + 1 + vlen + slen);
+}
+
+/*
+ * ez_output_param
+ *
+ * send a single url encoded query parameter, buf must be BUFFER_SIZE long.
+ */
+void ez_output_param(struct ez_session *s, char *buf, char *name,
+    char *value, char *sep)
+{
+  *buf = '\0';
+  ez_append_param(s, buf, buf + BUFFER_SIZE, name, value, sep);
+  ez_output(s, buf);
+}
+
+int ez_read_input(struct ez_session *s, char *buf, int len)
+{
+  int bread;
+
+  if(s->overflow)
+  {
+    return(-1);
+  }
+  bread = s->transport->recv(s, buf, len);
+  PROBE2(recv, s, bread);
+  if(bread < 0)
+  {
+    trace(s, EZ_TRACE_RECV_FAIL, NULL, 0);
+  }
+  else
+  {
+    trace(s, EZ_TRACE_RECV, buf, bread);
+  }
+
+  return(bread);
+}
+
+int ez_net_recv(struct ez_session *s, char *buf, int len)
+{
+  struct pollfd pfd;
+  int ret;
+  int bread = -1;
+
+  pfd.fd = s->sock;
+  pfd.events = POLLIN;
+  pfd.revents = 0;
+
+  ret = poll(&pfd, 1, timeout_ms(s));
+  dprintf((stderr, "ret: %d\n", ret));
+
+  if(ret == -1)
+  {
+    dprintf((stderr, "poll: %s\n", error_string));
+  }
+  else if(ret == 0)
+  {
+    ez_message(s, EZ_MSG_DETAIL, "timeout waiting for reply from %s\n",
+        N_STR(s->server));
+    s->timeouts++;
+  }
+  else
+  {
+    /* if we woke up on sock do the data passing, recv() tells of errors */
+    if(pfd.revents & (POLLIN | POLLERR | POLLHUP))
+    {
+      bread = recv(s->sock, buf, len-1, 0);
+      dprintf((stderr, "bread: %d\n", bread));
+      if(bread == -1)
+      {
+        ez_message(s, EZ_MSG_DETAIL, "error recv()ing reply: %s\n",
+            error_string);
+      }
+      else
+      {
+        buf[bread] = '\0';
+        dprintf((stderr, "got: %s\n", buf));
+        ez_mark(s, EZ_MARK_RECEIVED);
+        s->bytes_in += bread;
+      }
+    }
+    else
+    {
+      dprintf((stderr, "error: case not handled."));
+    }
+  }
+
+  return(bread);
+}
+
+/*
+ * a worker thread waiting out a server's wait response is a worker less,
+ * give a transport whose pause returns straight away and look at s->wait
+ * if that matters.
+ */
+void ez_net_pause(struct ez_session *s, int seconds)
+{
+  sleep(seconds);
+}
+
+/*
+ * ez_update
+ *
+ * run one update for the session and return its result, which is also
+ * left in s->result.
+ */
+int ez_update(struct ez_session *s)
+{
+  char user[256+1];
+  int res;
+
+  s->nochg = 0;
+  s->wait = 0;
+  *s->response = '\0';
+  memset(s->marked, 0, sizeof(s->marked));
+  s->bytes_out = 0;
+  s->bytes_in = 0;
+  s->timeouts = 0;
+  s->overflow = 0;
+  ez_mark(s, EZ_MARK_START);
+  PROBE2(update__start, s, s->host);
+
+  if(s->service == NULL || s->service->update == NULL)
+  {
+    ez_message(s, EZ_MSG_NOTICE, "no service to update with\n");
+    return(s->result = EZ_SHUTDOWN);
+  }
+  if(s->transport == NULL) { s->transport = &ez_net_transport; }
+  if(s->server == NULL) { s->server = s->service->default_server; }
+  if(s->port == NULL) { s->port = s->service->default_port; }
+  if(s->request == NULL) { s->request = s->service->default_request; }
+  if(s->mx == NULL) { s->mx = ""; }
+  if(s->url == NULL) { s->url = ""; }
+
+  if(snprintf(user, sizeof(user), "%s:%s", N_STR(s->user_name),
+        N_STR(s->password)) >= sizeof(user) ||
+      base64_encode(user, strlen(user), s->auth, sizeof(s->auth)) < 0)
+  {
+    ez_message(s, EZ_MSG_NOTICE, "user name and password are too long\n");
+    return(s->result = EZ_SHUTDOWN);
+  }
+  if(url_encode(N_STR(s->password), s->password_url,
+        sizeof(s->password_url)) < 0)
+  {
+    *s->password_url = '\0';
+  }
+
+  // the buffers live in the session's arena, which keeps its block from
+  // one update to the next
+  if(s->arena == NULL && (s->arena=malloc(sizeof(struct arena))) != NULL)
+  {
+    struct arena init = ARENA_INIT(ARENA_BLOCK);
+
+    *s->arena = init;
+  }
+  if(s->arena == NULL || (s->buf=arena_alloc(s->arena, BUFFER_SIZE+1)) == NULL)
+  {
+    ez_message(s, EZ_MSG_NOTICE, "out of memory\n");
+    return(s->result = EZ_ERROR);
+  }
+
+  res = s->service->update(s);
+  if(s->overflow && res == EZ_OK)
+  {
+    res = EZ_ERROR;
+  }
+
+  ez_mark(s, EZ_MARK_DONE);
+  PROBE5(update__done, s, res, s->nochg, s->bytes_out, s->bytes_in);
+  arena_reset(s->arena);
+  s->buf = NULL;
+
+  return(s->result = res);
+}
+
+/**************************************************/
+
+#ifdef EZ_THREADS
+static void *worker_main(void *arg)
+{
+  struct ez_engine *e = arg;
+  struct ez_session *s;
+
+  pthread_mutex_lock(&e->lock);
+  for(;;)
+  {
+    while(e->queue == NULL && !e->stopping)
+    {
+      pthread_cond_wait(&e->work, &e->lock);
+    }
+    if(e->stopping)
+    {
+      break;
+    }
+    s = e->queue;
+    if((e->queue=s->next) == NULL)
+    {
+      e->queue_tail = NULL;
+    }
+    pthread_mutex_unlock(&e->lock);
+
+    ez_update(s);
+
+    pthread_mutex_lock(&e->lock);
+    s->next = NULL;
+    if(e->done == NULL)
+    {
+      e->done = s;
+      write(e->wake[1], "", 1);
+    }
+    else
+    {
+      e->done_tail->next = s;
+    }
+    e->done_tail = s;
+  }
+  pthread_mutex_unlock(&e->lock);
+
+  return(NULL);
+}
+#endif
+
+/*
+ * ez_engine_new
+ *
+ * an engine with workers threads to run updates on
+ */
+struct ez_engine *ez_engine_new(int workers)
+{
+  struct ez_engine *e;
+
+  if((e=calloc(1, sizeof(struct ez_engine))) == NULL)
+  {
+    return(NULL);
+  }
+  if(pipe(e->wake) != 0)
+  {
+    free(e);
+    return(NULL);
+  }
+#if HAVE_FCNTL_H
+  fcntl(e->wake[0], F_SETFL, O_NONBLOCK);
+  fcntl(e->wake[0], F_SETFD, FD_CLOEXEC);
+  fcntl(e->wake[1], F_SETFD, FD_CLOEXEC);
+#endif
+
+#ifdef EZ_THREADS
+  pthread_mutex_init(&e->lock, NULL);
+  pthread_cond_init(&e->work, NULL);
+  if(workers < 1) { workers = 1; }
+  if((e->workers=calloc(workers, sizeof(pthread_t))) == NULL)
+  {
+    ez_engine_free(e);
+    return(NULL);
+  }
+  for(e->nworkers=0; e->nworkers<workers; e->nworkers++)
+  {
+    if(pthread_create(&e->workers[e->nworkers], NULL, worker_main, e) != 0)
+    {
+      break;
+    }
+  }
+  if(e->nworkers == 0)
+  {
+    ez_engine_free(e);
+    return(NULL);
+  }
+#endif
+
+  return(e);
+}
+
+/*
+ * ez_submit
+ *
+ * queue the session to be updated, done(s, arg) is called from ez_poll()
+ * once it has been.  the session is the engine's until then.
+ */
+int ez_submit(struct ez_engine *e, struct ez_session *s, ez_callback done,
+    void *arg)
+{
+  s->done = done;
+  s->done_arg = arg;
+  s->next = NULL;
+
+#ifdef EZ_THREADS
+  pthread_mutex_lock(&e->lock);
+#endif
+  if(e->queue_tail == NULL)
+  {
+    e->queue = s;
+  }
+  else
+  {
+    e->queue_tail->next = s;
+  }
+  e->queue_tail = s;
+  e->pending++;
+#ifdef EZ_THREADS
+  pthread_cond_signal(&e->work);
+  pthread_mutex_unlock(&e->lock);
+#endif
+
+  return(0);
+}
+
+/*
+ * ez_poll
+ *
+ * call the callbacks of the sessions that have finished, waiting up to
+ * timeout_ms (-1 for ever) for one to if none have.  returns how many
+ * were called.
+ */
+int ez_poll(struct ez_engine *e, int timeout_ms)
+{
+  struct ez_session *s;
+  struct ez_session *next;
+  char drain[64];
+  int n = 0;
+
+#ifdef EZ_THREADS
+  struct pollfd pfd;
+
+  pthread_mutex_lock(&e->lock);
+  s = e->done;
+  pthread_mutex_unlock(&e->lock);
+  if(s == NULL && timeout_ms != 0 && e->pending > 0)
+  {
+    pfd.fd = e->wake[0];
+    pfd.events = POLLIN;
+    poll(&pfd, 1, timeout_ms);
+  }
+
+  pthread_mutex_lock(&e->lock);
+  s = e->done;
+  e->done = NULL;
+  e->done_tail = NULL;
+  while(read(e->wake[0], drain, sizeof(drain)) > 0);
+  pthread_mutex_unlock(&e->lock);
+#else
+  // no threads, run the next one here
+  if((s=e->queue) != NULL)
+  {
+    if((e->queue=s->next) == NULL)
+    {
+      e->queue_tail = NULL;
+    }
+    ez_update(s);
+    s->next = NULL;
+  }
+#endif
+
+  for(; s != NULL; s=next)
+  {
+    next = s->next;
+    s->next = NULL;
+    e->pending--;
+    n++;
+    if(s->done != NULL)
+    {
+      s->done(s, s->done_arg);
+    }
+  }
+
+  return(n);
+}
+
+/*
+ * ez_engine_fd
+ *
+ * a descriptor that is readable when ez_poll() has callbacks to call
+ */
+int ez_engine_fd(struct ez_engine *e)
+{
+  return(e->wake[0]);
+}
+
+/*
+ * ez_engine_pending
+ *
+ * sessions submitted whose callbacks haven't been called yet
+ */
+int ez_engine_pending(struct ez_engine *e)
+{
+  return(e->pending);
+}
+
+/*
+ * ez_engine_free
+ *
+ * stop the workers once they finish the updates they are running and free
+ * the engine.  sessions that were still queued are dropped and their
+ * callbacks are never called.
+ */
+void ez_engine_free(struct ez_engine *e)
+{
+#ifdef EZ_THREADS
+  int i;
+
+  pthread_mutex_lock(&e->lock);
+  e->stopping = 1;
+  pthread_cond_broadcast(&e->work);
+  pthread_mutex_unlock(&e->lock);
+  for(i=0; i<e->nworkers; i++)
+  {
+    pthread_join(e->workers[i], NULL);
+  }
+  free(e->workers);
+  pthread_cond_destroy(&e->work);
+  pthread_mutex_destroy(&e->lock);
+#endif
+  close(e->wake[0]);
+  close(e->wake[1]);
+  free(e);
+}
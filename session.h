@@ -0,0 +1,63 @@
+/* ============================================================================
+ * Copyright (C) 2001 Angus Mackay. All rights reserved; 
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2, or (at your option)
+ * any later version.
+ *
+ * THIS SOFTWARE IS PROVIDED ``AS IS'' AND ANY EXPRESSED OR IMPLIED WARRANTIES,
+ * INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND
+ * FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE
+ * AUTHOR BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY,
+ * OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ * ============================================================================
+ */
+
+/*
+ * session.h
+ *
+ * what the services of libezipupdate share, not part of its interface.
+ *
+ */
+
+#ifndef _SESSION_H
+#define _SESSION_H
+
+#include <ezipupdate.h>
+
+#ifdef DEBUG
+#  define BUFFER_SIZE (16*1024)
+#else
+#  define BUFFER_SIZE (4*1024-1)
+#endif
+
+// the library has no options global, debugging is per session
+#ifdef DEBUG
+#define dprintf(x) if( s->flags & EZ_DEBUG ) \
+{ \
+  fprintf(stderr, "%s,%d: ", __FILE__, __LINE__); \
+    fprintf x; \
+}
+#else
+#  define dprintf(x)
+#endif
+
+#define N_STR(x) (x == NULL ? "(null)" : x)
+
+extern void ez_message(struct ez_session *s, int level, char *fmt, ...);
+extern void ez_mark(struct ez_session *s, int mark);
+extern int ez_connect(struct ez_session *s);
+extern void ez_output(struct ez_session *s, char *buf);
+extern char *ez_append_param(struct ez_session *s, char *p, char *end,
+    char *name, char *value, char *sep);
+extern void ez_output_param(struct ez_session *s, char *buf, char *name,
+    char *value, char *sep);
+extern int ez_read_input(struct ez_session *s, char *buf, int len);
+
+#endif
@@ -0,0 +1,263 @@
+/* ============================================================================
+ * Copyright (C) 2001 Angus Mackay. All rights reserved; 
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2, or (at your option)
+ * any later version.
+ *
+ * THIS SOFTWARE IS PROVIDED ``AS IS'' AND ANY EXPRESSED OR IMPLIED WARRANTIES,
+ * INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND
+ * FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE
+ * AUTHOR BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY,
+ * OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ * ============================================================================
+ */
+
+/*
+ * shm_status.c
+ *
+ * writer and reader sides of the shared status table, the layout and the
+ * locking are described in shm_status.h.
+ *
+ */
+
+#ifdef HAVE_CONFIG_H
+#  include <config.h>
+#endif
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#if HAVE_FCNTL_H
+#  include <fcntl.h>
+#endif
+#if HAVE_SYS_TYPES_H
+#  include <sys/types.h>
+#endif
+#if HAVE_SYS_STAT_H
+#  include <sys/stat.h>
+#endif
+#include <time.h>
+#ifdef HAVE_MMAP
+#  include <sys/mman.h>
+#endif
+
+#include <shm_status.h>
+
+// how many times a reader retries an entry that keeps changing under it
+#define READ_RETRIES 1000
+
+static struct shm_status_header *table = NULL;
+static size_t table_size = 0;
+static char *table_path = NULL;
+
+static struct shm_status_job *job_entry(struct shm_status_header *hdr, int slot)
+{
+  return((struct shm_status_job *)((char *)hdr + hdr->header_size +
+        (size_t)slot * hdr->job_size));
+}
+
+static int open_segment(char *path, int flags, mode_t mode)
+{
+  if(strncmp(path, "shm:", 4) == 0)
+  {
+#ifdef HAVE_SHM_OPEN
+    return(shm_open(path+4, flags, mode));
+#else
+    return(-1);
+#endif
+  }
+  return(open(path, flags, mode));
+}
+
+/*
+ * shm_status_create
+ *
+ * create (or recreate) the segment at path with room for njobs entries.
+ * it is readable by everyone, only we write to it.
+ */
+int shm_status_create(char *path, int njobs)
+{
+#ifdef HAVE_MMAP
+  struct shm_status_header *hdr;
+  size_t size;
+  int fd;
+
+  size = sizeof(struct shm_status_header) + (size_t)njobs * sizeof(struct shm_status_job);
+  if((fd=open_segment(path, O_RDWR | O_CREAT | O_TRUNC, 0644)) == -1)
+  {
+    return(-1);
+  }
+  if(ftruncate(fd, size) != 0)
+  {
+    close(fd);
+    return(-1);
+  }
+  hdr = mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+  close(fd);
+  if(hdr == MAP_FAILED)
+  {
+    return(-1);
+  }
+
+  memset(hdr, 0, size);
+  hdr->version = SHM_STATUS_VERSION;
+  hdr->header_size = sizeof(struct shm_status_header);
+  hdr->job_size = sizeof(struct shm_status_job);
+  hdr->njobs = njobs;
+  hdr->pid = getpid();
+  hdr->started = time(NULL);
+  // readers check the magic last
+  __atomic_store_n(&hdr->magic, SHM_STATUS_MAGIC, __ATOMIC_RELEASE);
+
+  table = hdr;
+  table_size = size;
+  table_path = strdup(path);
+
+  return(0);
+#else
+  return(-1);
+#endif
+}
+
+/*
+ * shm_status_publish
+ *
+ * copy job into the table at slot under the entry's seqlock
+ */
+void shm_status_publish(int slot, struct shm_status_job *job)
+{
+  struct shm_status_job *entry;
+  uint32_t seq;
+
+  if(table == NULL || slot < 0 || slot >= table->njobs)
+  {
+    return;
+  }
+  entry = job_entry(table, slot);
+
+  seq = entry->seq;
+  __atomic_store_n(&entry->seq, seq+1, __ATOMIC_RELAXED);
+  __atomic_thread_fence(__ATOMIC_RELEASE);
+
+  memcpy((char *)entry + sizeof(entry->seq), (char *)job + sizeof(job->seq),
+      sizeof(*entry) - sizeof(entry->seq));
+
+  __atomic_store_n(&entry->seq, seq+2, __ATOMIC_RELEASE);
+}
+
+void shm_status_destroy(void)
+{
+#ifdef HAVE_MMAP
+  if(table == NULL)
+  {
+    return;
+  }
+
+  munmap(table, table_size);
+  table = NULL;
+  if(strncmp(table_path, "shm:", 4) == 0)
+  {
+#  ifdef HAVE_SHM_OPEN
+    shm_unlink(table_path+4);
+#  endif
+  }
+  else
+  {
+    unlink(table_path);
+  }
+  free(table_path);
+  table_path = NULL;
+#endif
+}
+
+/*
+ * shm_status_attach
+ *
+ * map an existing segment read only, returns NULL if it isn't there or
+ * doesn't look like ours.
+ */
+struct shm_status_header *shm_status_attach(char *path)
+{
+#ifdef HAVE_MMAP
+  struct shm_status_header *hdr;
+  struct stat st;
+  int fd;
+
+  if((fd=open_segment(path, O_RDONLY, 0)) == -1)
+  {
+    return(NULL);
+  }
+  if(fstat(fd, &st) != 0 || st.st_size < sizeof(struct shm_status_header))
+  {
+    close(fd);
+    return(NULL);
+  }
+  hdr = mmap(NULL, st.st_size, PROT_READ, MAP_SHARED, fd, 0);
+  close(fd);
+  if(hdr == MAP_FAILED)
+  {
+    return(NULL);
+  }
+
+  if(__atomic_load_n(&hdr->magic, __ATOMIC_ACQUIRE) != SHM_STATUS_MAGIC ||
+      hdr->version != SHM_STATUS_VERSION ||
+      hdr->job_size < sizeof(struct shm_status_job) ||
+      hdr->header_size + (size_t)hdr->njobs * hdr->job_size > st.st_size)
+  {
+    munmap(hdr, st.st_size);
+    return(NULL);
+  }
+
+  return(hdr);
+#else
+  return(NULL);
+#endif
+}
+
+/*
+ * shm_status_read
+ *
+ * take a consistent copy of entry slot, returns -1 if the writer kept it
+ * busy for too long.
+ */
+int shm_status_read(struct shm_status_header *hdr, int slot, struct shm_status_job *job)
+{
+  struct shm_status_job *entry;
+  uint32_t before;
+  uint32_t after;
+  int i;
+
+  if(slot < 0 || slot >= hdr->njobs)
+  {
+    return(-1);
+  }
+  entry = job_entry(hdr, slot);
+
+  for(i=0; i<READ_RETRIES; i++)
+  {
+    before = __atomic_load_n(&entry->seq, __ATOMIC_ACQUIRE);
+    if(before & 1)
+    {
+      continue;
+    }
+    memcpy(job, entry, sizeof(*job));
+    __atomic_thread_fence(__ATOMIC_ACQUIRE);
+    after = __atomic_load_n(&entry->seq, __ATOMIC_RELAXED);
+    if(before == after)
+    {
+      job->seq = before;
+      return(0);
+    }
+  }
+
+  return(-1);
+}
+
@@ -0,0 +1,117 @@
+/* ============================================================================
+ * Copyright (C) 2001 Angus Mackay. All rights reserved; 
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2, or (at your option)
+ * any later version.
+ *
+ * THIS SOFTWARE IS PROVIDED ``AS IS'' AND ANY EXPRESSED OR IMPLIED WARRANTIES,
+ * INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND
+ * FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE
+ * AUTHOR BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY,
+ * OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ * ============================================================================
+ */
+
+/*
+ * shm_status.h
+ *
+ * a fixed layout table of job status published in shared memory so that
+ * monitors can read it as often as they like without talking to us.
+ *
+ * the segment is a POSIX shm object (status-file=shm:/<name>) or a plain
+ * mmap()ed file (status-file=<path>). all integers are in host byte order
+ * and the layout is:
+ *
+ *   offset  size  header
+ *        0     4  magic, SHM_STATUS_MAGIC
+ *        4     2  version, SHM_STATUS_VERSION
+ *        6     2  header size in bytes (64)
+ *        8     4  job entry size in bytes (256)
+ *       12     4  number of job entries
+ *       16     8  pid of the daemon
+ *       24     8  when the daemon started (unix time)
+ *       32    32  reserved, zero
+ *
+ *   offset  size  job entry, the first at offset 64
+ *        0     4  seq, odd while the entry is being written
+ *        4     4  flags, SHM_JOB_*
+ *        8     8  last successful update (unix time, 0 if none)
+ *       16     8  last update attempt (unix time, 0 if none)
+ *       24     8  next time the address will be checked (unix time)
+ *       32     4  consecutive failed updates
+ *       36     4  result of the last attempt, SHM_RESULT_*
+ *       40   128  job name (the host), NUL terminated
+ *      168    16  current IPv4 address, NUL terminated
+ *      184    48  current IPv6 address, NUL terminated, empty if none
+ *      232    24  reserved, zero
+ *
+ * each entry is guarded by a seqlock. the writer makes seq odd, changes
+ * the entry and then makes seq even again. a reader copies the entry out
+ * between two reads of seq and tries again if they differ or are odd, see
+ * shm_status_read(). readers never block the daemon and the daemon never
+ * waits for readers.
+ *
+ */
+
+#ifndef _SHM_STATUS_H
+#define _SHM_STATUS_H
+
+#include <stdint.h>
+
+#define SHM_STATUS_MAGIC   0x457a5374    /* "EzSt" */
+#define SHM_STATUS_VERSION 2
+
+#define SHM_JOB_PAUSED  0x0001
+#define SHM_JOB_ACTIVE  0x0002
+
+#define SHM_RESULT_OK       0
+#define SHM_RESULT_ERROR    1
+#define SHM_RESULT_SHUTDOWN 2
+#define SHM_RESULT_NONE     0xffffffff
+
+struct shm_status_header
+{
+  uint32_t magic;
+  uint16_t version;
+  uint16_t header_size;
+  uint32_t job_size;
+  uint32_t njobs;
+  int64_t pid;
+  int64_t started;
+  char reserved[32];
+};
+
+struct shm_status_job
+{
+  uint32_t seq;
+  uint32_t flags;
+  int64_t last_success;
+  int64_t last_attempt;
+  int64_t next_due;
+  uint32_t failures;
+  uint32_t last_result;
+  char name[128];
+  char address[16];
+  char address6[48];
+  char reserved[24];
+};
+
+/* the layout above is an interface, make sure the compiler agrees */
+typedef char shm_status_header_size_check[sizeof(struct shm_status_header) == 64 ? 1 : -1];
+typedef char shm_status_job_size_check[sizeof(struct shm_status_job) == 256 ? 1 : -1];
+
+extern int shm_status_create(char *path, int njobs);
+extern void shm_status_publish(int slot, struct shm_status_job *job);
+extern void shm_status_destroy(void);
+
+extern struct shm_status_header *shm_status_attach(char *path);
+extern int shm_status_read(struct shm_status_header *hdr, int slot, struct shm_status_job *job);
+
+#endif
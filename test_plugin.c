@@ -0,0 +1,111 @@
+/* ============================================================================
+ * Copyright (C) 2001 Angus Mackay. All rights reserved; 
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2, or (at your option)
+ * any later version.
+ *
+ * THIS SOFTWARE IS PROVIDED ``AS IS'' AND ANY EXPRESSED OR IMPLIED WARRANTIES,
+ * INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND
+ * FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE
+ * AUTHOR BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY,
+ * OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ * ============================================================================
+ */
+
+/*
+ * test_plugin.c
+ *
+ * the plugin plugin_test.sh loads.  it adds "testsvc", whose init() gives
+ * the session a default partner and whose check_info() asks for an MX
+ * when there isn't one, and whose update() only says what it was given.
+ * built with -DOLD_ABI it is a plugin from before the checks, adding
+ * "testsvc2" with add_service() to see those still load.
+ *
+ */
+
+#include <stdio.h>
+#include <stddef.h>
+#include <string.h>
+
+#include "ezplugin.h"
+
+static const struct ez_plugin_api *ez;
+
+#ifdef OLD_ABI
+int ez_plugin_abi = 2;
+#else
+int ez_plugin_abi = EZ_PLUGIN_ABI;
+#endif
+
+static char *fields[] = { "host", "mx", "partner", "address", NULL };
+
+static int test_update(struct ez_session *s)
+{
+  char buf[512];
+
+  snprintf(buf, sizeof(buf), "%s: host=%s mx=%s partner=%s\n",
+      s->service->names[0], s->host ? s->host : "-", s->mx ? s->mx : "-",
+      s->partner ? s->partner : "-");
+  ez->message(EZ_MSG_RESULT, buf);
+  return(EZ_OK);
+}
+
+#ifdef OLD_ABI
+static struct ez_service test_service = {
+  "old ABI test service", { "testsvc2", NULL, NULL }, test_update, fields,
+  "localhost", "80", "/"
+};
+#else
+static struct ez_service test_service = {
+  "test service", { "testsvc", NULL, NULL }, test_update, fields,
+  "localhost", "80", "/"
+};
+
+static void test_init(struct ez_session *s)
+{
+  if(s->partner == NULL)
+  {
+    s->partner = "from-init";
+  }
+}
+
+static int test_check_info(struct ez_session *s)
+{
+  if(s->host == NULL || *s->host == '\0')
+  {
+    return(-1);
+  }
+  if(s->mx == NULL || *s->mx == '\0')
+  {
+    s->mx = ez->ask("mx", 0);
+  }
+  return(s->mx != NULL && *s->mx != '\0' ? 0 : -1);
+}
+
+static struct ez_plugin_service test_plugin_service = {
+  &test_service, test_init, test_check_info
+};
+#endif
+
+int ez_plugin_init(const struct ez_plugin_api *api)
+{
+  ez = api;
+#ifdef OLD_ABI
+  return(api->add_service(&test_service));
+#else
+  // an older ez-ipupdate has no add_plugin_service(), the service then
+  // only gets the generic checks
+  if(api->size < offsetof(struct ez_plugin_api, ask) + sizeof(api->ask))
+  {
+    return(api->add_service(&test_service));
+  }
+  return(api->add_plugin_service(&test_plugin_service));
+#endif
+}
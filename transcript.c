@@ -0,0 +1,490 @@
+/* ============================================================================
+ * Copyright (C) 2001 Angus Mackay. All rights reserved;
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2, or (at your option)
+ * any later version.
+ *
+ * THIS SOFTWARE IS PROVIDED ``AS IS'' AND ANY EXPRESSED OR IMPLIED WARRANTIES,
+ * INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND
+ * FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE
+ * AUTHOR BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY,
+ * OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ * ============================================================================
+ */
+
+#ifdef HAVE_CONFIG_H
+#  include <config.h>
+#endif
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#if HAVE_SYS_TIME_H
+#  include <sys/time.h>
+#endif
+
+#include <transcript.h>
+#include <dprintf.h>
+
+#define TR_MAX_SECRETS 8
+#define TR_HEADER_SIZE 8
+#define TR_RECORD_SIZE 9
+
+static FILE *tr_fp = NULL;
+static struct timeval tr_start;
+static const char *tr_secrets[TR_MAX_SECRETS];
+static int tr_nsecrets = 0;
+
+static struct transcript_session *cur = NULL;
+
+static void put_u32(unsigned char *p, unsigned long v)
+{
+  p[0] = (v >> 24) & 0xff;
+  p[1] = (v >> 16) & 0xff;
+  p[2] = (v >> 8) & 0xff;
+  p[3] = v & 0xff;
+}
+
+static unsigned long get_u32(const unsigned char *p)
+{
+  return(((unsigned long)p[0] << 24) | ((unsigned long)p[1] << 16) |
+      ((unsigned long)p[2] << 8) | (unsigned long)p[3]);
+}
+
+static unsigned long since_start(void)
+{
+  struct timeval now;
+
+  gettimeofday(&now, NULL);
+  return((now.tv_sec - tr_start.tv_sec) * 1000000 +
+      (now.tv_usec - tr_start.tv_usec));
+}
+
+static void write_record(int type, const char *data, int len)
+{
+  unsigned char hdr[TR_RECORD_SIZE];
+
+  hdr[0] = type;
+  put_u32(hdr + 1, since_start());
+  put_u32(hdr + 5, len);
+  fwrite(hdr, 1, sizeof(hdr), tr_fp);
+  if(len > 0)
+  {
+    fwrite(data, 1, len, tr_fp);
+  }
+}
+
+/*
+ * transcript_open
+ *
+ * start appending sessions to path, writing the file header if the file
+ * is new.
+ */
+int transcript_open(const char *path)
+{
+  unsigned char hdr[TR_HEADER_SIZE];
+
+  transcript_close();
+  if((tr_fp=fopen(path, "ab")) == NULL)
+  {
+    return(-1);
+  }
+  fseek(tr_fp, 0, SEEK_END);
+  if(ftell(tr_fp) == 0)
+  {
+    memset(hdr, 0, sizeof(hdr));
+    memcpy(hdr, "EZTR", 4);
+    hdr[4] = TRANSCRIPT_VERSION;
+    fwrite(hdr, 1, sizeof(hdr), tr_fp);
+  }
+  gettimeofday(&tr_start, NULL);
+
+  return(0);
+}
+
+void transcript_close(void)
+{
+  if(tr_fp != NULL)
+  {
+    fclose(tr_fp);
+    tr_fp = NULL;
+  }
+}
+
+int transcript_recording(void)
+{
+  return(tr_fp != NULL);
+}
+
+/*
+ * transcript_secret
+ *
+ * never write what secret holds to the file. the string is looked at each
+ * time something is recorded, so it may be a buffer that changes.
+ */
+void transcript_secret(const char *secret)
+{
+  if(tr_nsecrets < TR_MAX_SECRETS)
+  {
+    tr_secrets[tr_nsecrets++] = secret;
+  }
+}
+
+static void redact(char *buf, int len)
+{
+  char *p;
+  int slen;
+  int i;
+
+  for(i=0; i<tr_nsecrets; i++)
+  {
+    if((slen=strlen(tr_secrets[i])) == 0)
+    {
+      continue;
+    }
+    for(p=buf; p + slen <= buf + len; p++)
+    {
+      if(memcmp(p, tr_secrets[i], slen) == 0)
+      {
+        memset(p, '*', slen);
+        p += slen - 1;
+      }
+    }
+  }
+}
+
+void transcript_begin(const char *service, const char *server,
+    const char *port, const char *host, const char *address,
+    const char *user)
+{
+  const char *fields[6];
+  char buf[1024];
+  int len = 4;
+  int n;
+  int i;
+
+  if(tr_fp == NULL)
+  {
+    return;
+  }
+
+  fields[0] = service;
+  fields[1] = server;
+  fields[2] = port;
+  fields[3] = host;
+  fields[4] = address;
+  fields[5] = user;
+  put_u32((unsigned char *)buf, time(NULL));
+  for(i=0; i<6; i++)
+  {
+    n = strlen(fields[i] ? fields[i] : "") + 1;
+    if(len + n > sizeof(buf))
+    {
+      n = 1;
+    }
+    memcpy(buf + len, fields[i] && n > 1 ? fields[i] : "", n);
+    len += n;
+  }
+
+  gettimeofday(&tr_start, NULL);
+  write_record(TR_BEGIN, buf, len);
+}
+
+void transcript_add(int type, const char *buf, int len)
+{
+  char *copy;
+
+  if(tr_fp == NULL)
+  {
+    return;
+  }
+  if(type != TR_SEND || len == 0)
+  {
+    write_record(type, buf, len);
+    return;
+  }
+  if((copy=malloc(len)) == NULL)
+  {
+    return;
+  }
+  memcpy(copy, buf, len);
+  redact(copy, len);
+  write_record(type, copy, len);
+  free(copy);
+}
+
+void transcript_connect(int result)
+{
+  unsigned char buf[4];
+
+  if(tr_fp == NULL)
+  {
+    return;
+  }
+  put_u32(buf, (unsigned long)result);
+  write_record(TR_CONNECT, (char *)buf, sizeof(buf));
+}
+
+void transcript_end(int result)
+{
+  unsigned char buf[4];
+
+  if(tr_fp == NULL)
+  {
+    return;
+  }
+  put_u32(buf, (unsigned long)result);
+  write_record(TR_END, (char *)buf, sizeof(buf));
+  fflush(tr_fp);
+}
+
+static char *take_string(char **p, char *end)
+{
+  char *s = *p;
+  char *nul;
+
+  if(s >= end || (nul=memchr(s, '\0', end - s)) == NULL)
+  {
+    return(strdup(""));
+  }
+  *p = nul + 1;
+  return(strdup(s));
+}
+
+/*
+ * transcript_load
+ *
+ * read every session in a transcript file. returns NULL if the file can't
+ * be read or is not a transcript.
+ */
+struct transcript_session *transcript_load(const char *path, int *nsessions)
+{
+  struct transcript_session *sessions = NULL;
+  struct transcript_session *s = NULL;
+  struct transcript_record *r;
+  unsigned char *buf;
+  unsigned char *p;
+  unsigned char *end;
+  char *sp;
+  FILE *fp;
+  long size;
+  int n = 0;
+  int type;
+  int len;
+
+  *nsessions = 0;
+  if((fp=fopen(path, "rb")) == NULL)
+  {
+    return(NULL);
+  }
+  fseek(fp, 0, SEEK_END);
+  size = ftell(fp);
+  rewind(fp);
+  if(size < TR_HEADER_SIZE || (buf=malloc(size)) == NULL)
+  {
+    fclose(fp);
+    return(NULL);
+  }
+  if(fread(buf, 1, size, fp) != size || memcmp(buf, "EZTR", 4) != 0 ||
+      buf[4] != TRANSCRIPT_VERSION)
+  {
+    fclose(fp);
+    free(buf);
+    return(NULL);
+  }
+  fclose(fp);
+
+  end = buf + size;
+  for(p=buf + TR_HEADER_SIZE; p + TR_RECORD_SIZE <= end; p += len)
+  {
+    type = p[0];
+    len = get_u32(p + 5);
+    p += TR_RECORD_SIZE;
+    if(len < 0 || p + len > end)
+    {
+      dprintf((stderr, "transcript %s: truncated record\n", path));
+      break;
+    }
+
+    if(type == TR_BEGIN)
+    {
+      if((s=realloc(sessions, (n + 1) * sizeof(*s))) == NULL)
+      {
+        break;
+      }
+      sessions = s;
+      s = &sessions[n++];
+      memset(s, 0, sizeof(*s));
+      s->started = len >= 4 ? (long)get_u32(p) : 0;
+      sp = (char *)p + 4;
+      s->service = take_string(&sp, (char *)p + len);
+      s->server = take_string(&sp, (char *)p + len);
+      s->port = take_string(&sp, (char *)p + len);
+      s->host = take_string(&sp, (char *)p + len);
+      s->address = take_string(&sp, (char *)p + len);
+      s->user = take_string(&sp, (char *)p + len);
+      continue;
+    }
+    if(s == NULL)
+    {
+      continue;
+    }
+    if(type == TR_END)
+    {
+      s->result = len >= 4 ? (int)get_u32(p) : -1;
+      s->complete = 1;
+      s = NULL;
+      continue;
+    }
+
+    if((r=realloc(s->records, (s->nrecords + 1) * sizeof(*r))) == NULL)
+    {
+      break;
+    }
+    s->records = r;
+    r = &s->records[s->nrecords++];
+    r->type = type;
+    r->usec = get_u32(p - TR_RECORD_SIZE + 1);
+    r->len = len;
+    r->data = malloc(len + 1);
+    if(r->data != NULL)
+    {
+      memcpy(r->data, p, len);
+      r->data[len] = '\0';
+    }
+  }
+  free(buf);
+
+  *nsessions = n;
+  return(sessions);
+}
+
+void transcript_free(struct transcript_session *sessions, int nsessions)
+{
+  struct transcript_session *s;
+  int i;
+  int j;
+
+  for(i=0; i<nsessions; i++)
+  {
+    s = &sessions[i];
+    for(j=0; j<s->nrecords; j++)
+    {
+      free(s->records[j].data);
+    }
+    free(s->records);
+    free(s->service);
+    free(s->server);
+    free(s->port);
+    free(s->host);
+    free(s->address);
+    free(s->user);
+  }
+  free(sessions);
+}
+
+/*
+ * transcript_replay
+ *
+ * make session the one the transcript_replay_ functions play back, from
+ * its start.
+ */
+void transcript_replay(struct transcript_session *session)
+{
+  cur = session;
+  cur->pos = 0;
+  cur->off = 0;
+}
+
+static struct transcript_record *next_record(void)
+{
+  if(cur == NULL || cur->pos >= cur->nrecords)
+  {
+    return(NULL);
+  }
+  return(&cur->records[cur->pos]);
+}
+
+/*
+ * returns 0 if the recorded connect worked and -1 if it failed or the
+ * update code has gone somewhere the recording did not
+ */
+int transcript_replay_connect(void)
+{
+  struct transcript_record *r;
+
+  while((r=next_record()) != NULL && r->type != TR_CONNECT)
+  {
+    cur->pos++;
+  }
+  if(r == NULL)
+  {
+    return(-1);
+  }
+  cur->pos++;
+  cur->off = 0;
+  return(r->len >= 4 && get_u32((unsigned char *)r->data) == 0 ? 0 : -1);
+}
+
+/*
+ * what is sent is not checked, the matching record is just skipped
+ */
+int transcript_replay_send(const char *buf, int len)
+{
+  struct transcript_record *r;
+
+  if((r=next_record()) != NULL && r->type == TR_SEND)
+  {
+    cur->pos++;
+  }
+  return(len);
+}
+
+/*
+ * like recv() into a buffer of len bytes that is then NUL terminated:
+ * returns up to len-1 bytes of what was received next, 0 at end of file
+ * and -1 for a recorded failure.
+ */
+int transcript_replay_recv(char *buf, int len)
+{
+  struct transcript_record *r;
+  int n;
+
+  while((r=next_record()) != NULL && r->type == TR_SEND)
+  {
+    cur->pos++;
+  }
+  if(r == NULL || (r->type != TR_RECV && r->type != TR_RECV_FAIL))
+  {
+    *buf = '\0';
+    return(0);
+  }
+  if(r->type == TR_RECV_FAIL)
+  {
+    cur->pos++;
+    return(-1);
+  }
+
+  n = r->len - cur->off;
+  if(n > len - 1)
+  {
+    n = len - 1;
+  }
+  memcpy(buf, r->data + cur->off, n);
+  buf[n] = '\0';
+  cur->off += n;
+  if(cur->off >= r->len)
+  {
+    cur->pos++;
+    cur->off = 0;
+  }
+  return(n);
+}
@@ -0,0 +1,115 @@
+/* ============================================================================
+ * Copyright (C) 2001 Angus Mackay. All rights reserved;
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2, or (at your option)
+ * any later version.
+ *
+ * THIS SOFTWARE IS PROVIDED ``AS IS'' AND ANY EXPRESSED OR IMPLIED WARRANTIES,
+ * INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND
+ * FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE
+ * AUTHOR BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY,
+ * OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ * ============================================================================
+ */
+
+/*
+ * transcript.h
+ *
+ * recording of everything an update says to and hears from the server,
+ * and playing it back to the update code without a network.
+ *
+ * a transcript file is a header followed by records.  all integers are
+ * big endian.
+ *
+ *   header   4  "EZTR"
+ *            1  version, TRANSCRIPT_VERSION
+ *            3  zero
+ *
+ *   record   1  type, TR_*
+ *            4  microseconds since the session began
+ *            4  payload length
+ *            n  payload
+ *
+ * a session is a TR_BEGIN record whose payload is the unix time (4 bytes)
+ * and then the service, server, port, host, address and user name as NUL
+ * terminated strings, the records of the session, and a TR_END whose
+ * payload is the update result (4 bytes, signed).  TR_CONNECT carries 0
+ * or -1 for a failed connect, TR_RECV with no payload is end of file and
+ * TR_RECV_FAIL is a timeout or receive error.
+ *
+ * secrets registered with transcript_secret() are overwritten with '*'
+ * in everything that is sent before it reaches the file.
+ *
+ */
+
+#ifndef _TRANSCRIPT_H
+#define _TRANSCRIPT_H
+
+#define TRANSCRIPT_VERSION 1
+
+enum {
+  TR_BEGIN = 1,
+  TR_CONNECT,
+  TR_SEND,
+  TR_RECV,
+  TR_RECV_FAIL,
+  TR_END,
+};
+
+struct transcript_record
+{
+  int type;
+  unsigned long usec;
+  int len;
+  char *data;
+};
+
+struct transcript_session
+{
+  long started;
+  char *service;
+  char *server;
+  char *port;
+  char *host;
+  char *address;
+  char *user;
+  int result;
+  int complete;
+  int nrecords;
+  struct transcript_record *records;
+
+  // replay position
+  int pos;
+  int off;
+};
+
+// recording
+extern int transcript_open(const char *path);
+extern void transcript_close(void);
+extern int transcript_recording(void);
+extern void transcript_secret(const char *secret);
+extern void transcript_begin(const char *service, const char *server,
+    const char *port, const char *host, const char *address,
+    const char *user);
+extern void transcript_add(int type, const char *buf, int len);
+extern void transcript_connect(int result);
+extern void transcript_end(int result);
+
+// replay
+extern struct transcript_session *transcript_load(const char *path,
+    int *nsessions);
+extern void transcript_free(struct transcript_session *sessions,
+    int nsessions);
+extern void transcript_replay(struct transcript_session *session);
+extern int transcript_replay_connect(void);
+extern int transcript_replay_send(const char *buf, int len);
+extern int transcript_replay_recv(char *buf, int len);
+
+#endif
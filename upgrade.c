@@ -0,0 +1,287 @@
+/* ============================================================================
+ * Copyright (C) 2001 Angus Mackay. All rights reserved; 
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2, or (at your option)
+ * any later version.
+ *
+ * THIS SOFTWARE IS PROVIDED ``AS IS'' AND ANY EXPRESSED OR IMPLIED WARRANTIES,
+ * INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND
+ * FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE
+ * AUTHOR BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY,
+ * OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ * ============================================================================
+ */
+
+/*
+ * upgrade.c
+ *
+ * the daemon upgrades itself by exec()ing its own command line again,
+ * which keeps its pid.  what it had in memory goes along in the
+ * environment as "key=value" pairs separated by spaces, with anything
+ * that isn't printable (or is a space, '=' or '%') written as %XX, and the
+ * descriptors it listens on stay open across the exec with their numbers
+ * in the state.  the new process finds it with upgrade_resume().
+ *
+ */
+
+#ifdef HAVE_CONFIG_H
+#  include <config.h>
+#endif
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <ctype.h>
+#include <unistd.h>
+#include <fcntl.h>
+#if HAVE_STDARG_H
+#  include <stdarg.h>
+#endif
+#if HAVE_ERRNO_H
+#  include <errno.h>
+#endif
+
+#include <dprintf.h>
+#include <upgrade.h>
+
+#define MAX_UPGRADE_KEYS 32
+#define MAX_UPGRADE_FDS 8
+#define UPGRADE_STATE_SIZE 4096
+
+static char state[UPGRADE_STATE_SIZE];
+static int state_len = 0;
+static int passed_fds[MAX_UPGRADE_FDS];
+static int npassed_fds = 0;
+
+static struct
+{
+  char *key;
+  char *value;
+} resumed[MAX_UPGRADE_KEYS];
+static int nresumed = 0;
+
+static void state_char(char c)
+{
+  if(state_len < sizeof(state) - 1)
+  {
+    state[state_len++] = c;
+    state[state_len] = '\0';
+  }
+}
+
+static void state_escaped(char *s)
+{
+  static char hex[] = "0123456789ABCDEF";
+
+  for(; *s != '\0'; s++)
+  {
+    if(isgraph((unsigned char)*s) && *s != '=' && *s != '%')
+    {
+      state_char(*s);
+    }
+    else
+    {
+      state_char('%');
+      state_char(hex[(unsigned char)*s >> 4]);
+      state_char(hex[(unsigned char)*s & 0xf]);
+    }
+  }
+}
+
+/*
+ * upgrade_put
+ *
+ * add key, set to the printf style value, to the state to hand over
+ */
+void upgrade_put(char *key, char *fmt, ...)
+{
+  char value[512];
+  va_list args;
+
+  va_start(args, fmt);
+  vsnprintf(value, sizeof(value), fmt, args);
+  va_end(args);
+
+  if(state_len > 0)
+  {
+    state_char(' ');
+  }
+  state_escaped(key);
+  state_char('=');
+  state_escaped(value);
+}
+
+/*
+ * upgrade_put_fd
+ *
+ * hand fd over as key, it is kept open across the exec
+ */
+void upgrade_put_fd(char *key, int fd)
+{
+  if(fd == -1 || npassed_fds >= MAX_UPGRADE_FDS)
+  {
+    return;
+  }
+  fcntl(fd, F_SETFD, 0);
+  passed_fds[npassed_fds++] = fd;
+  upgrade_put(key, "%d", fd);
+}
+
+/*
+ * upgrade_exec
+ *
+ * exec argv with the state. only returns, with -1, if that failed, in
+ * which case the state is thrown away and the descriptors are closed on
+ * exec again.
+ */
+int upgrade_exec(char **argv)
+{
+  int err;
+  int i;
+
+  dprintf((stderr, "upgrading with state: %s\n", state));
+  if(setenv(UPGRADE_ENV, state, 1) == 0)
+  {
+    execvp(argv[0], argv);
+  }
+  err = errno;
+
+  unsetenv(UPGRADE_ENV);
+  for(i=0; i<npassed_fds; i++)
+  {
+    fcntl(passed_fds[i], F_SETFD, FD_CLOEXEC);
+  }
+  npassed_fds = 0;
+  state_len = 0;
+  state[0] = '\0';
+  errno = err;
+
+  return(-1);
+}
+
+static int hex_value(char c)
+{
+  if(c >= '0' && c <= '9') { return(c - '0'); }
+  if(c >= 'A' && c <= 'F') { return(c - 'A' + 10); }
+  if(c >= 'a' && c <= 'f') { return(c - 'a' + 10); }
+  return(-1);
+}
+
+/* undo state_escaped() in place */
+static void unescape(char *s)
+{
+  char *out = s;
+
+  for(; *s != '\0'; s++)
+  {
+    if(*s == '%' && hex_value(s[1]) != -1 && hex_value(s[2]) != -1)
+    {
+      *out++ = hex_value(s[1]) * 16 + hex_value(s[2]);
+      s += 2;
+    }
+    else
+    {
+      *out++ = *s;
+    }
+  }
+  *out = '\0';
+}
+
+/*
+ * upgrade_resume
+ *
+ * returns 1 if this process was started by upgrade_exec(), after which
+ * upgrade_get() and friends give what was handed over.  the state is taken
+ * out of the environment so that hooks and later upgrades don't see it.
+ */
+int upgrade_resume(void)
+{
+  char *env;
+  char *copy;
+  char *p;
+  char *eq;
+
+  if((env=getenv(UPGRADE_ENV)) == NULL)
+  {
+    return(0);
+  }
+  if((copy=strdup(env)) == NULL)
+  {
+    return(0);
+  }
+  unsetenv(UPGRADE_ENV);
+
+  for(p=strtok(copy, " "); p != NULL && nresumed < MAX_UPGRADE_KEYS;
+      p=strtok(NULL, " "))
+  {
+    if((eq=strchr(p, '=')) == NULL)
+    {
+      continue;
+    }
+    *eq = '\0';
+    unescape(p);
+    unescape(eq + 1);
+    resumed[nresumed].key = p;
+    resumed[nresumed].value = eq + 1;
+    nresumed++;
+  }
+
+  return(1);
+}
+
+/*
+ * upgrade_get
+ *
+ * the value handed over as key, or NULL
+ */
+char *upgrade_get(char *key)
+{
+  int i;
+
+  for(i=0; i<nresumed; i++)
+  {
+    if(strcmp(resumed[i].key, key) == 0)
+    {
+      return(resumed[i].value);
+    }
+  }
+  return(NULL);
+}
+
+long upgrade_get_long(char *key, long def)
+{
+  char *value;
+
+  if((value=upgrade_get(key)) == NULL || *value == '\0')
+  {
+    return(def);
+  }
+  return(strtol(value, NULL, 10));
+}
+
+/*
+ * upgrade_get_fd
+ *
+ * the descriptor handed over as key, or -1. it is closed on exec again from
+ * here on.
+ */
+int upgrade_get_fd(char *key)
+{
+  int fd;
+
+  fd = upgrade_get_long(key, -1);
+  if(fd < 0 || fcntl(fd, F_GETFD) == -1)
+  {
+    return(-1);
+  }
+  fcntl(fd, F_SETFD, FD_CLOEXEC);
+
+  return(fd);
+}